@@ -25,7 +25,6 @@ BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, uint32_t
     : pool_size_(pool_size),
       num_instances_(num_instances),
       instance_index_(instance_index),
-      next_page_id_(instance_index),
       disk_manager_(disk_manager),
       log_manager_(log_manager) {
   BUSTUB_ASSERT(num_instances > 0, "If BPI is not part of a pool, then the pool size should just be 1");
@@ -54,7 +53,7 @@ auto BufferPoolManagerInstance::FlushPgImp(page_id_t page_id) -> bool {
     return false;
   }
   if (pages_[page_table_[page_id]].is_dirty_) {
-    disk_manager_->WritePage(page_id, pages_[page_table_[page_id]].data_);
+    WritePage(&pages_[page_table_[page_id]]);
     pages_[page_table_[page_id]].is_dirty_ = false;
   }
   return true;
@@ -65,7 +64,7 @@ void BufferPoolManagerInstance::FlushAllPgsImp() {
   // You can do it!
   for (auto &it : page_table_) {
     if (pages_[it.second].is_dirty_) {
-      disk_manager_->WritePage(it.first, pages_[it.second].data_);
+      WritePage(&pages_[it.second]);
       pages_[it.second].is_dirty_ = false;
     }
   }
@@ -84,7 +83,7 @@ auto BufferPoolManagerInstance::NewPgImp(page_id_t *page_id) -> Page * {
   } else if (replacer_->Victim(&victim_page)) {
     assert(victim_page != INVALID_PAGE_ID);
     if (pages_[victim_page].is_dirty_) {
-      disk_manager_->WritePage(pages_[victim_page].page_id_, pages_[victim_page].data_);
+      WritePage(&pages_[victim_page]);
     }
     page_table_.erase(pages_[victim_page].page_id_);
   } else {
@@ -99,6 +98,7 @@ auto BufferPoolManagerInstance::NewPgImp(page_id_t *page_id) -> Page * {
   pages_[victim_page].page_id_ = *page_id;
   pages_[victim_page].is_dirty_ = false;
   pages_[victim_page].pin_count_ = 1;
+  pages_[victim_page].rec_offset_ = NextLogOffset();
 
   replacer_->Pin(victim_page);
 
@@ -130,7 +130,7 @@ auto BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) -> Page * {
   }
   // 2.     If R is dirty, write it back to the disk.
   if (pages_[replacement_page].is_dirty_) {
-    disk_manager_->WritePage(pages_[replacement_page].page_id_, pages_[replacement_page].data_);
+    WritePage(&pages_[replacement_page]);
   }
   // 3.     Delete R from the page table and insert P.
   page_table_.erase(pages_[replacement_page].page_id_);
@@ -141,6 +141,7 @@ auto BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) -> Page * {
   pages_[replacement_page].page_id_ = page_id;
   pages_[replacement_page].is_dirty_ = false;
   pages_[replacement_page].pin_count_ = 1;
+  pages_[replacement_page].rec_offset_ = NextLogOffset();
   disk_manager_->ReadPage(page_id, pages_[replacement_page].data_);
   replacer_->Pin(replacement_page);
   return &pages_[replacement_page];
@@ -154,15 +155,18 @@ auto BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) -> bool {
   // 2.   If P exists, but has a non-zero pin-count, return false. Someone is using the page.
   // 3.   Otherwise, P can be deleted. Remove P from the page table, reset its metadata and return it to the free list.
   if (page_table_.find(page_id) == page_table_.end()) {
+    DeallocatePage(page_id);
     return true;
   }
   if (pages_[page_table_[page_id]].pin_count_ != 0) {
     return false;
   }
+  // The frame goes back to the free list, so the replacer must no longer consider it a victim
+  replacer_->Pin(page_table_[page_id]);
   pages_[page_table_[page_id]].ResetMemory();
   pages_[page_table_[page_id]].page_id_ = INVALID_PAGE_ID;
   pages_[page_table_[page_id]].is_dirty_ = false;
-  pages_[page_table_[page_id]].pin_count_ = 1;
+  pages_[page_table_[page_id]].pin_count_ = 0;
 
   free_list_.emplace_back(page_table_[page_id]);
   page_table_.erase(page_id);
@@ -187,9 +191,36 @@ auto BufferPoolManagerInstance::UnpinPgImp(page_id_t page_id, bool is_dirty) ->
   return true;
 }
 
+void BufferPoolManagerInstance::WritePage(Page *page) {
+  // Write-ahead logging: the log must be durable up to the last change of a page before the page is written. This
+  // holds for the compensations recovery logs before logging is enabled, too
+  if (log_manager_ != nullptr && page->GetLSN() > log_manager_->GetPersistentLSN()) {
+    log_manager_->Flush(page->GetLSN());
+  }
+  // Changes logged from here on may be missing from the image written
+  int rec_offset = NextLogOffset();
+  disk_manager_->WritePage(page->page_id_, page->data_);
+  page->rec_offset_ = rec_offset;
+}
+
+auto BufferPoolManagerInstance::NextLogOffset() -> int {
+  return enable_logging && log_manager_ != nullptr ? log_manager_->GetNextOffset() : 0;
+}
+
+auto BufferPoolManagerInstance::GetDirtyPageTable() -> std::vector<DirtyPageEntry> {
+  std::scoped_lock scoped_buffer_pool_manager_latch(buffer_pool_manager_latch_);
+  std::vector<DirtyPageEntry> dirty_pages;
+  for (auto &it : page_table_) {
+    // A pinned page may be changed before it is unpinned dirty
+    if (pages_[it.second].is_dirty_ || pages_[it.second].pin_count_ > 0) {
+      dirty_pages.push_back({it.first, pages_[it.second].rec_offset_});
+    }
+  }
+  return dirty_pages;
+}
+
 auto BufferPoolManagerInstance::AllocatePage() -> page_id_t {
-  const page_id_t next_page_id = next_page_id_;
-  next_page_id_ += num_instances_;
+  const page_id_t next_page_id = disk_manager_->AllocatePage(num_instances_, instance_index_);
   ValidatePageId(next_page_id);
   return next_page_id;
 }
@@ -49,6 +49,15 @@ auto ParallelBufferPoolManager::GetPoolSize() -> size_t {
   return num_instances_ * pool_size_;
 }
 
+auto ParallelBufferPoolManager::GetDirtyPageTable() -> std::vector<DirtyPageEntry> {
+  std::vector<DirtyPageEntry> dirty_pages;
+  for (auto *buffer_pool : buffer_pools_) {
+    auto instance_pages = buffer_pool->GetDirtyPageTable();
+    dirty_pages.insert(dirty_pages.end(), instance_pages.begin(), instance_pages.end());
+  }
+  return dirty_pages;
+}
+
 auto ParallelBufferPoolManager::GetBufferPoolManager(page_id_t page_id) -> BufferPoolManager * {
   // Get BufferPoolManager responsible for handling given page id. You can use this method in your other methods.
   return buffer_pools_[page_id % num_instances_];
@@ -12,31 +12,629 @@
 
 #include "concurrency/lock_manager.h"
 
+#include <functional>
 #include <utility>
 #include <vector>
 
+#include "common/macros.h"
+
 namespace bustub {
 
-auto LockManager::LockShared(Transaction *txn, const RID &rid) -> bool {
-  txn->GetSharedLockSet()->emplace(rid);
+/**
+ * COMPATIBLE[a][b] tells whether locks in modes a and b can be held by different transactions at once, in the order
+ * IS, IX, S, SIX, X.
+ */
+static constexpr bool COMPATIBLE[5][5] = {{true, true, true, true, false},
+                                          {true, true, false, false, false},
+                                          {true, false, true, false, false},
+                                          {true, false, false, false, false},
+                                          {false, false, false, false, false}};
+
+auto LockManager::AreCompatible(LockMode first, LockMode second) -> bool {
+  return COMPATIBLE[static_cast<int>(first)][static_cast<int>(second)];
+}
+
+auto LockManager::Covers(LockMode held, LockMode wanted) -> bool {
+  switch (held) {
+    case LockMode::INTENTION_SHARED:
+      return wanted == LockMode::INTENTION_SHARED;
+    case LockMode::INTENTION_EXCLUSIVE:
+      return wanted == LockMode::INTENTION_SHARED || wanted == LockMode::INTENTION_EXCLUSIVE;
+    case LockMode::SHARED:
+      return wanted == LockMode::INTENTION_SHARED || wanted == LockMode::SHARED;
+    case LockMode::SHARED_INTENTION_EXCLUSIVE:
+      return wanted != LockMode::EXCLUSIVE;
+    case LockMode::EXCLUSIVE:
+      return true;
+  }
+  return false;
+}
+
+auto LockManager::Combine(LockMode first, LockMode second) -> LockMode {
+  if (Covers(first, second)) {
+    return first;
+  }
+  if (Covers(second, first)) {
+    return second;
+  }
+  // The remaining pairs are SHARED with INTENTION_EXCLUSIVE, and SHARED_INTENTION_EXCLUSIVE needs neither covered
+  return LockMode::SHARED_INTENTION_EXCLUSIVE;
+}
+
+LockManager::LockManager(DeadlockPolicy policy, uint32_t escalation_threshold)
+    : policy_(policy), escalation_threshold_(escalation_threshold) {
+  if (policy_ == DeadlockPolicy::DETECTION) {
+    enable_cycle_detection_ = true;
+    cycle_detection_thread_ = new std::thread(&LockManager::RunCycleDetection, this);
+  }
+}
+
+LockManager::~LockManager() {
+  if (cycle_detection_thread_ != nullptr) {
+    {
+      std::scoped_lock lock(detection_latch_);
+      enable_cycle_detection_ = false;
+    }
+    detection_cv_.notify_one();
+    cycle_detection_thread_->join();
+    delete cycle_detection_thread_;
+    cycle_detection_thread_ = nullptr;
+  }
+}
+
+void LockManager::AbortImplicitly(Transaction *txn, AbortReason reason) {
+  txn->SetState(TransactionState::ABORTED);
+  throw TransactionAbortException(txn->GetTransactionId(), reason);
+}
+
+auto LockManager::Refuse(Transaction *txn, AbortReason reason, bool wait) -> bool {
+  if (wait) {
+    AbortImplicitly(txn, reason);
+  }
+  return false;
+}
+
+auto LockManager::AcquireQueue(LockKey key, std::list<LockRequest> *request, Transaction *txn, LockMode mode)
+    -> LockRequestQueue * {
+  auto &shard = GetShard(key);
+  std::scoped_lock lock(shard.latch_);
+  if (request != nullptr) {
+    if (shard.free_requests_.empty()) {
+      request->emplace_back(txn, mode);
+    } else {
+      request->splice(request->end(), shard.free_requests_, shard.free_requests_.begin());
+      request->back() = LockRequest(txn, mode);
+    }
+  }
+  auto &queue = shard.queues_[key];
+  queue.users_++;
+  return &queue;
+}
+
+void LockManager::ReleaseQueue(LockKey key, LockRequestQueue *queue, std::list<LockRequest> *freed) {
+  auto &shard = GetShard(key);
+  std::scoped_lock lock(shard.latch_);
+  shard.free_requests_.splice(shard.free_requests_.end(), *freed);
+  // Every thread that touches the queue is a user, so an unused queue is not latched
+  if (--queue->users_ == 0 && queue->request_queue_.empty()) {
+    shard.queues_.erase(key);
+  }
+}
+
+auto LockManager::Acquire(Transaction *txn, LockKey key, LockMode mode, const LockMode *held, bool wait) -> bool {
+  std::list<LockRequest> request;
+  auto *queue = AcquireQueue(key, held == nullptr ? &request : nullptr, txn, mode);
+  bool granted = false;
+  bool conflict = false;
+  {
+    std::unique_lock lock(queue->latch_);
+    auto &requests = queue->request_queue_;
+    if (held == nullptr) {
+      requests.splice(requests.end(), request);
+      if (wait) {
+        granted = WaitForGrant(&lock, queue, txn, key);
+      } else if (IsGrantable(*queue, requests.back())) {
+        requests.back().granted_ = true;
+        granted = true;
+      }
+      if (!granted) {
+        RemoveRequest(queue, txn->GetTransactionId(), &request);
+      }
+    } else {
+      // The held request takes the new mode ahead of every waiting request, so it is granted as soon as the other
+      // holders allow, and no request behind it is granted in the meantime
+      auto upgrade = std::find_if(requests.begin(), requests.end(), [&](const LockRequest &r) {
+        return r.txn_id_ == txn->GetTransactionId();
+      });
+      BUSTUB_ASSERT(upgrade != requests.end(), "the held lock is not in the queue");
+      auto pos = std::find_if(requests.begin(), requests.end(), [](const LockRequest &r) { return !r.granted_; });
+      requests.splice(pos, requests, upgrade);
+      upgrade->lock_mode_ = mode;
+      upgrade->granted_ = false;
+      if (IsGrantable(*queue, *upgrade)) {
+        upgrade->granted_ = true;
+        granted = true;
+      } else if (!wait) {
+        // Given up; the held lock is restored below
+      } else if (queue->upgrading_ != INVALID_TXN_ID) {
+        // Two upgrades that have to wait would wait for each other
+        conflict = true;
+      } else {
+        queue->upgrading_ = txn->GetTransactionId();
+        granted = WaitForGrant(&lock, queue, txn, key);
+        queue->upgrading_ = INVALID_TXN_ID;
+      }
+      if (!granted) {
+        // The request still sits behind the granted ones only, so the held lock is kept
+        upgrade->lock_mode_ = *held;
+        upgrade->granted_ = true;
+        queue->cv_.notify_all();
+      }
+    }
+  }
+  ReleaseQueue(key, queue, &request);
+  if (conflict) {
+    AbortImplicitly(txn, AbortReason::UPGRADE_CONFLICT);
+  }
+  return granted;
+}
+
+void LockManager::Release(Transaction *txn, LockKey key) {
+  std::list<LockRequest> freed;
+  auto *queue = AcquireQueue(key, nullptr, txn, LockMode::SHARED);
+  {
+    std::scoped_lock lock(queue->latch_);
+    RemoveRequest(queue, txn->GetTransactionId(), &freed);
+  }
+  ReleaseQueue(key, queue, &freed);
+}
+
+void LockManager::ShrinkOnUnlock(Transaction *txn, LockMode mode) {
+  // Releasing a lock ends the growing phase, except for the shared locks READ_COMMITTED releases after each read
+  bool shared = mode == LockMode::SHARED || mode == LockMode::INTENTION_SHARED;
+  if (txn->GetState() == TransactionState::GROWING &&
+      !(shared && txn->GetIsolationLevel() == IsolationLevel::READ_COMMITTED)) {
+    txn->SetState(TransactionState::SHRINKING);
+  }
+}
+
+auto LockManager::GetPageMode(Transaction *txn, page_id_t page_id) -> const LockMode * {
+  auto page_locks = txn->GetPageLockSet();
+  auto lock = page_locks->find(page_id);
+  return lock == page_locks->end() ? nullptr : &lock->second;
+}
+
+auto LockManager::LockPage(Transaction *txn, page_id_t page_id, LockMode mode, bool wait) -> bool {
+  const auto *held = GetPageMode(txn, page_id);
+  if (held != nullptr && Covers(*held, mode)) {
+    return true;
+  }
+  auto target = held == nullptr ? mode : Combine(*held, mode);
+  if (!Acquire(txn, PageKey(page_id), target, held, wait)) {
+    return false;
+  }
+  (*txn->GetPageLockSet())[page_id] = target;
   return true;
 }
 
-auto LockManager::LockExclusive(Transaction *txn, const RID &rid) -> bool {
-  txn->GetExclusiveLockSet()->emplace(rid);
+auto LockManager::CountRowLock(Transaction *txn, page_id_t page_id, LockMode mode, bool wait) -> bool {
+  auto &count = (*txn->GetPageRowLockCounts())[page_id];
+  if (++count <= escalation_threshold_) {
+    return true;
+  }
+  // Lock the whole page, in exclusive mode if any row on it is, and drop the row locks the page lock now covers
+  auto &exclusive_rows = *txn->GetExclusiveLockSet();
+  bool exclusive = mode == LockMode::EXCLUSIVE ||
+                   std::any_of(exclusive_rows.begin(), exclusive_rows.end(),
+                               [&](const RID &rid) { return rid.GetPageId() == page_id; });
+  if (!LockPage(txn, page_id, exclusive ? LockMode::EXCLUSIVE : LockMode::SHARED, wait)) {
+    // The row lock is granted either way; one that may not wait keeps the row locks for a later row to escalate
+    return !wait && txn->GetState() != TransactionState::ABORTED;
+  }
+  auto page_mode = *GetPageMode(txn, page_id);
+  std::vector<RID> covered;
+  for (const auto &rid : *txn->GetSharedLockSet()) {
+    if (rid.GetPageId() == page_id) {
+      covered.push_back(rid);
+    }
+  }
+  if (page_mode == LockMode::EXCLUSIVE) {
+    for (const auto &rid : exclusive_rows) {
+      if (rid.GetPageId() == page_id) {
+        covered.push_back(rid);
+      }
+    }
+  }
+  for (const auto &rid : covered) {
+    Release(txn, RowKey(rid));
+    txn->GetSharedLockSet()->erase(rid);
+    exclusive_rows.erase(rid);
+  }
+  count -= covered.size();
+  if (count == 0) {
+    txn->GetPageRowLockCounts()->erase(page_id);
+  }
   return true;
 }
 
-auto LockManager::LockUpgrade(Transaction *txn, const RID &rid) -> bool {
+auto LockManager::LockShared(Transaction *txn, const RID &rid) -> bool { return LockRowShared(txn, rid, true); }
+
+auto LockManager::LockExclusive(Transaction *txn, const RID &rid) -> bool { return LockRowExclusive(txn, rid, true); }
+
+auto LockManager::LockUpgrade(Transaction *txn, const RID &rid) -> bool { return UpgradeRow(txn, rid, true); }
+
+auto LockManager::TryLockShared(Transaction *txn, const RID &rid) -> bool { return LockRowShared(txn, rid, false); }
+
+auto LockManager::TryLockExclusive(Transaction *txn, const RID &rid) -> bool {
+  return LockRowExclusive(txn, rid, false);
+}
+
+auto LockManager::LockRowShared(Transaction *txn, const RID &rid, bool wait) -> bool {
+  if (txn->GetState() == TransactionState::ABORTED) {
+    return false;
+  }
+  if (txn->GetIsolationLevel() == IsolationLevel::READ_UNCOMMITTED) {
+    return Refuse(txn, AbortReason::LOCKSHARED_ON_READ_UNCOMMITTED, wait);
+  }
+  if (txn->GetState() == TransactionState::SHRINKING) {
+    return Refuse(txn, AbortReason::LOCK_ON_SHRINKING, wait);
+  }
+  if (txn->IsSharedLocked(rid) || txn->IsExclusiveLocked(rid)) {
+    return true;
+  }
+  const auto *page_mode = GetPageMode(txn, rid.GetPageId());
+  if (page_mode != nullptr && Covers(*page_mode, LockMode::SHARED)) {
+    return true;
+  }
+  if (!LockPage(txn, rid.GetPageId(), LockMode::INTENTION_SHARED, wait) ||
+      !Acquire(txn, RowKey(rid), LockMode::SHARED, nullptr, wait)) {
+    return false;
+  }
+  txn->GetSharedLockSet()->emplace(rid);
+  return CountRowLock(txn, rid.GetPageId(), LockMode::SHARED, wait);
+}
+
+auto LockManager::LockRowExclusive(Transaction *txn, const RID &rid, bool wait) -> bool {
+  if (txn->GetState() == TransactionState::ABORTED) {
+    return false;
+  }
+  if (txn->GetState() == TransactionState::SHRINKING) {
+    return Refuse(txn, AbortReason::LOCK_ON_SHRINKING, wait);
+  }
+  if (txn->IsExclusiveLocked(rid) || txn->IsPageExclusiveLocked(rid.GetPageId())) {
+    return true;
+  }
+  if (txn->IsSharedLocked(rid)) {
+    return UpgradeRow(txn, rid, wait);
+  }
+  if (!LockPage(txn, rid.GetPageId(), LockMode::INTENTION_EXCLUSIVE, wait) ||
+      !Acquire(txn, RowKey(rid), LockMode::EXCLUSIVE, nullptr, wait)) {
+    return false;
+  }
+  txn->GetExclusiveLockSet()->emplace(rid);
+  return CountRowLock(txn, rid.GetPageId(), LockMode::EXCLUSIVE, wait);
+}
+
+auto LockManager::UpgradeRow(Transaction *txn, const RID &rid, bool wait) -> bool {
+  if (txn->GetState() == TransactionState::ABORTED) {
+    return false;
+  }
+  if (txn->GetState() == TransactionState::SHRINKING) {
+    return Refuse(txn, AbortReason::LOCK_ON_SHRINKING, wait);
+  }
+  if (txn->IsExclusiveLocked(rid) || txn->IsPageExclusiveLocked(rid.GetPageId())) {
+    return true;
+  }
+  if (!txn->IsSharedLocked(rid)) {
+    return LockRowExclusive(txn, rid, wait);
+  }
+  if (!LockPage(txn, rid.GetPageId(), LockMode::INTENTION_EXCLUSIVE, wait)) {
+    return false;
+  }
+  auto held = LockMode::SHARED;
+  if (!Acquire(txn, RowKey(rid), LockMode::EXCLUSIVE, &held, wait)) {
+    return false;
+  }
   txn->GetSharedLockSet()->erase(rid);
   txn->GetExclusiveLockSet()->emplace(rid);
   return true;
 }
 
 auto LockManager::Unlock(Transaction *txn, const RID &rid) -> bool {
-  txn->GetSharedLockSet()->erase(rid);
-  txn->GetExclusiveLockSet()->erase(rid);
+  bool shared = txn->GetSharedLockSet()->erase(rid) != 0;
+  bool exclusive = txn->GetExclusiveLockSet()->erase(rid) != 0;
+  if (!shared && !exclusive) {
+    return false;
+  }
+  Release(txn, RowKey(rid));
+  auto page_id = rid.GetPageId();
+  auto counts = txn->GetPageRowLockCounts();
+  auto count = counts->find(page_id);
+  if (count != counts->end() && --count->second == 0) {
+    counts->erase(count);
+    // A READ_COMMITTED reader gives back the intention lock of its last row on the page as well
+    const auto *page_mode = GetPageMode(txn, page_id);
+    if (shared && txn->GetIsolationLevel() == IsolationLevel::READ_COMMITTED && page_mode != nullptr &&
+        *page_mode == LockMode::INTENTION_SHARED) {
+      Release(txn, PageKey(page_id));
+      txn->GetPageLockSet()->erase(page_id);
+    }
+  }
+  ShrinkOnUnlock(txn, shared ? LockMode::SHARED : LockMode::EXCLUSIVE);
+  return true;
+}
+
+auto LockManager::UnlockPage(Transaction *txn, page_id_t page_id) -> bool {
+  auto page_locks = txn->GetPageLockSet();
+  auto lock = page_locks->find(page_id);
+  if (lock == page_locks->end()) {
+    return false;
+  }
+  auto mode = lock->second;
+  page_locks->erase(lock);
+  txn->GetPageRowLockCounts()->erase(page_id);
+  Release(txn, PageKey(page_id));
+  ShrinkOnUnlock(txn, mode);
+  return true;
+}
+
+auto LockManager::LockTable(Transaction *txn, LockMode mode, table_oid_t oid) -> bool {
+  if (txn->GetState() == TransactionState::ABORTED) {
+    return false;
+  }
+  if (txn->GetIsolationLevel() == IsolationLevel::READ_UNCOMMITTED && mode != LockMode::INTENTION_EXCLUSIVE &&
+      mode != LockMode::EXCLUSIVE) {
+    AbortImplicitly(txn, AbortReason::LOCKSHARED_ON_READ_UNCOMMITTED);
+  }
+  if (txn->GetState() == TransactionState::SHRINKING) {
+    AbortImplicitly(txn, AbortReason::LOCK_ON_SHRINKING);
+  }
+  auto table_locks = txn->GetTableLockSet();
+  auto lock = table_locks->find(oid);
+  const auto *held = lock == table_locks->end() ? nullptr : &lock->second;
+  if (held != nullptr && Covers(*held, mode)) {
+    return true;
+  }
+  auto target = held == nullptr ? mode : Combine(*held, mode);
+  if (!Acquire(txn, TableKey(oid), target, held)) {
+    return false;
+  }
+  (*table_locks)[oid] = target;
   return true;
 }
 
+auto LockManager::UnlockTable(Transaction *txn, table_oid_t oid) -> bool {
+  auto table_locks = txn->GetTableLockSet();
+  auto lock = table_locks->find(oid);
+  if (lock == table_locks->end()) {
+    return false;
+  }
+  auto mode = lock->second;
+  table_locks->erase(lock);
+  Release(txn, TableKey(oid));
+  ShrinkOnUnlock(txn, mode);
+  return true;
+}
+
+void LockManager::RemoveRequest(LockRequestQueue *queue, txn_id_t txn_id, std::list<LockRequest> *freed) {
+  auto &requests = queue->request_queue_;
+  auto request = std::find_if(requests.begin(), requests.end(), [&](const LockRequest &r) {
+    return r.txn_id_ == txn_id;
+  });
+  if (request == requests.end()) {
+    return;
+  }
+  freed->splice(freed->end(), requests, request);
+  queue->cv_.notify_all();
+}
+
+auto LockManager::IsGrantable(const LockRequestQueue &queue, const LockRequest &request) const -> bool {
+  // Granted requests can sit behind waiting ones, e.g. an INTENTION_SHARED request granted behind a waiting SHARED
+  // one, and an upgrade moves ahead of the waiting requests only, so it must not pass over such holders
+  bool ahead = true;
+  for (const auto &other : queue.request_queue_) {
+    if (&other == &request) {
+      ahead = false;
+    } else if ((ahead || other.granted_) && !AreCompatible(request.lock_mode_, other.lock_mode_)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+auto LockManager::WaitForGrant(std::unique_lock<std::mutex> *lock, LockRequestQueue *queue, Transaction *txn,
+                               LockKey key) -> bool {
+  auto request = std::find_if(queue->request_queue_.begin(), queue->request_queue_.end(), [&](const LockRequest &r) {
+    return r.txn_id_ == txn->GetTransactionId() && !r.granted_;
+  });
+  BUSTUB_ASSERT(request != queue->request_queue_.end(), "the request is not in the queue");
+  while (txn->GetState() != TransactionState::ABORTED && !IsGrantable(*queue, *request)) {
+    if (policy_ == DeadlockPolicy::WOUND_WAIT) {
+      auto wounded = Wound(queue, *request);
+      if (!wounded.empty()) {
+        // The wounded may wait in other queues, whose latches are not taken under this one
+        lock->unlock();
+        for (auto victim : wounded) {
+          WakeUp(victim);
+        }
+        lock->lock();
+        continue;
+      }
+    }
+    {
+      // An abort by another thread either comes before this check or sees the transaction waiting
+      std::scoped_lock waiting_lock(waiting_latch_);
+      if (txn->GetState() == TransactionState::ABORTED) {
+        break;
+      }
+      waiting_for_[txn->GetTransactionId()] = key;
+    }
+    queue->cv_.wait(*lock);
+    std::scoped_lock waiting_lock(waiting_latch_);
+    waiting_for_.erase(txn->GetTransactionId());
+  }
+  if (txn->GetState() == TransactionState::ABORTED) {
+    return false;
+  }
+  request->granted_ = true;
+  return true;
+}
+
+auto LockManager::Wound(LockRequestQueue *queue, const LockRequest &request) -> std::vector<txn_id_t> {
+  std::vector<txn_id_t> wounded;
+  for (auto &ahead : queue->request_queue_) {
+    if (&ahead == &request) {
+      break;
+    }
+    bool conflicts = !AreCompatible(request.lock_mode_, ahead.lock_mode_);
+    // A wounded holder keeps its lock until it notices and aborts; a wounded waiter gives up its request
+    if (conflicts && ahead.txn_id_ > request.txn_id_ && AbortTransaction(ahead.txn_, ahead.txn_id_, nullptr)) {
+      wounded.push_back(ahead.txn_id_);
+    }
+  }
+  return wounded;
+}
+
+auto LockManager::AbortTransaction(Transaction *txn, txn_id_t txn_id, const LockKey *key) -> bool {
+  std::scoped_lock lock(waiting_latch_);
+  if (key != nullptr) {
+    // Only a waiting transaction is sure to still exist
+    auto waiting = waiting_for_.find(txn_id);
+    if (waiting == waiting_for_.end() || waiting->second != *key) {
+      return false;
+    }
+  }
+  if (txn->GetState() == TransactionState::ABORTED) {
+    return false;
+  }
+  txn->SetState(TransactionState::ABORTED);
+  return true;
+}
+
+void LockManager::WakeUp(txn_id_t txn_id) {
+  LockKey key;
+  {
+    std::scoped_lock lock(waiting_latch_);
+    auto waiting = waiting_for_.find(txn_id);
+    if (waiting == waiting_for_.end()) {
+      return;
+    }
+    key = waiting->second;
+  }
+  // The waiter holds its queue latch from registering until it sleeps, so the notification cannot come too early
+  auto &shard = GetShard(key);
+  std::scoped_lock shard_lock(shard.latch_);
+  auto queue = shard.queues_.find(key);
+  if (queue != shard.queues_.end()) {
+    std::scoped_lock queue_lock(queue->second.latch_);
+    queue->second.cv_.notify_all();
+  }
+}
+
+void LockManager::AddEdge(txn_id_t t1, txn_id_t t2) { waits_for_[t1].insert(t2); }
+
+void LockManager::RemoveEdge(txn_id_t t1, txn_id_t t2) {
+  auto it = waits_for_.find(t1);
+  if (it == waits_for_.end()) {
+    return;
+  }
+  it->second.erase(t2);
+  if (it->second.empty()) {
+    waits_for_.erase(it);
+  }
+}
+
+auto LockManager::HasCycle(txn_id_t *txn_id) -> bool {
+  // Depth-first search from the lowest transaction id, visiting the targets in ascending order, so the victim does
+  // not depend on hashing
+  enum class Color { WHITE, GRAY, BLACK };
+  std::unordered_map<txn_id_t, Color> colors;
+  std::vector<txn_id_t> path;
+  std::function<bool(txn_id_t)> visit = [&](txn_id_t node) -> bool {
+    colors[node] = Color::GRAY;
+    path.push_back(node);
+    auto edges = waits_for_.find(node);
+    if (edges != waits_for_.end()) {
+      for (auto next : edges->second) {
+        auto color = colors[next];
+        if (color == Color::GRAY) {
+          auto begin = std::find(path.begin(), path.end(), next);
+          *txn_id = *std::max_element(begin, path.end());
+          return true;
+        }
+        if (color == Color::WHITE && visit(next)) {
+          return true;
+        }
+      }
+    }
+    path.pop_back();
+    colors[node] = Color::BLACK;
+    return false;
+  };
+  for (const auto &[node, edges] : waits_for_) {
+    if (colors[node] == Color::WHITE && visit(node)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+auto LockManager::GetEdgeList() -> std::vector<std::pair<txn_id_t, txn_id_t>> {
+  std::vector<std::pair<txn_id_t, txn_id_t>> edges;
+  for (const auto &[from, targets] : waits_for_) {
+    for (auto to : targets) {
+      edges.emplace_back(from, to);
+    }
+  }
+  return edges;
+}
+
+void LockManager::BuildWaitsForGraph(std::unordered_map<txn_id_t, std::pair<Transaction *, LockKey>> *waiters) {
+  waits_for_.clear();
+  // The shards are read one queue at a time, so the graph is not a consistent snapshot; a victim is only aborted
+  // if it still waits for the same object, and a cycle that is real persists until the next round
+  for (auto &shard : shards_) {
+    std::scoped_lock shard_lock(shard.latch_);
+    for (auto &[key, queue] : shard.queues_) {
+      std::scoped_lock queue_lock(queue.latch_);
+      for (auto request = queue.request_queue_.begin(); request != queue.request_queue_.end(); ++request) {
+        if (request->granted_ || request->txn_->GetState() == TransactionState::ABORTED) {
+          continue;
+        }
+        (*waiters)[request->txn_id_] = {request->txn_, key};
+        // A request waits for every conflicting request ahead of it, granted or not
+        for (auto ahead = queue.request_queue_.begin(); ahead != request; ++ahead) {
+          if (!AreCompatible(request->lock_mode_, ahead->lock_mode_)) {
+            AddEdge(request->txn_id_, ahead->txn_id_);
+          }
+        }
+      }
+    }
+  }
+}
+
+void LockManager::RunCycleDetection() {
+  while (enable_cycle_detection_) {
+    {
+      std::unique_lock lock(detection_latch_);
+      detection_cv_.wait_for(lock, cycle_detection_interval, [&] { return !enable_cycle_detection_; });
+      if (!enable_cycle_detection_) {
+        break;
+      }
+    }
+    std::unordered_map<txn_id_t, std::pair<Transaction *, LockKey>> waiters;
+    BuildWaitsForGraph(&waiters);
+    txn_id_t victim;
+    while (HasCycle(&victim)) {
+      // The victim is in a cycle, so it waits for a lock; its other waits-for edges go with it
+      auto [txn, key] = waiters.at(victim);
+      if (AbortTransaction(txn, victim, &key)) {
+        WakeUp(victim);
+      }
+      waits_for_.erase(victim);
+    }
+    waits_for_.clear();
+  }
+}
+
 }  // namespace bustub
@@ -26,36 +26,96 @@ std::shared_mutex TransactionManager::txn_map_mutex = {};
 auto TransactionManager::Begin(Transaction *txn, IsolationLevel isolation_level) -> Transaction * {
   // Acquire the global transaction latch in shared mode.
   global_txn_latch_.RLock();
+  return Register(txn, isolation_level);
+}
+
+auto TransactionManager::BeginExclusive(IsolationLevel isolation_level) -> Transaction * {
+  // Acquire the global transaction latch in exclusive mode, which waits for the running transactions to end.
+  global_txn_latch_.WLock();
+  auto *txn = Register(nullptr, isolation_level);
+  exclusive_txn_id_ = txn->GetTransactionId();
+  return txn;
+}
 
+auto TransactionManager::Register(Transaction *txn, IsolationLevel isolation_level) -> Transaction * {
   if (txn == nullptr) {
     txn = new Transaction(next_txn_id_++, isolation_level);
   }
   txn_map_mutex.lock();
   txn_map[txn->GetTransactionId()] = txn;
   txn_map_mutex.unlock();
+  BUSTUB_ASSERT(enable_mvcc || txn->GetIsolationLevel() != IsolationLevel::SNAPSHOT_ISOLATION,
+                "Snapshot isolation needs the old versions of tuples.");
+  if (enable_mvcc) {
+    std::scoped_lock lock(timestamp_latch_);
+    txn->SetReadTs(last_commit_ts_);
+    if (txn->GetIsolationLevel() == IsolationLevel::SNAPSHOT_ISOLATION) {
+      snapshots_.insert(last_commit_ts_);
+    }
+  }
+  if (enable_logging) {
+    // Registered before its first record is appended, so a checkpoint that misses it precedes all of its records
+    {
+      std::scoped_lock lock(logged_txns_latch_);
+      logged_txns_[txn->GetTransactionId()] = log_manager_->GetNextOffset();
+    }
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::BEGIN);
+    txn->SetPrevLSN(log_manager_->AppendLogRecord(&log_record));
+  }
   return txn;
 }
 
 void TransactionManager::Commit(Transaction *txn) {
   txn->SetState(TransactionState::COMMITTED);
 
-  // Perform all deletes before we commit.
+  // Perform all deletes before we commit. The write set is kept for stamping the versions.
   auto write_set = txn->GetWriteSet();
-  while (!write_set->empty()) {
-    auto &item = write_set->back();
-    auto table = item.table_;
-    if (item.wtype_ == WType::DELETE) {
+  for (auto item = write_set->rbegin(); item != write_set->rend(); ++item) {
+    if (item->wtype_ == WType::DELETE) {
       // Note that this also releases the lock when holding the page latch.
-      table->ApplyDelete(item.rid_, txn);
+      item->table_->ApplyDelete(item->rid_, txn);
     }
-    write_set->pop_back();
+  }
+
+  if (enable_logging) {
+    // The commit is durable once its record is; the flush is shared with every commit waiting at the same time
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::COMMIT);
+    lsn_t lsn = log_manager_->AppendLogRecord(&log_record);
+    txn->SetPrevLSN(lsn);
+    log_manager_->Flush(lsn);
+    std::scoped_lock lock(logged_txns_latch_);
+    logged_txns_.erase(txn->GetTransactionId());
+  }
+
+  // Snapshots see the commit from here on, while the writes are still locked
+  if (enable_mvcc) {
+    CommitVersions(txn);
   }
   write_set->clear();
 
   // Release all the locks.
   ReleaseLocks(txn);
   // Release the global transaction latch.
-  global_txn_latch_.RUnlock();
+  ReleaseGlobalLatch(txn);
+}
+
+void TransactionManager::CommitVersions(Transaction *txn) {
+  // Commits stamp their versions one at a time, so a snapshot never sees a later commit without an earlier one
+  std::scoped_lock lock(timestamp_latch_);
+  EndSnapshot(txn);
+  auto commit_ts = last_commit_ts_ + 1;
+  txn->SetCommitTs(commit_ts);
+  auto watermark = snapshots_.empty() ? commit_ts : *snapshots_.begin();
+  for (const auto &item : *txn->GetWriteSet()) {
+    item.table_->CommitVersion(item.rid_, item.wtype_, txn, watermark);
+  }
+  last_commit_ts_ = commit_ts;
+}
+
+void TransactionManager::EndSnapshot(Transaction *txn) {
+  if (txn->GetIsolationLevel() == IsolationLevel::SNAPSHOT_ISOLATION) {
+    snapshots_.erase(snapshots_.find(txn->GetReadTs()));
+  }
 }
 
 void TransactionManager::Abort(Transaction *txn) {
@@ -72,6 +132,8 @@ void TransactionManager::Abort(Transaction *txn) {
       table->ApplyDelete(item.rid_, txn);
     } else if (item.wtype_ == WType::UPDATE) {
       table->UpdateTuple(item.tuple_, item.rid_, txn);
+    } else if (item.wtype_ == WType::INSERT_PAGE) {
+      table->RollbackAppend(item.rid_, txn);
     }
     table_write_set->pop_back();
   }
@@ -102,10 +164,40 @@ void TransactionManager::Abort(Transaction *txn) {
   table_write_set->clear();
   index_write_set->clear();
 
+  if (enable_logging) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::ABORT);
+    txn->SetPrevLSN(log_manager_->AppendLogRecord(&log_record));
+    std::scoped_lock lock(logged_txns_latch_);
+    logged_txns_.erase(txn->GetTransactionId());
+  }
+  if (enable_mvcc) {
+    std::scoped_lock lock(timestamp_latch_);
+    EndSnapshot(txn);
+  }
+
   // Release all the locks.
   ReleaseLocks(txn);
   // Release the global transaction latch.
-  global_txn_latch_.RUnlock();
+  ReleaseGlobalLatch(txn);
+}
+
+auto TransactionManager::GetActiveTransactionTable() -> std::vector<ActiveTxnEntry> {
+  std::scoped_lock lock(logged_txns_latch_);
+  std::vector<ActiveTxnEntry> active_txns;
+  active_txns.reserve(logged_txns_.size());
+  for (const auto &[txn_id, first_offset] : logged_txns_) {
+    active_txns.push_back({txn_id, GetTransaction(txn_id)->GetPrevLSN(), first_offset});
+  }
+  return active_txns;
+}
+
+void TransactionManager::ReleaseGlobalLatch(Transaction *txn) {
+  if (txn->GetTransactionId() == exclusive_txn_id_) {
+    exclusive_txn_id_ = INVALID_TXN_ID;
+    global_txn_latch_.WUnlock();
+  } else {
+    global_txn_latch_.RUnlock();
+  }
 }
 
 void TransactionManager::BlockAllTransactions() { global_txn_latch_.WLock(); }
@@ -1,29 +1,514 @@
-//===----------------------------------------------------------------------===//
-//
-//                         BusTub
-//
-// aggregation_executor.cpp
-//
-// Identification: src/execution/aggregation_executor.cpp
-//
-// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
-//
-//===----------------------------------------------------------------------===//
-#include <memory>
-#include <vector>
-
-#include "execution/executors/aggregation_executor.h"
-
-namespace bustub {
-
-AggregationExecutor::AggregationExecutor(ExecutorContext *exec_ctx, const AggregationPlanNode *plan,
-                                         std::unique_ptr<AbstractExecutor> &&child)
-    : AbstractExecutor(exec_ctx) {}
-
-void AggregationExecutor::Init() {}
-
-auto AggregationExecutor::Next(Tuple *tuple, RID *rid) -> bool { return false; }
-
-auto AggregationExecutor::GetChildExecutor() const -> const AbstractExecutor * { return child_.get(); }
-
-}  // namespace bustub
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// aggregation_executor.cpp
+//
+// Identification: src/execution/aggregation_executor.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "execution/executors/aggregation_executor.h"
+
+namespace bustub {
+
+AggregationExecutor::AggregationExecutor(ExecutorContext *exec_ctx, const AggregationPlanNode *plan,
+                                         std::unique_ptr<AbstractExecutor> &&child)
+    : AbstractExecutor(exec_ctx),
+      plan_{plan},
+      child_{std::move(child)},
+      aht_{plan->GetAggregates(), plan->GetAggregateTypes()},
+      aht_iterator_{aht_.Begin()},
+      agg_functions_{plan->GetAggregateTypes()} {
+  std::vector<TypeId> types;
+  for (const auto *expr : plan_->GetGroupBys()) {
+    types.push_back(expr->GetReturnType());
+  }
+
+  // Partial aggregates are spilled in a fixed type so that they can be read back; COUNT is an integer, SUM is
+  // widened like its running value, and MIN/MAX keep the type of their input
+  std::vector<Column> columns;
+  for (size_t i = 0; i < types.size(); i++) {
+    if (types[i] == TypeId::VARCHAR) {
+      columns.emplace_back("group_" + std::to_string(i), types[i], TmpTuplePage::MAX_TUPLE_SIZE);
+    } else {
+      columns.emplace_back("group_" + std::to_string(i), types[i]);
+    }
+  }
+  for (size_t i = 0; i < plan_->GetAggregates().size(); i++) {
+    auto type = plan_->GetAggregates()[i]->GetReturnType();
+    auto agg_type = plan_->GetAggregateTypes()[i];
+    if (agg_type == AggregationType::CountAggregate ||
+        (agg_type == AggregationType::SumAggregate && type != TypeId::BIGINT && type != TypeId::DECIMAL)) {
+      type = TypeId::INTEGER;
+    }
+    if (type == TypeId::VARCHAR) {
+      columns.emplace_back("aggregate_" + std::to_string(i), type, TmpTuplePage::MAX_TUPLE_SIZE);
+    } else {
+      columns.emplace_back("aggregate_" + std::to_string(i), type);
+    }
+  }
+  spill_schema_ = std::make_unique<Schema>(columns);
+
+  // Every spill partition keeps a page pinned while it is written
+  auto fanout = std::clamp<size_t>(exec_ctx->GetBufferPoolManager()->GetPoolSize() / 4, 2, 16);
+  spill_bits_ = 0;
+  while ((size_t{2} << spill_bits_) <= fanout) {
+    spill_bits_++;
+  }
+
+  if (AggregateKeyLayout::IsSupported(types)) {
+    key_layout_ = std::make_unique<AggregateKeyLayout>(std::move(types));
+  }
+}
+
+void AggregationExecutor::Init() {
+  child_->Init();
+  aht_.Clear();
+  partitions_.clear();
+  partition_idx_ = 0;
+  group_idx_ = 0;
+  spill_heaps_.clear();
+  pending_.clear();
+
+  if (key_layout_ == nullptr) {
+    TupleBatch batch;
+    while (child_->NextBatch(&batch)) {
+      for (uint32_t i = 0; i < batch.Size(); i++) {
+        const auto &tuple = batch.TupleAt(i);
+        aht_.InsertCombine(MakeAggregateKey(&tuple), MakeAggregateValue(&tuple));
+      }
+      if (GetHashTableMemoryUsage() > exec_ctx_->GetMemoryBudget()) {
+        if (spill_heaps_.empty()) {
+          spill_heaps_ = MakeSpillHeaps();
+        }
+        SpillHashTable(1, spill_heaps_);
+      }
+    }
+    if (!spill_heaps_.empty()) {
+      SpillHashTable(1, spill_heaps_);
+      FinishSpilling();
+    }
+    aht_iterator_ = aht_.Begin();
+    return;
+  }
+
+  // Each partition of the result is moved in from the first worker by MergePartition()
+  partitions_.resize(NUM_PARTITIONS, FlatAggregationTable{key_layout_->GetWidth(), agg_functions_.GetCount(), 1, true});
+  std::vector<LocalAggregation> locals;
+  auto threads = exec_ctx_->GetParallelism();
+  for (size_t i = 0; i < threads; i++) {
+    locals.emplace_back(MakeLocalAggregation());
+  }
+  if (threads == 1) {
+    TupleBatch batch;
+    while (child_->NextBatch(&batch)) {
+      Aggregate(&locals[0], batch);
+    }
+    Flush(&locals[0]);
+  } else {
+    AggregateParallel(&locals);
+  }
+
+  if (!spill_heaps_.empty()) {
+    // Once anything has spilled, all groups go through the spill partitions
+    for (auto &local : locals) {
+      for (auto &table : local.partitions_) {
+        SpillTable(&table, 1, spill_heaps_);
+      }
+    }
+    partitions_.clear();
+    FinishSpilling();
+    return;
+  }
+  if (threads == 1) {
+    for (size_t partition = 0; partition < NUM_PARTITIONS; partition++) {
+      MergePartition(&locals, partition);
+    }
+    return;
+  }
+
+  // Every partition is merged by exactly one thread, so the merge takes no locks
+  std::atomic<size_t> next_partition{0};
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < threads; i++) {
+    workers.emplace_back([&] {
+      for (auto partition = next_partition++; partition < NUM_PARTITIONS; partition = next_partition++) {
+        MergePartition(&locals, partition);
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+auto AggregationExecutor::MakeLocalAggregation() const -> LocalAggregation {
+  auto width = key_layout_->GetWidth();
+  auto count = agg_functions_.GetCount();
+  LocalAggregation local{FlatAggregationTable{width, count, PREAGGREGATION_CAPACITY, false}, {}};
+  local.partitions_.reserve(NUM_PARTITIONS);
+  for (size_t partition = 0; partition < NUM_PARTITIONS; partition++) {
+    local.partitions_.emplace_back(width, count, PREAGGREGATION_CAPACITY / NUM_PARTITIONS, true);
+  }
+  return local;
+}
+
+void AggregationExecutor::Aggregate(LocalAggregation *local, const TupleBatch &batch) {
+  const auto &group_bys = plan_->GetGroupBys();
+  const auto &aggregates = plan_->GetAggregates();
+  const auto *schema = child_->GetOutputSchema();
+  std::vector<char> key(key_layout_->GetWidth());
+  std::vector<Value> input(aggregates.size());
+  for (uint32_t i = 0; i < batch.Size(); i++) {
+    const auto &tuple = batch.TupleAt(i);
+    std::fill(key.begin(), key.end(), 0);
+    for (uint32_t column = 0; column < group_bys.size(); column++) {
+      key_layout_->Store(column, group_bys[column]->Evaluate(&tuple, schema), key.data());
+    }
+    auto hash = key_layout_->Hash(key.data());
+
+    bool inserted;
+    auto *running = local->table_.FindOrInsert(hash, key.data(), &inserted);
+    if (running == nullptr) {
+      Flush(local);
+      running = local->table_.FindOrInsert(hash, key.data(), &inserted);
+    }
+    if (inserted) {
+      agg_functions_.Initialize(running);
+    }
+    for (uint32_t j = 0; j < aggregates.size(); j++) {
+      input[j] = aggregates[j]->Evaluate(&tuple, schema);
+    }
+    agg_functions_.Combine(running, input.data());
+  }
+}
+
+void AggregationExecutor::Flush(LocalAggregation *local) {
+  auto &table = local->table_;
+  auto count = agg_functions_.GetCount();
+  for (size_t group = 0; group < table.Size(); group++) {
+    auto hash = table.HashAt(group);
+    bool inserted;
+    auto *running = local->partitions_[PartitionOf(hash)].FindOrInsert(hash, table.KeyAt(group), &inserted);
+    if (inserted) {
+      std::copy(table.AggregatesAt(group), table.AggregatesAt(group) + count, running);
+    } else {
+      agg_functions_.Merge(running, table.AggregatesAt(group));
+    }
+  }
+  table.Clear();
+
+  // Every worker gets an equal share of the memory budget
+  if (GetMemoryUsage(*local) <= exec_ctx_->GetMemoryBudget() / exec_ctx_->GetParallelism()) {
+    return;
+  }
+  std::lock_guard<std::mutex> guard(spill_latch_);
+  if (spill_heaps_.empty()) {
+    spill_heaps_ = MakeSpillHeaps();
+  }
+  for (auto &partition : local->partitions_) {
+    SpillTable(&partition, 1, spill_heaps_);
+  }
+  // Unpin the pages being written so that other workers can spill too
+  for (auto &heap : spill_heaps_) {
+    heap->Seal();
+  }
+}
+
+void AggregationExecutor::AggregateParallel(std::vector<LocalAggregation> *locals) {
+  // The child is not thread-safe, so this thread pulls the batches and the workers aggregate them
+  auto max_queued = 2 * locals->size();
+  std::mutex latch;
+  std::condition_variable not_empty;
+  std::condition_variable not_full;
+  std::deque<TupleBatch> queue;
+  bool done = false;
+  std::exception_ptr error;
+
+  std::vector<std::thread> workers;
+  for (auto &local : *locals) {
+    workers.emplace_back([&, local = &local] {
+      try {
+        while (true) {
+          std::unique_lock<std::mutex> guard(latch);
+          not_empty.wait(guard, [&] { return !queue.empty() || done; });
+          if (queue.empty()) {
+            break;
+          }
+          auto batch = std::move(queue.front());
+          queue.pop_front();
+          guard.unlock();
+          not_full.notify_one();
+          Aggregate(local, batch);
+        }
+        Flush(local);
+      } catch (...) {
+        std::lock_guard<std::mutex> guard(latch);
+        if (error == nullptr) {
+          error = std::current_exception();
+        }
+        done = true;
+        not_full.notify_all();
+      }
+    });
+  }
+
+  try {
+    TupleBatch batch;
+    while (child_->NextBatch(&batch)) {
+      std::unique_lock<std::mutex> guard(latch);
+      not_full.wait(guard, [&] { return queue.size() < max_queued || done; });
+      if (done) {
+        break;
+      }
+      queue.emplace_back(std::move(batch));
+      guard.unlock();
+      not_empty.notify_one();
+      batch = TupleBatch{};
+    }
+  } catch (...) {
+    std::lock_guard<std::mutex> guard(latch);
+    if (error == nullptr) {
+      error = std::current_exception();
+    }
+  }
+  {
+    std::lock_guard<std::mutex> guard(latch);
+    done = true;
+  }
+  not_empty.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  if (error != nullptr) {
+    std::rethrow_exception(error);
+  }
+}
+
+void AggregationExecutor::MergePartition(std::vector<LocalAggregation> *locals, size_t partition) {
+  // The first worker's partition becomes the result; the others are folded into it
+  auto &result = partitions_[partition];
+  result = std::move((*locals)[0].partitions_[partition]);
+  auto count = agg_functions_.GetCount();
+  for (size_t i = 1; i < locals->size(); i++) {
+    auto &table = (*locals)[i].partitions_[partition];
+    for (size_t group = 0; group < table.Size(); group++) {
+      bool inserted;
+      auto *running = result.FindOrInsert(table.HashAt(group), table.KeyAt(group), &inserted);
+      if (inserted) {
+        std::copy(table.AggregatesAt(group), table.AggregatesAt(group) + count, running);
+      } else {
+        agg_functions_.Merge(running, table.AggregatesAt(group));
+      }
+    }
+    table.Clear();
+  }
+}
+
+auto AggregationExecutor::GetMemoryUsage(const LocalAggregation &local) -> size_t {
+  auto bytes = local.table_.GetMemoryUsage();
+  for (const auto &table : local.partitions_) {
+    bytes += table.GetMemoryUsage();
+  }
+  return bytes;
+}
+
+auto AggregationExecutor::GetHashTableMemoryUsage() const -> size_t {
+  // A rough count of a map node and the values of a group; out-of-line VARCHAR data is not included
+  auto values = plan_->GetGroupBys().size() + plan_->GetAggregates().size();
+  return aht_.Size() * (4 * sizeof(void *) + sizeof(AggregateKey) + sizeof(AggregateValue) + values * sizeof(Value));
+}
+
+auto AggregationExecutor::MakeSpillHeaps() const -> std::vector<std::unique_ptr<TmpTupleHeap>> {
+  std::vector<std::unique_ptr<TmpTupleHeap>> heaps;
+  heaps.reserve(size_t{1} << spill_bits_);
+  for (size_t i = 0; i < (size_t{1} << spill_bits_); i++) {
+    heaps.emplace_back(std::make_unique<TmpTupleHeap>(exec_ctx_->GetBufferPoolManager()));
+  }
+  return heaps;
+}
+
+auto AggregationExecutor::HashGroup(const std::vector<Value> &group_bys) const -> hash_t {
+  if (key_layout_ == nullptr) {
+    return HashUtil::Finalize(std::hash<AggregateKey>{}(AggregateKey{group_bys}));
+  }
+  std::vector<char> key(key_layout_->GetWidth(), 0);
+  for (uint32_t column = 0; column < group_bys.size(); column++) {
+    key_layout_->Store(column, group_bys[column], key.data());
+  }
+  return key_layout_->Hash(key.data());
+}
+
+void AggregationExecutor::SpillGroup(const std::vector<Value> &group_bys, const Value *aggregates, hash_t hash,
+                                     size_t depth, const std::vector<std::unique_ptr<TmpTupleHeap>> &heaps) {
+  std::vector<Value> values{group_bys};
+  for (uint32_t i = 0; i < agg_functions_.GetCount(); i++) {
+    values.emplace_back(aggregates[i].CastAs(spill_schema_->GetColumn(group_bys.size() + i).GetType()));
+  }
+  heaps[SpillPartitionOf(hash, depth)]->Append(Tuple{values, spill_schema_.get()});
+}
+
+void AggregationExecutor::SpillTable(FlatAggregationTable *table, size_t depth,
+                                     const std::vector<std::unique_ptr<TmpTupleHeap>> &heaps) {
+  for (size_t group = 0; group < table->Size(); group++) {
+    SpillGroup(key_layout_->Decode(table->KeyAt(group)), table->AggregatesAt(group), table->HashAt(group), depth,
+               heaps);
+  }
+  table->Clear();
+}
+
+void AggregationExecutor::SpillHashTable(size_t depth, const std::vector<std::unique_ptr<TmpTupleHeap>> &heaps) {
+  for (auto iter = aht_.Begin(); iter != aht_.End(); ++iter) {
+    const auto &group_bys = iter.Key().group_bys_;
+    SpillGroup(group_bys, iter.Val().aggregates_.data(), HashGroup(group_bys), depth, heaps);
+  }
+  aht_.Clear();
+}
+
+void AggregationExecutor::FinishSpilling() {
+  for (auto &heap : spill_heaps_) {
+    heap->Seal();
+    if (!heap->IsEmpty()) {
+      pending_.push_back(SpillPartition{std::move(heap), 1});
+    }
+  }
+  spill_heaps_.clear();
+}
+
+void AggregationExecutor::LoadPartition(SpillPartition *partition) {
+  auto group_count = plan_->GetGroupBys().size();
+  auto count = agg_functions_.GetCount();
+  aht_.Clear();
+  partitions_.clear();
+  partition_idx_ = 0;
+  group_idx_ = 0;
+  if (key_layout_ != nullptr) {
+    partitions_.emplace_back(key_layout_->GetWidth(), count, 1, true);
+  }
+
+  std::vector<char> key(key_layout_ == nullptr ? 0 : key_layout_->GetWidth());
+  std::vector<std::unique_ptr<TmpTupleHeap>> children;
+  Tuple row;
+  partition->heap_->Rewind();
+  while (partition->heap_->Next(&row)) {
+    std::vector<Value> group_bys;
+    std::vector<Value> aggregates;
+    for (uint32_t i = 0; i < group_count + count; i++) {
+      (i < group_count ? group_bys : aggregates).emplace_back(row.GetValue(spill_schema_.get(), i));
+    }
+    if (!children.empty()) {
+      // The partition did not fit, so the rest of it goes straight to the children
+      SpillGroup(group_bys, aggregates.data(), HashGroup(group_bys), partition->depth_ + 1, children);
+      continue;
+    }
+
+    if (key_layout_ == nullptr) {
+      aht_.InsertMerge(AggregateKey{group_bys}, AggregateValue{aggregates});
+    } else {
+      std::fill(key.begin(), key.end(), 0);
+      for (uint32_t column = 0; column < group_count; column++) {
+        key_layout_->Store(column, group_bys[column], key.data());
+      }
+      bool inserted;
+      auto *running = partitions_[0].FindOrInsert(key_layout_->Hash(key.data()), key.data(), &inserted);
+      if (inserted) {
+        std::copy(aggregates.begin(), aggregates.end(), running);
+      } else {
+        agg_functions_.Merge(running, aggregates.data());
+      }
+    }
+
+    auto bytes = key_layout_ == nullptr ? GetHashTableMemoryUsage() : partitions_[0].GetMemoryUsage();
+    if (bytes > exec_ctx_->GetMemoryBudget() && partition->depth_ < MAX_SPILL_DEPTH) {
+      children = MakeSpillHeaps();
+      if (key_layout_ == nullptr) {
+        SpillHashTable(partition->depth_ + 1, children);
+      } else {
+        SpillTable(&partitions_[0], partition->depth_ + 1, children);
+      }
+    }
+  }
+
+  for (auto &child : children) {
+    child->Seal();
+    if (!child->IsEmpty()) {
+      pending_.push_back(SpillPartition{std::move(child), partition->depth_ + 1});
+    }
+  }
+  aht_iterator_ = aht_.Begin();
+}
+
+auto AggregationExecutor::Next(Tuple *tuple, RID *rid) -> bool {
+  while (!NextInMemory(tuple)) {
+    if (pending_.empty()) {
+      return false;
+    }
+    auto partition = std::move(pending_.back());
+    pending_.pop_back();
+    LoadPartition(&partition);
+  }
+  return true;
+}
+
+auto AggregationExecutor::NextInMemory(Tuple *tuple) -> bool {
+  if (key_layout_ == nullptr) {
+    while (aht_iterator_ != aht_.End()) {
+      const auto &group_bys = aht_iterator_.Key().group_bys_;
+      const auto &aggregates = aht_iterator_.Val().aggregates_;
+      ++aht_iterator_;
+      if (MakeOutputTuple(group_bys, aggregates, tuple)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  auto count = agg_functions_.GetCount();
+  while (partition_idx_ < partitions_.size()) {
+    const auto &table = partitions_[partition_idx_];
+    if (group_idx_ == table.Size()) {
+      partition_idx_++;
+      group_idx_ = 0;
+      continue;
+    }
+    auto group = group_idx_++;
+    std::vector<Value> aggregates(table.AggregatesAt(group), table.AggregatesAt(group) + count);
+    if (MakeOutputTuple(key_layout_->Decode(table.KeyAt(group)), aggregates, tuple)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+auto AggregationExecutor::MakeOutputTuple(const std::vector<Value> &group_bys, const std::vector<Value> &aggregates,
+                                          Tuple *tuple) -> bool {
+  const auto *having = plan_->GetHaving();
+  if (having != nullptr && !having->EvaluateAggregate(group_bys, aggregates).GetAs<bool>()) {
+    return false;
+  }
+  const auto *output_schema = GetOutputSchema();
+  std::vector<Value> values;
+  values.reserve(output_schema->GetColumnCount());
+  for (const auto &column : output_schema->GetColumns()) {
+    values.emplace_back(column.GetExpr()->EvaluateAggregate(group_bys, aggregates));
+  }
+  *tuple = Tuple{values, output_schema};
+  return true;
+}
+
+auto AggregationExecutor::GetChildExecutor() const -> const AbstractExecutor * { return child_.get(); }
+
+}  // namespace bustub
@@ -12,16 +12,50 @@
 
 #include <memory>
 
+#include "common/exception.h"
 #include "execution/executors/delete_executor.h"
 
 namespace bustub {
 
 DeleteExecutor::DeleteExecutor(ExecutorContext *exec_ctx, const DeletePlanNode *plan,
                                std::unique_ptr<AbstractExecutor> &&child_executor)
-    : AbstractExecutor(exec_ctx) {}
+    : AbstractExecutor(exec_ctx),
+      plan_{plan},
+      child_executor_{std::move(child_executor)},
+      table_info_{exec_ctx->GetCatalog()->GetTable(plan->TableOid())} {}
 
-void DeleteExecutor::Init() {}
+void DeleteExecutor::Init() {
+  indexes_ = exec_ctx_->GetCatalog()->GetTableIndexes(table_info_->name_);
+  child_executor_->Init();
+}
 
-auto DeleteExecutor::Next([[maybe_unused]] Tuple *tuple, RID *rid) -> bool { return false; }
+auto DeleteExecutor::Next([[maybe_unused]] Tuple *tuple, RID *rid) -> bool {
+  TupleBatch batch;
+  while (child_executor_->NextBatch(&batch)) {
+    for (uint32_t i = 0; i < batch.Size(); i++) {
+      DeleteTuple(batch.RidAt(i));
+    }
+  }
+  return false;
+}
+
+void DeleteExecutor::DeleteTuple(const RID &rid) {
+  auto *txn = exec_ctx_->GetTransaction();
+  // The child may have projected away the key columns, so index keys are built from the stored tuple
+  Tuple old_tuple;
+  if (!indexes_.empty() && !table_info_->table_->GetTuple(rid, &old_tuple, txn)) {
+    throw Exception("DeleteExecutor: the tuple to be deleted does not exist");
+  }
+  if (!table_info_->table_->MarkDelete(rid, txn)) {
+    throw Exception("DeleteExecutor: the tuple could not be marked as deleted");
+  }
+  for (auto *index_info : indexes_) {
+    index_info->index_->DeleteEntry(
+        old_tuple.KeyFromTuple(table_info_->schema_, index_info->key_schema_, index_info->index_->GetKeyAttrs()), rid,
+        txn);
+    txn->GetIndexWriteSet()->emplace_back(rid, table_info_->oid_, WType::DELETE, old_tuple, Tuple{},
+                                          index_info->index_oid_, exec_ctx_->GetCatalog());
+  }
+}
 
 }  // namespace bustub
@@ -12,14 +12,47 @@
 
 #include "execution/executors/distinct_executor.h"
 
+#include <vector>
+
 namespace bustub {
 
 DistinctExecutor::DistinctExecutor(ExecutorContext *exec_ctx, const DistinctPlanNode *plan,
                                    std::unique_ptr<AbstractExecutor> &&child_executor)
-    : AbstractExecutor(exec_ctx) {}
+    : AbstractExecutor(exec_ctx), plan_{plan}, child_executor_{std::move(child_executor)} {}
+
+void DistinctExecutor::Init() {
+  child_executor_->Init();
+  seen_.clear();
+}
+
+auto DistinctExecutor::Next(Tuple *tuple, RID *rid) -> bool {
+  while (child_executor_->Next(tuple, rid)) {
+    if (InsertIfAbsent(*tuple)) {
+      return true;
+    }
+  }
+  return false;
+}
 
-void DistinctExecutor::Init() {}
+auto DistinctExecutor::NextBatch(TupleBatch *batch) -> bool {
+  // Duplicates are dropped from the child's batch by narrowing its selection vector
+  while (child_executor_->NextBatch(batch)) {
+    batch->Filter([this](const Tuple &tuple) { return InsertIfAbsent(tuple); });
+    if (!batch->IsEmpty()) {
+      return true;
+    }
+  }
+  return false;
+}
 
-auto DistinctExecutor::Next(Tuple *tuple, RID *rid) -> bool { return false; }
+auto DistinctExecutor::InsertIfAbsent(const Tuple &tuple) -> bool {
+  const auto *schema = GetOutputSchema();
+  std::vector<Value> values;
+  values.reserve(schema->GetColumnCount());
+  for (uint32_t i = 0; i < schema->GetColumnCount(); i++) {
+    values.emplace_back(tuple.GetValue(schema, i));
+  }
+  return seen_.insert(DistinctKey{std::move(values)}).second;
+}
 
 }  // namespace bustub
@@ -0,0 +1,165 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// exchange_executor.cpp
+//
+// Identification: src/execution/exchange_executor.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "execution/executors/exchange_executor.h"
+
+#include "common/config.h"
+#include "common/exception.h"
+#include "execution/plans/hash_join_plan.h"
+#include "execution/plans/nested_index_join_plan.h"
+#include "execution/plans/nested_loop_join_plan.h"
+
+namespace bustub {
+
+ExchangeExecutor::ExchangeExecutor(ExecutorContext *exec_ctx, const ExchangePlanNode *plan,
+                                   std::vector<std::unique_ptr<AbstractExecutor>> &&children)
+    : AbstractExecutor(exec_ctx),
+      plan_{plan},
+      children_{std::move(children)},
+      scan_plan_{GetDrivingScan(plan->GetChildPlan())} {
+  if (scan_plan_ == nullptr) {
+    throw Exception(ExceptionType::NOT_IMPLEMENTED, "exchange needs a pipeline driven by a sequential scan");
+  }
+}
+
+ExchangeExecutor::~ExchangeExecutor() {
+  Stop();
+  exec_ctx_->SetMorselQueue(scan_plan_, nullptr);
+}
+
+auto ExchangeExecutor::GetDrivingScan(const AbstractPlanNode *plan) -> const SeqScanPlanNode * {
+  switch (plan->GetType()) {
+    case PlanType::SeqScan:
+      return dynamic_cast<const SeqScanPlanNode *>(plan);
+    case PlanType::HashJoin:
+      return GetDrivingScan(dynamic_cast<const HashJoinPlanNode *>(plan)->GetRightPlan());
+    case PlanType::NestedLoopJoin:
+      return GetDrivingScan(dynamic_cast<const NestedLoopJoinPlanNode *>(plan)->GetLeftPlan());
+    case PlanType::NestedIndexJoin:
+      return GetDrivingScan(dynamic_cast<const NestedIndexJoinPlanNode *>(plan)->GetChildPlan());
+    default:
+      // Anything else needs all of its input in every instance
+      return nullptr;
+  }
+}
+
+void ExchangeExecutor::Init() {
+  Stop();
+  queue_.clear();
+  cancelled_ = false;
+  running_ = children_.size();
+  ResetBatchAdapter();
+
+  auto *table_info = exec_ctx_->GetCatalog()->GetTable(scan_plan_->GetTableOid());
+  morsels_ = std::make_unique<MorselQueue>(table_info->table_.get());
+  exec_ctx_->SetMorselQueue(scan_plan_, morsels_.get());
+
+  parallel_ = !TakesRowLocks(exec_ctx_->GetTransaction());
+  current_child_ = 0;
+  current_started_ = false;
+  if (!parallel_) {
+    return;
+  }
+  auto *scheduler = exec_ctx_->GetTaskScheduler();
+  for (auto &child : children_) {
+    producers_.emplace_back(scheduler->Submit([this, child = child.get()] { Produce(child); }));
+  }
+}
+
+void ExchangeExecutor::Produce(AbstractExecutor *child) {
+  auto finish = [this] {
+    std::lock_guard<std::mutex> guard(latch_);
+    running_--;
+    not_empty_.notify_all();
+  };
+  try {
+    // Init() runs here too, so that the instances build their hash tables and such in parallel
+    child->Init();
+    TupleBatch batch;
+    while (child->NextBatch(&batch)) {
+      std::unique_lock<std::mutex> guard(latch_);
+      not_full_.wait(guard, [this] { return queue_.size() < 2 * children_.size() || cancelled_; });
+      if (cancelled_) {
+        break;
+      }
+      queue_.emplace_back(std::move(batch));
+      not_empty_.notify_one();
+      guard.unlock();
+      batch = TupleBatch{};
+    }
+  } catch (...) {
+    {
+      std::lock_guard<std::mutex> guard(latch_);
+      cancelled_ = true;
+      not_full_.notify_all();
+    }
+    finish();
+    throw;
+  }
+  finish();
+}
+
+auto ExchangeExecutor::TakesRowLocks(Transaction *txn) -> bool {
+  // Rows are only locked with logging on, and neither dirty nor snapshot reads lock them
+  return enable_logging && txn != nullptr && txn->GetIsolationLevel() != IsolationLevel::READ_UNCOMMITTED &&
+         txn->GetIsolationLevel() != IsolationLevel::SNAPSHOT_ISOLATION;
+}
+
+void ExchangeExecutor::Stop() {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    cancelled_ = true;
+    not_full_.notify_all();
+  }
+  for (auto &producer : producers_) {
+    if (producer.valid()) {
+      producer.wait();
+    }
+  }
+  producers_.clear();
+}
+
+auto ExchangeExecutor::Next(Tuple *tuple, RID *rid) -> bool { return NextFromBatch(tuple, rid); }
+
+auto ExchangeExecutor::NextBatch(TupleBatch *batch) -> bool {
+  batch->Reset();
+  if (!parallel_) {
+    for (; current_child_ < children_.size(); current_child_++, current_started_ = false) {
+      auto *child = children_[current_child_].get();
+      if (!current_started_) {
+        child->Init();
+        current_started_ = true;
+      }
+      if (child->NextBatch(batch)) {
+        return true;
+      }
+    }
+    return false;
+  }
+  std::unique_lock<std::mutex> guard(latch_);
+  not_empty_.wait(guard, [this] { return !queue_.empty() || running_ == 0; });
+  if (queue_.empty()) {
+    guard.unlock();
+    // Every instance is done; surface the first failure, if any
+    for (auto &producer : producers_) {
+      producer.get();
+    }
+    producers_.clear();
+    return false;
+  }
+  *batch = std::move(queue_.front());
+  queue_.pop_front();
+  not_full_.notify_one();
+  return true;
+}
+
+}  // namespace bustub
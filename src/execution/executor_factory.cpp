@@ -14,11 +14,13 @@
 
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "execution/executors/abstract_executor.h"
 #include "execution/executors/aggregation_executor.h"
 #include "execution/executors/delete_executor.h"
 #include "execution/executors/distinct_executor.h"
+#include "execution/executors/exchange_executor.h"
 #include "execution/executors/hash_join_executor.h"
 #include "execution/executors/index_scan_executor.h"
 #include "execution/executors/insert_executor.h"
@@ -26,6 +28,7 @@
 #include "execution/executors/nested_index_join_executor.h"
 #include "execution/executors/nested_loop_join_executor.h"
 #include "execution/executors/seq_scan_executor.h"
+#include "execution/executors/sort_executor.h"
 #include "execution/executors/update_executor.h"
 #include "storage/index/generic_key.h"
 
@@ -66,10 +69,18 @@ auto ExecutorFactory::CreateExecutor(ExecutorContext *exec_ctx, const AbstractPl
       return std::make_unique<DeleteExecutor>(exec_ctx, delete_plan, std::move(child_executor));
     }
 
-    // Create a new limit executor
+    // Create a new limit executor; a sort below it only has to produce the first tuples (Top-N)
     case PlanType::Limit: {
       auto limit_plan = dynamic_cast<const LimitPlanNode *>(plan);
-      auto child_executor = ExecutorFactory::CreateExecutor(exec_ctx, limit_plan->GetChildPlan());
+      std::unique_ptr<AbstractExecutor> child_executor;
+      if (limit_plan->GetChildPlan()->GetType() == PlanType::Sort) {
+        auto sort_plan = dynamic_cast<const SortPlanNode *>(limit_plan->GetChildPlan());
+        child_executor = std::make_unique<SortExecutor>(
+            exec_ctx, sort_plan, ExecutorFactory::CreateExecutor(exec_ctx, sort_plan->GetChildPlan()),
+            limit_plan->GetLimit());
+      } else {
+        child_executor = ExecutorFactory::CreateExecutor(exec_ctx, limit_plan->GetChildPlan());
+      }
       return std::make_unique<LimitExecutor>(exec_ctx, limit_plan, std::move(child_executor));
     }
 
@@ -111,6 +122,25 @@ auto ExecutorFactory::CreateExecutor(ExecutorContext *exec_ctx, const AbstractPl
       return std::make_unique<HashJoinExecutor>(exec_ctx, hash_join_plan, std::move(left), std::move(right));
     }
 
+    // Create a new sort executor
+    case PlanType::Sort: {
+      auto sort_plan = dynamic_cast<const SortPlanNode *>(plan);
+      auto child_executor = ExecutorFactory::CreateExecutor(exec_ctx, sort_plan->GetChildPlan());
+      return std::make_unique<SortExecutor>(exec_ctx, sort_plan, std::move(child_executor));
+    }
+
+    // Create a new exchange executor over parallel instances of its child
+    case PlanType::Exchange: {
+      auto exchange_plan = dynamic_cast<const ExchangePlanNode *>(plan);
+      auto parallelism =
+          exchange_plan->GetParallelism() == 0 ? exec_ctx->GetParallelism() : exchange_plan->GetParallelism();
+      std::vector<std::unique_ptr<AbstractExecutor>> children;
+      for (size_t i = 0; i < parallelism; i++) {
+        children.emplace_back(ExecutorFactory::CreateExecutor(exec_ctx, exchange_plan->GetChildPlan()));
+      }
+      return std::make_unique<ExchangeExecutor>(exec_ctx, exchange_plan, std::move(children));
+    }
+
     default:
       UNREACHABLE("Unsupported plan type.");
   }
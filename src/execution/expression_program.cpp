@@ -0,0 +1,375 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// expression_program.cpp
+//
+// Identification: src/execution/expression_program.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "execution/expression_program.h"
+
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <type_traits>
+
+#include "execution/expressions/column_value_expression.h"
+#include "execution/expressions/comparison_expression.h"
+#include "execution/expressions/constant_value_expression.h"
+
+namespace bustub {
+
+namespace {
+
+/** @return `true` if values of the type can be held by a register */
+auto IsCompilable(TypeId type) -> bool {
+  switch (type) {
+    case TypeId::BOOLEAN:
+    case TypeId::TINYINT:
+    case TypeId::SMALLINT:
+    case TypeId::INTEGER:
+    case TypeId::BIGINT:
+    case TypeId::DECIMAL:
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+auto ExpressionProgram::Compile(const AbstractExpression *predicate, const Schema *schema, const Schema *right_schema)
+    -> std::unique_ptr<ExpressionProgram> {
+  if (predicate == nullptr) {
+    return nullptr;
+  }
+  std::unique_ptr<ExpressionProgram> program{new ExpressionProgram()};
+  program->join_ = right_schema != nullptr;
+  bool ok = true;
+  program->result_ = program->CompileNode(predicate, schema, right_schema, &ok);
+  if (!ok || !program->result_.boolean_) {
+    return nullptr;
+  }
+  program->rows_[0].resize(1);
+  program->rows_[1].resize(1);
+  return program;
+}
+
+auto ExpressionProgram::CompileNode(const AbstractExpression *expr, const Schema *schema, const Schema *right_schema,
+                                    bool *ok) -> Operand {
+  Operand operand{};
+  if (const auto *constant = dynamic_cast<const ConstantValueExpression *>(expr); constant != nullptr) {
+    const auto &value = constant->GetValue();
+    auto type = value.GetTypeId();
+    if (!IsCompilable(type)) {
+      *ok = false;
+      return operand;
+    }
+    operand.constant_ = true;
+    operand.null_ = value.IsNull();
+    operand.boolean_ = type == TypeId::BOOLEAN;
+    operand.type_ = type == TypeId::DECIMAL ? RegisterType::Decimal : RegisterType::Integer;
+    if (!operand.null_) {
+      switch (type) {
+        case TypeId::BOOLEAN:
+        case TypeId::TINYINT:
+          operand.integer_ = value.GetAs<int8_t>();
+          break;
+        case TypeId::SMALLINT:
+          operand.integer_ = value.GetAs<int16_t>();
+          break;
+        case TypeId::INTEGER:
+          operand.integer_ = value.GetAs<int32_t>();
+          break;
+        case TypeId::BIGINT:
+          operand.integer_ = value.GetAs<int64_t>();
+          break;
+        default:
+          operand.decimal_ = value.GetAs<double>();
+          break;
+      }
+    }
+    return operand;
+  }
+
+  if (const auto *column = dynamic_cast<const ColumnValueExpression *>(expr); column != nullptr) {
+    // Single tuples ignore the tuple index, just like ColumnValueExpression::Evaluate()
+    uint32_t side = right_schema != nullptr ? column->GetTupleIdx() : 0;
+    const auto &col = (side == 0 ? schema : right_schema)->GetColumn(column->GetColIdx());
+    auto type = col.GetType();
+    if (!IsCompilable(type)) {
+      *ok = false;
+      return operand;
+    }
+    Instruction load{};
+    load.side_ = side;
+    load.offset_ = col.GetOffset();
+    switch (type) {
+      case TypeId::BOOLEAN:
+      case TypeId::TINYINT:
+        load.kernel_ = &LoadKernel<int8_t, int64_t>;
+        break;
+      case TypeId::SMALLINT:
+        load.kernel_ = &LoadKernel<int16_t, int64_t>;
+        break;
+      case TypeId::INTEGER:
+        load.kernel_ = &LoadKernel<int32_t, int64_t>;
+        break;
+      case TypeId::BIGINT:
+        load.kernel_ = &LoadKernel<int64_t, int64_t>;
+        break;
+      default:
+        load.kernel_ = &LoadKernel<double, double>;
+        break;
+    }
+    operand.type_ = type == TypeId::DECIMAL ? RegisterType::Decimal : RegisterType::Integer;
+    operand.boolean_ = type == TypeId::BOOLEAN;
+    operand.reg_ = load.dst_ = NewRegister(operand.type_);
+    instructions_.push_back(load);
+    return operand;
+  }
+
+  const auto *comparison = dynamic_cast<const ComparisonExpression *>(expr);
+  if (comparison == nullptr) {
+    *ok = false;
+    return operand;
+  }
+  auto left = CompileNode(comparison->GetChildAt(0), schema, right_schema, ok);
+  auto right = CompileNode(comparison->GetChildAt(1), schema, right_schema, ok);
+  if (!*ok || left.boolean_ != right.boolean_) {
+    // BOOLEAN values only compare with BOOLEAN values; leave the error to the interpreter
+    *ok = false;
+    return operand;
+  }
+  operand.boolean_ = true;
+  operand.type_ = RegisterType::Integer;
+  if (left.constant_ && right.constant_) {
+    // Both sides are constant all the way down, so the interpreter never looks at a tuple
+    auto value = comparison->Evaluate(nullptr, schema);
+    operand.constant_ = true;
+    operand.null_ = value.IsNull();
+    operand.integer_ = operand.null_ ? 0 : static_cast<int64_t>(value.GetAs<int8_t>());
+    return operand;
+  }
+
+  // Mixed comparisons are done on doubles, as the Value comparisons do
+  bool decimal = left.type_ == RegisterType::Decimal || right.type_ == RegisterType::Decimal;
+  if (decimal) {
+    left = CastToDecimal(left);
+    right = CastToDecimal(right);
+  }
+  Instruction compare{};
+  compare.left_ = left;
+  compare.right_ = right;
+  switch (comparison->GetComparisonType()) {
+    case ComparisonType::Equal:
+      compare.kernel_ = decimal ? PickCompareKernel<double, std::equal_to>(left, right)
+                                : PickCompareKernel<int64_t, std::equal_to>(left, right);
+      break;
+    case ComparisonType::NotEqual:
+      compare.kernel_ = decimal ? PickCompareKernel<double, std::not_equal_to>(left, right)
+                                : PickCompareKernel<int64_t, std::not_equal_to>(left, right);
+      break;
+    case ComparisonType::LessThan:
+      compare.kernel_ = decimal ? PickCompareKernel<double, std::less>(left, right)
+                                : PickCompareKernel<int64_t, std::less>(left, right);
+      break;
+    case ComparisonType::LessThanOrEqual:
+      compare.kernel_ = decimal ? PickCompareKernel<double, std::less_equal>(left, right)
+                                : PickCompareKernel<int64_t, std::less_equal>(left, right);
+      break;
+    case ComparisonType::GreaterThan:
+      compare.kernel_ = decimal ? PickCompareKernel<double, std::greater>(left, right)
+                                : PickCompareKernel<int64_t, std::greater>(left, right);
+      break;
+    case ComparisonType::GreaterThanOrEqual:
+      compare.kernel_ = decimal ? PickCompareKernel<double, std::greater_equal>(left, right)
+                                : PickCompareKernel<int64_t, std::greater_equal>(left, right);
+      break;
+  }
+  operand.reg_ = compare.dst_ = NewRegister(RegisterType::Integer);
+  instructions_.push_back(compare);
+  return operand;
+}
+
+auto ExpressionProgram::CastToDecimal(const Operand &operand) -> Operand {
+  if (operand.type_ == RegisterType::Decimal) {
+    return operand;
+  }
+  auto cast = operand;
+  cast.type_ = RegisterType::Decimal;
+  if (operand.constant_) {
+    cast.decimal_ = static_cast<double>(operand.integer_);
+    return cast;
+  }
+  Instruction instruction{};
+  instruction.kernel_ = &CastKernel;
+  instruction.left_ = operand;
+  cast.reg_ = instruction.dst_ = NewRegister(RegisterType::Decimal);
+  instructions_.push_back(instruction);
+  return cast;
+}
+
+auto ExpressionProgram::NewRegister(RegisterType type) -> uint32_t {
+  register_types_.push_back(type);
+  integers_.emplace_back();
+  decimals_.emplace_back();
+  nulls_.emplace_back();
+  return static_cast<uint32_t>(register_types_.size() - 1);
+}
+
+void ExpressionProgram::Run(size_t count) {
+  if (!nulls_.empty() && nulls_[0].size() < count) {
+    for (uint32_t reg = 0; reg < register_types_.size(); reg++) {
+      if (register_types_[reg] == RegisterType::Integer) {
+        integers_[reg].resize(count);
+      } else {
+        decimals_[reg].resize(count);
+      }
+      nulls_[reg].resize(count);
+    }
+  }
+  for (const auto &instruction : instructions_) {
+    instruction.kernel_(instruction, this, count);
+  }
+}
+
+auto ExpressionProgram::Matches(const Tuple &tuple) -> bool {
+  BUSTUB_ASSERT(!join_, "A join predicate needs a pair of tuples.");
+  rows_[0][0] = tuple.GetData();
+  Run(1);
+  return Passes(0);
+}
+
+auto ExpressionProgram::MatchesJoin(const Tuple &left_tuple, const Tuple &right_tuple) -> bool {
+  rows_[0][0] = left_tuple.GetData();
+  rows_[1][0] = right_tuple.GetData();
+  Run(1);
+  return Passes(0);
+}
+
+void ExpressionProgram::Filter(TupleBatch *batch) {
+  BUSTUB_ASSERT(!join_, "A join predicate needs pairs of tuples.");
+  auto count = batch->Size();
+  if (rows_[0].size() < count) {
+    rows_[0].resize(count);
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    rows_[0][i] = batch->TupleAt(i).GetData();
+  }
+  RunRows(count);
+  batch->Select(keep_.data());
+}
+
+auto ExpressionProgram::Evaluate(const std::vector<Tuple> &tuples) -> const std::vector<uint8_t> & {
+  BUSTUB_ASSERT(!join_, "A join predicate needs pairs of tuples.");
+  if (rows_[0].size() < tuples.size()) {
+    rows_[0].resize(tuples.size());
+  }
+  for (size_t i = 0; i < tuples.size(); i++) {
+    rows_[0][i] = tuples[i].GetData();
+  }
+  RunRows(tuples.size());
+  return keep_;
+}
+
+auto ExpressionProgram::Evaluate(const std::vector<Tuple> &tuples, const std::vector<uint32_t> &selection)
+    -> const std::vector<uint8_t> & {
+  BUSTUB_ASSERT(!join_, "A join predicate needs pairs of tuples.");
+  if (rows_[0].size() < selection.size()) {
+    rows_[0].resize(selection.size());
+  }
+  for (size_t i = 0; i < selection.size(); i++) {
+    rows_[0][i] = tuples[selection[i]].GetData();
+  }
+  RunRows(selection.size());
+  return keep_;
+}
+
+void ExpressionProgram::RunRows(size_t count) {
+  Run(count);
+  keep_.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    keep_[i] = static_cast<uint8_t>(Passes(i));
+  }
+}
+
+template <typename T>
+auto ExpressionProgram::Values(uint32_t reg) -> std::vector<T> & {
+  if constexpr (std::is_same_v<T, double>) {
+    return decimals_[reg];
+  } else {
+    return integers_[reg];
+  }
+}
+
+template <typename Raw, typename T>
+void ExpressionProgram::LoadKernel(const Instruction &instruction, ExpressionProgram *program, size_t count) {
+  const auto *rows = program->rows_[instruction.side_].data();
+  auto *values = program->Values<T>(instruction.dst_).data();
+  auto *nulls = program->nulls_[instruction.dst_].data();
+  for (size_t i = 0; i < count; i++) {
+    Raw raw;
+    memcpy(&raw, rows[i] + instruction.offset_, sizeof(Raw));
+    values[i] = static_cast<T>(raw);
+    // Every fixed-width type stores NULL as its lowest value (BUSTUB_INT32_NULL, BUSTUB_DECIMAL_NULL, ...)
+    nulls[i] = static_cast<uint8_t>(raw == std::numeric_limits<Raw>::lowest());
+  }
+}
+
+template <typename T, typename Compare, bool LeftConstant, bool RightConstant>
+void ExpressionProgram::CompareKernel(const Instruction &instruction, ExpressionProgram *program, size_t count) {
+  const auto &left = instruction.left_;
+  const auto &right = instruction.right_;
+  const T *left_values = LeftConstant ? nullptr : program->Values<T>(left.reg_).data();
+  const T *right_values = RightConstant ? nullptr : program->Values<T>(right.reg_).data();
+  const uint8_t *left_nulls = LeftConstant ? nullptr : program->nulls_[left.reg_].data();
+  const uint8_t *right_nulls = RightConstant ? nullptr : program->nulls_[right.reg_].data();
+  T left_constant;
+  T right_constant;
+  if constexpr (std::is_same_v<T, double>) {
+    left_constant = left.decimal_;
+    right_constant = right.decimal_;
+  } else {
+    left_constant = left.integer_;
+    right_constant = right.integer_;
+  }
+  auto *results = program->integers_[instruction.dst_].data();
+  auto *nulls = program->nulls_[instruction.dst_].data();
+  Compare compare;
+  for (size_t i = 0; i < count; i++) {
+    // No branches on the values, so the loop compiles to SIMD compares
+    results[i] = static_cast<int64_t>(compare(LeftConstant ? left_constant : left_values[i],
+                                              RightConstant ? right_constant : right_values[i]));
+    nulls[i] = static_cast<uint8_t>((LeftConstant ? left.null_ : left_nulls[i] != 0) |
+                                    (RightConstant ? right.null_ : right_nulls[i] != 0));
+  }
+}
+
+void ExpressionProgram::CastKernel(const Instruction &instruction, ExpressionProgram *program, size_t count) {
+  const auto *integers = program->integers_[instruction.left_.reg_].data();
+  const auto *source_nulls = program->nulls_[instruction.left_.reg_].data();
+  auto *decimals = program->decimals_[instruction.dst_].data();
+  auto *nulls = program->nulls_[instruction.dst_].data();
+  for (size_t i = 0; i < count; i++) {
+    decimals[i] = static_cast<double>(integers[i]);
+    nulls[i] = source_nulls[i];
+  }
+}
+
+template <typename T, template <typename> class Compare>
+auto ExpressionProgram::PickCompareKernel(const Operand &left, const Operand &right) -> Kernel {
+  if (left.constant_) {
+    return &CompareKernel<T, Compare<T>, true, false>;
+  }
+  if (right.constant_) {
+    return &CompareKernel<T, Compare<T>, false, true>;
+  }
+  return &CompareKernel<T, Compare<T>, false, false>;
+}
+
+}  // namespace bustub
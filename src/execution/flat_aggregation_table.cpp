@@ -0,0 +1,256 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// flat_aggregation_table.cpp
+//
+// Identification: src/execution/flat_aggregation_table.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "execution/flat_aggregation_table.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "common/exception.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+auto AggregateKeyLayout::IsSupported(const std::vector<TypeId> &types) -> bool {
+  if (types.size() > MAX_COLUMNS) {
+    return false;
+  }
+  for (auto type : types) {
+    switch (type) {
+      case TypeId::BOOLEAN:
+      case TypeId::TINYINT:
+      case TypeId::SMALLINT:
+      case TypeId::INTEGER:
+      case TypeId::BIGINT:
+      case TypeId::DECIMAL:
+      case TypeId::TIMESTAMP:
+        break;
+      default:
+        return false;
+    }
+  }
+  return true;
+}
+
+void AggregateKeyLayout::Store(uint32_t column, const Value &value, char *key) const {
+  uint64_t word = 0;
+  if (value.IsNull()) {
+    uint64_t nulls;
+    memcpy(&nulls, key, sizeof(uint64_t));
+    nulls |= uint64_t{1} << column;
+    memcpy(key, &nulls, sizeof(uint64_t));
+  } else {
+    switch (types_[column]) {
+      case TypeId::BOOLEAN:
+        word = static_cast<uint64_t>(value.GetAs<int8_t>());
+        break;
+      case TypeId::TINYINT:
+        word = static_cast<uint64_t>(static_cast<int64_t>(value.GetAs<int8_t>()));
+        break;
+      case TypeId::SMALLINT:
+        word = static_cast<uint64_t>(static_cast<int64_t>(value.GetAs<int16_t>()));
+        break;
+      case TypeId::INTEGER:
+        word = static_cast<uint64_t>(static_cast<int64_t>(value.GetAs<int32_t>()));
+        break;
+      case TypeId::BIGINT:
+        word = static_cast<uint64_t>(value.GetAs<int64_t>());
+        break;
+      case TypeId::DECIMAL: {
+        // -0.0 and 0.0 compare equal, so they must normalize alike
+        auto decimal = value.GetAs<double>() + 0.0;
+        memcpy(&word, &decimal, sizeof(uint64_t));
+        break;
+      }
+      case TypeId::TIMESTAMP:
+        word = value.GetAs<uint64_t>();
+        break;
+      default:
+        UNREACHABLE("Unsupported group-by type");
+    }
+  }
+  memcpy(key + (column + 1) * sizeof(uint64_t), &word, sizeof(uint64_t));
+}
+
+auto AggregateKeyLayout::Hash(const char *key) const -> hash_t {
+  hash_t hash = types_.size();
+  for (size_t offset = 0; offset < GetWidth(); offset += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, key + offset, sizeof(uint64_t));
+    hash = HashUtil::Finalize(hash ^ word) + offset;
+  }
+  return hash;
+}
+
+auto AggregateKeyLayout::Decode(const char *key) const -> std::vector<Value> {
+  uint64_t nulls;
+  memcpy(&nulls, key, sizeof(uint64_t));
+  std::vector<Value> values;
+  values.reserve(types_.size());
+  for (uint32_t column = 0; column < types_.size(); column++) {
+    if ((nulls & (uint64_t{1} << column)) != 0) {
+      values.emplace_back(ValueFactory::GetNullValueByType(types_[column]));
+      continue;
+    }
+    uint64_t word;
+    memcpy(&word, key + (column + 1) * sizeof(uint64_t), sizeof(uint64_t));
+    switch (types_[column]) {
+      case TypeId::BOOLEAN:
+        values.emplace_back(ValueFactory::GetBooleanValue(static_cast<int8_t>(word)));
+        break;
+      case TypeId::TINYINT:
+        values.emplace_back(ValueFactory::GetTinyIntValue(static_cast<int8_t>(word)));
+        break;
+      case TypeId::SMALLINT:
+        values.emplace_back(ValueFactory::GetSmallIntValue(static_cast<int16_t>(word)));
+        break;
+      case TypeId::INTEGER:
+        values.emplace_back(ValueFactory::GetIntegerValue(static_cast<int32_t>(word)));
+        break;
+      case TypeId::BIGINT:
+        values.emplace_back(ValueFactory::GetBigIntValue(static_cast<int64_t>(word)));
+        break;
+      case TypeId::DECIMAL: {
+        double decimal;
+        memcpy(&decimal, &word, sizeof(double));
+        values.emplace_back(ValueFactory::GetDecimalValue(decimal));
+        break;
+      }
+      case TypeId::TIMESTAMP:
+        values.emplace_back(ValueFactory::GetTimestampValue(static_cast<int64_t>(word)));
+        break;
+      default:
+        UNREACHABLE("Unsupported group-by type");
+    }
+  }
+  return values;
+}
+
+void AggregateFunctions::Initialize(Value *aggregates) const {
+  for (uint32_t i = 0; i < agg_types_.size(); i++) {
+    switch (agg_types_[i]) {
+      case AggregationType::CountAggregate:
+      case AggregationType::SumAggregate:
+        aggregates[i] = ValueFactory::GetIntegerValue(0);
+        break;
+      case AggregationType::MinAggregate:
+        aggregates[i] = ValueFactory::GetIntegerValue(BUSTUB_INT32_MAX);
+        break;
+      case AggregationType::MaxAggregate:
+        aggregates[i] = ValueFactory::GetIntegerValue(BUSTUB_INT32_MIN);
+        break;
+    }
+  }
+}
+
+void AggregateFunctions::Combine(Value *aggregates, const Value *input) const {
+  for (uint32_t i = 0; i < agg_types_.size(); i++) {
+    switch (agg_types_[i]) {
+      case AggregationType::CountAggregate:
+        aggregates[i] = aggregates[i].Add(ValueFactory::GetIntegerValue(1));
+        break;
+      case AggregationType::SumAggregate:
+        aggregates[i] = aggregates[i].Add(input[i]);
+        break;
+      case AggregationType::MinAggregate:
+        aggregates[i] = aggregates[i].Min(input[i]);
+        break;
+      case AggregationType::MaxAggregate:
+        aggregates[i] = aggregates[i].Max(input[i]);
+        break;
+    }
+  }
+}
+
+void AggregateFunctions::Merge(Value *aggregates, const Value *partial) const {
+  for (uint32_t i = 0; i < agg_types_.size(); i++) {
+    switch (agg_types_[i]) {
+      case AggregationType::CountAggregate:
+      case AggregationType::SumAggregate:
+        // Partial counts add up just like partial sums
+        aggregates[i] = aggregates[i].Add(partial[i]);
+        break;
+      case AggregationType::MinAggregate:
+        aggregates[i] = aggregates[i].Min(partial[i]);
+        break;
+      case AggregationType::MaxAggregate:
+        aggregates[i] = aggregates[i].Max(partial[i]);
+        break;
+    }
+  }
+}
+
+FlatAggregationTable::FlatAggregationTable(size_t key_width, size_t num_aggregates, size_t capacity, bool growable)
+    : key_width_{key_width}, num_aggregates_{num_aggregates}, capacity_{capacity}, growable_{growable} {
+  size_t slots = 2;
+  while (slots < 2 * capacity_) {
+    slots <<= 1;
+  }
+  slots_.assign(slots, EMPTY_SLOT);
+  keys_.reserve(capacity_ * key_width_);
+  hashes_.reserve(capacity_);
+  aggregates_.reserve(capacity_ * num_aggregates_);
+}
+
+auto FlatAggregationTable::FindOrInsert(hash_t hash, const char *key, bool *inserted) -> Value * {
+  auto mask = slots_.size() - 1;
+  auto slot = hash & mask;
+  for (; slots_[slot] != EMPTY_SLOT; slot = (slot + 1) & mask) {
+    auto group = slots_[slot];
+    if (hashes_[group] == hash && memcmp(KeyAt(group), key, key_width_) == 0) {
+      *inserted = false;
+      return AggregatesAt(group);
+    }
+  }
+
+  if (hashes_.size() >= capacity_) {
+    if (!growable_) {
+      return nullptr;
+    }
+    Grow();
+    return FindOrInsert(hash, key, inserted);
+  }
+  auto group = static_cast<uint32_t>(hashes_.size());
+  slots_[slot] = group;
+  hashes_.push_back(hash);
+  keys_.insert(keys_.end(), key, key + key_width_);
+  aggregates_.resize(aggregates_.size() + num_aggregates_);
+  *inserted = true;
+  return AggregatesAt(group);
+}
+
+auto FlatAggregationTable::GetMemoryUsage() const -> size_t {
+  return slots_.size() * sizeof(uint32_t) + keys_.size() + hashes_.size() * sizeof(hash_t) +
+         aggregates_.size() * sizeof(Value);
+}
+
+void FlatAggregationTable::Clear() {
+  std::fill(slots_.begin(), slots_.end(), EMPTY_SLOT);
+  keys_.clear();
+  hashes_.clear();
+  aggregates_.clear();
+}
+
+void FlatAggregationTable::Grow() {
+  capacity_ *= 2;
+  slots_.assign(2 * slots_.size(), EMPTY_SLOT);
+  auto mask = slots_.size() - 1;
+  for (uint32_t group = 0; group < hashes_.size(); group++) {
+    auto slot = hashes_[group] & mask;
+    while (slots_[slot] != EMPTY_SLOT) {
+      slot = (slot + 1) & mask;
+    }
+    slots_[slot] = group;
+  }
+}
+
+}  // namespace bustub
@@ -12,15 +12,359 @@
 
 #include "execution/executors/hash_join_executor.h"
 
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "execution/plans/seq_scan_plan.h"
+#include "storage/page/table_page.h"
+
 namespace bustub {
 
 HashJoinExecutor::HashJoinExecutor(ExecutorContext *exec_ctx, const HashJoinPlanNode *plan,
                                    std::unique_ptr<AbstractExecutor> &&left_child,
                                    std::unique_ptr<AbstractExecutor> &&right_child)
-    : AbstractExecutor(exec_ctx) {}
+    : AbstractExecutor(exec_ctx),
+      plan_{plan},
+      left_child_{std::move(left_child)},
+      right_child_{std::move(right_child)},
+      // Every partition pins one page while it is written; leave room in the pool for the children
+      fanout_{std::clamp<size_t>(exec_ctx->GetBufferPoolManager()->GetPoolSize() / 4, 2, 16)} {}
+
+void HashJoinExecutor::Init() {
+  left_child_->Init();
+  right_child_->Init();
+  ht_.clear();
+  ht_bytes_ = 0;
+  pending_.clear();
+  probe_child_ = true;
+  probe_heap_.reset();
+  right_batch_.Reset();
+  right_cursor_ = 0;
+  matches_ = nullptr;
+  match_idx_ = 0;
+  build_tuples_.clear();
+  build_keys_.clear();
+  radix_table_.Clear();
+  probe_chunk_.clear();
+  probe_keys_.clear();
+  radix_matches_.clear();
+  radix_match_idx_ = 0;
+
+  // Large builds are worth the extra partitioning pass of the radix join
+  auto estimate = EstimateBuildRows();
+  radix_mode_ = estimate.has_value() && *estimate >= RADIX_JOIN_MIN_BUILD_ROWS;
+  MakeBloomFilter(estimate);
+
+  // Build on the left child, spilling if the build side grows too large
+  std::vector<std::unique_ptr<TmpTupleHeap>> left_partitions;
+  std::vector<RadixEntry> radix_entries;
+  TupleBatch batch;
+  while (left_child_->NextBatch(&batch)) {
+    for (uint32_t i = 0; i < batch.Size(); i++) {
+      if (radix_mode_) {
+        BuildRadix(std::move(batch.TupleAt(i)), &radix_entries, &left_partitions);
+      } else {
+        Build(std::move(batch.TupleAt(i)), 0, &left_partitions);
+      }
+    }
+  }
+  PushDownBloomFilter();
+  if (left_partitions.empty()) {
+    if (radix_mode_) {
+      radix_table_.Build(radix_entries, RadixJoinTable::ChooseRadixBits(radix_entries.size()));
+    }
+    return;
+  }
+
+  // The build side was spilled, so the probe side has to be partitioned the same way
+  const auto *right_key = plan_->RightJoinKeyExpression();
+  const auto *right_schema = right_child_->GetOutputSchema();
+  auto right_partitions = MakePartitions();
+  while (right_child_->NextBatch(&batch)) {
+    for (uint32_t i = 0; i < batch.Size(); i++) {
+      const auto &tuple = batch.TupleAt(i);
+      HashJoinKey key{right_key->Evaluate(&tuple, right_schema)};
+      if (!key.key_.IsNull()) {
+        right_partitions[PartitionOf(key, 0)]->Append(tuple);
+      }
+    }
+  }
+  QueuePartitions(std::move(left_partitions), std::move(right_partitions), 0);
+  probe_child_ = false;
+}
+
+auto HashJoinExecutor::EstimateBuildRows() const -> std::optional<size_t> {
+  const auto *left_plan = plan_->GetLeftPlan();
+  if (left_plan->GetEstimatedCardinality().has_value() || left_plan->GetType() != PlanType::SeqScan) {
+    return left_plan->GetEstimatedCardinality();
+  }
+  // A scanned table holds about as many rows as its pages fit, ignoring the predicate and variable-length data
+  const auto *table_info =
+      exec_ctx_->GetCatalog()->GetTable(static_cast<const SeqScanPlanNode *>(left_plan)->GetTableOid());
+  auto rows_per_page = PAGE_SIZE / TablePage::GetInsertSize(table_info->schema_.GetLength());
+  return table_info->table_->GetPageIds().size() * rows_per_page;
+}
+
+auto HashJoinExecutor::Next(Tuple *tuple, RID *rid) -> bool {
+  if (radix_mode_) {
+    while (radix_match_idx_ >= radix_matches_.size()) {
+      if (!ProbeRadixChunk()) {
+        return false;
+      }
+    }
+    const auto &[build_row, probe_row] = radix_matches_[radix_match_idx_++];
+    *tuple = MakeOutputTuple(build_tuples_[build_row], probe_chunk_[probe_row]);
+    return true;
+  }
+
+  const auto *right_key = plan_->RightJoinKeyExpression();
+  const auto *right_schema = right_child_->GetOutputSchema();
+  while (true) {
+    if (matches_ != nullptr && match_idx_ < matches_->size()) {
+      *tuple = MakeOutputTuple((*matches_)[match_idx_++], probe_tuple_);
+      return true;
+    }
+
+    // Advance to the next probe tuple; this may replace the hash table, so drop the matches first
+    matches_ = nullptr;
+    if (!NextProbeTuple(&probe_tuple_)) {
+      return false;
+    }
+    HashJoinKey key{right_key->Evaluate(&probe_tuple_, right_schema)};
+    auto iter = key.key_.IsNull() ? ht_.end() : ht_.find(key);
+    matches_ = iter == ht_.end() ? nullptr : &iter->second;
+    match_idx_ = 0;
+  }
+}
+
+void HashJoinExecutor::Build(Tuple &&tuple, uint32_t depth,
+                             std::vector<std::unique_ptr<TmpTupleHeap>> *partitions) {
+  HashJoinKey key{plan_->LeftJoinKeyExpression()->Evaluate(&tuple, left_child_->GetOutputSchema())};
+  // NULL never joins with anything
+  if (key.key_.IsNull()) {
+    return;
+  }
+  if (depth == 0 && bloom_filter_ != nullptr) {
+    bloom_filter_->Insert(HashUtil::HashValue(&key.key_));
+  }
+  if (!partitions->empty()) {
+    (*partitions)[PartitionOf(key, depth)]->Append(tuple);
+    return;
+  }
+
+  ht_bytes_ += sizeof(Tuple) + tuple.GetLength();
+  ht_[key].emplace_back(std::move(tuple));
+  if (ht_bytes_ <= GetExecutorContext()->GetMemoryBudget() || depth >= MAX_PARTITION_DEPTH) {
+    return;
+  }
+
+  // Over budget: move everything built so far into spill partitions
+  *partitions = MakePartitions();
+  for (const auto &[build_key, tuples] : ht_) {
+    auto &partition = (*partitions)[PartitionOf(build_key, depth)];
+    for (const auto &build_tuple : tuples) {
+      partition->Append(build_tuple);
+    }
+  }
+  ht_.clear();
+  ht_bytes_ = 0;
+}
+
+void HashJoinExecutor::BuildRadix(Tuple &&tuple, std::vector<RadixEntry> *entries,
+                                  std::vector<std::unique_ptr<TmpTupleHeap>> *partitions) {
+  HashJoinKey key{plan_->LeftJoinKeyExpression()->Evaluate(&tuple, left_child_->GetOutputSchema())};
+  if (key.key_.IsNull()) {
+    return;
+  }
+  if (bloom_filter_ != nullptr) {
+    bloom_filter_->Insert(HashUtil::HashValue(&key.key_));
+  }
+  auto hash = HashUtil::Finalize(std::hash<HashJoinKey>{}(key));
+  entries->push_back(RadixEntry{hash, static_cast<uint32_t>(build_tuples_.size())});
+  ht_bytes_ += sizeof(Tuple) + sizeof(Value) + sizeof(RadixEntry) + tuple.GetLength();
+  build_tuples_.emplace_back(std::move(tuple));
+  build_keys_.emplace_back(std::move(key.key_));
+  if (ht_bytes_ <= GetExecutorContext()->GetMemoryBudget()) {
+    return;
+  }
+
+  // The estimate was off and the build side does not fit: spill what we have and go the Grace way
+  radix_mode_ = false;
+  *partitions = MakePartitions();
+  for (size_t row = 0; row < build_tuples_.size(); row++) {
+    (*partitions)[PartitionOf(HashJoinKey{build_keys_[row]}, 0)]->Append(build_tuples_[row]);
+  }
+  build_tuples_.clear();
+  build_keys_.clear();
+  entries->clear();
+  ht_bytes_ = 0;
+}
+
+auto HashJoinExecutor::ProbeRadixChunk() -> bool {
+  const auto *right_key = plan_->RightJoinKeyExpression();
+  const auto *right_schema = right_child_->GetOutputSchema();
+  probe_chunk_.clear();
+  probe_keys_.clear();
+  radix_matches_.clear();
+  radix_match_idx_ = 0;
+
+  // Materialize a chunk of probe tuples along with their key hashes
+  std::vector<RadixEntry> entries;
+  uint32_t batches = 0;
+  while (batches < RADIX_PROBE_CHUNK_BATCHES && right_child_->NextBatch(&right_batch_)) {
+    batches++;
+    for (uint32_t i = 0; i < right_batch_.Size(); i++) {
+      auto &tuple = right_batch_.TupleAt(i);
+      HashJoinKey key{right_key->Evaluate(&tuple, right_schema)};
+      if (key.key_.IsNull()) {
+        continue;
+      }
+      auto hash = HashUtil::Finalize(std::hash<HashJoinKey>{}(key));
+      entries.push_back(RadixEntry{hash, static_cast<uint32_t>(probe_chunk_.size())});
+      probe_chunk_.emplace_back(std::move(tuple));
+      probe_keys_.emplace_back(std::move(key.key_));
+    }
+  }
+  if (batches == 0) {
+    return false;
+  }
+
+  // Partition the chunk like the build side and probe one partition at a time
+  RadixPartitions partitions;
+  partitions.Partition(entries, radix_table_.GetRadixBits());
+  for (uint32_t part = 0; part < partitions.GetPartitionCount(); part++) {
+    for (const auto *entry = partitions.PartitionBegin(part); entry != partitions.PartitionEnd(part); entry++) {
+      const auto &probe_key = probe_keys_[entry->row_];
+      radix_table_.ForEachCandidate(entry->hash_, [&](uint32_t build_row) {
+        if (build_keys_[build_row].CompareEquals(probe_key) == CmpBool::CmpTrue) {
+          radix_matches_.emplace_back(build_row, entry->row_);
+        }
+      });
+    }
+  }
+  return true;
+}
+
+void HashJoinExecutor::MakeBloomFilter(std::optional<size_t> estimated_rows) {
+  bloom_filter_.reset();
+  // The filter holds hashes, so both keys must hash equal values alike. All integer types hash as BIGINT.
+  auto left_type = plan_->LeftJoinKeyExpression()->GetReturnType();
+  auto right_type = plan_->RightJoinKeyExpression()->GetReturnType();
+  auto is_integer = [](TypeId type) {
+    return type == TypeId::TINYINT || type == TypeId::SMALLINT || type == TypeId::INTEGER || type == TypeId::BIGINT;
+  };
+  if (left_type != right_type && !(is_integer(left_type) && is_integer(right_type))) {
+    return;
+  }
+
+  // The filter is sized before the build and never grows, so a build side that spills does not grow it either.
+  // Rounded up to a power of two, a filter for `max_keys` keys takes at most an eighth of the memory budget; a
+  // larger build side only raises the false positive rate.
+  auto max_keys = std::max<size_t>(GetExecutorContext()->GetMemoryBudget() / (2 * BloomFilter::BITS_PER_KEY), 1);
+  bloom_filter_ = std::make_unique<BloomFilter>(std::min(estimated_rows.value_or(max_keys), max_keys));
+}
+
+void HashJoinExecutor::PushDownBloomFilter() {
+  if (bloom_filter_ != nullptr &&
+      !right_child_->PushDownBloomFilter(bloom_filter_.get(), plan_->RightJoinKeyExpression())) {
+    bloom_filter_.reset();
+  }
+}
+
+auto HashJoinExecutor::MakePartitions() -> std::vector<std::unique_ptr<TmpTupleHeap>> {
+  std::vector<std::unique_ptr<TmpTupleHeap>> partitions;
+  partitions.reserve(fanout_);
+  for (size_t i = 0; i < fanout_; i++) {
+    partitions.emplace_back(std::make_unique<TmpTupleHeap>(GetExecutorContext()->GetBufferPoolManager()));
+  }
+  return partitions;
+}
+
+auto HashJoinExecutor::PartitionOf(const HashJoinKey &key, uint32_t depth) const -> size_t {
+  // Seed the hash with the depth so that a partition does not map onto itself when it is split again
+  return HashUtil::CombineHashes(std::hash<HashJoinKey>{}(key), depth) % fanout_;
+}
+
+void HashJoinExecutor::QueuePartitions(std::vector<std::unique_ptr<TmpTupleHeap>> &&left,
+                                       std::vector<std::unique_ptr<TmpTupleHeap>> &&right, uint32_t depth) {
+  for (size_t i = 0; i < left.size(); i++) {
+    left[i]->Seal();
+    right[i]->Seal();
+    // An inner join produces nothing for a partition that is empty on either side
+    if (!left[i]->IsEmpty() && !right[i]->IsEmpty()) {
+      pending_.push_back(Partition{std::move(left[i]), std::move(right[i]), depth});
+    }
+  }
+}
+
+void HashJoinExecutor::LoadPartition(Partition &&partition) {
+  ht_.clear();
+  ht_bytes_ = 0;
+
+  uint32_t depth = partition.depth_ + 1;
+  std::vector<std::unique_ptr<TmpTupleHeap>> left_partitions;
+  Tuple tuple;
+  partition.left_->Rewind();
+  while (partition.left_->Next(&tuple)) {
+    Build(std::move(tuple), depth, &left_partitions);
+  }
+  partition.left_.reset();
+  if (left_partitions.empty()) {
+    probe_heap_ = std::move(partition.right_);
+    probe_heap_->Rewind();
+    return;
+  }
+
+  // Still too large: split both sides again
+  const auto *right_key = plan_->RightJoinKeyExpression();
+  const auto *right_schema = right_child_->GetOutputSchema();
+  auto right_partitions = MakePartitions();
+  partition.right_->Rewind();
+  while (partition.right_->Next(&tuple)) {
+    HashJoinKey key{right_key->Evaluate(&tuple, right_schema)};
+    right_partitions[PartitionOf(key, depth)]->Append(tuple);
+  }
+  partition.right_.reset();
+  QueuePartitions(std::move(left_partitions), std::move(right_partitions), depth);
+}
+
+auto HashJoinExecutor::NextProbeTuple(Tuple *tuple) -> bool {
+  if (probe_child_) {
+    if (right_cursor_ >= right_batch_.Size()) {
+      right_cursor_ = 0;
+      if (!right_child_->NextBatch(&right_batch_)) {
+        return false;
+      }
+    }
+    *tuple = std::move(right_batch_.TupleAt(right_cursor_++));
+    return true;
+  }
 
-void HashJoinExecutor::Init() {}
+  while (true) {
+    if (probe_heap_ != nullptr && probe_heap_->Next(tuple)) {
+      return true;
+    }
+    probe_heap_.reset();
+    if (pending_.empty()) {
+      return false;
+    }
+    auto partition = std::move(pending_.back());
+    pending_.pop_back();
+    LoadPartition(std::move(partition));
+  }
+}
 
-auto HashJoinExecutor::Next(Tuple *tuple, RID *rid) -> bool { return false; }
+auto HashJoinExecutor::MakeOutputTuple(const Tuple &left_tuple, const Tuple &right_tuple) -> Tuple {
+  const auto *output_schema = GetOutputSchema();
+  const auto *left_schema = left_child_->GetOutputSchema();
+  const auto *right_schema = right_child_->GetOutputSchema();
+  std::vector<Value> values;
+  values.reserve(output_schema->GetColumnCount());
+  for (const auto &column : output_schema->GetColumns()) {
+    values.emplace_back(column.GetExpr()->EvaluateJoin(&left_tuple, left_schema, &right_tuple, right_schema));
+  }
+  return Tuple{values, output_schema};
+}
 
 }  // namespace bustub
@@ -11,12 +11,70 @@
 //===----------------------------------------------------------------------===//
 #include "execution/executors/index_scan_executor.h"
 
+#include "common/exception.h"
+#include "execution/expressions/column_value_expression.h"
+#include "execution/expressions/comparison_expression.h"
+#include "execution/expressions/constant_value_expression.h"
+
 namespace bustub {
 IndexScanExecutor::IndexScanExecutor(ExecutorContext *exec_ctx, const IndexScanPlanNode *plan)
-    : AbstractExecutor(exec_ctx) {}
+    : AbstractExecutor(exec_ctx),
+      plan_{plan},
+      index_info_{exec_ctx->GetCatalog()->GetIndex(plan->GetIndexOid())},
+      table_info_{exec_ctx->GetCatalog()->GetTable(index_info_->table_name_)} {}
+
+void IndexScanExecutor::Init() {
+  rids_.clear();
+  cursor_ = 0;
+
+  // Hash indexes only answer point lookups: the predicate must be `key_column = constant`
+  const auto &key_attrs = index_info_->index_->GetKeyAttrs();
+  const auto *comparison = dynamic_cast<const ComparisonExpression *>(plan_->GetPredicate());
+  if (comparison == nullptr || comparison->GetComparisonType() != ComparisonType::Equal || key_attrs.size() != 1) {
+    throw NotImplementedException("IndexScanExecutor: only equality lookups on a single-column key are supported");
+  }
+  const ColumnValueExpression *column = nullptr;
+  const ConstantValueExpression *constant = nullptr;
+  for (const auto *child : comparison->GetChildren()) {
+    if (const auto *col = dynamic_cast<const ColumnValueExpression *>(child); col != nullptr) {
+      column = col;
+    } else if (const auto *val = dynamic_cast<const ConstantValueExpression *>(child); val != nullptr) {
+      constant = val;
+    }
+  }
+  if (column == nullptr || constant == nullptr || column->GetColIdx() != key_attrs[0]) {
+    throw NotImplementedException("IndexScanExecutor: the predicate does not compare the index key with a constant");
+  }
 
-void IndexScanExecutor::Init() {}
+  // Index keys are built from table values, so the constant is serialized with the table column type
+  const auto column_type = table_info_->schema_.GetColumn(key_attrs[0]).GetType();
+  Tuple key{{constant->GetValue().CastAs(column_type)}, &index_info_->key_schema_};
+  index_info_->index_->ScanKey(key, &rids_, exec_ctx_->GetTransaction());
+  predicate_program_ = ExpressionProgram::Compile(plan_->GetPredicate(), &table_info_->schema_);
+}
 
-auto IndexScanExecutor::Next(Tuple *tuple, RID *rid) -> bool { return false; }
+auto IndexScanExecutor::Next(Tuple *tuple, RID *rid) -> bool {
+  const auto *predicate = plan_->GetPredicate();
+  const auto *table_schema = &table_info_->schema_;
+  const auto *output_schema = GetOutputSchema();
+  Tuple table_tuple;
+  while (cursor_ < rids_.size()) {
+    const auto &cur_rid = rids_[cursor_++];
+    if (!table_info_->table_->GetTuple(cur_rid, &table_tuple, exec_ctx_->GetTransaction()) ||
+        !(predicate_program_ != nullptr ? predicate_program_->Matches(table_tuple)
+                                        : predicate->Evaluate(&table_tuple, table_schema).GetAs<bool>())) {
+      continue;
+    }
+    std::vector<Value> values;
+    values.reserve(output_schema->GetColumnCount());
+    for (const auto &column : output_schema->GetColumns()) {
+      values.emplace_back(column.GetExpr()->Evaluate(&table_tuple, table_schema));
+    }
+    *tuple = Tuple{values, output_schema};
+    *rid = cur_rid;
+    return true;
+  }
+  return false;
+}
 
 }  // namespace bustub
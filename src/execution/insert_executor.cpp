@@ -1,27 +1,101 @@
-//===----------------------------------------------------------------------===//
-//
-//                         BusTub
-//
-// insert_executor.cpp
-//
-// Identification: src/execution/insert_executor.cpp
-//
-// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
-//
-//===----------------------------------------------------------------------===//
-
-#include <memory>
-
-#include "execution/executors/insert_executor.h"
-
-namespace bustub {
-
-InsertExecutor::InsertExecutor(ExecutorContext *exec_ctx, const InsertPlanNode *plan,
-                               std::unique_ptr<AbstractExecutor> &&child_executor)
-    : AbstractExecutor(exec_ctx) {}
-
-void InsertExecutor::Init() {}
-
-auto InsertExecutor::Next([[maybe_unused]] Tuple *tuple, RID *rid) -> bool { return false; }
-
-}  // namespace bustub
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// insert_executor.cpp
+//
+// Identification: src/execution/insert_executor.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <memory>
+#include <vector>
+
+#include "common/exception.h"
+#include "execution/executors/insert_executor.h"
+
+namespace bustub {
+
+InsertExecutor::InsertExecutor(ExecutorContext *exec_ctx, const InsertPlanNode *plan,
+                               std::unique_ptr<AbstractExecutor> &&child_executor)
+    : AbstractExecutor(exec_ctx),
+      plan_{plan},
+      child_executor_{std::move(child_executor)},
+      table_info_{exec_ctx->GetCatalog()->GetTable(plan->TableOid())} {}
+
+void InsertExecutor::Init() {
+  indexes_ = exec_ctx_->GetCatalog()->GetTableIndexes(table_info_->name_);
+  if (child_executor_ != nullptr) {
+    child_executor_->Init();
+  }
+  done_ = false;
+}
+
+auto InsertExecutor::Next([[maybe_unused]] Tuple *tuple, RID *rid) -> bool {
+  if (done_) {
+    return false;
+  }
+  done_ = true;
+
+  if (plan_->IsRawInsert()) {
+    std::vector<Tuple> tuples;
+    tuples.reserve(plan_->RawValues().size());
+    size_t bytes = 0;
+    for (const auto &values : plan_->RawValues()) {
+      tuples.emplace_back(values, &table_info_->schema_);
+      bytes += tuples.back().GetLength();
+    }
+    // Too few tuples to fill a page would only leave a fresh, mostly empty page behind.
+    if (bytes < PAGE_SIZE) {
+      for (const auto &tuple : tuples) {
+        InsertTuple(tuple);
+      }
+      return false;
+    }
+    BulkInsert(tuples);
+    return false;
+  }
+
+  TupleBatch batch;
+  while (child_executor_->NextBatch(&batch)) {
+    for (uint32_t i = 0; i < batch.Size(); i++) {
+      InsertTuple(batch.TupleAt(i));
+    }
+  }
+  return false;
+}
+
+void InsertExecutor::InsertTuple(const Tuple &tuple) {
+  auto *txn = exec_ctx_->GetTransaction();
+  RID rid;
+  if (!table_info_->table_->InsertTuple(tuple, &rid, txn)) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "InsertExecutor: the table heap could not hold the tuple");
+  }
+  for (auto *index_info : indexes_) {
+    index_info->index_->InsertEntry(
+        tuple.KeyFromTuple(table_info_->schema_, index_info->key_schema_, index_info->index_->GetKeyAttrs()), rid, txn);
+    txn->GetIndexWriteSet()->emplace_back(rid, table_info_->oid_, WType::INSERT, tuple, Tuple{},
+                                          index_info->index_oid_, exec_ctx_->GetCatalog());
+  }
+}
+
+void InsertExecutor::BulkInsert(const std::vector<Tuple> &tuples) {
+  auto *txn = exec_ctx_->GetTransaction();
+  std::vector<RID> rids;
+  if (!table_info_->table_->BulkAppend(tuples, &rids, txn)) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "InsertExecutor: the table heap could not hold the tuples");
+  }
+  for (auto *index_info : indexes_) {
+    for (size_t i = 0; i < tuples.size(); i++) {
+      index_info->index_->InsertEntry(tuples[i].KeyFromTuple(table_info_->schema_, index_info->key_schema_,
+                                                             index_info->index_->GetKeyAttrs()),
+                                      rids[i], txn);
+      txn->GetIndexWriteSet()->emplace_back(rids[i], table_info_->oid_, WType::INSERT, tuples[i], Tuple{},
+                                            index_info->index_oid_, exec_ctx_->GetCatalog());
+    }
+  }
+}
+
+}  // namespace bustub
@@ -16,10 +16,35 @@ namespace bustub {
 
 LimitExecutor::LimitExecutor(ExecutorContext *exec_ctx, const LimitPlanNode *plan,
                              std::unique_ptr<AbstractExecutor> &&child_executor)
-    : AbstractExecutor(exec_ctx) {}
+    : AbstractExecutor(exec_ctx), plan_{plan}, child_executor_{std::move(child_executor)} {}
 
-void LimitExecutor::Init() {}
+void LimitExecutor::Init() {
+  child_executor_->Init();
+  emitted_ = 0;
+}
 
-auto LimitExecutor::Next(Tuple *tuple, RID *rid) -> bool { return false; }
+auto LimitExecutor::Next(Tuple *tuple, RID *rid) -> bool {
+  if (emitted_ >= plan_->GetLimit() || !child_executor_->Next(tuple, rid)) {
+    return false;
+  }
+  emitted_++;
+  return true;
+}
+
+auto LimitExecutor::NextBatch(TupleBatch *batch) -> bool {
+  if (emitted_ >= plan_->GetLimit()) {
+    batch->Reset();
+    return false;
+  }
+  if (!child_executor_->NextBatch(batch)) {
+    return false;
+  }
+  const auto remaining = plan_->GetLimit() - emitted_;
+  if (batch->Size() > remaining) {
+    batch->Truncate(static_cast<uint32_t>(remaining));
+  }
+  emitted_ += batch->Size();
+  return true;
+}
 
 }  // namespace bustub
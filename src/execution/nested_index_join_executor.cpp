@@ -12,14 +12,84 @@
 
 #include "execution/executors/nested_index_join_executor.h"
 
+#include "common/exception.h"
+#include "execution/expressions/column_value_expression.h"
+
 namespace bustub {
 
 NestIndexJoinExecutor::NestIndexJoinExecutor(ExecutorContext *exec_ctx, const NestedIndexJoinPlanNode *plan,
                                              std::unique_ptr<AbstractExecutor> &&child_executor)
-    : AbstractExecutor(exec_ctx) {}
+    : AbstractExecutor(exec_ctx),
+      plan_{plan},
+      child_executor_{std::move(child_executor)},
+      inner_table_info_{exec_ctx->GetCatalog()->GetTable(plan->GetInnerTableOid())},
+      index_info_{exec_ctx->GetCatalog()->GetIndex(plan->GetIndexName(), inner_table_info_->name_)} {}
+
+void NestIndexJoinExecutor::Init() {
+  if (index_info_->index_->GetKeyAttrs().size() != 1 || OuterKeyExpression() == nullptr) {
+    throw NotImplementedException("NestIndexJoinExecutor: the predicate must equate an outer column with the key");
+  }
+  child_executor_->Init();
+  rids_.clear();
+  cursor_ = 0;
+  predicate_program_ =
+      ExpressionProgram::Compile(plan_->Predicate(), child_executor_->GetOutputSchema(), &inner_table_info_->schema_);
+}
+
+auto NestIndexJoinExecutor::Next(Tuple *tuple, RID *rid) -> bool {
+  auto *txn = exec_ctx_->GetTransaction();
+  const auto *predicate = plan_->Predicate();
+  const auto *outer_schema = child_executor_->GetOutputSchema();
+  const auto *inner_schema = &inner_table_info_->schema_;
+  const auto *output_schema = GetOutputSchema();
+  const auto key_attr = index_info_->index_->GetKeyAttrs()[0];
+  Tuple inner_tuple;
+  RID outer_rid;
+  while (true) {
+    while (cursor_ < rids_.size()) {
+      if (!inner_table_info_->table_->GetTuple(rids_[cursor_++], &inner_tuple, txn) ||
+          !(predicate_program_ != nullptr
+                ? predicate_program_->MatchesJoin(outer_tuple_, inner_tuple)
+                : predicate->EvaluateJoin(&outer_tuple_, outer_schema, &inner_tuple, inner_schema).GetAs<bool>())) {
+        continue;
+      }
+      std::vector<Value> values;
+      values.reserve(output_schema->GetColumnCount());
+      for (const auto &column : output_schema->GetColumns()) {
+        values.emplace_back(column.GetExpr()->EvaluateJoin(&outer_tuple_, outer_schema, &inner_tuple, inner_schema));
+      }
+      *tuple = Tuple{values, output_schema};
+      return true;
+    }
 
-void NestIndexJoinExecutor::Init() {}
+    // Probe the index with the next outer tuple
+    if (!child_executor_->Next(&outer_tuple_, &outer_rid)) {
+      return false;
+    }
+    rids_.clear();
+    cursor_ = 0;
+    auto value = OuterKeyExpression()->Evaluate(&outer_tuple_, outer_schema);
+    if (value.IsNull()) {
+      continue;
+    }
+    // Index keys are built from table values, so the probe is serialized with the inner column type
+    Tuple key{{value.CastAs(inner_schema->GetColumn(key_attr).GetType())}, &index_info_->key_schema_};
+    index_info_->index_->ScanKey(key, &rids_, txn);
+  }
+}
 
-auto NestIndexJoinExecutor::Next(Tuple *tuple, RID *rid) -> bool { return false; }
+auto NestIndexJoinExecutor::OuterKeyExpression() const -> const AbstractExpression * {
+  const auto *predicate = plan_->Predicate();
+  if (predicate == nullptr) {
+    return nullptr;
+  }
+  for (const auto *child : predicate->GetChildren()) {
+    const auto *column = dynamic_cast<const ColumnValueExpression *>(child);
+    if (column != nullptr && column->GetTupleIdx() == 0) {
+      return column;
+    }
+  }
+  return nullptr;
+}
 
 }  // namespace bustub
@@ -12,15 +12,65 @@
 
 #include "execution/executors/nested_loop_join_executor.h"
 
+#include <vector>
+
 namespace bustub {
 
 NestedLoopJoinExecutor::NestedLoopJoinExecutor(ExecutorContext *exec_ctx, const NestedLoopJoinPlanNode *plan,
                                                std::unique_ptr<AbstractExecutor> &&left_executor,
                                                std::unique_ptr<AbstractExecutor> &&right_executor)
-    : AbstractExecutor(exec_ctx) {}
+    : AbstractExecutor(exec_ctx),
+      plan_{plan},
+      left_executor_{std::move(left_executor)},
+      right_executor_{std::move(right_executor)} {}
+
+void NestedLoopJoinExecutor::Init() {
+  left_executor_->Init();
+  right_executor_->Init();
+  has_left_ = false;
+  predicate_program_ = ExpressionProgram::Compile(plan_->Predicate(), left_executor_->GetOutputSchema(),
+                                                  right_executor_->GetOutputSchema());
+}
 
-void NestedLoopJoinExecutor::Init() {}
+auto NestedLoopJoinExecutor::Next(Tuple *tuple, RID *rid) -> bool {
+  const auto *predicate = plan_->Predicate();
+  const auto *left_schema = left_executor_->GetOutputSchema();
+  const auto *right_schema = right_executor_->GetOutputSchema();
+  RID left_rid;
+  Tuple right_tuple;
+  RID right_rid;
+  while (true) {
+    if (!has_left_) {
+      if (!left_executor_->Next(&left_tuple_, &left_rid)) {
+        return false;
+      }
+      has_left_ = true;
+    }
+    while (right_executor_->Next(&right_tuple, &right_rid)) {
+      if (predicate == nullptr ||
+          (predicate_program_ != nullptr
+               ? predicate_program_->MatchesJoin(left_tuple_, right_tuple)
+               : predicate->EvaluateJoin(&left_tuple_, left_schema, &right_tuple, right_schema).GetAs<bool>())) {
+        *tuple = MakeOutputTuple(left_tuple_, right_tuple);
+        return true;
+      }
+    }
+    // The inner side is exhausted: rewind it and advance the outer side
+    right_executor_->Init();
+    has_left_ = false;
+  }
+}
 
-auto NestedLoopJoinExecutor::Next(Tuple *tuple, RID *rid) -> bool { return false; }
+auto NestedLoopJoinExecutor::MakeOutputTuple(const Tuple &left_tuple, const Tuple &right_tuple) -> Tuple {
+  const auto *output_schema = GetOutputSchema();
+  const auto *left_schema = left_executor_->GetOutputSchema();
+  const auto *right_schema = right_executor_->GetOutputSchema();
+  std::vector<Value> values;
+  values.reserve(output_schema->GetColumnCount());
+  for (const auto &column : output_schema->GetColumns()) {
+    values.emplace_back(column.GetExpr()->EvaluateJoin(&left_tuple, left_schema, &right_tuple, right_schema));
+  }
+  return Tuple{values, output_schema};
+}
 
 }  // namespace bustub
@@ -0,0 +1,102 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// radix_join_table.cpp
+//
+// Identification: src/execution/radix_join_table.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "execution/radix_join_table.h"
+
+#include <cstring>
+
+namespace bustub {
+
+void RadixPartitions::Partition(const std::vector<RadixEntry> &input, uint32_t radix_bits) {
+  radix_bits_ = radix_bits;
+  auto partitions = GetPartitionCount();
+
+  // Histogram, then prefix sums give every partition its range
+  offsets_.assign(partitions + 1, 0);
+  for (const auto &entry : input) {
+    offsets_[PartitionOf(entry.hash_, radix_bits) + 1]++;
+  }
+  for (uint32_t part = 0; part < partitions; part++) {
+    offsets_[part + 1] += offsets_[part];
+  }
+  entries_.resize(input.size());
+
+  // Scatter through the write-combining buffers
+  struct alignas(64) WriteCombineBuffer {
+    RadixEntry entries_[WRITE_COMBINE_ENTRIES];
+  };
+  std::vector<WriteCombineBuffer> buffers(partitions);
+  std::vector<size_t> fill(partitions, 0);
+  for (const auto &entry : input) {
+    auto part = PartitionOf(entry.hash_, radix_bits);
+    auto slot = fill[part]++ % WRITE_COMBINE_ENTRIES;
+    buffers[part].entries_[slot] = entry;
+    if (slot == WRITE_COMBINE_ENTRIES - 1) {
+      memcpy(&entries_[offsets_[part] + fill[part] - WRITE_COMBINE_ENTRIES], buffers[part].entries_,
+             sizeof(WriteCombineBuffer));
+    }
+  }
+  for (uint32_t part = 0; part < partitions; part++) {
+    auto staged = fill[part] % WRITE_COMBINE_ENTRIES;
+    if (staged != 0) {
+      memcpy(&entries_[offsets_[part] + fill[part] - staged], buffers[part].entries_, staged * sizeof(RadixEntry));
+    }
+  }
+}
+
+auto RadixJoinTable::ChooseRadixBits(size_t rows) -> uint32_t {
+  uint32_t radix_bits = 0;
+  while ((rows >> radix_bits) > TARGET_PARTITION_ROWS && radix_bits < MAX_RADIX_BITS) {
+    radix_bits++;
+  }
+  return radix_bits;
+}
+
+void RadixJoinTable::Build(const std::vector<RadixEntry> &entries, uint32_t radix_bits) {
+  radix_bits_ = radix_bits;
+  RadixPartitions partitions;
+  partitions.Partition(entries, radix_bits);
+
+  // Size every table to a power of two with a load factor of at most one half
+  auto count = partitions.GetPartitionCount();
+  table_offsets_.assign(count + 1, 0);
+  for (uint32_t part = 0; part < count; part++) {
+    size_t rows = partitions.PartitionEnd(part) - partitions.PartitionBegin(part);
+    size_t capacity = 2;
+    while (capacity < 2 * rows) {
+      capacity <<= 1;
+    }
+    table_offsets_[part + 1] = table_offsets_[part] + capacity;
+  }
+  slots_.assign(table_offsets_[count], RadixEntry{0, EMPTY_ROW});
+
+  // Partitions are built one at a time so that each table is cache resident while it is filled
+  for (uint32_t part = 0; part < count; part++) {
+    auto base = table_offsets_[part];
+    auto mask = table_offsets_[part + 1] - base - 1;
+    for (const auto *entry = partitions.PartitionBegin(part); entry != partitions.PartitionEnd(part); entry++) {
+      auto slot = (entry->hash_ >> radix_bits_) & mask;
+      while (slots_[base + slot].row_ != EMPTY_ROW) {
+        slot = (slot + 1) & mask;
+      }
+      slots_[base + slot] = *entry;
+    }
+  }
+}
+
+void RadixJoinTable::Clear() {
+  radix_bits_ = 0;
+  slots_.clear();
+  table_offsets_.clear();
+}
+
+}  // namespace bustub
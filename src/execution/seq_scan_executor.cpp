@@ -1,23 +1,133 @@
-//===----------------------------------------------------------------------===//
-//
-//                         BusTub
-//
-// seq_scan_executor.cpp
-//
-// Identification: src/execution/seq_scan_executor.cpp
-//
-// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
-//
-//===----------------------------------------------------------------------===//
-
-#include "execution/executors/seq_scan_executor.h"
-
-namespace bustub {
-
-SeqScanExecutor::SeqScanExecutor(ExecutorContext *exec_ctx, const SeqScanPlanNode *plan) : AbstractExecutor(exec_ctx) {}
-
-void SeqScanExecutor::Init() {}
-
-auto SeqScanExecutor::Next(Tuple *tuple, RID *rid) -> bool { return false; }
-
-}  // namespace bustub
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// seq_scan_executor.cpp
+//
+// Identification: src/execution/seq_scan_executor.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "execution/executors/seq_scan_executor.h"
+
+#include <vector>
+
+#include "common/exception.h"
+#include "execution/expressions/column_value_expression.h"
+
+namespace bustub {
+
+SeqScanExecutor::SeqScanExecutor(ExecutorContext *exec_ctx, const SeqScanPlanNode *plan)
+    : AbstractExecutor(exec_ctx), plan_{plan}, table_info_{exec_ctx->GetCatalog()->GetTable(plan->GetTableOid())} {}
+
+void SeqScanExecutor::Init() {
+  morsels_ = exec_ctx_->GetMorselQueue(plan_);
+  next_page_id_ = table_info_->table_->GetFirstPageId();
+  morsel_.clear();
+  morsel_idx_ = 0;
+  bloom_filter_ = nullptr;
+  bloom_key_ = nullptr;
+  predicate_program_ = ExpressionProgram::Compile(plan_->GetPredicate(), &table_info_->schema_);
+  ResetBatchAdapter();
+}
+
+auto SeqScanExecutor::Next(Tuple *tuple, RID *rid) -> bool { return NextFromBatch(tuple, rid); }
+
+auto SeqScanExecutor::NextBatch(TupleBatch *batch) -> bool {
+  batch->Reset();
+  auto *txn = exec_ctx_->GetTransaction();
+
+  // Keep scanning until the batch is full, so a selective predicate never yields an empty batch
+  while (!batch->IsFull()) {
+    auto page_id = NextPageId();
+    if (page_id == INVALID_PAGE_ID) {
+      break;
+    }
+    page_id_t next_page_id;
+    if (!table_info_->table_->ScanPage(page_id, txn, &page_views_, &next_page_id,
+                                       [this, batch](const auto &table_tuples) { ScanTuples(table_tuples, batch); })) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "SeqScanExecutor: no free frame to fetch a table page");
+    }
+    if (morsels_ == nullptr) {
+      next_page_id_ = next_page_id;
+    }
+  }
+  return !batch->IsEmpty();
+}
+
+auto SeqScanExecutor::NextPageId() -> page_id_t {
+  if (morsels_ == nullptr) {
+    return next_page_id_;
+  }
+  if (morsel_idx_ == morsel_.size()) {
+    morsel_idx_ = 0;
+    if (!morsels_->Next(&morsel_)) {
+      return INVALID_PAGE_ID;
+    }
+  }
+  return morsel_[morsel_idx_++];
+}
+
+void SeqScanExecutor::ScanTuples(const std::vector<Tuple> &table_tuples, TupleBatch *batch) {
+  const auto *predicate = plan_->GetPredicate();
+  const auto *table_schema = &table_info_->schema_;
+
+  // 1. Probe the Bloom filter, which is cheaper than the predicate and drops most probe rows of a selective join.
+  selection_.clear();
+  for (uint32_t i = 0; i < table_tuples.size(); i++) {
+    if (bloom_filter_ == nullptr || MayMatchBloomFilter(table_tuples[i])) {
+      selection_.push_back(i);
+    }
+  }
+
+  // 2. Evaluate a compiled predicate over the survivors at once, straight from the page bytes.
+  const auto *passes =
+      predicate_program_ != nullptr && !selection_.empty() ? &predicate_program_->Evaluate(table_tuples, selection_)
+                                                           : nullptr;
+
+  for (size_t i = 0; i < selection_.size(); i++) {
+    const auto &table_tuple = table_tuples[selection_[i]];
+    // 3. Interpret the predicate if it could not be compiled.
+    if (passes != nullptr ? (*passes)[i] == 0
+                          : predicate != nullptr && !predicate->Evaluate(&table_tuple, table_schema).GetAs<bool>()) {
+      continue;
+    }
+    // 4. Copy out only the output columns of the survivors.
+    batch->Append(Project(table_tuple), table_tuple.GetRid());
+  }
+}
+
+auto SeqScanExecutor::PushDownBloomFilter(const BloomFilter *filter, const AbstractExpression *key) -> bool {
+  // The key refers to the output schema; find the table expression that the output column projects
+  const auto *column_value = dynamic_cast<const ColumnValueExpression *>(key);
+  if (column_value == nullptr) {
+    return false;
+  }
+  const auto *table_key = plan_->OutputSchema()->GetColumn(column_value->GetColIdx()).GetExpr();
+  if (table_key == nullptr) {
+    return false;
+  }
+  bloom_filter_ = filter;
+  bloom_key_ = table_key;
+  return true;
+}
+
+auto SeqScanExecutor::MayMatchBloomFilter(const Tuple &table_tuple) const -> bool {
+  auto key = bloom_key_->Evaluate(&table_tuple, &table_info_->schema_);
+  // NULL keys never join
+  return !key.IsNull() && bloom_filter_->MayContain(HashUtil::HashValue(&key));
+}
+
+auto SeqScanExecutor::Project(const Tuple &table_tuple) const -> Tuple {
+  const auto *output_schema = plan_->OutputSchema();
+  std::vector<Value> values;
+  values.reserve(output_schema->GetColumnCount());
+  for (const auto &column : output_schema->GetColumns()) {
+    values.emplace_back(column.GetExpr()->Evaluate(&table_tuple, &table_info_->schema_));
+  }
+  return Tuple{values, output_schema};
+}
+
+}  // namespace bustub
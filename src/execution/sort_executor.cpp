@@ -0,0 +1,275 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// sort_executor.cpp
+//
+// Identification: src/execution/sort_executor.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "execution/executors/sort_executor.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace bustub {
+
+namespace {
+
+/** Append an unsigned integer to a key, most significant byte first */
+template <typename T>
+void AppendBigEndian(T bits, std::string *key) {
+  for (int shift = (sizeof(T) - 1) * 8; shift >= 0; shift -= 8) {
+    key->push_back(static_cast<char>((bits >> shift) & 0xFF));
+  }
+}
+
+/** Orders entries by key */
+template <typename Entry>
+auto KeyLess(const Entry &a, const Entry &b) -> bool {
+  return a.key_ < b.key_;
+}
+
+/** Orders entries by run, then by key, backwards: the heap of replacement selection is a min-heap */
+template <typename Entry>
+auto RunGreater(const Entry &a, const Entry &b) -> bool {
+  return a.run_ != b.run_ ? a.run_ > b.run_ : a.key_ > b.key_;
+}
+
+}  // namespace
+
+SortExecutor::SortExecutor(ExecutorContext *exec_ctx, const SortPlanNode *plan,
+                           std::unique_ptr<AbstractExecutor> &&child_executor, std::optional<size_t> limit)
+    : AbstractExecutor(exec_ctx), plan_{plan}, child_executor_{std::move(child_executor)}, limit_{limit} {}
+
+void SortExecutor::AppendNormalizedKey(const Value &value, OrderByType order_by, std::string *key) {
+  auto start = key->size();
+  if (value.IsNull()) {
+    key->push_back(0);
+  } else {
+    key->push_back(1);
+    // Signed integers have their sign bit flipped so that negative numbers come first as unsigned bytes
+    switch (value.GetTypeId()) {
+      case TypeId::BOOLEAN:
+      case TypeId::TINYINT:
+        AppendBigEndian(static_cast<uint8_t>(value.GetAs<int8_t>()) ^ uint8_t{0x80}, key);
+        break;
+      case TypeId::SMALLINT:
+        AppendBigEndian(static_cast<uint16_t>(static_cast<uint16_t>(value.GetAs<int16_t>()) ^ 0x8000U), key);
+        break;
+      case TypeId::INTEGER:
+        AppendBigEndian(static_cast<uint32_t>(value.GetAs<int32_t>()) ^ 0x80000000U, key);
+        break;
+      case TypeId::BIGINT:
+        AppendBigEndian(static_cast<uint64_t>(value.GetAs<int64_t>()) ^ (uint64_t{1} << 63), key);
+        break;
+      case TypeId::TIMESTAMP:
+        AppendBigEndian(value.GetAs<uint64_t>(), key);
+        break;
+      case TypeId::DECIMAL: {
+        // Negative doubles order backwards, so all their bits are flipped; -0.0 is folded into 0.0
+        auto decimal = value.GetAs<double>() + 0.0;
+        uint64_t bits;
+        memcpy(&bits, &decimal, sizeof(uint64_t));
+        AppendBigEndian((bits >> 63) != 0 ? ~bits : bits | (uint64_t{1} << 63), key);
+        break;
+      }
+      case TypeId::VARCHAR: {
+        // A zero byte is escaped as 0x00 0xFF and the string ends with 0x00 0x00, so prefixes come first
+        const auto *data = value.GetData();
+        for (uint32_t i = 0; i + 1 < value.GetLength(); i++) {
+          key->push_back(data[i]);
+          if (data[i] == 0) {
+            key->push_back(static_cast<char>(0xFF));
+          }
+        }
+        key->push_back(0);
+        key->push_back(0);
+        break;
+      }
+      default:
+        UNREACHABLE("Unsupported ORDER BY type");
+    }
+  }
+  if (order_by == OrderByType::Descending) {
+    for (auto i = start; i < key->size(); i++) {
+      (*key)[i] = static_cast<char>(~(*key)[i]);
+    }
+  }
+}
+
+auto SortExecutor::MakeKey(const Tuple &tuple) const -> std::string {
+  std::string key;
+  for (const auto &[order_by, expr] : plan_->GetOrderBys()) {
+    AppendNormalizedKey(expr->Evaluate(&tuple, child_executor_->GetOutputSchema()), order_by, &key);
+  }
+  return key;
+}
+
+auto SortExecutor::EntrySize(const SortEntry &entry) -> size_t {
+  return sizeof(SortEntry) + entry.key_.size() + entry.tuple_.GetLength();
+}
+
+void SortExecutor::Init() {
+  child_executor_->Init();
+  entries_.clear();
+  memory_ = 0;
+  top_n_ = limit_.has_value();
+  spilling_ = false;
+  current_run_ = 0;
+  last_key_.clear();
+  runs_.clear();
+  run_count_ = 0;
+  tree_.reset();
+  cursors_.clear();
+  cursor_ = 0;
+
+  TupleBatch batch;
+  while (child_executor_->NextBatch(&batch)) {
+    for (uint32_t i = 0; i < batch.Size(); i++) {
+      Tuple tuple{batch.TupleAt(i)};
+      auto key = MakeKey(tuple);
+      SortEntry entry{std::move(key), std::move(tuple), 0};
+      if (top_n_) {
+        AddTopN(std::move(entry));
+      } else {
+        AddSort(std::move(entry));
+      }
+    }
+  }
+
+  if (!spilling_) {
+    std::sort(entries_.begin(), entries_.end(), KeyLess<SortEntry>);
+    return;
+  }
+  while (!entries_.empty()) {
+    WriteSmallest();
+  }
+  runs_.back()->Seal();
+  MergeRuns();
+}
+
+void SortExecutor::AddTopN(SortEntry &&entry) {
+  // A max-heap on the key: its top is the entry that leaves first when a smaller one comes in
+  if (entries_.size() < *limit_) {
+    memory_ += EntrySize(entry);
+    entries_.emplace_back(std::move(entry));
+    std::push_heap(entries_.begin(), entries_.end(), KeyLess<SortEntry>);
+  } else if (!entries_.empty() && entry.key_ < entries_.front().key_) {
+    std::pop_heap(entries_.begin(), entries_.end(), KeyLess<SortEntry>);
+    memory_ -= EntrySize(entries_.back());
+    memory_ += EntrySize(entry);
+    entries_.back() = std::move(entry);
+    std::push_heap(entries_.begin(), entries_.end(), KeyLess<SortEntry>);
+  }
+  // A limit too large for memory gets no benefit from the heap; sort the rest of the input instead
+  if (memory_ > exec_ctx_->GetMemoryBudget()) {
+    top_n_ = false;
+  }
+}
+
+void SortExecutor::AddSort(SortEntry &&entry) {
+  // Replacement selection orders the heap on (run, key): the smallest entry of the current run leaves first
+  memory_ += EntrySize(entry);
+  if (spilling_) {
+    // An entry smaller than what the current run already holds has to wait for the next run
+    entry.run_ = entry.key_ >= last_key_ ? current_run_ : current_run_ + 1;
+    entries_.emplace_back(std::move(entry));
+    std::push_heap(entries_.begin(), entries_.end(), RunGreater<SortEntry>);
+  } else {
+    entries_.emplace_back(std::move(entry));
+    if (memory_ <= exec_ctx_->GetMemoryBudget()) {
+      return;
+    }
+    spilling_ = true;
+    for (auto &held : entries_) {
+      held.run_ = 0;
+    }
+    std::make_heap(entries_.begin(), entries_.end(), RunGreater<SortEntry>);
+  }
+  while (memory_ > exec_ctx_->GetMemoryBudget() && !entries_.empty()) {
+    WriteSmallest();
+  }
+}
+
+void SortExecutor::WriteSmallest() {
+  std::pop_heap(entries_.begin(), entries_.end(), RunGreater<SortEntry>);
+  auto &entry = entries_.back();
+  if (runs_.empty() || entry.run_ != current_run_) {
+    if (!runs_.empty()) {
+      runs_.back()->Seal();
+    }
+    runs_.emplace_back(std::make_unique<TmpTupleHeap>(exec_ctx_->GetBufferPoolManager()));
+    current_run_ = entry.run_;
+  }
+  runs_.back()->Append(entry.tuple_);
+  memory_ -= EntrySize(entry);
+  last_key_ = std::move(entry.key_);
+  entries_.pop_back();
+}
+
+void SortExecutor::Advance(RunCursor *cursor) {
+  cursor->valid_ = cursor->heap_->Next(&cursor->tuple_);
+  if (cursor->valid_) {
+    cursor->key_ = MakeKey(cursor->tuple_);
+  }
+}
+
+void SortExecutor::MergeRuns() {
+  run_count_ = runs_.size();
+  auto open = [this](std::vector<std::unique_ptr<TmpTupleHeap>>::iterator begin,
+                     std::vector<std::unique_ptr<TmpTupleHeap>>::iterator end) {
+    std::vector<RunCursor> cursors;
+    for (auto run = begin; run != end; ++run) {
+      (*run)->Rewind();
+      cursors.push_back(RunCursor{std::move(*run), Tuple{}, {}, false});
+      Advance(&cursors.back());
+    }
+    return cursors;
+  };
+
+  // Every run being read pins a page, so the fan-in is bounded by the buffer pool
+  auto fan_in = std::clamp<size_t>(exec_ctx_->GetBufferPoolManager()->GetPoolSize() / 4, 2, 64);
+  while (runs_.size() > fan_in) {
+    auto cursors = open(runs_.begin(), runs_.begin() + fan_in);
+    runs_.erase(runs_.begin(), runs_.begin() + fan_in);
+    auto merged = std::make_unique<TmpTupleHeap>(exec_ctx_->GetBufferPoolManager());
+    LoserTree<CursorLess> tree{cursors.size(), CursorLess{&cursors}};
+    for (auto winner = tree.Winner(); cursors[winner].valid_; winner = tree.Winner()) {
+      merged->Append(cursors[winner].tuple_);
+      Advance(&cursors[winner]);
+      tree.Replay();
+    }
+    merged->Seal();
+    runs_.emplace_back(std::move(merged));
+  }
+
+  cursors_ = open(runs_.begin(), runs_.end());
+  runs_.clear();
+  tree_ = std::make_unique<LoserTree<CursorLess>>(cursors_.size(), CursorLess{&cursors_});
+}
+
+auto SortExecutor::Next(Tuple *tuple, RID *rid) -> bool {
+  if (tree_ != nullptr) {
+    auto &cursor = cursors_[tree_->Winner()];
+    if (!cursor.valid_) {
+      return false;
+    }
+    *tuple = std::move(cursor.tuple_);
+    *rid = tuple->GetRid();
+    Advance(&cursor);
+    tree_->Replay();
+    return true;
+  }
+  if (cursor_ == entries_.size()) {
+    return false;
+  }
+  *tuple = std::move(entries_[cursor_++].tuple_);
+  *rid = tuple->GetRid();
+  return true;
+}
+
+}  // namespace bustub
@@ -0,0 +1,111 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// task_scheduler.cpp
+//
+// Identification: src/execution/task_scheduler.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "execution/task_scheduler.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace bustub {
+
+namespace {
+
+/** The scheduler and worker index of the current thread, if it is a worker */
+thread_local const TaskScheduler *current_scheduler = nullptr;
+thread_local size_t current_worker = 0;
+
+}  // namespace
+
+TaskScheduler::TaskScheduler(size_t threads) {
+  threads = std::max<size_t>(threads, 1);
+  for (size_t i = 0; i < threads; i++) {
+    queues_.emplace_back(std::make_unique<WorkerQueue>());
+  }
+  for (size_t i = 0; i < threads; i++) {
+    threads_.emplace_back([this, i] { Run(i); });
+  }
+}
+
+TaskScheduler::~TaskScheduler() {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+}
+
+auto TaskScheduler::Submit(std::function<void()> task) -> std::future<void> {
+  std::packaged_task<void()> packaged{std::move(task)};
+  auto future = packaged.get_future();
+  auto worker = current_scheduler == this ? current_worker : next_queue_++ % queues_.size();
+  // Count the task first, so that a worker taking it right away never drives the count below zero
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    queued_++;
+  }
+  {
+    std::lock_guard<std::mutex> guard(queues_[worker]->latch_);
+    queues_[worker]->tasks_.emplace_back(std::move(packaged));
+  }
+  wake_.notify_one();
+  return future;
+}
+
+void TaskScheduler::Run(size_t worker) {
+  current_scheduler = this;
+  current_worker = worker;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> guard(latch_);
+      wake_.wait(guard, [this] { return queued_ > 0 || stopping_; });
+      if (queued_ == 0) {
+        return;
+      }
+    }
+    std::packaged_task<void()> task;
+    if (TryTake(worker, &task)) {
+      {
+        std::lock_guard<std::mutex> guard(latch_);
+        queued_--;
+      }
+      // Exceptions are stored in the task's future
+      task();
+    }
+  }
+}
+
+auto TaskScheduler::TryTake(size_t worker, std::packaged_task<void()> *task) -> bool {
+  {
+    auto &own = *queues_[worker];
+    std::lock_guard<std::mutex> guard(own.latch_);
+    if (!own.tasks_.empty()) {
+      *task = std::move(own.tasks_.back());
+      own.tasks_.pop_back();
+      return true;
+    }
+  }
+  for (size_t i = 1; i < queues_.size(); i++) {
+    auto &victim = *queues_[(worker + i) % queues_.size()];
+    std::lock_guard<std::mutex> guard(victim.latch_);
+    if (!victim.tasks_.empty()) {
+      *task = std::move(victim.tasks_.front());
+      victim.tasks_.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace bustub
@@ -11,17 +11,54 @@
 //===----------------------------------------------------------------------===//
 #include <memory>
 
+#include "common/exception.h"
 #include "execution/executors/update_executor.h"
 
 namespace bustub {
 
 UpdateExecutor::UpdateExecutor(ExecutorContext *exec_ctx, const UpdatePlanNode *plan,
                                std::unique_ptr<AbstractExecutor> &&child_executor)
-    : AbstractExecutor(exec_ctx) {}
+    : AbstractExecutor(exec_ctx),
+      plan_{plan},
+      table_info_{exec_ctx->GetCatalog()->GetTable(plan->TableOid())},
+      child_executor_{std::move(child_executor)} {}
 
-void UpdateExecutor::Init() {}
+void UpdateExecutor::Init() {
+  indexes_ = exec_ctx_->GetCatalog()->GetTableIndexes(table_info_->name_);
+  child_executor_->Init();
+}
+
+auto UpdateExecutor::Next([[maybe_unused]] Tuple *tuple, RID *rid) -> bool {
+  TupleBatch batch;
+  while (child_executor_->NextBatch(&batch)) {
+    for (uint32_t i = 0; i < batch.Size(); i++) {
+      UpdateTuple(batch.RidAt(i));
+    }
+  }
+  return false;
+}
 
-auto UpdateExecutor::Next([[maybe_unused]] Tuple *tuple, RID *rid) -> bool { return false; }
+void UpdateExecutor::UpdateTuple(const RID &rid) {
+  auto *txn = exec_ctx_->GetTransaction();
+  // The child may have projected away columns, so the update is computed from the stored tuple
+  Tuple old_tuple;
+  if (!table_info_->table_->GetTuple(rid, &old_tuple, txn)) {
+    throw Exception("UpdateExecutor: the tuple to be updated does not exist");
+  }
+  Tuple new_tuple = GenerateUpdatedTuple(old_tuple);
+  if (!table_info_->table_->UpdateTuple(new_tuple, rid, txn)) {
+    throw Exception("UpdateExecutor: the tuple could not be updated in place");
+  }
+  for (auto *index_info : indexes_) {
+    const auto &key_attrs = index_info->index_->GetKeyAttrs();
+    index_info->index_->DeleteEntry(old_tuple.KeyFromTuple(table_info_->schema_, index_info->key_schema_, key_attrs),
+                                    rid, txn);
+    index_info->index_->InsertEntry(new_tuple.KeyFromTuple(table_info_->schema_, index_info->key_schema_, key_attrs),
+                                    rid, txn);
+    txn->GetIndexWriteSet()->emplace_back(rid, table_info_->oid_, WType::UPDATE, new_tuple, old_tuple,
+                                          index_info->index_oid_, exec_ctx_->GetCatalog());
+  }
+}
 
 auto UpdateExecutor::GenerateUpdatedTuple(const Tuple &src_tuple) -> Tuple {
   const auto &update_attrs = plan_->GetUpdateAttr();
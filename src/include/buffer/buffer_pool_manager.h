@@ -15,6 +15,7 @@
 #include <list>
 #include <mutex>  // NOLINT
 #include <unordered_map>
+#include <vector>
 
 #include "buffer/lru_replacer.h"
 #include "recovery/log_manager.h"
@@ -87,6 +88,12 @@ class BufferPoolManager {
   /** @return size of the buffer pool */
   virtual auto GetPoolSize() -> size_t = 0;
 
+  /**
+   * @return the pages that may differ from their image on disk, with the log file offset redo must start at to
+   * bring each up to date, for the dirty page table of a checkpoint
+   */
+  virtual auto GetDirtyPageTable() -> std::vector<DirtyPageEntry> = 0;
+
  protected:
   /**
    * Grading function. Do not modify!
@@ -41,6 +41,9 @@ class ParallelBufferPoolManager : public BufferPoolManager {
   /** @return size of the buffer pool */
   auto GetPoolSize() -> size_t override;
 
+  /** @return the dirty pages of every instance */
+  auto GetDirtyPageTable() -> std::vector<DirtyPageEntry> override;
+
  protected:
   /**
    * @param page_id id of page
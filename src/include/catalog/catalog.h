@@ -20,6 +20,7 @@
 
 #include "buffer/buffer_pool_manager.h"
 #include "catalog/schema.h"
+#include "concurrency/transaction_manager.h"
 #include "container/hash/hash_function.h"
 #include "storage/index/extendible_hash_table_index.h"
 #include "storage/index/index.h"
@@ -322,6 +323,33 @@ class Catalog {
     return indexes;
   }
 
+  /**
+   * Vacuum a table (see TableHeap::Vacuum()) and keep its indexes pointing at the tuples it moves. The vacuum runs
+   * in an exclusive transaction of its own, so it waits for the running transactions to end and keeps new ones out
+   * until it is done; the calling thread must not be running a transaction.
+   * @param txn_mgr The transaction manager to run the vacuum under
+   * @param table_name The name of the table
+   * @return The number of pages deleted from the table
+   */
+  auto VacuumTable(TransactionManager *txn_mgr, const std::string &table_name) -> size_t {
+    auto *table_info = GetTable(table_name);
+    BUSTUB_ASSERT(table_info != NULL_TABLE_INFO, "Vacuuming a table that does not exist");
+    auto indexes = GetTableIndexes(table_name);
+    auto *txn = txn_mgr->BeginExclusive();
+    auto pages_deleted =
+        table_info->table_->Vacuum(txn, [&](const Tuple &tuple, const RID &old_rid, const RID &new_rid) {
+          for (auto *index_info : indexes) {
+            auto key =
+                tuple.KeyFromTuple(table_info->schema_, index_info->key_schema_, index_info->index_->GetKeyAttrs());
+            index_info->index_->DeleteEntry(key, old_rid, txn);
+            index_info->index_->InsertEntry(key, new_rid, txn);
+          }
+        });
+    txn_mgr->Commit(txn);
+    delete txn;
+    return pages_deleted;
+  }
+
  private:
   [[maybe_unused]] BufferPoolManager *bpm_;
   [[maybe_unused]] LockManager *lock_manager_;
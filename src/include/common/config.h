@@ -14,6 +14,7 @@
 
 #include <atomic>
 #include <chrono>  // NOLINT
+#include <cstddef>
 #include <cstdint>
 
 namespace bustub {
@@ -24,22 +25,34 @@ extern std::chrono::milliseconds cycle_detection_interval;
 /** True if logging should be enabled, false otherwise. */
 extern std::atomic<bool> enable_logging;
 
+/**
+ * True if table heaps should keep the old versions of tuples for SNAPSHOT_ISOLATION transactions, false otherwise.
+ * Only changed while no transaction runs.
+ */
+extern std::atomic<bool> enable_mvcc;
+
 /** If ENABLE_LOGGING is true, the log should be flushed to disk every LOG_TIMEOUT. */
 extern std::chrono::duration<int64_t> log_timeout;
 
 static constexpr int INVALID_PAGE_ID = -1;                                    // invalid page id
 static constexpr int INVALID_TXN_ID = -1;                                     // invalid transaction id
 static constexpr int INVALID_LSN = -1;                                        // invalid log sequence number
+static constexpr int INVALID_TS = -1;                                         // timestamp of an uncommitted write
 static constexpr int HEADER_PAGE_ID = 0;                                      // the header page id
 static constexpr int PAGE_SIZE = 4096;                                        // size of a data page in byte
 static constexpr int BUFFER_POOL_SIZE = 10;                                   // size of buffer pool
 static constexpr int LOG_BUFFER_SIZE = ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE);  // size of a log buffer in byte
+static constexpr int LOG_SEGMENT_SIZE = 1 << 20;                              // size of a log segment file in byte
+static constexpr uint32_t LOCK_ESCALATION_THRESHOLD = 64;                     // row locks on a page before locking it
 static constexpr int BUCKET_SIZE = 50;                                        // size of extendible hash bucket
+static constexpr int TUPLE_BATCH_SIZE = 1024;                                 // tuples moved per NextBatch() call
+static constexpr size_t EXECUTOR_MEMORY_BUDGET = 1 << 24;                     // per-operator bytes before spilling
 
 using frame_id_t = int32_t;    // frame id type
 using page_id_t = int32_t;     // page id type
 using txn_id_t = int32_t;      // transaction id type
 using lsn_t = int32_t;         // log sequence number type
+using timestamp_t = int64_t;   // commit timestamp type
 using slot_offset_t = size_t;  // slot offset type
 using oid_t = uint16_t;
 
@@ -13,6 +13,8 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
 #include <cstdlib>
 #include <iostream>
 #include <string>
@@ -45,6 +47,40 @@ class HashUtil {
     return HashBytes(reinterpret_cast<char *>(both), sizeof(hash_t) * 2);
   }
 
+  /**
+   * Scramble a hash so that every output bit depends on every input bit (the MurmurHash3 64-bit finalizer).
+   * Use it before taking a few bits of a hash, e.g. to pick a partition or a filter block.
+   */
+  static inline auto Finalize(hash_t hash) -> hash_t {
+    uint64_t mixed = hash;
+    mixed ^= mixed >> 33;
+    mixed *= 0xff51afd7ed558ccdULL;
+    mixed ^= mixed >> 33;
+    mixed *= 0xc4ceb9fe1a85ec53ULL;
+    mixed ^= mixed >> 33;
+    return static_cast<hash_t>(mixed);
+  }
+
+  /** @return the CRC32C (Castagnoli) checksum of the bytes, as used by iSCSI and ext4 */
+  static inline auto Crc32c(const char *bytes, size_t length) -> uint32_t {
+    static const std::array<uint32_t, 256> TABLE = [] {
+      std::array<uint32_t, 256> table{};
+      for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+          crc = (crc >> 1) ^ ((crc & 1U) != 0 ? 0x82f63b78U : 0U);
+        }
+        table[i] = crc;
+      }
+      return table;
+    }();
+    uint32_t crc = 0xffffffffU;
+    for (size_t i = 0; i < length; i++) {
+      crc = (crc >> 8) ^ TABLE[(crc ^ static_cast<uint8_t>(bytes[i])) & 0xffU];
+    }
+    return crc ^ 0xffffffffU;
+  }
+
   static inline auto SumHashes(hash_t l, hash_t r) -> hash_t {
     return (l % PRIME_FACTOR + r % PRIME_FACTOR) % PRIME_FACTOR;
   }
@@ -59,24 +95,27 @@ class HashUtil {
     return HashBytes(reinterpret_cast<const char *>(&ptr), sizeof(void *));
   }
 
-  /** @return the hash of the value */
+  /**
+   * @return the hash of the value. All integer types hash alike, so equal values of different widths collide.
+   * Integers are not run through HashBytes(), which maps many small integers to the same hash.
+   */
   static inline auto HashValue(const Value *val) -> hash_t {
     switch (val->GetTypeId()) {
       case TypeId::TINYINT: {
         auto raw = static_cast<int64_t>(val->GetAs<int8_t>());
-        return Hash<int64_t>(&raw);
+        return Finalize(static_cast<hash_t>(raw));
       }
       case TypeId::SMALLINT: {
         auto raw = static_cast<int64_t>(val->GetAs<int16_t>());
-        return Hash<int64_t>(&raw);
+        return Finalize(static_cast<hash_t>(raw));
       }
       case TypeId::INTEGER: {
         auto raw = static_cast<int64_t>(val->GetAs<int32_t>());
-        return Hash<int64_t>(&raw);
+        return Finalize(static_cast<hash_t>(raw));
       }
       case TypeId::BIGINT: {
         auto raw = static_cast<int64_t>(val->GetAs<int64_t>());
-        return Hash<int64_t>(&raw);
+        return Finalize(static_cast<hash_t>(raw));
       }
       case TypeId::BOOLEAN: {
         auto raw = val->GetAs<bool>();
@@ -13,10 +13,15 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <condition_variable>  // NOLINT
 #include <list>
+#include <map>
 #include <memory>
 #include <mutex>  // NOLINT
+#include <set>
+#include <thread>  // NOLINT
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -29,16 +34,45 @@ namespace bustub {
 
 class TransactionManager;
 
+/** How the lock manager keeps transactions from waiting for each other forever */
+enum class DeadlockPolicy {
+  /** Transactions wait; a background thread finds cycles in the waits-for graph and aborts their youngest member */
+  DETECTION,
+  /** An older transaction aborts (wounds) the younger ones in its way; a younger one waits for older ones */
+  WOUND_WAIT
+};
+
 /**
- * LockManager handles transactions asking for locks on records.
+ * LockManager handles transactions asking for locks on tables, pages and records.
+ *
+ * Locks form a hierarchy: a row lock first takes an intention lock (INTENTION_SHARED or INTENTION_EXCLUSIVE) on the
+ * row's page, and a page lock in SHARED, SHARED_INTENTION_EXCLUSIVE or EXCLUSIVE mode covers the rows of the page,
+ * so no row locks are taken under it. Once a transaction holds more than the escalation threshold of row locks on a
+ * page, the page lock is escalated to cover them and the row locks are dropped, which bounds the lock bookkeeping of
+ * a scan or a bulk update by the number of pages. Table locks are taken explicitly by the caller, which knows the
+ * table of the rows it locks; the lock manager does not.
+ *
+ * Every locked object has a queue of requests in arrival order. A request is granted once it is compatible with
+ * every request ahead of it, so a stream of shared requests cannot starve an exclusive one; an upgrade waits for
+ * the other holders to leave. Locks are held until the transaction commits or aborts (strict 2PL), except that
+ * READ_COMMITTED transactions may release shared locks early and READ_UNCOMMITTED transactions take no shared locks
+ * at all.
+ *
+ * The lock table is split into LOCK_TABLE_SHARDS shards by the hash of the object, each with its own latch over its
+ * map of queues, and every queue has its own latch that its waiters sleep on. Requests on different objects only
+ * meet on a shard latch, held just long enough to find the queue. The list nodes of finished requests are kept in a
+ * free list of their shard and spliced into queues again, so the steady state allocates no memory.
  */
 class LockManager {
-  enum class LockMode { SHARED, EXCLUSIVE };
+  /** A lockable object: the level in the top bits, then the table oid, page id or RID */
+  using LockKey = uint64_t;
 
   class LockRequest {
    public:
-    LockRequest(txn_id_t txn_id, LockMode lock_mode) : txn_id_(txn_id), lock_mode_(lock_mode), granted_(false) {}
+    LockRequest(Transaction *txn, LockMode lock_mode)
+        : txn_(txn), txn_id_(txn->GetTransactionId()), lock_mode_(lock_mode), granted_(false) {}
 
+    Transaction *txn_;
     txn_id_t txn_id_;
     LockMode lock_mode_;
     bool granted_;
@@ -46,28 +80,46 @@ class LockManager {
 
   class LockRequestQueue {
    public:
+    // protects the queue
+    std::mutex latch_;
     std::list<LockRequest> request_queue_;
-    // for notifying blocked transactions on this rid
+    // for notifying blocked transactions on this object
     std::condition_variable cv_;
     // txn_id of an upgrading transaction (if any)
     txn_id_t upgrading_ = INVALID_TXN_ID;
+    // the threads using the queue outside the shard latch, which keep it in the lock table; protected by the shard
+    size_t users_ = 0;
+  };
+
+  /** A part of the lock table */
+  class LockTableShard {
+   public:
+    std::mutex latch_;
+    std::unordered_map<LockKey, LockRequestQueue> queues_;
+    // list nodes of finished requests, for reuse
+    std::list<LockRequest> free_requests_;
   };
 
  public:
   /**
    * Creates a new lock manager configured for the deadlock prevention policy.
+   * @param policy how deadlocks are handled; DETECTION starts the cycle detection thread
+   * @param escalation_threshold the number of row locks a transaction may hold on a page before the page is locked
    */
-  LockManager() = default;
+  explicit LockManager(DeadlockPolicy policy = DeadlockPolicy::DETECTION,
+                       uint32_t escalation_threshold = LOCK_ESCALATION_THRESHOLD);
 
-  ~LockManager() = default;
+  ~LockManager();
 
   /*
    * [LOCK_NOTE]: For all locking functions, we:
-   * 1. return false if the transaction is aborted; and
+   * 1. return false if the transaction is aborted, including when it is chosen as a deadlock victim or wounded
+   * while it waits; and
    * 2. block on wait, return true when the lock request is granted; and
    * 3. it is undefined behavior to try locking an already locked RID in the
    * same transaction, i.e. the transaction is responsible for keeping track of
    * its current locks.
+   * Requests that break the locking protocol set the transaction to ABORTED and throw TransactionAbortException.
    */
 
   /**
@@ -95,6 +147,26 @@ class LockManager {
    */
   auto LockUpgrade(Transaction *txn, const RID &rid) -> bool;
 
+  /**
+   * Acquire a lock on RID in shared mode if it can be granted right away, for a caller holding a page latch, which
+   * must not wait for a lock: the holder of the lock may need the latch to finish. Unlike LockShared(), it returns
+   * false instead of waiting or throwing, without aborting the transaction; the caller then releases its latches
+   * and calls LockShared(), which waits or aborts the transaction.
+   * @param txn the transaction requesting the shared lock
+   * @param rid the RID to be locked in shared mode
+   * @return true if the lock is granted, false otherwise
+   */
+  auto TryLockShared(Transaction *txn, const RID &rid) -> bool;
+
+  /**
+   * Acquire a lock on RID in exclusive mode, upgrading a shared lock, if it can be granted right away. See
+   * TryLockShared().
+   * @param txn the transaction requesting the exclusive lock
+   * @param rid the RID to be locked in exclusive mode
+   * @return true if the lock is granted, false otherwise
+   */
+  auto TryLockExclusive(Transaction *txn, const RID &rid) -> bool;
+
   /**
    * Release the lock held by the transaction.
    * @param txn the transaction releasing the lock, it should actually hold the
@@ -104,11 +176,197 @@ class LockManager {
    */
   auto Unlock(Transaction *txn, const RID &rid) -> bool;
 
+  /**
+   * Acquire or strengthen a lock on a table. See [LOCK_NOTE] in header file.
+   * @param txn the transaction requesting the lock
+   * @param mode the lock mode; a transaction holding SHARED that asks for INTENTION_EXCLUSIVE gets
+   * SHARED_INTENTION_EXCLUSIVE
+   * @param oid the table to lock
+   * @return true if the lock is granted, false otherwise
+   */
+  auto LockTable(Transaction *txn, LockMode mode, table_oid_t oid) -> bool;
+
+  /**
+   * Release the lock held by the transaction on a table.
+   * @return true if the unlock is successful, false otherwise
+   */
+  auto UnlockTable(Transaction *txn, table_oid_t oid) -> bool;
+
+  /**
+   * Release the lock held by the transaction on a page, which its row locks took. Used when the transaction ends.
+   * @return true if the unlock is successful, false otherwise
+   */
+  auto UnlockPage(Transaction *txn, page_id_t page_id) -> bool;
+
+  /** @return `true` if a lock held in mode `held` covers a request for mode `wanted` */
+  static auto Covers(LockMode held, LockMode wanted) -> bool;
+
+  /** @return `true` if locks in the two modes can be held by different transactions at once */
+  static auto AreCompatible(LockMode first, LockMode second) -> bool;
+
+  /** @return the deadlock policy */
+  auto GetDeadlockPolicy() const -> DeadlockPolicy { return policy_; }
+
+  /*** Graph API ***/
+
+  /** Adds an edge from t1 -> t2. */
+  void AddEdge(txn_id_t t1, txn_id_t t2);
+
+  /** Removes an edge from t1 -> t2. */
+  void RemoveEdge(txn_id_t t1, txn_id_t t2);
+
+  /**
+   * Checks if the graph has a cycle, returning the newest transaction ID in the cycle if so.
+   * @param[out] txn_id if the graph has a cycle, will contain the newest transaction ID
+   * @return false if the graph has no cycle, otherwise stores the newest transaction ID in the cycle to txn_id
+   */
+  auto HasCycle(txn_id_t *txn_id) -> bool;
+
+  /** @return the set of all edges in the graph, used for testing only! */
+  auto GetEdgeList() -> std::vector<std::pair<txn_id_t, txn_id_t>>;
+
+  /** Runs cycle detection in the background. */
+  void RunCycleDetection();
+
  private:
-  std::mutex latch_;
+  /** Number of shards of the lock table */
+  static constexpr size_t LOCK_TABLE_SHARDS = 64;
+
+  static auto TableKey(table_oid_t oid) -> LockKey { return 2ULL << 62 | oid; }
+  static auto PageKey(page_id_t page_id) -> LockKey { return 1ULL << 62 | static_cast<uint32_t>(page_id); }
+  /** Page ids stay below 2^30, so the page id of a row never reaches the level bits */
+  static auto RowKey(const RID &rid) -> LockKey {
+    return static_cast<LockKey>(static_cast<uint32_t>(rid.GetPageId())) << 32 | rid.GetSlotNum();
+  }
+
+  /** @return the weakest mode that covers both modes */
+  static auto Combine(LockMode first, LockMode second) -> LockMode;
+
+  auto GetShard(LockKey key) -> LockTableShard & { return shards_[std::hash<LockKey>()(key) % LOCK_TABLE_SHARDS]; }
+
+  /**
+   * Find or create the queue of an object and register as a user, so it stays in the lock table until
+   * ReleaseQueue().
+   * @param[out] request if not nullptr, receives a list node holding a new request of the transaction
+   */
+  auto AcquireQueue(LockKey key, std::list<LockRequest> *request, Transaction *txn, LockMode mode)
+      -> LockRequestQueue *;
+
+  /**
+   * Unregister as a user of a queue, dropping it if it is unused and empty.
+   * @param freed list nodes of finished requests to recycle
+   */
+  void ReleaseQueue(LockKey key, LockRequestQueue *queue, std::list<LockRequest> *freed);
+
+  /**
+   * Lock an object, or change the mode of the transaction's lock on it.
+   * @param held the mode the transaction holds the object in, or nullptr if it holds no lock on it
+   * @param wait whether to wait for the lock, rather than give up if it cannot be granted right away
+   * @return `true` if the lock is granted; throws if another transaction is upgrading its lock on the object
+   */
+  auto Acquire(Transaction *txn, LockKey key, LockMode mode, const LockMode *held, bool wait = true) -> bool;
+
+  /** Remove the transaction's lock on an object, without changing the state of the transaction. */
+  void Release(Transaction *txn, LockKey key);
+
+  /** Lock the page of a row in at least the given mode, recording it in the transaction */
+  auto LockPage(Transaction *txn, page_id_t page_id, LockMode mode, bool wait) -> bool;
+
+  /** @return the mode the transaction holds a page in, or nullptr if it holds no lock on it */
+  static auto GetPageMode(Transaction *txn, page_id_t page_id) -> const LockMode *;
+
+  /**
+   * Count a new row lock on a page, and escalate the page lock once there are too many.
+   * @param mode SHARED or EXCLUSIVE, the mode of the new row lock
+   * @param wait whether to wait for the page lock; if not, a page lock that cannot be granted right away is left
+   * to a later row lock to escalate
+   * @return `false` if the transaction was aborted while escalating
+   */
+  auto CountRowLock(Transaction *txn, page_id_t page_id, LockMode mode, bool wait) -> bool;
+
+  /** Lock a row in shared mode; see LockShared() and TryLockShared() */
+  auto LockRowShared(Transaction *txn, const RID &rid, bool wait) -> bool;
+
+  /** Lock a row in exclusive mode; see LockExclusive() and TryLockExclusive() */
+  auto LockRowExclusive(Transaction *txn, const RID &rid, bool wait) -> bool;
+
+  /** Upgrade the shared lock on a row; see LockUpgrade() and TryLockExclusive() */
+  auto UpgradeRow(Transaction *txn, const RID &rid, bool wait) -> bool;
+
+  /** End the growing phase of a transaction that released a lock in the given mode */
+  static void ShrinkOnUnlock(Transaction *txn, LockMode mode);
+
+  /**
+   * @return `true` if the request is compatible with every request ahead of it and every granted request behind it.
+   * Called with the queue latch held.
+   */
+  auto IsGrantable(const LockRequestQueue &queue, const LockRequest &request) const -> bool;
+
+  /**
+   * Wait until the transaction's request is granted, or the transaction is aborted. Called with the queue latch held.
+   * @return `true` if the request was granted
+   */
+  auto WaitForGrant(std::unique_lock<std::mutex> *lock, LockRequestQueue *queue, Transaction *txn, LockKey key)
+      -> bool;
+
+  /**
+   * Take the transaction's request out of a queue and wake the waiters behind it. Called with the queue latch held.
+   * @param[out] freed receives the list node of the request
+   */
+  void RemoveRequest(LockRequestQueue *queue, txn_id_t txn_id, std::list<LockRequest> *freed);
+
+  /**
+   * Abort the younger transactions whose requests are ahead of the request and conflict with it.
+   * @return the ids of the transactions wounded, to be woken once the queue latch is released
+   */
+  auto Wound(LockRequestQueue *queue, const LockRequest &request) -> std::vector<txn_id_t>;
+
+  /**
+   * Abort a transaction, unless it is no longer waiting for the given object.
+   * @param key the object the transaction waits for, or nullptr to abort it whether it waits or not; a transaction
+   * that does not wait must be kept alive by the caller, such as by a request in a latched queue
+   * @return `true` if the transaction was aborted
+   */
+  auto AbortTransaction(Transaction *txn, txn_id_t txn_id, const LockKey *key) -> bool;
+
+  /** Wake the transaction if it waits for a lock. Called without queue latches held. */
+  void WakeUp(txn_id_t txn_id);
+
+  /** Set the transaction to ABORTED and throw. */
+  [[noreturn]] static void AbortImplicitly(Transaction *txn, AbortReason reason);
+
+  /**
+   * Refuse a request that breaks the locking protocol: a request that may wait aborts the transaction and throws,
+   * one that may not returns false and leaves the abort to the request the caller makes once it may wait.
+   */
+  static auto Refuse(Transaction *txn, AbortReason reason, bool wait) -> bool;
+
+  /**
+   * Rebuild the waits-for graph from the lock table.
+   * @param[out] waiters receives the blocked transactions and the objects they wait for
+   */
+  void BuildWaitsForGraph(std::unordered_map<txn_id_t, std::pair<Transaction *, LockKey>> *waiters);
+
+  const DeadlockPolicy policy_;
+  /** The number of row locks on a page past which the page is locked instead */
+  const uint32_t escalation_threshold_;
+
+  /** The lock table */
+  std::array<LockTableShard, LOCK_TABLE_SHARDS> shards_;
+
+  /** Protects `waiting_for_` and the aborts of other transactions */
+  std::mutex waiting_latch_;
+  /** The object every blocked transaction waits for */
+  std::unordered_map<txn_id_t, LockKey> waiting_for_;
+
+  /** Waits-for graph representation, with the targets of every transaction in ascending order. */
+  std::map<txn_id_t, std::set<txn_id_t>> waits_for_;
 
-  /** Lock table for lock requests. */
-  std::unordered_map<RID, LockRequestQueue> lock_table_;
+  std::atomic<bool> enable_cycle_detection_{false};
+  std::thread *cycle_detection_thread_{nullptr};
+  /** Wakes the cycle detection thread to stop it */
+  std::mutex detection_latch_;
+  std::condition_variable detection_cv_;
 };
 
 }  // namespace bustub
@@ -17,6 +17,7 @@
 #include <memory>
 #include <string>
 #include <thread>  // NOLINT
+#include <unordered_map>
 #include <unordered_set>
 
 #include "common/config.h"
@@ -44,14 +45,22 @@ namespace bustub {
 enum class TransactionState { GROWING, SHRINKING, COMMITTED, ABORTED };
 
 /**
- * Transaction isolation level.
+ * Transaction isolation level. SNAPSHOT_ISOLATION reads the tables as of the start of the transaction without taking
+ * locks, and aborts a write to a tuple another transaction wrote since then; it needs `enable_mvcc`.
  */
-enum class IsolationLevel { READ_UNCOMMITTED, REPEATABLE_READ, READ_COMMITTED };
+enum class IsolationLevel { READ_UNCOMMITTED, REPEATABLE_READ, READ_COMMITTED, SNAPSHOT_ISOLATION };
 
 /**
- * Type of write operation.
+ * Lock modes, from the intention modes taken on a table or page before locking inside it to the whole-object modes.
+ * SHARED_INTENTION_EXCLUSIVE reads the whole object and locks the parts it writes.
  */
-enum class WType { INSERT = 0, DELETE, UPDATE };
+enum class LockMode { INTENTION_SHARED, INTENTION_EXCLUSIVE, SHARED, SHARED_INTENTION_EXCLUSIVE, EXCLUSIVE };
+
+/**
+ * Type of write operation. INSERT_PAGE stands for the tuples a bulk append put in a fresh page: the rid names the
+ * page, and its slot number is the number of tuples appended.
+ */
+enum class WType { INSERT = 0, DELETE, UPDATE, INSERT_PAGE };
 
 class TableHeap;
 class Catalog;
@@ -161,7 +170,9 @@ class Transaction {
         txn_id_(txn_id),
         prev_lsn_(INVALID_LSN),
         shared_lock_set_{new std::unordered_set<RID>},
-        exclusive_lock_set_{new std::unordered_set<RID>} {
+        exclusive_lock_set_{new std::unordered_set<RID>},
+        page_lock_set_{new std::unordered_map<page_id_t, LockMode>},
+        table_lock_set_{new std::unordered_map<table_oid_t, LockMode>} {
     // Initialize the sets that will be tracked.
     table_write_set_ = std::make_shared<std::deque<TableWriteRecord>>();
     index_write_set_ = std::make_shared<std::deque<IndexWriteRecord>>();
@@ -236,6 +247,23 @@ class Transaction {
     return exclusive_lock_set_->find(rid) != exclusive_lock_set_->end();
   }
 
+  /** @return true if the page is exclusively locked by this transaction, which covers the rows on it */
+  auto IsPageExclusiveLocked(page_id_t page_id) -> bool {
+    auto lock = page_lock_set_->find(page_id);
+    return lock != page_lock_set_->end() && lock->second == LockMode::EXCLUSIVE;
+  }
+
+  /** @return the pages locked by this transaction, as parents of its row locks or in their place */
+  inline auto GetPageLockSet() -> std::shared_ptr<std::unordered_map<page_id_t, LockMode>> { return page_lock_set_; }
+
+  /** @return the tables locked by this transaction */
+  inline auto GetTableLockSet() -> std::shared_ptr<std::unordered_map<table_oid_t, LockMode>> {
+    return table_lock_set_;
+  }
+
+  /** @return the number of row locks held on every page, which the lock manager escalates past a threshold */
+  inline auto GetPageRowLockCounts() -> std::unordered_map<page_id_t, uint32_t> * { return &page_row_lock_counts_; }
+
   /** @return the current state of the transaction */
   inline auto GetState() -> TransactionState { return state_; }
 
@@ -245,6 +273,18 @@ class Transaction {
    */
   inline void SetState(TransactionState state) { state_ = state; }
 
+  /** @return the commit timestamp of the last transaction committed when this transaction began */
+  inline auto GetReadTs() const -> timestamp_t { return read_ts_; }
+
+  /** Set the timestamp of the snapshot the transaction reads. */
+  inline void SetReadTs(timestamp_t read_ts) { read_ts_ = read_ts; }
+
+  /** @return the commit timestamp, or INVALID_TS before the transaction commits */
+  inline auto GetCommitTs() const -> timestamp_t { return commit_ts_; }
+
+  /** Set the commit timestamp. */
+  inline void SetCommitTs(timestamp_t commit_ts) { commit_ts_ = commit_ts; }
+
   /** @return the previous LSN */
   inline auto GetPrevLSN() -> lsn_t { return prev_lsn_; }
 
@@ -270,6 +310,10 @@ class Transaction {
   std::shared_ptr<std::deque<IndexWriteRecord>> index_write_set_;
   /** The LSN of the last record written by the transaction. */
   lsn_t prev_lsn_;
+  /** MVCC: the commit timestamp of the snapshot the transaction reads. */
+  timestamp_t read_ts_{0};
+  /** MVCC: the commit timestamp of the transaction. */
+  timestamp_t commit_ts_{INVALID_TS};
 
   /** Concurrent index: the pages that were latched during index operation. */
   std::shared_ptr<std::deque<Page *>> page_set_;
@@ -280,6 +324,12 @@ class Transaction {
   std::shared_ptr<std::unordered_set<RID>> shared_lock_set_;
   /** LockManager: the set of exclusive-locked tuples held by this transaction. */
   std::shared_ptr<std::unordered_set<RID>> exclusive_lock_set_;
+  /** LockManager: the modes of the pages locked by this transaction. */
+  std::shared_ptr<std::unordered_map<page_id_t, LockMode>> page_lock_set_;
+  /** LockManager: the modes of the tables locked by this transaction. */
+  std::shared_ptr<std::unordered_map<table_oid_t, LockMode>> table_lock_set_;
+  /** LockManager: the number of row locks held on every page. */
+  std::unordered_map<page_id_t, uint32_t> page_row_lock_counts_;
 };
 
 }  // namespace bustub
@@ -13,9 +13,12 @@
 #pragma once
 
 #include <atomic>
+#include <mutex>  // NOLINT
+#include <set>
 #include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "common/config.h"
 #include "concurrency/lock_manager.h"
@@ -27,6 +30,10 @@ class LockManager;
 
 /**
  * TransactionManager keeps track of all the transactions running in the system.
+ *
+ * With `enable_mvcc`, it also hands out the timestamps of multi-version concurrency control. A transaction reads the
+ * snapshot of the last commit before it began, and a committing transaction takes the next commit timestamp and
+ * stamps the versions it wrote with it once its commit is durable; new snapshots see the commit only after that.
  */
 class TransactionManager {
  public:
@@ -44,6 +51,14 @@ class TransactionManager {
   auto Begin(Transaction *txn = nullptr, IsolationLevel isolation_level = IsolationLevel::REPEATABLE_READ)
       -> Transaction *;
 
+  /**
+   * Begins a transaction that runs alone: it waits for the running transactions to end, and no other transaction
+   * begins until it commits or aborts. The calling thread must not be running a transaction of its own.
+   * @param isolation_level an optional isolation level of the transaction.
+   * @return a new transaction
+   */
+  auto BeginExclusive(IsolationLevel isolation_level = IsolationLevel::REPEATABLE_READ) -> Transaction *;
+
   /**
    * Commits a transaction.
    * @param txn the transaction to commit
@@ -78,13 +93,37 @@ class TransactionManager {
     return res;
   }
 
+  /**
+   * @return the transactions that have logged their BEGIN record but not yet their COMMIT or ABORT record, for the
+   * active transaction table of a checkpoint
+   */
+  auto GetActiveTransactionTable() -> std::vector<ActiveTxnEntry>;
+
   /** Prevents all transactions from performing operations, used for checkpointing. */
   void BlockAllTransactions();
 
   /** Resumes all transactions, used for checkpointing. */
   void ResumeTransactions();
 
+  /** @return the commit timestamp of the last transaction committed */
+  auto GetLastCommitTs() -> timestamp_t {
+    std::scoped_lock lock(timestamp_latch_);
+    return last_commit_ts_;
+  }
+
  private:
+  /** Take a commit timestamp, stamp the versions the transaction wrote, and publish the commit to new snapshots. */
+  void CommitVersions(Transaction *txn);
+
+  /** Register a transaction that holds the global transaction latch, creating it if `txn` is null. */
+  auto Register(Transaction *txn, IsolationLevel isolation_level) -> Transaction *;
+
+  /** Release the global transaction latch in the mode the transaction took it. */
+  void ReleaseGlobalLatch(Transaction *txn);
+
+  /** Forget the snapshot of a finished SNAPSHOT_ISOLATION transaction. Called with `timestamp_latch_` held. */
+  void EndSnapshot(Transaction *txn);
+
   /**
    * Releases all the locks held by the given transaction.
    * @param txn the transaction whose locks should be released
@@ -100,14 +139,43 @@ class TransactionManager {
     for (auto locked_rid : lock_set) {
       lock_manager_->Unlock(txn, locked_rid);
     }
+    // Then the page and table locks the row locks sat below
+    std::vector<page_id_t> pages;
+    for (const auto &[page_id, mode] : *txn->GetPageLockSet()) {
+      pages.push_back(page_id);
+    }
+    for (auto page_id : pages) {
+      lock_manager_->UnlockPage(txn, page_id);
+    }
+    std::vector<table_oid_t> tables;
+    for (const auto &[oid, mode] : *txn->GetTableLockSet()) {
+      tables.push_back(oid);
+    }
+    for (auto oid : tables) {
+      lock_manager_->UnlockTable(txn, oid);
+    }
   }
 
   std::atomic<txn_id_t> next_txn_id_{0};
   LockManager *lock_manager_ __attribute__((__unused__));
-  LogManager *log_manager_ __attribute__((__unused__));
+  LogManager *log_manager_;
+
+  /** Protects `logged_txns_` */
+  std::mutex logged_txns_latch_;
+  /** The transactions with an unfinished log, mapped to the log offset at or before their BEGIN record */
+  std::unordered_map<txn_id_t, int> logged_txns_;
+
+  /** Protects the timestamps and `snapshots_` */
+  std::mutex timestamp_latch_;
+  /** The commit timestamp of the last transaction committed */
+  timestamp_t last_commit_ts_{0};
+  /** The snapshots of the running SNAPSHOT_ISOLATION transactions; the oldest bounds the versions kept */
+  std::multiset<timestamp_t> snapshots_;
 
-  /** The global transaction latch is used for checkpointing. */
+  /** The global transaction latch is used for checkpointing and by exclusive transactions. */
   ReaderWriterLatch global_txn_latch_;
+  /** The transaction holding the global transaction latch exclusively, set and cleared only while it is held so */
+  txn_id_t exclusive_txn_id_{INVALID_TXN_ID};
 };
 
 }  // namespace bustub
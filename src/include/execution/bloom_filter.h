@@ -0,0 +1,114 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// bloom_filter.h
+//
+// Identification: src/include/execution/bloom_filter.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "common/util/hash_util.h"
+
+namespace bustub {
+
+/**
+ * BloomFilter is a register-blocked Bloom filter over key hashes.
+ *
+ * Every key maps to a single 256-bit block and sets one bit in each of the block's eight 32-bit lanes,
+ * so an insert or a lookup touches one cache line and the eight lanes are handled by the same
+ * branch-free loop, which the compiler turns into SIMD instructions. The filter never reports a false
+ * negative; with BITS_PER_KEY bits per key the false positive rate is about one percent.
+ *
+ * Keys are hashed with HashUtil::HashValue() by the caller; the filter mixes the hash itself.
+ */
+class BloomFilter {
+ public:
+  /** The number of filter bits spent per expected key */
+  static constexpr size_t BITS_PER_KEY = 16;
+  /** The number of 32-bit lanes in a block */
+  static constexpr uint32_t LANES = 8;
+
+  /**
+   * Create a filter sized for the given number of keys.
+   * @param expected_keys the number of keys that will be inserted
+   */
+  explicit BloomFilter(size_t expected_keys) {
+    size_t blocks = 1;
+    while (blocks * LANES * 32 < expected_keys * BITS_PER_KEY) {
+      blocks <<= 1;
+    }
+    blocks_.resize(blocks);
+    block_mask_ = blocks - 1;
+  }
+
+  /**
+   * Add a key to the filter.
+   * @param hash the hash of the key
+   */
+  void Insert(hash_t hash) {
+    hash = HashUtil::Finalize(hash);
+    auto &block = blocks_[BlockOf(hash)];
+    auto masks = MakeMasks(static_cast<uint32_t>(hash));
+    for (uint32_t i = 0; i < LANES; i++) {
+      block.lanes_[i] |= masks[i];
+    }
+  }
+
+  /**
+   * Check whether a key may be in the filter.
+   * @param hash the hash of the key
+   * @return `false` if the key was definitely never inserted
+   */
+  auto MayContain(hash_t hash) const -> bool {
+    hash = HashUtil::Finalize(hash);
+    const auto &block = blocks_[BlockOf(hash)];
+    auto masks = MakeMasks(static_cast<uint32_t>(hash));
+    uint32_t missing = 0;
+    for (uint32_t i = 0; i < LANES; i++) {
+      missing |= masks[i] & ~block.lanes_[i];
+    }
+    return missing == 0;
+  }
+
+  /** @return the size of the filter in bytes */
+  auto GetSize() const -> size_t { return blocks_.size() * sizeof(Block); }
+
+ private:
+  struct alignas(32) Block {
+    uint32_t lanes_[LANES];
+  };
+
+  struct Masks {
+    uint32_t masks_[LANES];
+    auto operator[](uint32_t i) const -> uint32_t { return masks_[i]; }
+  };
+
+  /** The upper half of the hash picks the block */
+  auto BlockOf(hash_t hash) const -> size_t { return (hash >> 32) & block_mask_; }
+
+  /** The lower half of the hash picks one bit per lane, each lane with its own odd multiplier */
+  static auto MakeMasks(uint32_t hash) -> Masks {
+    static constexpr uint32_t SALT[LANES] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                                             0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+    Masks masks{};
+    for (uint32_t i = 0; i < LANES; i++) {
+      masks.masks_[i] = 1U << ((hash * SALT[i]) >> 27);
+    }
+    return masks;
+  }
+
+  /** The blocks of the filter; their count is a power of two */
+  std::vector<Block> blocks_;
+  /** The number of blocks minus one */
+  size_t block_mask_;
+};
+
+}  // namespace bustub
@@ -12,15 +12,25 @@
 
 #pragma once
 
+#include <algorithm>
+#include <memory>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "catalog/catalog.h"
 #include "concurrency/transaction.h"
+#include "execution/morsel_queue.h"
+#include "execution/task_scheduler.h"
 #include "storage/page/tmp_tuple_page.h"
 
 namespace bustub {
+
+class AbstractPlanNode;
+
 /**
  * ExecutorContext stores all the context necessary to run an executor.
  */
@@ -60,6 +70,51 @@ class ExecutorContext {
   /** @return the transaction manager */
   auto GetTransactionManager() -> TransactionManager * { return txn_mgr_; }
 
+  /** @return the number of bytes of tuples a single operator may hold in memory before spilling */
+  auto GetMemoryBudget() const -> size_t { return memory_budget_; }
+
+  /** @param memory_budget the number of bytes of tuples a single operator may hold in memory before spilling */
+  void SetMemoryBudget(size_t memory_budget) { memory_budget_ = memory_budget; }
+
+  /** @return the number of threads a single operator may use */
+  auto GetParallelism() const -> size_t { return parallelism_; }
+
+  /** @param parallelism the number of threads a single operator may use (at least one) */
+  void SetParallelism(size_t parallelism) { parallelism_ = std::max<size_t>(parallelism, 1); }
+
+  /** @return the thread pool of the query, started with GetParallelism() workers on first use */
+  auto GetTaskScheduler() -> TaskScheduler * {
+    std::lock_guard<std::mutex> guard(latch_);
+    if (scheduler_ == nullptr) {
+      scheduler_ = std::make_unique<TaskScheduler>(parallelism_);
+    }
+    return scheduler_.get();
+  }
+
+  /**
+   * @param plan a sequential scan plan node
+   * @return the morsels that the parallel instances of the scan share, or `nullptr` if it is not parallel
+   */
+  auto GetMorselQueue(const AbstractPlanNode *plan) -> MorselQueue * {
+    std::lock_guard<std::mutex> guard(latch_);
+    auto iter = morsel_queues_.find(plan);
+    return iter == morsel_queues_.end() ? nullptr : iter->second;
+  }
+
+  /**
+   * Make every instance of a sequential scan take its pages from a shared queue.
+   * @param plan a sequential scan plan node
+   * @param queue the morsels of the scan, or `nullptr` to scan the whole table again
+   */
+  void SetMorselQueue(const AbstractPlanNode *plan, MorselQueue *queue) {
+    std::lock_guard<std::mutex> guard(latch_);
+    if (queue == nullptr) {
+      morsel_queues_.erase(plan);
+    } else {
+      morsel_queues_[plan] = queue;
+    }
+  }
+
  private:
   /** The transaction context associated with this executor context */
   Transaction *transaction_;
@@ -71,6 +126,16 @@ class ExecutorContext {
   TransactionManager *txn_mgr_;
   /** The lock manager associated with this executor context */
   LockManager *lock_mgr_;
+  /** The per-operator memory budget, in bytes */
+  size_t memory_budget_{EXECUTOR_MEMORY_BUDGET};
+  /** The per-operator thread count; one per hardware thread by default */
+  size_t parallelism_{std::max<size_t>(std::thread::hardware_concurrency(), 1)};
+  /** Protects `scheduler_` and `morsel_queues_` */
+  std::mutex latch_;
+  /** The thread pool of the query */
+  std::unique_ptr<TaskScheduler> scheduler_;
+  /** The morsel queues of the parallel sequential scans */
+  std::unordered_map<const AbstractPlanNode *, MorselQueue *> morsel_queues_;
 };
 
 }  // namespace bustub
@@ -12,14 +12,26 @@
 
 #pragma once
 
+#include <utility>
+
+#include "execution/bloom_filter.h"
 #include "execution/executor_context.h"
+#include "execution/tuple_batch.h"
 #include "storage/table/tuple.h"
 
 namespace bustub {
+
+class AbstractExpression;
+
 /**
- * The AbstractExecutor implements the Volcano tuple-at-a-time iterator model.
+ * The AbstractExecutor implements the Volcano iterator model.
  * This is the base class from which all executors in the BustTub execution
  * engine inherit, and defines the minimal interface that all executors support.
+ *
+ * Executors may be driven either tuple-at-a-time through Next() or a batch at a
+ * time through NextBatch(). Every executor implements Next(); the default NextBatch()
+ * adapts it. Executors on hot paths implement NextBatch() natively instead, and may
+ * in turn implement Next() on top of it with NextFromBatch().
  */
 class AbstractExecutor {
  public:
@@ -46,14 +58,71 @@ class AbstractExecutor {
    */
   virtual auto Next(Tuple *tuple, RID *rid) -> bool = 0;
 
+  /**
+   * Yield the next batch of tuples from this executor.
+   * The batch is reset before it is filled. A batch returned with `true` always has
+   * at least one selected tuple; it may be smaller than its capacity even if more
+   * tuples follow.
+   * @param[out] batch The batch that receives the tuples produced by this executor
+   * @return `true` if at least one tuple was produced, `false` if there are no more tuples
+   */
+  virtual auto NextBatch(TupleBatch *batch) -> bool {
+    batch->Reset();
+    Tuple tuple;
+    RID rid;
+    while (!batch->IsFull() && Next(&tuple, &rid)) {
+      batch->Append(std::move(tuple), rid);
+    }
+    return !batch->IsEmpty();
+  }
+
   /** @return The schema of the tuples that this executor produces */
   virtual auto GetOutputSchema() -> const Schema * = 0;
 
+  /**
+   * Offer a runtime filter to this executor, typically from the build side of a hash join. An executor that
+   * accepts it may drop any tuple whose key hash is not in the filter, as early as it likes. The filter is
+   * forgotten on the next Init(). Executors ignore filters by default.
+   * @param filter The filter, which must outlive the executor's use of it
+   * @param key The expression, over this executor's output schema, whose HashUtil::HashValue() is looked up
+   * @return `true` if the executor applies the filter
+   */
+  virtual auto PushDownBloomFilter(const BloomFilter *filter, const AbstractExpression *key) -> bool { return false; }
+
   /** @return The executor context in which this executor runs */
   auto GetExecutorContext() -> ExecutorContext * { return exec_ctx_; }
 
  protected:
+  /**
+   * Tuple-at-a-time adapter for executors that implement NextBatch() natively.
+   * Such executors must call ResetBatchAdapter() from Init().
+   */
+  auto NextFromBatch(Tuple *tuple, RID *rid) -> bool {
+    if (adapter_cursor_ >= adapter_batch_.Size()) {
+      adapter_cursor_ = 0;
+      if (!NextBatch(&adapter_batch_)) {
+        return false;
+      }
+    }
+    *tuple = std::move(adapter_batch_.TupleAt(adapter_cursor_));
+    *rid = adapter_batch_.RidAt(adapter_cursor_);
+    adapter_cursor_++;
+    return true;
+  }
+
+  /** Discard any tuples buffered by NextFromBatch(). */
+  void ResetBatchAdapter() {
+    adapter_batch_.Reset();
+    adapter_cursor_ = 0;
+  }
+
   /** The executor context in which the executor runs */
   ExecutorContext *exec_ctx_;
+
+ private:
+  /** Tuples produced by NextBatch() that NextFromBatch() has not handed out yet */
+  TupleBatch adapter_batch_;
+  /** Position of the next selected tuple in `adapter_batch_` */
+  uint32_t adapter_cursor_{0};
 };
 }  // namespace bustub
@@ -13,6 +13,7 @@
 #pragma once
 
 #include <memory>
+#include <mutex>  // NOLINT
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -22,7 +23,9 @@
 #include "execution/executor_context.h"
 #include "execution/executors/abstract_executor.h"
 #include "execution/expressions/abstract_expression.h"
+#include "execution/flat_aggregation_table.h"
 #include "execution/plans/aggregation_plan.h"
+#include "storage/table/tmp_tuple_heap.h"
 #include "storage/table/tuple.h"
 #include "type/value_factory.h"
 
@@ -108,6 +111,23 @@ class SimpleAggregationHashTable {
     CombineAggregateValues(&ht_[agg_key], agg_val);
   }
 
+  /**
+   * Inserts the partial aggregates of a group, computed over other tuples, and merges them into the group.
+   * @param agg_key the key of the group
+   * @param partial the partial aggregates of the group
+   */
+  void InsertMerge(const AggregateKey &agg_key, const AggregateValue &partial) {
+    auto iter = ht_.find(agg_key);
+    if (iter == ht_.end()) {
+      ht_.insert({agg_key, partial});
+      return;
+    }
+    AggregateFunctions{agg_types_}.Merge(iter->second.aggregates_.data(), partial.aggregates_.data());
+  }
+
+  /** @return The number of groups in the hash table */
+  auto Size() const -> size_t { return ht_.size(); }
+
   /** An iterator over the aggregation hash table */
   class Iterator {
    public:
@@ -143,6 +163,9 @@ class SimpleAggregationHashTable {
   /** @return Iterator to the end of the hash table */
   auto End() -> Iterator { return Iterator{ht_.cend()}; }
 
+  /** Remove every group from the hash table */
+  void Clear() { ht_.clear(); }
+
  private:
   /** The hash table is just a map from aggregate keys to aggregate values */
   std::unordered_map<AggregateKey, AggregateValue> ht_{};
@@ -155,9 +178,29 @@ class SimpleAggregationHashTable {
 /**
  * AggregationExecutor executes an aggregation operation (e.g. COUNT, SUM, MIN, MAX)
  * over the tuples produced by a child executor.
+ *
+ * When every GROUP BY expression has a fixed-length type, the aggregation runs in parallel on
+ * ExecutorContext::GetParallelism() threads. The calling thread pulls batches from the child and hands
+ * them to the workers. Each worker pre-aggregates into a small thread-local FlatAggregationTable over
+ * normalized keys and, whenever that table fills up, flushes its groups into thread-local partitions
+ * picked by the top bits of the key hash. The partitions are then merged across threads, one partition
+ * per worker at a time, so the merge needs no locking. Other GROUP BYs use SimpleAggregationHashTable.
+ *
+ * Memory is bounded by ExecutorContext::GetMemoryBudget(). When the groups held in memory outgrow it,
+ * they are written out as partial aggregates to TmpTupleHeaps, hash-partitioned on the group key, and
+ * from then on everything is spilled. Next() then loads the spilled partitions one at a time, merging
+ * the partial aggregates of each group; a partition that still does not fit is split again on the next
+ * bits of the hash, up to MAX_SPILL_DEPTH levels.
  */
 class AggregationExecutor : public AbstractExecutor {
  public:
+  /** The number of groups in a thread-local pre-aggregation table */
+  static constexpr size_t PREAGGREGATION_CAPACITY = 1 << 12;
+  /** The number of partitions the groups are merged in; a power of two */
+  static constexpr size_t NUM_PARTITIONS = 16;
+  /** The number of times a spilled partition can be split */
+  static constexpr size_t MAX_SPILL_DEPTH = 4;
+
   /**
    * Construct a new AggregationExecutor instance.
    * @param exec_ctx The executor context
@@ -204,13 +247,114 @@ class AggregationExecutor : public AbstractExecutor {
   }
 
  private:
+  /** The state of one aggregation worker */
+  struct LocalAggregation {
+    /** The fixed-capacity pre-aggregation table */
+    FlatAggregationTable table_;
+    /** The groups flushed from `table_`, by partition */
+    std::vector<FlatAggregationTable> partitions_;
+  };
+
+  /** A spilled partition of partial aggregates */
+  struct SpillPartition {
+    /** The partial aggregates, as tuples of `spill_schema_` */
+    std::unique_ptr<TmpTupleHeap> heap_;
+    /** The number of times the input has been partitioned to produce this partition */
+    size_t depth_;
+  };
+
+  /** @return A fresh worker state */
+  auto MakeLocalAggregation() const -> LocalAggregation;
+
+  /** Pre-aggregate the selected tuples of a batch into a worker's table */
+  void Aggregate(LocalAggregation *local, const TupleBatch &batch);
+
+  /** Move every group of a worker's pre-aggregation table into its partitions, spilling them if over budget */
+  void Flush(LocalAggregation *local);
+
+  /** Pull every batch from the child and aggregate it on the worker threads */
+  void AggregateParallel(std::vector<LocalAggregation> *locals);
+
+  /** @return The bytes held by a worker's tables */
+  static auto GetMemoryUsage(const LocalAggregation &local) -> size_t;
+
+  /** @return The approximate bytes held by `aht_` */
+  auto GetHashTableMemoryUsage() const -> size_t;
+
+  /** @return A fresh set of spill partitions */
+  auto MakeSpillHeaps() const -> std::vector<std::unique_ptr<TmpTupleHeap>>;
+
+  /** @return The spill partition of a key hash at a given depth */
+  auto SpillPartitionOf(hash_t hash, size_t depth) const -> size_t {
+    return (hash >> (sizeof(hash_t) * 8 - spill_bits_ * depth)) & ((size_t{1} << spill_bits_) - 1);
+  }
+
+  /** @return The hash of a group, as used to partition spilled groups */
+  auto HashGroup(const std::vector<Value> &group_bys) const -> hash_t;
+
+  /** Append the partial aggregates of a group to its spill partition */
+  void SpillGroup(const std::vector<Value> &group_bys, const Value *aggregates, hash_t hash, size_t depth,
+                  const std::vector<std::unique_ptr<TmpTupleHeap>> &heaps);
+
+  /** Spill and clear every group of a flat table */
+  void SpillTable(FlatAggregationTable *table, size_t depth, const std::vector<std::unique_ptr<TmpTupleHeap>> &heaps);
+
+  /** Spill and clear every group of `aht_` */
+  void SpillHashTable(size_t depth, const std::vector<std::unique_ptr<TmpTupleHeap>> &heaps);
+
+  /** Seal the depth-one spill partitions and queue them for Next() */
+  void FinishSpilling();
+
+  /** Merge a spilled partition into memory, or split it further if it does not fit */
+  void LoadPartition(SpillPartition *partition);
+
+  /** Produce the next output tuple from the groups in memory */
+  auto NextInMemory(Tuple *tuple) -> bool;
+
+  /** Merge one partition of every worker into `partitions_` */
+  void MergePartition(std::vector<LocalAggregation> *locals, size_t partition);
+
+  /** @return The partition of a key hash */
+  static auto PartitionOf(hash_t hash) -> size_t { return hash >> (sizeof(hash_t) * 8 - 4); }
+  static_assert(NUM_PARTITIONS == 16, "PartitionOf() takes the top four bits of the hash");
+
+  /**
+   * Produce the output tuple of a group, unless HAVING rejects it.
+   * @param group_bys The group-by values of the group
+   * @param aggregates The aggregates of the group
+   * @param[out] tuple The output tuple
+   * @return `true` if the group passes the HAVING clause
+   */
+  auto MakeOutputTuple(const std::vector<Value> &group_bys, const std::vector<Value> &aggregates, Tuple *tuple)
+      -> bool;
+
   /** The aggregation plan node */
   const AggregationPlanNode *plan_;
   /** The child executor that produces tuples over which the aggregation is computed */
   std::unique_ptr<AbstractExecutor> child_;
   /** Simple aggregation hash table */
-  // TODO(Student): Uncomment SimpleAggregationHashTable aht_;
+  SimpleAggregationHashTable aht_;
   /** Simple aggregation hash table iterator */
-  // TODO(Student): Uncomment SimpleAggregationHashTable::Iterator aht_iterator_;
+  SimpleAggregationHashTable::Iterator aht_iterator_;
+  /** The semantics of the plan's aggregates over flat arrays */
+  AggregateFunctions agg_functions_;
+  /** The normalized key layout of the group-bys, or `nullptr` if they cannot be normalized */
+  std::unique_ptr<AggregateKeyLayout> key_layout_;
+  /** The merged groups, by partition */
+  std::vector<FlatAggregationTable> partitions_;
+  /** The partition of the next group to output */
+  size_t partition_idx_{0};
+  /** The position of the next group to output in its partition */
+  size_t group_idx_{0};
+  /** The layout of spilled partial aggregates: the group-bys, then the aggregates */
+  std::unique_ptr<Schema> spill_schema_;
+  /** The number of hash bits that select a spill partition at each depth */
+  size_t spill_bits_;
+  /** The depth-one spill partitions; empty unless the aggregation has spilled */
+  std::vector<std::unique_ptr<TmpTupleHeap>> spill_heaps_;
+  /** Serializes workers writing to `spill_heaps_` */
+  std::mutex spill_latch_;
+  /** The spilled partitions that have not been output yet */
+  std::vector<SpillPartition> pending_;
 };
 }  // namespace bustub
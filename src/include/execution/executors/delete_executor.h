@@ -56,9 +56,19 @@ class DeleteExecutor : public AbstractExecutor {
   auto GetOutputSchema() -> const Schema * override { return plan_->OutputSchema(); };
 
  private:
+  /**
+   * Delete the tuple identified by `rid` from the table and all of its indexes.
+   * @param rid The RID of the tuple to be deleted
+   */
+  void DeleteTuple(const RID &rid);
+
   /** The delete plan node to be executed */
   const DeletePlanNode *plan_;
   /** The child executor from which RIDs for deleted tuples are pulled */
   std::unique_ptr<AbstractExecutor> child_executor_;
+  /** Metadata identifying the table that should be deleted from */
+  TableInfo *table_info_;
+  /** The indexes that must be maintained alongside the table */
+  std::vector<IndexInfo *> indexes_;
 };
 }  // namespace bustub
@@ -13,6 +13,7 @@
 #pragma once
 
 #include <memory>
+#include <unordered_set>
 #include <utility>
 
 #include "execution/executors/abstract_executor.h"
@@ -45,13 +46,25 @@ class DistinctExecutor : public AbstractExecutor {
    */
   auto Next(Tuple *tuple, RID *rid) -> bool override;
 
+  /**
+   * Yield the next batch of tuples from the distinct.
+   * @param[out] batch The batch that receives the tuples produced by the distinct
+   * @return `true` if a tuple was produced, `false` if there are no more tuples
+   */
+  auto NextBatch(TupleBatch *batch) -> bool override;
+
   /** @return The output schema for the distinct */
   auto GetOutputSchema() -> const Schema * override { return plan_->OutputSchema(); };
 
  private:
+  /** @return `true` the first time the values of `tuple` are seen, `false` afterwards */
+  auto InsertIfAbsent(const Tuple &tuple) -> bool;
+
   /** The distinct plan node to be executed */
   const DistinctPlanNode *plan_;
   /** The child executor from which tuples are obtained */
   std::unique_ptr<AbstractExecutor> child_executor_;
+  /** The rows produced so far */
+  std::unordered_set<DistinctKey> seen_;
 };
 }  // namespace bustub
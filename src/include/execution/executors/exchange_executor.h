@@ -0,0 +1,127 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// exchange_executor.h
+//
+// Identification: src/include/execution/executors/exchange_executor.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <future>  // NOLINT
+#include <memory>
+#include <mutex>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "execution/executor_context.h"
+#include "execution/executors/abstract_executor.h"
+#include "execution/morsel_queue.h"
+#include "execution/plans/exchange_plan.h"
+#include "execution/plans/seq_scan_plan.h"
+
+namespace bustub {
+
+/**
+ * ExchangeExecutor runs the instances of its child on the TaskScheduler of the ExecutorContext and
+ * gathers the batches they produce.
+ *
+ * Parallelism is morsel-driven: the instances share one MorselQueue over the table of the driving scan,
+ * and every instance keeps claiming morsels until the table is exhausted, so the work balances itself
+ * however unevenly the instances progress. Batches go through a bounded queue, which blocks the
+ * instances when the consumer falls behind.
+ *
+ * The instances share the transaction of the query, whose lock bookkeeping is not thread-safe, and the lock
+ * manager expects a transaction to wait for one lock at a time. So a transaction that takes row locks runs the
+ * instances one after the other on the calling thread instead; the first one then drains the morsels.
+ */
+class ExchangeExecutor : public AbstractExecutor {
+ public:
+  /**
+   * Construct a new ExchangeExecutor instance.
+   * @param exec_ctx The executor context
+   * @param plan The exchange plan to be executed
+   * @param children The instances of the child plan
+   */
+  ExchangeExecutor(ExecutorContext *exec_ctx, const ExchangePlanNode *plan,
+                   std::vector<std::unique_ptr<AbstractExecutor>> &&children);
+
+  /** Stop the instances of the child */
+  ~ExchangeExecutor() override;
+
+  /** Start the instances of the child */
+  void Init() override;
+
+  /**
+   * Yield the next tuple from the exchange.
+   * @param[out] tuple The next tuple produced by the exchange
+   * @param[out] rid The next tuple RID produced by the exchange
+   * @return `true` if a tuple was produced, `false` if there are no more tuples
+   */
+  auto Next(Tuple *tuple, RID *rid) -> bool override;
+
+  /**
+   * Yield the next batch produced by any instance of the child.
+   * @param[out] batch The batch that receives the tuples
+   * @return `true` if a tuple was produced, `false` if there are no more tuples
+   */
+  auto NextBatch(TupleBatch *batch) -> bool override;
+
+  /** @return The output schema for the exchange */
+  auto GetOutputSchema() -> const Schema * override { return plan_->OutputSchema(); };
+
+  /**
+   * Find the sequential scan whose tuples drive a pipeline: the probe side of a hash join, the outer
+   * side of a nested loop or nested index join, or the plan itself.
+   * @param plan The root of the pipeline
+   * @return The driving scan, or `nullptr` if the pipeline is not driven by a sequential scan
+   */
+  static auto GetDrivingScan(const AbstractPlanNode *plan) -> const SeqScanPlanNode *;
+
+ private:
+  /** Run one instance of the child, queueing its batches */
+  void Produce(AbstractExecutor *child);
+
+  /** Cancel the running instances and wait for them */
+  void Stop();
+
+  /** @return `true` if the reads of the transaction take row locks, so its instances may not run in parallel */
+  static auto TakesRowLocks(Transaction *txn) -> bool;
+
+  /** The exchange plan node to be executed */
+  const ExchangePlanNode *plan_;
+  /** The instances of the child */
+  std::vector<std::unique_ptr<AbstractExecutor>> children_;
+  /** The scan whose pages the instances split */
+  const SeqScanPlanNode *scan_plan_;
+  /** The morsels of the driving scan */
+  std::unique_ptr<MorselQueue> morsels_;
+  /** `true` if the instances run on the scheduler, rather than in turn on the calling thread */
+  bool parallel_{false};
+  /** The instance running on the calling thread, if not parallel */
+  size_t current_child_{0};
+  /** Whether the instance running on the calling thread has been initialized */
+  bool current_started_{false};
+  /** Protects the members below */
+  std::mutex latch_;
+  /** Signalled when a batch is queued or an instance finishes */
+  std::condition_variable not_empty_;
+  /** Signalled when a batch is dequeued or the exchange is cancelled */
+  std::condition_variable not_full_;
+  /** The batches produced and not consumed yet */
+  std::deque<TupleBatch> queue_;
+  /** The number of instances still running */
+  size_t running_{0};
+  /** `true` once the instances should stop early */
+  bool cancelled_{false};
+  /** Completion of the instances, holding the exception of a failed one */
+  std::vector<std::future<void>> producers_;
+};
+
+}  // namespace bustub
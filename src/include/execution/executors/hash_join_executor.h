@@ -13,20 +13,49 @@
 #pragma once
 
 #include <memory>
+#include <optional>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "execution/executor_context.h"
 #include "execution/executors/abstract_executor.h"
+#include "execution/expressions/abstract_expression.h"
 #include "execution/plans/hash_join_plan.h"
+#include "execution/radix_join_table.h"
+#include "storage/table/tmp_tuple_heap.h"
 #include "storage/table/tuple.h"
 
 namespace bustub {
 
 /**
- * HashJoinExecutor executes a nested-loop JOIN on two tables.
+ * HashJoinExecutor executes an equi-JOIN on two tables.
+ *
+ * The hash table is built on the left child and probed with the tuples of the right child. When the
+ * build side outgrows the executor context's memory budget, the join turns into a Grace hash join:
+ * both inputs are hash partitioned into TmpTupleHeaps, and each pair of partitions is joined in turn.
+ * A build partition that still does not fit is partitioned again with a different hash seed.
+ *
+ * When the build side is estimated at RADIX_JOIN_MIN_BUILD_ROWS rows or more, the in-memory join
+ * is radix partitioned instead: the build tuples are materialized, their key hashes are scattered into
+ * cache-sized partitions and each partition gets a compact open-addressing table (see RadixJoinTable).
+ * The probe side is consumed in chunks that are partitioned the same way, so that every partition is
+ * probed while its table is cache resident. If the build side turns out not to fit in memory after all,
+ * the join falls back to the Grace hash join above.
+ *
+ * The build side keys are also summarized in a BloomFilter of a fixed size, which is offered to the right
+ * child once the build side is consumed (see AbstractExecutor::PushDownBloomFilter()), so that a scan can drop probe tuples without a
+ * match before materializing them.
  */
 class HashJoinExecutor : public AbstractExecutor {
  public:
+  /** Partitions are not split any further past this depth, e.g. when a single key is too large */
+  static constexpr uint32_t MAX_PARTITION_DEPTH = 4;
+  /** The smallest estimated build side for which the radix-partitioned join is used */
+  static constexpr size_t RADIX_JOIN_MIN_BUILD_ROWS = 1 << 14;
+  /** The number of probe batches partitioned together by the radix-partitioned join */
+  static constexpr uint32_t RADIX_PROBE_CHUNK_BATCHES = 16;
+
   /**
    * Construct a new HashJoinExecutor instance.
    * @param exec_ctx The executor context
@@ -52,8 +81,133 @@ class HashJoinExecutor : public AbstractExecutor {
   auto GetOutputSchema() -> const Schema * override { return plan_->OutputSchema(); };
 
  private:
-  /** The NestedLoopJoin plan node to be executed. */
+  /** A pair of spilled partitions that still have to be joined */
+  struct Partition {
+    /** The build side tuples of the partition */
+    std::unique_ptr<TmpTupleHeap> left_;
+    /** The probe side tuples of the partition */
+    std::unique_ptr<TmpTupleHeap> right_;
+    /** The number of partitioning passes that produced the partition */
+    uint32_t depth_;
+  };
+
+  /**
+   * @return The number of build rows the radix join choice is based on: the plan's estimate if it has one, else the
+   * capacity of the pages of a scanned build table
+   */
+  auto EstimateBuildRows() const -> std::optional<size_t>;
+
+  /** @return The output tuple for a matching pair of left and right tuples */
+  auto MakeOutputTuple(const Tuple &left_tuple, const Tuple &right_tuple) -> Tuple;
+
+  /**
+   * Add a build tuple to the hash table, or to its spill partition once the table has been spilled.
+   * @param tuple The build side tuple
+   * @param depth The partitioning depth of the tuples being built
+   * @param partitions The spill partitions of this depth (empty while the build fits in memory)
+   */
+  void Build(Tuple &&tuple, uint32_t depth, std::vector<std::unique_ptr<TmpTupleHeap>> *partitions);
+
+  /**
+   * Add a build tuple to the radix join's materialized build side, falling back to the Grace hash join
+   * if the build side outgrows the memory budget.
+   * @param tuple The build side tuple
+   * @param entries The hashes of the rows built so far
+   * @param partitions The spill partitions, filled if the join falls back
+   */
+  void BuildRadix(Tuple &&tuple, std::vector<RadixEntry> *entries,
+                  std::vector<std::unique_ptr<TmpTupleHeap>> *partitions);
+
+  /**
+   * Read, partition and probe the next chunk of the right child for the radix join.
+   * @return `false` once the right child is exhausted
+   */
+  auto ProbeRadixChunk() -> bool;
+
+  /**
+   * Create the Bloom filter the build fills, unless the keys of the two sides hash differently.
+   * @param estimated_rows the estimated number of build rows, if known
+   */
+  void MakeBloomFilter(std::optional<size_t> estimated_rows);
+
+  /** Offer the Bloom filter over the build side to the right child */
+  void PushDownBloomFilter();
+
+  /** @return Fresh, empty spill partitions */
+  auto MakePartitions() -> std::vector<std::unique_ptr<TmpTupleHeap>>;
+
+  /** @return The partition a join key belongs to at the given partitioning depth */
+  auto PartitionOf(const HashJoinKey &key, uint32_t depth) const -> size_t;
+
+  /**
+   * Queue the non-empty partition pairs for joining.
+   * @param left The build side partitions
+   * @param right The probe side partitions
+   * @param depth The partitioning depth of the partitions
+   */
+  void QueuePartitions(std::vector<std::unique_ptr<TmpTupleHeap>> &&left,
+                       std::vector<std::unique_ptr<TmpTupleHeap>> &&right, uint32_t depth);
+
+  /**
+   * Build the hash table from a spilled partition and start probing it, or partition it further.
+   * @param partition The partition to join
+   */
+  void LoadPartition(Partition &&partition);
+
+  /**
+   * Fetch the next probe tuple, moving on to the next spilled partition as needed.
+   * @param[out] tuple The next probe tuple
+   * @return `true` if a tuple was produced, `false` if there are no more probe tuples
+   */
+  auto NextProbeTuple(Tuple *tuple) -> bool;
+
+  /** The HashJoin plan node to be executed. */
   const HashJoinPlanNode *plan_;
+  /** The child executor that produces tuples for the left (build) side of the join */
+  std::unique_ptr<AbstractExecutor> left_child_;
+  /** The child executor that produces tuples for the right (probe) side of the join */
+  std::unique_ptr<AbstractExecutor> right_child_;
+  /** The number of partitions produced by each partitioning pass */
+  size_t fanout_;
+  /** The build side hash table, mapping each join key to the left tuples carrying it */
+  std::unordered_map<HashJoinKey, std::vector<Tuple>> ht_;
+  /** The approximate number of bytes held by `ht_` */
+  size_t ht_bytes_{0};
+  /** The Bloom filter over the build keys, filled during the build and pushed down into the right child */
+  std::unique_ptr<BloomFilter> bloom_filter_;
+  /** Spilled partitions that still have to be joined */
+  std::vector<Partition> pending_;
+  /** `true` while probe tuples come straight from the right child, `false` once they come from partitions */
+  bool probe_child_{true};
+  /** The probe side of the partition being joined */
+  std::unique_ptr<TmpTupleHeap> probe_heap_;
+  /** The current batch of probe tuples from the right child */
+  TupleBatch right_batch_;
+  /** Position of the next unprobed tuple in `right_batch_` */
+  uint32_t right_cursor_{0};
+  /** The current probe tuple */
+  Tuple probe_tuple_;
+  /** The left tuples matching `probe_tuple_` (may be `nullptr`) */
+  const std::vector<Tuple> *matches_{nullptr};
+  /** Position of the next match to emit in `matches_` */
+  size_t match_idx_{0};
+
+  /** `true` if the in-memory join is radix partitioned */
+  bool radix_mode_{false};
+  /** The materialized build side of the radix join */
+  std::vector<Tuple> build_tuples_;
+  /** The join key of each row of `build_tuples_` */
+  std::vector<Value> build_keys_;
+  /** The partitioned build side tables of the radix join */
+  RadixJoinTable radix_table_;
+  /** The current chunk of probe tuples of the radix join */
+  std::vector<Tuple> probe_chunk_;
+  /** The join key of each row of `probe_chunk_` */
+  std::vector<Value> probe_keys_;
+  /** The (build row, probe row) pairs that joined in the current chunk */
+  std::vector<std::pair<uint32_t, uint32_t>> radix_matches_;
+  /** Position of the next pair to emit in `radix_matches_` */
+  size_t radix_match_idx_{0};
 };
 
 }  // namespace bustub
@@ -12,11 +12,13 @@
 
 #pragma once
 
+#include <memory>
 #include <vector>
 
 #include "common/rid.h"
 #include "execution/executor_context.h"
 #include "execution/executors/abstract_executor.h"
+#include "execution/expression_program.h"
 #include "execution/plans/index_scan_plan.h"
 #include "storage/table/tuple.h"
 
@@ -44,5 +46,15 @@ class IndexScanExecutor : public AbstractExecutor {
  private:
   /** The index scan plan node to be executed. */
   const IndexScanPlanNode *plan_;
+  /** Metadata identifying the index that is scanned */
+  IndexInfo *index_info_;
+  /** Metadata identifying the table the index is built on */
+  TableInfo *table_info_;
+  /** The RIDs returned by the index lookup */
+  std::vector<RID> rids_;
+  /** Position of the next RID to fetch in `rids_` */
+  size_t cursor_{0};
+  /** The predicate compiled in Init(), or nullptr if it is interpreted */
+  std::unique_ptr<ExpressionProgram> predicate_program_;
 };
 }  // namespace bustub
@@ -14,6 +14,7 @@
 
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "execution/executor_context.h"
 #include "execution/executors/abstract_executor.h"
@@ -27,6 +28,9 @@ namespace bustub {
  *
  * Unlike UPDATE and DELETE, inserted values may either be
  * embedded in the plan itself or be pulled from a child executor.
+ *
+ * Raw values that fill at least a page are appended in bulk with TableHeap::BulkAppend(), which
+ * fills fresh pages and logs and tracks them per page rather than per tuple.
  */
 class InsertExecutor : public AbstractExecutor {
  public:
@@ -57,8 +61,28 @@ class InsertExecutor : public AbstractExecutor {
   auto GetOutputSchema() -> const Schema * override { return plan_->OutputSchema(); };
 
  private:
+  /**
+   * Insert a single tuple into the table and all of its indexes.
+   * @param tuple The tuple to be inserted, in the table schema
+   */
+  void InsertTuple(const Tuple &tuple);
+
+  /**
+   * Append tuples to fresh pages of the table and insert them into all of its indexes.
+   * @param tuples The tuples to be inserted, in the table schema
+   */
+  void BulkInsert(const std::vector<Tuple> &tuples);
+
   /** The insert plan node to be executed*/
   const InsertPlanNode *plan_;
+  /** The child executor from which inserted tuples are pulled (may be `nullptr`) */
+  std::unique_ptr<AbstractExecutor> child_executor_;
+  /** Metadata identifying the table that should be inserted into */
+  TableInfo *table_info_;
+  /** The indexes that must be maintained alongside the table */
+  std::vector<IndexInfo *> indexes_;
+  /** `true` once all tuples have been inserted */
+  bool done_{false};
 };
 
 }  // namespace bustub
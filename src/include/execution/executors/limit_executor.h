@@ -45,6 +45,13 @@ class LimitExecutor : public AbstractExecutor {
    */
   auto Next(Tuple *tuple, RID *rid) -> bool override;
 
+  /**
+   * Yield the next batch of tuples from the limit.
+   * @param[out] batch The batch that receives the tuples produced by the limit
+   * @return `true` if a tuple was produced, `false` if there are no more tuples
+   */
+  auto NextBatch(TupleBatch *batch) -> bool override;
+
   /** @return The output schema for the limit */
   auto GetOutputSchema() -> const Schema * override { return plan_->OutputSchema(); };
 
@@ -53,5 +60,7 @@ class LimitExecutor : public AbstractExecutor {
   const LimitPlanNode *plan_;
   /** The child executor from which tuples are obtained */
   std::unique_ptr<AbstractExecutor> child_executor_;
+  /** The number of tuples produced so far */
+  size_t emitted_{0};
 };
 }  // namespace bustub
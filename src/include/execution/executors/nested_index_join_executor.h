@@ -20,6 +20,7 @@
 
 #include "execution/executor_context.h"
 #include "execution/executors/abstract_executor.h"
+#include "execution/expression_program.h"
 #include "execution/expressions/abstract_expression.h"
 #include "execution/plans/nested_index_join_plan.h"
 #include "storage/table/tmp_tuple.h"
@@ -48,7 +49,24 @@ class NestIndexJoinExecutor : public AbstractExecutor {
   auto Next(Tuple *tuple, RID *rid) -> bool override;
 
  private:
+  /** @return The expression that computes the inner index key from an outer tuple */
+  auto OuterKeyExpression() const -> const AbstractExpression *;
+
   /** The nested index join plan node. */
   const NestedIndexJoinPlanNode *plan_;
+  /** The child executor that produces the outer tuples */
+  std::unique_ptr<AbstractExecutor> child_executor_;
+  /** Metadata identifying the inner table */
+  TableInfo *inner_table_info_;
+  /** Metadata identifying the index probed on the inner table */
+  IndexInfo *index_info_;
+  /** The current outer tuple */
+  Tuple outer_tuple_;
+  /** The inner RIDs matching `outer_tuple_` */
+  std::vector<RID> rids_;
+  /** Position of the next RID to fetch in `rids_` */
+  size_t cursor_{0};
+  /** The predicate compiled in Init(), or nullptr if it is interpreted */
+  std::unique_ptr<ExpressionProgram> predicate_program_;
 };
 }  // namespace bustub
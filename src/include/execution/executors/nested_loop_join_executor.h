@@ -17,6 +17,7 @@
 
 #include "execution/executor_context.h"
 #include "execution/executors/abstract_executor.h"
+#include "execution/expression_program.h"
 #include "execution/plans/nested_loop_join_plan.h"
 #include "storage/table/tuple.h"
 
@@ -53,8 +54,21 @@ class NestedLoopJoinExecutor : public AbstractExecutor {
   auto GetOutputSchema() -> const Schema * override { return plan_->OutputSchema(); };
 
  private:
+  /** @return The output tuple for a matching pair of left and right tuples */
+  auto MakeOutputTuple(const Tuple &left_tuple, const Tuple &right_tuple) -> Tuple;
+
   /** The NestedLoopJoin plan node to be executed. */
   const NestedLoopJoinPlanNode *plan_;
+  /** The child executor that produces tuples for the left (outer) side of the join */
+  std::unique_ptr<AbstractExecutor> left_executor_;
+  /** The child executor that produces tuples for the right (inner) side of the join */
+  std::unique_ptr<AbstractExecutor> right_executor_;
+  /** The current left tuple */
+  Tuple left_tuple_;
+  /** `true` if `left_tuple_` holds a tuple that is being joined */
+  bool has_left_{false};
+  /** The predicate compiled in Init(), or nullptr if it is interpreted */
+  std::unique_ptr<ExpressionProgram> predicate_program_;
 };
 
 }  // namespace bustub
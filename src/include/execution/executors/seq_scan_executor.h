@@ -12,17 +12,30 @@
 
 #pragma once
 
+#include <memory>
 #include <vector>
 
 #include "execution/executor_context.h"
 #include "execution/executors/abstract_executor.h"
+#include "execution/expression_program.h"
+#include "execution/morsel_queue.h"
 #include "execution/plans/seq_scan_plan.h"
+#include "execution/tuple_batch.h"
 #include "storage/table/tuple.h"
 
 namespace bustub {
 
 /**
  * The SeqScanExecutor executor executes a sequential table scan.
+ *
+ * The scan works a page at a time with TableHeap::ScanPage(): the predicate, compiled into an
+ * ExpressionProgram when possible, is evaluated over views of the tuples inside the latched page, and only
+ * the output columns of the qualifying tuples are copied out. Tuples that do not qualify are never copied,
+ * so a selective scan allocates next to nothing. Whole pages are scanned, so a batch may overshoot its
+ * capacity by part of a page.
+ *
+ * Under an Exchange, several instances of the same scan run in parallel. They then find a MorselQueue
+ * for their plan in the ExecutorContext and each scan only the morsels of pages they claim from it.
  */
 class SeqScanExecutor : public AbstractExecutor {
  public:
@@ -44,11 +57,56 @@ class SeqScanExecutor : public AbstractExecutor {
    */
   auto Next(Tuple *tuple, RID *rid) -> bool override;
 
+  /**
+   * Yield the next batch of tuples from the sequential scan.
+   * @param[out] batch The batch that receives the qualifying tuples
+   * @return `true` if a tuple was produced, `false` if there are no more tuples
+   */
+  auto NextBatch(TupleBatch *batch) -> bool override;
+
   /** @return The output schema for the sequential scan */
   auto GetOutputSchema() -> const Schema * override { return plan_->OutputSchema(); }
 
+  /**
+   * Apply a Bloom filter to the raw table tuples, before the predicate and the projection.
+   * Only keys that are plain output columns are accepted.
+   */
+  auto PushDownBloomFilter(const BloomFilter *filter, const AbstractExpression *key) -> bool override;
+
  private:
+  /** @return The table tuple projected onto the output schema */
+  auto Project(const Tuple &table_tuple) const -> Tuple;
+
+  /** @return The id of the next page to scan, or INVALID_PAGE_ID once the scan is done */
+  auto NextPageId() -> page_id_t;
+
+  /** Append the qualifying tuples of a latched page, projected onto the output schema, to a batch */
+  void ScanTuples(const std::vector<Tuple> &table_tuples, TupleBatch *batch);
+
+  /** @return `false` if the Bloom filter rules the table tuple out */
+  auto MayMatchBloomFilter(const Tuple &table_tuple) const -> bool;
+
   /** The sequential scan plan node to be executed */
   const SeqScanPlanNode *plan_;
+  /** Metadata identifying the table that is scanned */
+  const TableInfo *table_info_;
+  /** The next page of the table to scan, unless the scan runs in parallel */
+  page_id_t next_page_id_{INVALID_PAGE_ID};
+  /** The views of the tuples of the page being scanned */
+  std::vector<Tuple> page_views_;
+  /** The indexes in the page being scanned of the tuples the Bloom filter lets through */
+  std::vector<uint32_t> selection_;
+  /** The morsels shared with the other instances of this scan, if it runs in parallel */
+  MorselQueue *morsels_{nullptr};
+  /** The pages of the morsel being scanned */
+  std::vector<page_id_t> morsel_;
+  /** The position in `morsel_` of the next page to scan */
+  size_t morsel_idx_{0};
+  /** The Bloom filter pushed down by a consumer, if any */
+  const BloomFilter *bloom_filter_{nullptr};
+  /** The expression, over the table schema, whose hash is looked up in `bloom_filter_` */
+  const AbstractExpression *bloom_key_{nullptr};
+  /** The predicate compiled in Init(), or nullptr if it is interpreted */
+  std::unique_ptr<ExpressionProgram> predicate_program_;
 };
 }  // namespace bustub
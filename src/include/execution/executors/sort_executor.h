@@ -0,0 +1,165 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// sort_executor.h
+//
+// Identification: src/include/execution/executors/sort_executor.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "execution/executor_context.h"
+#include "execution/executors/abstract_executor.h"
+#include "execution/loser_tree.h"
+#include "execution/plans/sort_plan.h"
+#include "storage/table/tmp_tuple_heap.h"
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+/**
+ * SortExecutor orders the tuples of its child executor.
+ *
+ * Every tuple is given a normalized key: its ORDER BY values encoded so that comparing two keys with
+ * memcmp orders the tuples, which keeps the comparisons in the sort and merge loops free of Value
+ * dispatch. Tuples are sorted in memory while they fit in ExecutorContext::GetMemoryBudget(). Beyond
+ * that, replacement selection turns the input into sorted runs of about twice the budget, written to
+ * TmpTupleHeaps through the buffer pool, and the runs are merged with a loser tree, in several passes
+ * if there are more runs than the buffer pool can read at once.
+ *
+ * When a limit is known (a LimitPlanNode sits on top of the sort), only that many tuples are kept, in a
+ * heap bounded by the limit instead of sorting the whole input.
+ */
+class SortExecutor : public AbstractExecutor {
+ public:
+  /**
+   * Construct a new SortExecutor instance.
+   * @param exec_ctx The executor context
+   * @param plan The sort plan to be executed
+   * @param child_executor The child executor from which tuples are pulled
+   * @param limit The number of tuples that will be consumed, if known
+   */
+  SortExecutor(ExecutorContext *exec_ctx, const SortPlanNode *plan, std::unique_ptr<AbstractExecutor> &&child_executor,
+               std::optional<size_t> limit = std::nullopt);
+
+  /** Initialize the sort */
+  void Init() override;
+
+  /**
+   * Yield the next tuple from the sort.
+   * @param[out] tuple The next tuple produced by the sort
+   * @param[out] rid The next tuple RID produced by the sort
+   * @return `true` if a tuple was produced, `false` if there are no more tuples
+   */
+  auto Next(Tuple *tuple, RID *rid) -> bool override;
+
+  /** @return The output schema for the sort */
+  auto GetOutputSchema() -> const Schema * override { return plan_->OutputSchema(); };
+
+  /**
+   * Append the normalized form of an ORDER BY value to a key.
+   * @param value The value
+   * @param order_by The direction of the ORDER BY term
+   * @param[out] key The key
+   */
+  static void AppendNormalizedKey(const Value &value, OrderByType order_by, std::string *key);
+
+  /** @return The number of sorted runs written by the last Init() */
+  auto GetRunCount() const -> size_t { return run_count_; }
+
+ private:
+  /** A tuple and its normalized key */
+  struct SortEntry {
+    /** The normalized key */
+    std::string key_;
+    /** The tuple */
+    Tuple tuple_;
+    /** The run the entry belongs to during replacement selection */
+    size_t run_;
+  };
+
+  /** A sorted run being merged */
+  struct RunCursor {
+    /** The run */
+    std::unique_ptr<TmpTupleHeap> heap_;
+    /** The current tuple of the run */
+    Tuple tuple_;
+    /** The normalized key of the current tuple */
+    std::string key_;
+    /** `false` once the run is exhausted */
+    bool valid_;
+  };
+
+  /** Orders run cursors on their current keys, exhausted runs last */
+  struct CursorLess {
+    /** The cursors being merged */
+    const std::vector<RunCursor> *cursors_;
+    auto operator()(size_t a, size_t b) const -> bool {
+      const auto &left = (*cursors_)[a];
+      const auto &right = (*cursors_)[b];
+      return left.valid_ && (!right.valid_ || left.key_ < right.key_);
+    }
+  };
+
+  /** @return The normalized key of a tuple */
+  auto MakeKey(const Tuple &tuple) const -> std::string;
+
+  /** @return The bytes an entry accounts for */
+  static auto EntrySize(const SortEntry &entry) -> size_t;
+
+  /** Add an entry to the bounded Top-N heap */
+  void AddTopN(SortEntry &&entry);
+
+  /** Add an entry to the full sort, starting replacement selection once over budget */
+  void AddSort(SortEntry &&entry);
+
+  /** Move the smallest entry of the replacement selection heap to its run */
+  void WriteSmallest();
+
+  /** Advance a run cursor to the next tuple of its run */
+  void Advance(RunCursor *cursor);
+
+  /** Merge runs until few enough are left to be read at once, then open the final merge */
+  void MergeRuns();
+
+  /** The sort plan node to be executed */
+  const SortPlanNode *plan_;
+  /** The child executor from which tuples are obtained */
+  std::unique_ptr<AbstractExecutor> child_executor_;
+  /** The number of tuples that will be consumed, if known */
+  std::optional<size_t> limit_;
+  /** The in-memory entries: a heap during Top-N or replacement selection, sorted for output otherwise */
+  std::vector<SortEntry> entries_;
+  /** The bytes held by `entries_` */
+  size_t memory_{0};
+  /** `true` while only the first `limit_` tuples are kept */
+  bool top_n_{false};
+  /** `true` once the input has outgrown memory and runs are being written */
+  bool spilling_{false};
+  /** The run currently written by replacement selection */
+  size_t current_run_{0};
+  /** The key of the last entry written to the current run */
+  std::string last_key_;
+  /** The sorted runs that have been written */
+  std::vector<std::unique_ptr<TmpTupleHeap>> runs_;
+  /** The number of sorted runs written by the last Init() */
+  size_t run_count_{0};
+  /** The runs of the final merge */
+  std::vector<RunCursor> cursors_;
+  /** The tournament of the final merge, if the sort spilled */
+  std::unique_ptr<LoserTree<CursorLess>> tree_;
+  /** The position of the next in-memory entry to output */
+  size_t cursor_{0};
+};
+
+}  // namespace bustub
@@ -66,11 +66,19 @@ class UpdateExecutor : public AbstractExecutor {
    */
   auto GenerateUpdatedTuple(const Tuple &src_tuple) -> Tuple;
 
+  /**
+   * Update the tuple identified by `rid` in the table and all of its indexes.
+   * @param rid The RID of the tuple to be updated
+   */
+  void UpdateTuple(const RID &rid);
+
   /** The update plan node to be executed */
   const UpdatePlanNode *plan_;
   /** Metadata identifying the table that should be updated */
   const TableInfo *table_info_;
   /** The child executor to obtain value from */
   std::unique_ptr<AbstractExecutor> child_executor_;
+  /** The indexes that must be maintained alongside the table */
+  std::vector<IndexInfo *> indexes_;
 };
 }  // namespace bustub
@@ -0,0 +1,194 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// expression_program.h
+//
+// Identification: src/include/execution/expression_program.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "catalog/schema.h"
+#include "execution/expressions/abstract_expression.h"
+#include "execution/tuple_batch.h"
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+/**
+ * ExpressionProgram is a predicate compiled into a flat list of instructions over typed registers.
+ *
+ * Interpreting an expression tree costs a virtual call per node and a Value, with type dispatch through
+ * Type::GetInstance(), per comparison and tuple. A program is compiled once, in an executor's Init(): every
+ * column reference becomes a load of the raw column bytes at their fixed offset, widened to int64_t or
+ * double, every comparison becomes a kernel specialized on its operator, its operand type and which of its
+ * operands are constants, and constant subexpressions are folded. Filter() runs every instruction over a
+ * whole TupleBatch at once, so the dispatch is paid per batch and the kernels are tight loops over arrays.
+ *
+ * Only comparisons of columns and constants of the fixed-width numeric and boolean types are compiled;
+ * Compile() returns nullptr for anything else and the caller keeps interpreting the tree. The results match
+ * AbstractExpression::Evaluate() exactly; a NULL result passes, since the NULL BOOLEAN of the interpreter is a
+ * nonzero byte that the executors read as `true`.
+ *
+ * A program keeps its registers between calls, so every executor compiles its own.
+ */
+class ExpressionProgram {
+ public:
+  /**
+   * Compile a predicate.
+   * @param predicate the predicate, which must return a BOOLEAN
+   * @param schema the schema of the tuples, or of the left tuples of a join
+   * @param right_schema the schema of the right tuples of a join, or nullptr to compile for single tuples
+   * @return the program, or nullptr if the predicate cannot be compiled
+   */
+  static auto Compile(const AbstractExpression *predicate, const Schema *schema, const Schema *right_schema = nullptr)
+      -> std::unique_ptr<ExpressionProgram>;
+
+  /** @return `true` if the tuple satisfies the predicate */
+  auto Matches(const Tuple &tuple) -> bool;
+
+  /** @return `true` if the pair of tuples satisfies the join predicate */
+  auto MatchesJoin(const Tuple &left_tuple, const Tuple &right_tuple) -> bool;
+
+  /** Narrow the selection of a batch to the tuples that satisfy the predicate. */
+  void Filter(TupleBatch *batch);
+
+  /**
+   * Evaluate the predicate over many tuples at once, such as views into a latched page.
+   * @param tuples the tuples
+   * @return one flag per tuple, nonzero if it satisfies the predicate; valid until the next call
+   */
+  auto Evaluate(const std::vector<Tuple> &tuples) -> const std::vector<uint8_t> &;
+
+  /**
+   * Evaluate the predicate over a selection of many tuples at once.
+   * @param tuples the tuples
+   * @param selection the indexes of the tuples to evaluate
+   * @return one flag per selected tuple, in selection order; valid until the next call
+   */
+  auto Evaluate(const std::vector<Tuple> &tuples, const std::vector<uint32_t> &selection)
+      -> const std::vector<uint8_t> &;
+
+  /** @return the number of instructions, zero if the predicate folded into a constant */
+  auto GetInstructionCount() const -> size_t { return instructions_.size(); }
+
+ private:
+  /** How the values of a register are stored */
+  enum class RegisterType { Integer, Decimal };
+
+  /** An instruction input: a register or a folded constant */
+  struct Operand {
+    /** `true` for a constant */
+    bool constant_;
+    /** The register, unless the operand is a constant */
+    uint32_t reg_;
+    /** The type of the values */
+    RegisterType type_;
+    /** The value of an Integer constant */
+    int64_t integer_;
+    /** The value of a Decimal constant */
+    double decimal_;
+    /** `true` if the constant is NULL */
+    bool null_;
+    /** `true` for BOOLEAN values, which only compare with BOOLEAN values */
+    bool boolean_;
+  };
+
+  struct Instruction;
+
+  /** A kernel runs one instruction over the first `count` rows */
+  using Kernel = void (*)(const Instruction &instruction, ExpressionProgram *program, size_t count);
+
+  /** One step of the program */
+  struct Instruction {
+    /** The kernel, specialized on the operation and operand types */
+    Kernel kernel_;
+    /** The register written */
+    uint32_t dst_;
+    /** The inputs of comparisons and casts */
+    Operand left_;
+    Operand right_;
+    /** The row source of a load: 0 for single tuples and left join tuples, 1 for right join tuples */
+    uint32_t side_;
+    /** The offset of the loaded column in the tuple data */
+    uint32_t offset_;
+  };
+
+  ExpressionProgram() = default;
+
+  /**
+   * Compile a subexpression, appending its instructions.
+   * @param[out] ok set to `false` if the subexpression cannot be compiled
+   * @return the operand holding the value of the subexpression
+   */
+  auto CompileNode(const AbstractExpression *expr, const Schema *schema, const Schema *right_schema, bool *ok)
+      -> Operand;
+
+  /** Append a cast of an Integer operand to a Decimal register, or fold it if the operand is a constant */
+  auto CastToDecimal(const Operand &operand) -> Operand;
+
+  /** @return a new register of the given type */
+  auto NewRegister(RegisterType type) -> uint32_t;
+
+  /** Size the registers for `count` rows and run every instruction */
+  void Run(size_t count);
+
+  /** Run the program over the first `count` rows and set their pass flags in `keep_` */
+  void RunRows(size_t count);
+
+  /** @return `true` if the idx'th row passes, given the result of the last Run() */
+  auto Passes(size_t idx) const -> bool {
+    if (result_.constant_) {
+      return result_.null_ || result_.integer_ != 0;
+    }
+    return nulls_[result_.reg_][idx] != 0 || integers_[result_.reg_][idx] != 0;
+  }
+
+  /** @return the values of a register holding T */
+  template <typename T>
+  auto Values(uint32_t reg) -> std::vector<T> &;
+
+  /** Load a column stored as Raw into a register holding T */
+  template <typename Raw, typename T>
+  static void LoadKernel(const Instruction &instruction, ExpressionProgram *program, size_t count);
+
+  /** Compare two operands holding T */
+  template <typename T, typename Compare, bool LeftConstant, bool RightConstant>
+  static void CompareKernel(const Instruction &instruction, ExpressionProgram *program, size_t count);
+
+  /** Widen an Integer register to a Decimal register */
+  static void CastKernel(const Instruction &instruction, ExpressionProgram *program, size_t count);
+
+  /** @return the comparison kernel for the constness of the operands */
+  template <typename T, template <typename> class Compare>
+  static auto PickCompareKernel(const Operand &left, const Operand &right) -> Kernel;
+
+  /** The instructions, in execution order */
+  std::vector<Instruction> instructions_;
+  /** The type of every register */
+  std::vector<RegisterType> register_types_;
+  /** The values of Integer registers; booleans are stored as 0 and 1 */
+  std::vector<std::vector<int64_t>> integers_;
+  /** The values of Decimal registers */
+  std::vector<std::vector<double>> decimals_;
+  /** The NULL flags of every register */
+  std::vector<std::vector<uint8_t>> nulls_;
+  /** The tuple data of every row, for the left (or only) and right sides */
+  std::vector<const char *> rows_[2];
+  /** `true` if the program was compiled for pairs of join tuples */
+  bool join_{false};
+  /** The value of the predicate */
+  Operand result_{};
+  /** The pass flags of the last evaluated rows */
+  std::vector<uint8_t> keep_;
+};
+
+}  // namespace bustub
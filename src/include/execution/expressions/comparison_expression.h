@@ -54,6 +54,9 @@ class ComparisonExpression : public AbstractExpression {
     return ValueFactory::GetBooleanValue(PerformComparison(lhs, rhs));
   }
 
+  /** @return The type of comparison performed by this expression */
+  auto GetComparisonType() const -> ComparisonType { return comp_type_; }
+
  private:
   auto PerformComparison(const Value &lhs, const Value &rhs) const -> CmpBool {
     switch (comp_type_) {
@@ -37,6 +37,9 @@ class ConstantValueExpression : public AbstractExpression {
     return val_;
   }
 
+  /** @return The constant wrapped by this expression */
+  auto GetValue() const -> const Value & { return val_; }
+
  private:
   Value val_;
 };
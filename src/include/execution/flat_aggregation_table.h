@@ -0,0 +1,164 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// flat_aggregation_table.h
+//
+// Identification: src/include/execution/flat_aggregation_table.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "common/util/hash_util.h"
+#include "execution/plans/aggregation_plan.h"
+#include "type/value.h"
+
+namespace bustub {
+
+/**
+ * AggregateKeyLayout normalizes GROUP BY values into flat, fixed-width keys that are compared with memcmp.
+ *
+ * A key is a run of 64-bit words: the first word is a NULL bitmap, then every group-by column takes one
+ * word holding its value widened to 64 bits (all integer types as int64_t). NULL columns have a zero word,
+ * so two keys are equal exactly when their bytes are, and NULLs group together. Only fixed-length types
+ * are supported; see IsSupported().
+ */
+class AggregateKeyLayout {
+ public:
+  /** The largest number of group-by columns a key can hold */
+  static constexpr size_t MAX_COLUMNS = 64;
+
+  /**
+   * Create the layout for a list of group-by types.
+   * @param types the types of the group-by columns
+   */
+  explicit AggregateKeyLayout(std::vector<TypeId> types) : types_{std::move(types)} {}
+
+  /** @return `true` if keys of these types can be normalized */
+  static auto IsSupported(const std::vector<TypeId> &types) -> bool;
+
+  /** @return the width of a key in bytes */
+  auto GetWidth() const -> size_t { return (types_.size() + 1) * sizeof(uint64_t); }
+
+  /**
+   * Write one column of a key.
+   * @param column the group-by column
+   * @param value the group-by value
+   * @param[out] key the key, which must have been zeroed before its first column was written
+   */
+  void Store(uint32_t column, const Value &value, char *key) const;
+
+  /** @return the hash of a key */
+  auto Hash(const char *key) const -> hash_t;
+
+  /** @return the group-by values of a key */
+  auto Decode(const char *key) const -> std::vector<Value>;
+
+ private:
+  /** The types of the group-by columns */
+  std::vector<TypeId> types_;
+};
+
+/**
+ * AggregateFunctions applies the COUNT/SUM/MIN/MAX semantics of SimpleAggregationHashTable to flat
+ * arrays of running aggregates, and merges partial aggregates computed over disjoint inputs.
+ */
+class AggregateFunctions {
+ public:
+  /** @param agg_types the types of the aggregates */
+  explicit AggregateFunctions(const std::vector<AggregationType> &agg_types) : agg_types_{agg_types} {}
+
+  /** @return the number of aggregates */
+  auto GetCount() const -> size_t { return agg_types_.size(); }
+
+  /** Set the running aggregates of a new group to their initial values */
+  void Initialize(Value *aggregates) const;
+
+  /** Fold one input row, given as the values of the aggregate expressions, into the running aggregates */
+  void Combine(Value *aggregates, const Value *input) const;
+
+  /** Fold the partial aggregates of the same group, computed over other rows, into the running aggregates */
+  void Merge(Value *aggregates, const Value *partial) const;
+
+ private:
+  /** The types of the aggregates */
+  const std::vector<AggregationType> &agg_types_;
+};
+
+/**
+ * FlatAggregationTable maps normalized group keys to running aggregates.
+ *
+ * Groups are stored densely in insertion order: one array of key bytes, one of hashes and one of
+ * aggregates. A separate power-of-two array of group indexes is probed linearly. A table built with
+ * a fixed capacity refuses new groups once full, which is how thread-local pre-aggregation tables know
+ * to flush; otherwise it grows.
+ */
+class FlatAggregationTable {
+ public:
+  /**
+   * Create an empty table.
+   * @param key_width the width of a key in bytes
+   * @param num_aggregates the number of aggregates of a group
+   * @param capacity the number of groups the table holds before it grows or refuses new groups
+   * @param growable `true` if the table grows, `false` if it has a fixed capacity
+   */
+  FlatAggregationTable(size_t key_width, size_t num_aggregates, size_t capacity, bool growable);
+
+  /**
+   * Find the group of a key, adding it if necessary.
+   * @param hash the hash of the key
+   * @param key the key
+   * @param[out] inserted set to `true` if the group is new; its aggregates must then be initialized
+   * @return the running aggregates of the group, or `nullptr` if the group is new and the table is full
+   */
+  auto FindOrInsert(hash_t hash, const char *key, bool *inserted) -> Value *;
+
+  /** @return the number of groups */
+  auto Size() const -> size_t { return hashes_.size(); }
+
+  /** @return the hash of the idx'th group */
+  auto HashAt(size_t idx) const -> hash_t { return hashes_[idx]; }
+
+  /** @return the key of the idx'th group */
+  auto KeyAt(size_t idx) const -> const char * { return keys_.data() + idx * key_width_; }
+
+  /** @return the aggregates of the idx'th group */
+  auto AggregatesAt(size_t idx) -> Value * { return aggregates_.data() + idx * num_aggregates_; }
+
+  /** @return the aggregates of the idx'th group */
+  auto AggregatesAt(size_t idx) const -> const Value * { return aggregates_.data() + idx * num_aggregates_; }
+
+  /** @return the approximate number of bytes held by the table */
+  auto GetMemoryUsage() const -> size_t;
+
+  /** Remove every group, keeping the allocated space */
+  void Clear();
+
+ private:
+  static constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+
+  /** Double the capacity and rebuild the slots */
+  void Grow();
+
+  size_t key_width_;
+  size_t num_aggregates_;
+  size_t capacity_;
+  bool growable_;
+  /** Group indexes, probed linearly; at most half full */
+  std::vector<uint32_t> slots_;
+  /** The key bytes of every group */
+  std::vector<char> keys_;
+  /** The hash of every group */
+  std::vector<hash_t> hashes_;
+  /** The running aggregates of every group */
+  std::vector<Value> aggregates_;
+};
+
+}  // namespace bustub
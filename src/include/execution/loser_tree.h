@@ -0,0 +1,81 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// loser_tree.h
+//
+// Identification: src/include/execution/loser_tree.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <utility>
+#include <vector>
+
+namespace bustub {
+
+/**
+ * LoserTree is a tournament tree for k-way merging. Every internal node remembers the loser of the
+ * match played there and the overall winner sits on top, so replacing the winner replays a single
+ * leaf-to-root path: log2(k) comparisons, against log2(k) to 2 log2(k) for a binary heap.
+ *
+ * The tree only knows source indexes. `less(a, b)` must tell whether the current element of source `a`
+ * comes before that of source `b`, with exhausted sources coming after everything else.
+ *
+ * @tparam Less the type of the comparison callable
+ */
+template <typename Less>
+class LoserTree {
+ public:
+  /**
+   * Build the tree and play the initial tournament.
+   * @param sources the number of sources, at least one
+   * @param less the comparison of the current elements of two sources
+   */
+  LoserTree(size_t sources, Less less) : sources_{sources}, less_{std::move(less)}, nodes_(sources) {
+    nodes_[0] = Play(1);
+  }
+
+  /** @return the source whose current element comes first */
+  auto Winner() const -> size_t { return nodes_[0]; }
+
+  /** Replay the tournament after the winning source moved on to its next element. */
+  void Replay() {
+    auto winner = nodes_[0];
+    for (auto node = (winner + sources_) / 2; node > 0; node /= 2) {
+      if (less_(nodes_[node], winner)) {
+        std::swap(nodes_[node], winner);
+      }
+    }
+    nodes_[0] = winner;
+  }
+
+ private:
+  /** Play the matches of the subtree below `node`, recording the losers, and return its winner */
+  auto Play(size_t node) -> size_t {
+    if (node >= sources_) {
+      // Leaves are the sources themselves; a single source is its own winner
+      return sources_ == 1 ? 0 : node - sources_;
+    }
+    auto left = Play(2 * node);
+    auto right = Play(2 * node + 1);
+    if (less_(right, left)) {
+      nodes_[node] = left;
+      return right;
+    }
+    nodes_[node] = right;
+    return left;
+  }
+
+  /** The number of sources */
+  size_t sources_;
+  /** The comparison of sources */
+  Less less_;
+  /** The overall winner, then the loser of every internal node; node n has children 2n and 2n + 1 */
+  std::vector<size_t> nodes_;
+};
+
+}  // namespace bustub
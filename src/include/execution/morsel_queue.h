@@ -0,0 +1,69 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// morsel_queue.h
+//
+// Identification: src/include/execution/morsel_queue.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "common/config.h"
+#include "storage/table/table_heap.h"
+
+namespace bustub {
+
+/**
+ * MorselQueue hands out the pages of a table heap to parallel scans in morsels of MORSEL_PAGES
+ * consecutive pages. Every page goes to exactly one scan, and a scan that finishes its morsel early
+ * simply claims the next one, so fast workers take over the work of slow ones.
+ *
+ * The pages are taken from the page directory of the heap when the queue is created, so claiming a
+ * morsel is a single atomic increment; pages added to the heap afterwards are not scanned.
+ */
+class MorselQueue {
+ public:
+  /** The number of pages in a morsel */
+  static constexpr size_t MORSEL_PAGES = 4;
+
+  /**
+   * Create a queue over all pages of a table heap.
+   * @param table_heap the table heap to scan
+   */
+  explicit MorselQueue(TableHeap *table_heap) : page_ids_{table_heap->GetPageIds()} {}
+
+  /**
+   * Claim the next morsel.
+   * @param[out] morsel the ids of the pages of the morsel
+   * @return `false` once every page has been handed out
+   */
+  auto Next(std::vector<page_id_t> *morsel) -> bool {
+    morsel->clear();
+    size_t begin = next_.fetch_add(MORSEL_PAGES, std::memory_order_relaxed);
+    if (begin >= page_ids_.size()) {
+      return false;
+    }
+    size_t end = std::min(begin + MORSEL_PAGES, page_ids_.size());
+    morsel->assign(page_ids_.begin() + begin, page_ids_.begin() + end);
+    return true;
+  }
+
+  /** @return the number of pages to scan */
+  auto GetPageCount() const -> size_t { return page_ids_.size(); }
+
+ private:
+  /** The pages to scan */
+  const std::vector<page_id_t> page_ids_;
+  /** The position in `page_ids_` of the first page not handed out yet */
+  std::atomic<size_t> next_{0};
+};
+
+}  // namespace bustub
@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <optional>
 #include <utility>
 #include <vector>
 
@@ -31,7 +32,9 @@ enum class PlanType {
   Distinct,
   NestedLoopJoin,
   NestedIndexJoin,
-  HashJoin
+  HashJoin,
+  Sort,
+  Exchange
 };
 
 /**
@@ -65,6 +68,15 @@ class AbstractPlanNode {
   /** @return the type of this plan node */
   virtual auto GetType() const -> PlanType = 0;
 
+  /** @return the estimated number of output tuples of this plan node, if one is known */
+  auto GetEstimatedCardinality() const -> std::optional<size_t> { return estimated_cardinality_; }
+
+  /**
+   * Attach a cardinality estimate to this plan node. Executors use it to pick an algorithm up front.
+   * @param estimated_cardinality the estimated number of output tuples
+   */
+  void SetEstimatedCardinality(size_t estimated_cardinality) { estimated_cardinality_ = estimated_cardinality; }
+
  private:
   /**
    * The schema for the output of this plan node. In the volcano model, every plan node will spit out tuples,
@@ -73,5 +85,7 @@ class AbstractPlanNode {
   const Schema *output_schema_;
   /** The children of this plan node. */
   std::vector<const AbstractPlanNode *> children_;
+  /** The estimated number of output tuples, if known */
+  std::optional<size_t> estimated_cardinality_;
 };
 }  // namespace bustub
@@ -12,6 +12,9 @@
 
 #pragma once
 
+#include <vector>
+
+#include "common/util/hash_util.h"
 #include "execution/plans/abstract_plan.h"
 
 namespace bustub {
@@ -38,4 +41,48 @@ class DistinctPlanNode : public AbstractPlanNode {
   }
 };
 
+/** DistinctKey represents a row in a distinct operation */
+struct DistinctKey {
+  /** The column values of the row */
+  std::vector<Value> values_;
+
+  /**
+   * Compares two distinct keys for equality. NULLs compare equal to each other, as in SQL DISTINCT.
+   * @param other the other distinct key to be compared with
+   * @return `true` if both distinct keys have equivalent values, `false` otherwise
+   */
+  auto operator==(const DistinctKey &other) const -> bool {
+    for (uint32_t i = 0; i < other.values_.size(); i++) {
+      if (values_[i].IsNull() || other.values_[i].IsNull()) {
+        if (values_[i].IsNull() != other.values_[i].IsNull()) {
+          return false;
+        }
+        continue;
+      }
+      if (values_[i].CompareEquals(other.values_[i]) != CmpBool::CmpTrue) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
 }  // namespace bustub
+
+namespace std {
+
+/** Implements std::hash on DistinctKey */
+template <>
+struct hash<bustub::DistinctKey> {
+  auto operator()(const bustub::DistinctKey &distinct_key) const -> std::size_t {
+    size_t curr_hash = 0;
+    for (const auto &value : distinct_key.values_) {
+      if (!value.IsNull()) {
+        curr_hash = bustub::HashUtil::CombineHashes(curr_hash, bustub::HashUtil::HashValue(&value));
+      }
+    }
+    return curr_hash;
+  }
+};
+
+}  // namespace std
@@ -0,0 +1,55 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// exchange_plan.h
+//
+// Identification: src/include/execution/plans/exchange_plan.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "execution/plans/abstract_plan.h"
+
+namespace bustub {
+
+/**
+ * Exchange runs several instances of its child plan in parallel and gathers their output.
+ *
+ * The instances split the pages of the sequential scan that drives the child pipeline (see
+ * ExchangeExecutor::GetDrivingScan()) between them, so together they produce the output of a single
+ * instance, in no particular order. Every other part of the child plan runs in full in every instance, e.g. each
+ * instance of a hash join builds its own hash table and probes it with its share of the scan.
+ */
+class ExchangePlanNode : public AbstractPlanNode {
+ public:
+  /**
+   * Construct a new ExchangePlanNode instance.
+   * @param output_schema The output schema of the exchange, the same as the child's
+   * @param child The child plan to run in parallel
+   * @param parallelism The number of instances of the child, or 0 for ExecutorContext::GetParallelism()
+   */
+  ExchangePlanNode(const Schema *output_schema, const AbstractPlanNode *child, size_t parallelism = 0)
+      : AbstractPlanNode(output_schema, {child}), parallelism_{parallelism} {}
+
+  /** @return The type of the plan node */
+  auto GetType() const -> PlanType override { return PlanType::Exchange; }
+
+  /** @return The child plan node */
+  auto GetChildPlan() const -> const AbstractPlanNode * {
+    BUSTUB_ASSERT(GetChildren().size() == 1, "Exchange should have at most one child plan.");
+    return GetChildAt(0);
+  }
+
+  /** @return The number of instances of the child, or 0 for ExecutorContext::GetParallelism() */
+  auto GetParallelism() const -> size_t { return parallelism_; }
+
+ private:
+  /** The number of instances of the child */
+  size_t parallelism_;
+};
+
+}  // namespace bustub
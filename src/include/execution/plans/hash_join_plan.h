@@ -15,6 +15,7 @@
 #include <utility>
 #include <vector>
 
+#include "common/util/hash_util.h"
 #include "execution/plans/abstract_plan.h"
 
 namespace bustub {
@@ -65,4 +66,29 @@ class HashJoinPlanNode : public AbstractPlanNode {
   const AbstractExpression *right_key_expression_;
 };
 
+/** HashJoinKey represents a join key in a hash join operation */
+struct HashJoinKey {
+  /** The join key value */
+  Value key_;
+
+  /**
+   * Compares two hash join keys for equality.
+   * @param other the other hash join key to be compared with
+   * @return `true` if both hash join keys have equivalent values, `false` otherwise
+   */
+  auto operator==(const HashJoinKey &other) const -> bool { return key_.CompareEquals(other.key_) == CmpBool::CmpTrue; }
+};
+
 }  // namespace bustub
+
+namespace std {
+
+/** Implements std::hash on HashJoinKey */
+template <>
+struct hash<bustub::HashJoinKey> {
+  auto operator()(const bustub::HashJoinKey &join_key) const -> std::size_t {
+    return join_key.key_.IsNull() ? 0 : bustub::HashUtil::HashValue(&join_key.key_);
+  }
+};
+
+}  // namespace std
@@ -0,0 +1,61 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// sort_plan.h
+//
+// Identification: src/include/execution/plans/sort_plan.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "execution/expressions/abstract_expression.h"
+#include "execution/plans/abstract_plan.h"
+
+namespace bustub {
+
+/** OrderByType enumerates the directions of an ORDER BY term; NULLs sort before every other value. */
+enum class OrderByType { Ascending, Descending };
+
+/**
+ * Sort orders the output of a child node on a list of ORDER BY terms. The output schema is the
+ * schema of the child; the terms are evaluated against it.
+ */
+class SortPlanNode : public AbstractPlanNode {
+ public:
+  /**
+   * Construct a new SortPlanNode instance.
+   * @param output_schema The output schema of this sort plan node
+   * @param child The child plan from which tuples are obtained
+   * @param order_bys The ORDER BY terms, most significant first
+   */
+  SortPlanNode(const Schema *output_schema, const AbstractPlanNode *child,
+               std::vector<std::pair<OrderByType, const AbstractExpression *>> order_bys)
+      : AbstractPlanNode(output_schema, {child}), order_bys_{std::move(order_bys)} {}
+
+  /** @return The type of the plan node */
+  auto GetType() const -> PlanType override { return PlanType::Sort; }
+
+  /** @return The child plan node */
+  auto GetChildPlan() const -> const AbstractPlanNode * {
+    BUSTUB_ASSERT(GetChildren().size() == 1, "Sort should have at most one child plan.");
+    return GetChildAt(0);
+  }
+
+  /** @return The ORDER BY terms */
+  auto GetOrderBys() const -> const std::vector<std::pair<OrderByType, const AbstractExpression *>> & {
+    return order_bys_;
+  }
+
+ private:
+  /** The ORDER BY terms */
+  std::vector<std::pair<OrderByType, const AbstractExpression *>> order_bys_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,138 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// radix_join_table.h
+//
+// Identification: src/include/execution/radix_join_table.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "common/util/hash_util.h"
+
+namespace bustub {
+
+/** The hash of a join key and the row that carries it */
+struct RadixEntry {
+  /** The hash of the join key */
+  hash_t hash_;
+  /** The position of the row in the materialized input */
+  uint32_t row_;
+};
+
+/**
+ * RadixPartitions scatters entries into 2^radix_bits contiguous partitions by the low bits of their hash.
+ *
+ * The scatter runs in two passes: a histogram pass sizes each partition, then every entry is staged in a
+ * cache-line sized write-combining buffer for its partition, which is copied out once full. With many
+ * partitions this turns one cache (and TLB) miss per entry into one per cache line.
+ */
+class RadixPartitions {
+ public:
+  /** Entries staged per partition before they are written out; one cache line worth */
+  static constexpr uint32_t WRITE_COMBINE_ENTRIES = 64 / sizeof(RadixEntry);
+
+  /**
+   * Partition the entries, replacing the previous contents.
+   * @param input the entries to partition
+   * @param radix_bits the number of low hash bits that select a partition
+   */
+  void Partition(const std::vector<RadixEntry> &input, uint32_t radix_bits);
+
+  /** @return the number of partitions */
+  auto GetPartitionCount() const -> uint32_t { return 1U << radix_bits_; }
+
+  /** @return the first entry of partition `part` */
+  auto PartitionBegin(uint32_t part) const -> const RadixEntry * { return entries_.data() + offsets_[part]; }
+
+  /** @return one past the last entry of partition `part` */
+  auto PartitionEnd(uint32_t part) const -> const RadixEntry * { return entries_.data() + offsets_[part + 1]; }
+
+  /** @return the partition of a hash when partitioning on `radix_bits` bits */
+  static auto PartitionOf(hash_t hash, uint32_t radix_bits) -> uint32_t {
+    return static_cast<uint32_t>(hash & ((hash_t{1} << radix_bits) - 1));
+  }
+
+ private:
+  /** The number of low hash bits that select a partition */
+  uint32_t radix_bits_{0};
+  /** The partitioned entries, partition by partition */
+  std::vector<RadixEntry> entries_;
+  /** Offset of each partition in `entries_`, plus the total entry count */
+  std::vector<size_t> offsets_{0, 0};
+};
+
+/**
+ * RadixJoinTable is the build side of a radix-partitioned hash join: one compact linear-probing table
+ * per radix partition, all stored back to back in a single array. Each table is sized for about
+ * TARGET_PARTITION_ROWS rows so that probing a partition stays within the CPU caches.
+ *
+ * The table only knows hashes and row numbers; callers compare the actual keys of candidate rows. The
+ * hashes should be passed through HashUtil::Finalize() so that the partition bits are well mixed.
+ */
+class RadixJoinTable {
+ public:
+  /** The number of build rows a partition should hold */
+  static constexpr size_t TARGET_PARTITION_ROWS = 2048;
+  /** The largest number of radix bits used; more partitions thrash the TLB during the scatter */
+  static constexpr uint32_t MAX_RADIX_BITS = 12;
+
+  /** @return the number of radix bits that gives partitions of about TARGET_PARTITION_ROWS rows */
+  static auto ChooseRadixBits(size_t rows) -> uint32_t;
+
+  /**
+   * Build the table, replacing the previous contents.
+   * @param entries the build side entries
+   * @param radix_bits the number of radix bits, see ChooseRadixBits()
+   */
+  void Build(const std::vector<RadixEntry> &entries, uint32_t radix_bits);
+
+  /** Drop every entry */
+  void Clear();
+
+  /** @return the number of radix bits the table was built with */
+  auto GetRadixBits() const -> uint32_t { return radix_bits_; }
+
+  /**
+   * Call `callback(row)` for every build row whose hash equals `hash`.
+   * @param hash the hash of the probe key
+   * @param callback a callable taking the uint32_t row of a candidate
+   */
+  template <typename Callback>
+  void ForEachCandidate(hash_t hash, Callback &&callback) const {
+    auto part = RadixPartitions::PartitionOf(hash, radix_bits_);
+    auto base = table_offsets_[part];
+    auto mask = table_offsets_[part + 1] - base - 1;
+    // The low bits picked the partition, so the slot comes from the bits above them
+    for (auto slot = (hash >> radix_bits_) & mask;; slot = (slot + 1) & mask) {
+      const auto &entry = slots_[base + slot];
+      if (entry.row_ == EMPTY_ROW) {
+        return;
+      }
+      if (entry.hash_ == hash) {
+        callback(entry.row_);
+      }
+    }
+  }
+
+ private:
+  /** Marks an unused slot */
+  static constexpr uint32_t EMPTY_ROW = std::numeric_limits<uint32_t>::max();
+
+  /** The number of low hash bits that select a partition */
+  uint32_t radix_bits_{0};
+  /** The slots of every partition's table */
+  std::vector<RadixEntry> slots_;
+  /** Offset of each partition's table in `slots_`, plus the total slot count; table sizes are powers of two */
+  std::vector<size_t> table_offsets_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,89 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// task_scheduler.h
+//
+// Identification: src/include/execution/task_scheduler.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <functional>
+#include <future>  // NOLINT
+#include <memory>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * TaskScheduler is a work-stealing thread pool.
+ *
+ * Every worker owns a deque of tasks. A task submitted from a worker goes to the back of that worker's
+ * deque, other tasks are dealt round robin. A worker runs the newest task of its own deque first, which
+ * keeps related work on one core, and once its deque is empty it steals the oldest task of another
+ * worker. Idle workers sleep until a task is submitted.
+ */
+class TaskScheduler {
+ public:
+  /**
+   * Start the workers.
+   * @param threads the number of worker threads, at least one
+   */
+  explicit TaskScheduler(size_t threads);
+
+  /** Run the tasks still queued, then stop and join the workers. */
+  ~TaskScheduler();
+
+  DISALLOW_COPY_AND_MOVE(TaskScheduler);
+
+  /**
+   * Queue a task.
+   * @param task the task
+   * @return a future that becomes ready once the task has run, holding any exception it threw
+   */
+  auto Submit(std::function<void()> task) -> std::future<void>;
+
+  /** @return the number of worker threads */
+  auto GetThreadCount() const -> size_t { return threads_.size(); }
+
+ private:
+  /** The tasks of one worker */
+  struct WorkerQueue {
+    std::mutex latch_;
+    std::deque<std::packaged_task<void()>> tasks_;
+  };
+
+  /** The loop of a worker thread */
+  void Run(size_t worker);
+
+  /** Take a task from the worker's own deque, or steal one; `false` if every deque is empty */
+  auto TryTake(size_t worker, std::packaged_task<void()> *task) -> bool;
+
+  /** The deque of every worker */
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+  /** The worker threads */
+  std::vector<std::thread> threads_;
+  /** Protects `queued_` and `stopping_` and goes with `wake_` */
+  std::mutex latch_;
+  /** Wakes workers when tasks are queued or the scheduler stops */
+  std::condition_variable wake_;
+  /** The number of tasks queued and not yet taken */
+  size_t queued_{0};
+  /** `true` once the destructor runs */
+  bool stopping_{false};
+  /** The deque that receives the next task submitted from outside the pool */
+  std::atomic<size_t> next_queue_{0};
+};
+
+}  // namespace bustub
@@ -0,0 +1,129 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// tuple_batch.h
+//
+// Identification: src/include/execution/tuple_batch.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+#include "common/rid.h"
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+/**
+ * TupleBatch is the unit of work exchanged by AbstractExecutor::NextBatch().
+ *
+ * A batch owns up to `capacity` tuples together with their RIDs, plus a selection
+ * vector holding the positions of the tuples that are still "live". Operators such
+ * as filters, DISTINCT and LIMIT narrow the selection in place instead of copying
+ * the surviving tuples into a new batch. All accessors below that take an index
+ * address the i-th *selected* tuple, not the i-th physical slot.
+ */
+class TupleBatch {
+ public:
+  /**
+   * Construct a new TupleBatch.
+   * @param capacity The maximum number of tuples held by the batch
+   */
+  explicit TupleBatch(uint32_t capacity = TUPLE_BATCH_SIZE) : capacity_{capacity} {}
+
+  /** Drop every tuple and clear the selection; the backing storage is kept for reuse. */
+  void Reset() {
+    tuples_.clear();
+    rids_.clear();
+    selection_.clear();
+  }
+
+  /** @return The maximum number of tuples held by the batch */
+  auto Capacity() const -> uint32_t { return capacity_; }
+
+  /** @return `true` if no more tuples can be appended */
+  auto IsFull() const -> bool { return tuples_.size() >= capacity_; }
+
+  /** @return `true` if no tuple is selected */
+  auto IsEmpty() const -> bool { return selection_.empty(); }
+
+  /** @return The number of selected tuples */
+  auto Size() const -> uint32_t { return static_cast<uint32_t>(selection_.size()); }
+
+  /**
+   * Append a tuple to the batch and select it.
+   * @param tuple The tuple to take ownership of
+   * @param rid The RID of the tuple
+   */
+  void Append(Tuple &&tuple, const RID &rid) {
+    selection_.push_back(static_cast<uint32_t>(tuples_.size()));
+    tuples_.emplace_back(std::move(tuple));
+    rids_.push_back(rid);
+  }
+
+  /** @return The idx'th selected tuple */
+  auto TupleAt(uint32_t idx) -> Tuple & { return tuples_[selection_[idx]]; }
+
+  /** @return The idx'th selected tuple */
+  auto TupleAt(uint32_t idx) const -> const Tuple & { return tuples_[selection_[idx]]; }
+
+  /** @return The RID of the idx'th selected tuple */
+  auto RidAt(uint32_t idx) const -> const RID & { return rids_[selection_[idx]]; }
+
+  /**
+   * Narrow the selection to the tuples for which `pred(tuple)` is true. Order is preserved.
+   * @param pred A callable taking `const Tuple &` and returning bool
+   */
+  template <typename Predicate>
+  void Filter(Predicate &&pred) {
+    uint32_t kept = 0;
+    for (auto pos : selection_) {
+      if (pred(static_cast<const Tuple &>(tuples_[pos]))) {
+        selection_[kept++] = pos;
+      }
+    }
+    selection_.resize(kept);
+  }
+
+  /**
+   * Narrow the selection to the tuples whose flag is set.
+   * @param keep one flag per selected tuple, in selection order
+   */
+  void Select(const uint8_t *keep) {
+    uint32_t kept = 0;
+    for (uint32_t idx = 0; idx < selection_.size(); idx++) {
+      selection_[kept] = selection_[idx];
+      kept += keep[idx] != 0 ? 1 : 0;
+    }
+    selection_.resize(kept);
+  }
+
+  /**
+   * Keep only the first `count` selected tuples.
+   * @param count The number of selected tuples to keep
+   */
+  void Truncate(uint32_t count) {
+    if (count < selection_.size()) {
+      selection_.resize(count);
+    }
+  }
+
+ private:
+  /** The maximum number of tuples held by the batch */
+  uint32_t capacity_;
+  /** Physical tuple slots */
+  std::vector<Tuple> tuples_;
+  /** The RID of each physical tuple slot */
+  std::vector<RID> rids_;
+  /** Positions into `tuples_` of the selected tuples, in output order */
+  std::vector<uint32_t> selection_;
+};
+
+}  // namespace bustub
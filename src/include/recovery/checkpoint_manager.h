@@ -12,6 +12,9 @@
 
 #pragma once
 
+#include <thread>  // NOLINT
+#include <vector>
+
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/transaction_manager.h"
 #include "recovery/log_manager.h"
@@ -19,7 +22,12 @@
 namespace bustub {
 
 /**
- * CheckpointManager creates consistent checkpoints by blocking all other transactions temporarily.
+ * CheckpointManager takes fuzzy checkpoints without blocking transactions.
+ *
+ * BeginCheckpoint() snapshots the active transaction table and the dirty page table, logs them in a CHECKPOINT
+ * record and points the master record at it; recovery then starts its log scan from the checkpoint instead of
+ * the start of the log. The pages dirty at the checkpoint are flushed in the background, one at a time, which
+ * moves the redo start of later checkpoints forward. EndCheckpoint() waits for that flush.
  */
 class CheckpointManager {
  public:
@@ -29,15 +37,23 @@ class CheckpointManager {
         log_manager_(log_manager),
         buffer_pool_manager_(buffer_pool_manager) {}
 
-  ~CheckpointManager() = default;
+  ~CheckpointManager() { EndCheckpoint(); }
 
+  /** Log a checkpoint and start flushing the pages dirty at it; waits for the flush of the previous checkpoint. */
   void BeginCheckpoint();
+
+  /** Wait until every page dirty at the last checkpoint has been flushed. */
   void EndCheckpoint();
 
  private:
-  TransactionManager *transaction_manager_ __attribute__((__unused__));
-  LogManager *log_manager_ __attribute__((__unused__));
-  BufferPoolManager *buffer_pool_manager_ __attribute__((__unused__));
+  /** Flush the pages of a dirty page table, taking each page's read latch so only consistent images are written */
+  void FlushPages(const std::vector<DirtyPageEntry> &dirty_pages);
+
+  TransactionManager *transaction_manager_;
+  LogManager *log_manager_;
+  BufferPoolManager *buffer_pool_manager_;
+  /** Flushes the dirty pages of the last checkpoint */
+  std::thread flush_thread_;
 };
 
 }  // namespace bustub
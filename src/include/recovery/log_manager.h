@@ -16,6 +16,7 @@
 #include <condition_variable>  // NOLINT
 #include <future>              // NOLINT
 #include <mutex>               // NOLINT
+#include <thread>              // NOLINT
 
 #include "recovery/log_record.h"
 #include "storage/disk/disk_manager.h"
@@ -25,16 +26,36 @@ namespace bustub {
 /**
  * LogManager maintains a separate thread that is awakened whenever the log buffer is full or whenever a timeout
  * happens. When the thread is awakened, the log buffer's content is written into the disk log file.
+ *
+ * Appending a record reserves space in the log buffer with a compare-and-swap on an atomic word holding the buffer
+ * offset, the number of records being copied in and a sealed flag, so appenders never take a latch. To flush, the
+ * flush thread seals the buffer, waits for the copies in flight, swaps it with the flush buffer and writes the full
+ * buffer out while appends continue into the other one. Records of one page or one transaction are in LSN order in
+ * the log; records of concurrent appends may be copied in either order.
+ *
+ * Committing transactions call Flush() and wait: every commit that arrives while a buffer is being written is made
+ * durable by the next write, which is synced to disk before the waiters are woken, so one write and one sync cover a
+ * whole group of commits.
  */
 class LogManager {
  public:
   explicit LogManager(DiskManager *disk_manager)
-      : next_lsn_(0), persistent_lsn_(INVALID_LSN), disk_manager_(disk_manager) {
+      : next_lsn_(0),
+        persistent_lsn_(INVALID_LSN),
+        buffer_file_offset_(disk_manager->GetLogEndOffset()),
+        disk_manager_(disk_manager) {
     log_buffer_ = new char[LOG_BUFFER_SIZE];
     flush_buffer_ = new char[LOG_BUFFER_SIZE];
+    // The log and the page LSNs on disk carry on from earlier runs, so the LSNs must too
+    lsn_t last_lsn = FindLastLSN();
+    next_lsn_ = last_lsn + 1;
+    persistent_lsn_ = last_lsn;
   }
 
   ~LogManager() {
+    if (flush_thread_ != nullptr) {
+      StopFlushThread();
+    }
     delete[] log_buffer_;
     delete[] flush_buffer_;
     log_buffer_ = nullptr;
@@ -46,13 +67,61 @@ class LogManager {
 
   auto AppendLogRecord(LogRecord *log_record) -> lsn_t;
 
+  /**
+   * Append a CHECKPOINT record, flush the log up to it and point the master record at it, so recovery starts
+   * from this checkpoint.
+   * @return the LSN of the record
+   */
+  auto AppendCheckpoint(LogRecord *checkpoint) -> lsn_t;
+
+  /**
+   * Block until the log is durable up to a record, asking the flush thread for an early flush.
+   * @param lsn the LSN of the record; LSNs that were never handed out wait for every record appended so far
+   */
+  void Flush(lsn_t lsn);
+
+  /**
+   * @return the log file offset the next appended record will start at; every record appended after the call
+   * starts at or after it
+   */
+  auto GetNextOffset() -> int;
+
+  /** @return the number of times the log buffer has been written to disk */
+  inline auto GetFlushCount() -> uint64_t {
+    std::scoped_lock lock(latch_);
+    return flush_count_;
+  }
+
   inline auto GetNextLSN() -> lsn_t { return next_lsn_; }
   inline auto GetPersistentLSN() -> lsn_t { return persistent_lsn_; }
   inline void SetPersistentLSN(lsn_t lsn) { persistent_lsn_ = lsn; }
   inline auto GetLogBuffer() -> char * { return log_buffer_; }
 
  private:
-  // TODO(students): you may add your own member variables
+  /** The sealed flag of the buffer state: no space can be reserved until the buffers are swapped */
+  static constexpr uint64_t SEALED = 1ULL << 63;
+  /** One record being copied into the buffer, counted in bits 48..62 of the buffer state */
+  static constexpr uint64_t WRITER = 1ULL << 48;
+  /** The number of buffer swaps, modulo 2^16, in bits 32..47 of the buffer state */
+  static constexpr uint64_t EPOCH = 1ULL << 32;
+  static constexpr uint64_t EPOCH_MASK = WRITER - EPOCH;
+  /** The buffer offset, in bits 0..31 of the buffer state */
+  static constexpr uint64_t OFFSET_MASK = EPOCH - 1;
+
+  /**
+   * Reserve space in the log buffer, waiting for a flush while it is full.
+   * @return the offset of the reserved space; the caller must release its writer count once the copy is done
+   */
+  auto ReserveSpace(uint32_t size) -> uint32_t;
+
+  /**
+   * Read the log written by earlier runs from the last checkpoint on, using `flush_buffer_`.
+   * @return the LSN of its last record, or INVALID_LSN if it is empty
+   */
+  auto FindLastLSN() -> lsn_t;
+
+  /** Swap the buffers and write the filled one to disk. Flushes are serialized by `flush_latch_`. */
+  void FlushBuffer();
 
   /** The atomic counter which records the next log sequence number. */
   std::atomic<lsn_t> next_lsn_;
@@ -62,13 +131,30 @@ class LogManager {
   char *log_buffer_;
   char *flush_buffer_;
 
+  /** The offset, swap epoch, writer count and sealed flag of `log_buffer_` */
+  std::atomic<uint64_t> buffer_state_{0};
+  /** The log file offset `log_buffer_` will be written at; only changed while the buffer is sealed */
+  std::atomic<int> buffer_file_offset_;
+
+  /** Protects the flush requests and counts and is used with both condition variables */
   std::mutex latch_;
+  /** Serializes buffer swaps */
+  std::mutex flush_latch_;
 
-  std::thread *flush_thread_ __attribute__((__unused__));
+  std::thread *flush_thread_{nullptr};
 
+  /** Wakes the flush thread */
   std::condition_variable cv_;
-
-  DiskManager *disk_manager_ __attribute__((__unused__));
+  /** Wakes the appenders and committers waiting for a flush */
+  std::condition_variable flushed_cv_;
+  /** `true` if someone is waiting for the next flush */
+  bool flush_requested_{false};
+  /** `true` once the flush thread should exit */
+  bool stop_flush_thread_{false};
+  /** The number of buffer writes so far */
+  uint64_t flush_count_{0};
+
+  DiskManager *disk_manager_;
 };
 
 }  // namespace bustub
@@ -12,8 +12,11 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
 #include "storage/table/tuple.h"
@@ -32,31 +35,72 @@ enum class LogRecordType {
   ABORT,
   /** Creating a new page in the table heap. */
   NEWPAGE,
+  /** Appending a whole page of tuples to the table heap. */
+  INSERTPAGE,
+  /** A fuzzy checkpoint: the active transactions and dirty pages when it was taken. */
+  CHECKPOINT,
+};
+
+/** An entry of the active transaction table of a checkpoint */
+struct ActiveTxnEntry {
+  txn_id_t txn_id_;
+  /** The last record of the transaction when the checkpoint was taken */
+  lsn_t last_lsn_;
+  /** The log file offset at or before the first record of the transaction */
+  int first_offset_;
+};
+
+/** An entry of the dirty page table of a checkpoint */
+struct DirtyPageEntry {
+  page_id_t page_id_;
+  /** The log file offset at or before the first change of the page that may not be on disk */
+  int rec_offset_;
 };
 
 /**
  * For every write operation on the table page, you should write ahead a corresponding log record.
  *
- * For EACH log record, HEADER is like (5 fields in common, 20 bytes in total).
- *---------------------------------------------
- * | size | LSN | transID | prevLSN | LogType |
- *---------------------------------------------
- * For insert type log record
- *---------------------------------------------------------------
- * | HEADER | tuple_rid | tuple_size | tuple_data(char[] array) |
+ * Records are encoded compactly: integers are varints (7 bits per byte, low groups first) and the ids that may be
+ * invalid (-1) are stored plus one. EACH log record starts with a HEADER of 11 to 24 bytes:
+ *---------------------------------------------------------------------------------
+ * | size | CRC32C (4) | LogType (1) | LSN (4) | transID + 1 | prevLSN + 1 | BODY |
+ *---------------------------------------------------------------------------------
+ * size is the length of the whole record, and the CRC32C covers everything after it, so a record torn by a crash
+ * ends the log. The LSN is fixed-width because the size of a record is known before its LSN is assigned.
+ *
+ * A compensation record (CLR) logs the undo of a change by recovery as a change of its own, with the high bit of
+ * LogType set and the LSN of the next record of the transaction to undo after prevLSN:
+ *----------------------------------------------------------------------------------------------------------
+ * | size | CRC32C (4) | LogType + 0x80 (1) | LSN (4) | transID + 1 | prevLSN + 1 | undoNextLSN + 1 | BODY |
+ *----------------------------------------------------------------------------------------------------------
+ * Redo applies it like any record of its type; undo never undoes it, and skips to its undoNextLSN instead.
+ *
+ * For insert and apply delete type log records (a page id and slot number make up the rid)
  *---------------------------------------------------------------
- * For delete type (including markdelete, rollbackdelete, applydelete)
- *----------------------------------------------------------------
- * | HEADER | tuple_rid | tuple_size | tuple_data(char[] array) |
+ * | HEADER | page_id | slot | tuple_size | tuple_data |
  *---------------------------------------------------------------
- * For update type log record
- *-----------------------------------------------------------------------------------
- * | HEADER | tuple_rid | tuple_size | old_tuple_data | tuple_size | new_tuple_data |
- *-----------------------------------------------------------------------------------
+ * For mark delete and rollback delete type log records, which only flip the delete flag
+ *-----------------------------
+ * | HEADER | page_id | slot |
+ *-----------------------------
+ * For update type log record, the delta from the old to the new tuple: runs of changed bytes, each after `gap`
+ * unchanged bytes, as long as the record lasts. Redo and undo rebuild one image from the other.
+ *---------------------------------------------------------------------------------------
+ * | HEADER | page_id | slot | gap | old_size | new_size | old_bytes | new_bytes | ... |
+ *---------------------------------------------------------------------------------------
  * For new page type log record
- *--------------------------
- * | HEADER | prev_page_id |
- *--------------------------
+ *------------------------------------------
+ * | HEADER | prev_page_id + 1 | page_id |
+ *------------------------------------------
+ * For insert page type log record, tuple_count is the number of tuples in the page image
+ *-------------------------------------------------------------------------------
+ * | HEADER | prev_page_id + 1 | page_id | tuple_count | page_image (PAGE_SIZE) |
+ *-------------------------------------------------------------------------------
+ * For checkpoint type log record, with every entry field a varint
+ *-----------------------------------------------------------------------------------------------------------------
+ * | HEADER | begin_offset | txn_count | ActiveTxnEntry[txn_count] | page_count | DirtyPageEntry[page_count] |
+ *-----------------------------------------------------------------------------------------------------------------
+ * begin_offset is the log file offset when the tables were snapshotted, at or before the checkpoint record.
  */
 class LogRecord {
   friend class LogManager;
@@ -67,7 +111,9 @@ class LogRecord {
 
   // constructor for Transaction type(BEGIN/COMMIT/ABORT)
   LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type)
-      : size_(HEADER_SIZE), txn_id_(txn_id), prev_lsn_(prev_lsn), log_record_type_(log_record_type) {}
+      : txn_id_(txn_id), prev_lsn_(prev_lsn), log_record_type_(log_record_type) {
+    ComputeSize();
+  }
 
   // constructor for INSERT/DELETE type
   LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type, const RID &rid, const Tuple &tuple)
@@ -81,8 +127,7 @@ class LogRecord {
       delete_rid_ = rid;
       delete_tuple_ = tuple;
     }
-    // calculate log record size
-    size_ = HEADER_SIZE + sizeof(RID) + sizeof(int32_t) + tuple.GetLength();
+    ComputeSize();
   }
 
   // constructor for UPDATE type
@@ -94,20 +139,40 @@ class LogRecord {
         update_rid_(update_rid),
         old_tuple_(old_tuple),
         new_tuple_(new_tuple) {
-    // calculate log record size
-    size_ = HEADER_SIZE + sizeof(RID) + old_tuple.GetLength() + new_tuple.GetLength() + 2 * sizeof(int32_t);
+    update_delta_ = EncodeUpdateDelta(old_tuple, new_tuple);
+    ComputeSize();
   }
 
   // constructor for NEWPAGE type
   LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type, page_id_t prev_page_id, page_id_t page_id)
-      : size_(HEADER_SIZE),
-        txn_id_(txn_id),
+      : txn_id_(txn_id),
         prev_lsn_(prev_lsn),
         log_record_type_(log_record_type),
         prev_page_id_(prev_page_id),
         page_id_(page_id) {
-    // calculate log record size, header size + sizeof(prev_page_id) + sizeof(page_id)
-    size_ = HEADER_SIZE + sizeof(page_id_t) * 2;
+    ComputeSize();
+  }
+
+  // constructor for INSERTPAGE type; the image is not copied and must stay valid until the record is appended
+  LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type, page_id_t prev_page_id, page_id_t page_id,
+            uint32_t tuple_count, const char *page_image)
+      : txn_id_(txn_id),
+        prev_lsn_(prev_lsn),
+        log_record_type_(log_record_type),
+        prev_page_id_(prev_page_id),
+        page_id_(page_id),
+        tuple_count_(tuple_count),
+        page_image_(page_image) {
+    ComputeSize();
+  }
+
+  // constructor for CHECKPOINT type
+  LogRecord(int begin_offset, std::vector<ActiveTxnEntry> active_txns, std::vector<DirtyPageEntry> dirty_pages)
+      : log_record_type_(LogRecordType::CHECKPOINT),
+        begin_offset_(begin_offset),
+        active_txns_(std::move(active_txns)),
+        dirty_pages_(std::move(dirty_pages)) {
+    ComputeSize();
   }
 
   ~LogRecord() = default;
@@ -120,6 +185,7 @@ class LogRecord {
 
   inline auto GetInsertRID() -> RID & { return insert_rid_; }
 
+  // the old and new tuples are only known to the record that logged the update, not to a deserialized one
   inline auto GetOriginalTuple() -> Tuple & { return old_tuple_; }
 
   inline auto GetUpdateTuple() -> Tuple & { return new_tuple_; }
@@ -128,6 +194,36 @@ class LogRecord {
 
   inline auto GetNewPageRecord() -> page_id_t { return prev_page_id_; }
 
+  inline auto GetPageId() -> page_id_t { return page_id_; }
+
+  inline auto GetTupleCount() -> uint32_t { return tuple_count_; }
+
+  inline auto GetPageImage() -> const char * { return page_image_; }
+
+  inline auto GetBeginOffset() -> int { return begin_offset_; }
+
+  /** @return for a checkpoint, the offset redo starts at: changes logged before it are in the database file */
+  auto GetRedoOffset() const -> int {
+    int offset = begin_offset_;
+    for (const auto &entry : dirty_pages_) {
+      offset = std::min(offset, entry.rec_offset_);
+    }
+    return offset;
+  }
+
+  /** @return for a checkpoint, the oldest offset recovery reads: the redo offset or the first record of a loser */
+  auto GetScanOffset() const -> int {
+    int offset = GetRedoOffset();
+    for (const auto &entry : active_txns_) {
+      offset = std::min(offset, entry.first_offset_);
+    }
+    return offset;
+  }
+
+  inline auto GetActiveTxns() -> std::vector<ActiveTxnEntry> & { return active_txns_; }
+
+  inline auto GetDirtyPages() -> std::vector<DirtyPageEntry> & { return dirty_pages_; }
+
   inline auto GetSize() -> int32_t { return size_; }
 
   inline auto GetLSN() -> lsn_t { return lsn_; }
@@ -138,6 +234,50 @@ class LogRecord {
 
   inline auto GetLogRecordType() -> LogRecordType & { return log_record_type_; }
 
+  /**
+   * Turn the record into a compensation record.
+   * @param undo_next_lsn the next record of the transaction to undo, INVALID_LSN if there is none
+   */
+  void SetUndoNextLSN(lsn_t undo_next_lsn) {
+    compensation_ = true;
+    undo_next_lsn_ = undo_next_lsn;
+    ComputeSize();
+  }
+
+  /** @return `true` for a compensation record */
+  inline auto IsCompensation() -> bool { return compensation_; }
+
+  inline auto GetUndoNextLSN() -> lsn_t { return undo_next_lsn_; }
+
+  /**
+   * Rebuild one image of an updated tuple from the other with the delta of this UPDATE record.
+   * @param tuple the tuple as it is before the change: the old tuple to redo, the new tuple to undo
+   * @param undo `true` to rebuild the old tuple from the new one
+   * @return the other image
+   */
+  auto ApplyUpdate(const Tuple &tuple, bool undo) const -> Tuple;
+
+  /** Serialize the record into `size_` bytes at `data`. */
+  void SerializeTo(char *data) const;
+
+  /**
+   * Deserialize a record, checking its CRC.
+   * @param data the serialized record
+   * @param size the number of bytes available at `data`
+   * @return `false` if the bytes do not hold a complete, intact record; an INSERTPAGE record points into `data`
+   */
+  auto DeserializeFrom(const char *data, int size) -> bool;
+
+  /**
+   * @param data the start of a serialized record
+   * @param size the number of bytes available at `data`, at least MAX_HEADER_SIZE to always succeed
+   * @return the size of the record, or 0 if it cannot be read
+   */
+  static auto PeekSize(const char *data, int size) -> int32_t;
+
+  /** The largest header: a 5-byte size, the CRC, the type, the LSN and three 5-byte ids */
+  static constexpr int MAX_HEADER_SIZE = 29;
+
   // For debug purpose
   inline auto ToString() const -> std::string {
     std::ostringstream os;
@@ -159,6 +299,9 @@ class LogRecord {
   txn_id_t txn_id_{INVALID_TXN_ID};
   lsn_t prev_lsn_{INVALID_LSN};
   LogRecordType log_record_type_{LogRecordType::INVALID};
+  // for a compensation record, the next record of the transaction to undo
+  bool compensation_{false};
+  lsn_t undo_next_lsn_{INVALID_LSN};
 
   // case1: for delete operation, delete_tuple_ for UNDO operation
   RID delete_rid_;
@@ -168,15 +311,36 @@ class LogRecord {
   RID insert_rid_;
   Tuple insert_tuple_;
 
-  // case3: for update operation
+  // case3: for update operation, the tuples are not logged, only update_delta_ encoded from them
   RID update_rid_;
   Tuple old_tuple_;
   Tuple new_tuple_;
+  std::string update_delta_;
 
   // case4: for new page operation
   page_id_t prev_page_id_{INVALID_PAGE_ID};
   page_id_t page_id_{INVALID_PAGE_ID};
-  static const int HEADER_SIZE = 20;
+
+  // case5: for insert page operation, the page is page_id_ and the previous page prev_page_id_
+  uint32_t tuple_count_{0};
+  const char *page_image_{nullptr};
+
+  // case6: for checkpoint
+  int begin_offset_{0};
+  std::vector<ActiveTxnEntry> active_txns_;
+  std::vector<DirtyPageEntry> dirty_pages_;
+
+  class Encoder;
+  class Decoder;
+
+  /** Set `size_` to the length of the serialized record */
+  void ComputeSize();
+
+  /** Encode the fields after the LSN */
+  void EncodeBody(Encoder *encoder) const;
+
+  /** @return the delta of an update, in the format of the record body */
+  static auto EncodeUpdateDelta(const Tuple &old_tuple, const Tuple &new_tuple) -> std::string;
 };  // namespace bustub
 
 }  // namespace bustub
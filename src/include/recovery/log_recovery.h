@@ -13,22 +13,48 @@
 #pragma once
 
 #include <algorithm>
+#include <condition_variable>  // NOLINT
+#include <deque>
 #include <mutex>  // NOLINT
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/lock_manager.h"
+#include "recovery/log_manager.h"
 #include "recovery/log_record.h"
 
 namespace bustub {
 
 /**
  * Read log file from disk, redo and undo.
+ *
+ * Redo reads the log sequentially in blocks of LOG_BUFFER_SIZE bytes. The reading thread runs the analysis (the
+ * active transactions and the file offset of every LSN) and hands every record that changes a page to a redo
+ * worker chosen by the page id, so the records of one page are applied by one worker in log order, which is LSN
+ * order for a page, while different pages are redone in parallel. A record is skipped when the page LSN shows the
+ * page already holds it.
+ *
+ * Undo rolls back the losers, newest change first, and logs every change it makes as a compensation record that
+ * points past the undone record, then an ABORT record for each loser. A crash during undo thus never undoes a change
+ * twice: redo repeats the compensations, and the next undo resumes where they stop.
  */
 class LogRecovery {
  public:
-  LogRecovery(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager)
-      : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager), offset_(0) {
+  /**
+   * @param disk_manager the disk manager of the database and its log
+   * @param buffer_pool_manager the buffer pool the pages are recovered in
+   * @param log_manager the log manager undo logs its compensation records with
+   * @param redo_threads the number of redo workers, or 0 for one per core, bounded by half the buffer pool
+   */
+  LogRecovery(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, LogManager *log_manager,
+              size_t redo_threads = 0)
+      : disk_manager_(disk_manager),
+        buffer_pool_manager_(buffer_pool_manager),
+        log_manager_(log_manager),
+        redo_threads_(redo_threads),
+        offset_(0) {
     log_buffer_ = new char[LOG_BUFFER_SIZE];
   }
 
@@ -39,18 +65,66 @@ class LogRecovery {
 
   void Redo();
   void Undo();
-  auto DeserializeLogRecord(const char *data, LogRecord *log_record) -> bool;
+
+  /**
+   * Deserialize a log record.
+   * @param data the serialized record
+   * @param size the number of bytes available at `data`
+   * @param[out] log_record the record; an INSERTPAGE record points into `data` for its page image
+   * @return `false` if the bytes do not hold a complete record
+   */
+  auto DeserializeLogRecord(const char *data, int size, LogRecord *log_record) -> bool;
 
  private:
-  DiskManager *disk_manager_ __attribute__((__unused__));
-  BufferPoolManager *buffer_pool_manager_ __attribute__((__unused__));
+  /** A change to redo on one page */
+  struct RedoItem {
+    /** `true` to redo only the link from the previous page to a page created by the record */
+    bool link_;
+    /** The serialized record */
+    std::string record_;
+  };
+
+  /** The records waiting for one redo worker */
+  struct RedoQueue {
+    std::mutex latch_;
+    std::condition_variable cv_;
+    std::deque<RedoItem> items_;
+    /** `true` once the whole log has been read */
+    bool done_{false};
+  };
+
+  /** Read the complete record at a log file offset found by the analysis */
+  void ReadLogRecord(int offset, LogRecord *log_record);
+
+  /** Apply the records of a queue until the log has been read and the queue drained */
+  void RunRedoWorker(RedoQueue *queue);
+
+  /** Redo one record on its page, unless the page LSN shows it is already there */
+  void RedoRecord(LogRecord *log_record, bool link);
+
+  /** Roll back one record of a transaction that did not finish, logging a compensation record for it */
+  void UndoRecord(LogRecord *log_record);
+
+  /**
+   * Append the compensation record of an undone record to the log.
+   * @param clr the change made by the undo
+   * @param undone the undone record
+   * @return the LSN of the compensation record
+   */
+  auto AppendCompensation(LogRecord *clr, LogRecord *undone) -> lsn_t;
+
+  DiskManager *disk_manager_;
+  BufferPoolManager *buffer_pool_manager_;
+  LogManager *log_manager_;
+  size_t redo_threads_;
 
-  /** Maintain active transactions and its corresponding latest lsn. */
+  /** Maintain active transactions and its corresponding latest lsn, which undo moves to its compensation records. */
   std::unordered_map<txn_id_t, lsn_t> active_txn_;
   /** Mapping the log sequence number to log file offset for undos. */
   std::unordered_map<lsn_t, int> lsn_mapping_;
 
-  int offset_ __attribute__((__unused__));
+  /** The offset in the log file of the next block to read */
+  int offset_;
   char *log_buffer_;
 };
 
@@ -16,23 +16,39 @@
 #include <fstream>
 #include <future>  // NOLINT
 #include <mutex>   // NOLINT
+#include <set>
 #include <string>
 
 #include "common/config.h"
+#include "storage/disk/log_segment_manager.h"
 
 namespace bustub {
 
 /**
  * DiskManager takes care of the allocation and deallocation of pages within a database. It performs the reading and
  * writing of pages to and from disk, providing a logical file layer within the context of a database management system.
+ *
+ * Page ids are handed out lowest first: a deallocated page is reused before the file grows. A page is free on disk
+ * while it holds a free-page marker: deallocating a page writes one, and so does allocating a page past the end of
+ * the file, for the new page and the ids skipped for other buffer pool instances, so a page that is allocated but
+ * never written, e.g. a spill page when the database stops, stays free. Writing the page removes the marker.
+ *
+ * The free pages are kept in memory and in a free page map next to the database file: a bitmap saved every
+ * FREE_PAGE_MAP_SAVE_INTERVAL pages the file grows by and on shutdown, and updated in place when a page is
+ * deallocated. Opening a database loads the map and only scans the pages past the end it records for markers, so it
+ * does not read the whole file. Pages written since the map was saved may still be listed as free, so a listed page
+ * is only reused, or truncated away at the end of the file, if its marker is still there.
+ *
+ * The log is kept in fixed-size segment files next to the database file, see LogSegmentManager.
  */
 class DiskManager {
  public:
   /**
    * Creates a new disk manager that writes to the specified database file.
    * @param db_file the file name of the database file to write to
+   * @param log_segment_size the size of a log segment file in bytes
    */
-  explicit DiskManager(const std::string &db_file);
+  explicit DiskManager(const std::string &db_file, int log_segment_size = LOG_SEGMENT_SIZE);
 
   ~DiskManager() = default;
 
@@ -55,6 +71,27 @@ class DiskManager {
    */
   void ReadPage(page_id_t page_id, char *page_data);
 
+  /**
+   * Allocate a page id. The lowest free page id that belongs to the instance is reused, otherwise the file is
+   * extended; ids of other instances skipped over become free pages for them.
+   * @param num_instances the number of buffer pool instances, whose page ids are striped over the file
+   * @param instance_index the index of the allocating instance, which gets page ids equal to it modulo num_instances
+   * @return the id of the allocated page
+   */
+  auto AllocatePage(uint32_t num_instances = 1, uint32_t instance_index = 0) -> page_id_t;
+
+  /**
+   * Deallocate a page, making its id available to AllocatePage(). The page must no longer be buffered.
+   * @param page_id id of the page
+   */
+  void DeallocatePage(page_id_t page_id);
+
+  /** @return the number of free pages below the end of the allocated pages */
+  auto GetFreePageCount() -> size_t;
+
+  /** @return the number of pages the database spans, free pages included */
+  auto GetPageCount() -> page_id_t;
+
   /**
    * Flush the entire log buffer into disk.
    * @param log_data raw log data
@@ -66,11 +103,47 @@ class DiskManager {
    * Read a log entry from the log file.
    * @param[out] log_data output buffer
    * @param size size of the log entry
-   * @param offset offset of the log entry in the file
+   * @param offset offset of the log entry in the log
    * @return true if the read was successful, false otherwise
    */
   auto ReadLog(char *log_data, int size, int offset) -> bool;
 
+  /** @return the log offset the next log write goes to */
+  auto GetLogEndOffset() -> int;
+
+  /** @return the offset of the log segment that follows the one holding the given offset */
+  auto GetNextLogSegmentOffset(int offset) const -> int;
+
+  /**
+   * Recycle or archive the log segments that only hold records before the given offset.
+   * @param offset the oldest log offset recovery still needs
+   */
+  void TruncateLog(int offset);
+
+  /**
+   * Archive truncated log segments into a directory instead of recycling them.
+   * @param directory the archive directory, created if missing; empty to recycle segments again
+   */
+  void SetLogArchiveDirectory(const std::string &directory);
+
+  /** @return the number of log segment files, including recycled ones waiting for reuse */
+  auto GetLogSegmentFileCount() -> size_t;
+
+  /**
+   * Remove the log, the master record and the free page map that belong to a database file.
+   * @param db_file the file name of the database file
+   */
+  static void RemoveLogFiles(const std::string &db_file);
+
+  /**
+   * Durably record where the last checkpoint record starts in the log, replacing the previous master record.
+   * @param offset the log file offset of the checkpoint record
+   */
+  void WriteMasterRecord(int offset);
+
+  /** @return the log file offset of the last checkpoint record, or -1 if there is none */
+  auto ReadMasterRecord() -> int;
+
   /** @return the number of disk flushes */
   auto GetNumFlushes() const -> int;
 
@@ -91,9 +164,32 @@ class DiskManager {
 
  private:
   auto GetFileSize(const std::string &file_name) -> int;
-  // stream to write log file
-  std::fstream log_io_;
+  /** Rebuild the free pages from the free page map and the markers of the pages past its end */
+  void LoadFreePages();
+  /**
+   * Read the free page map into `free_pages_`.
+   * @return false if there is no valid map
+   */
+  auto ReadFreePageMap() -> bool;
+  /** Save the free pages, and the allocated pages that still hold their marker, as the free page map */
+  void SaveFreePageMap();
+  /** Add a page to the saved free page map, and shrink the map to the end of the file */
+  void UpdateFreePageMap(page_id_t page_id);
+  /** Write free-page markers into the pages from `first` to `last` */
+  void WriteFreePageMarkers(page_id_t first, page_id_t last);
+  /** @return true if the page holds a free-page marker */
+  auto IsMarkedFree(page_id_t page_id) -> bool;
+  /** Drop the free pages at the end of the allocated pages and truncate the file after the last page in use */
+  void TrimFreePages();
+  /** @return the name of a database file without its extension */
+  static auto BaseName(const std::string &db_file) -> std::string;
   std::string log_name_;
+  // segment files of the log
+  LogSegmentManager log_segments_;
+  // file holding the master record, which points to the last checkpoint
+  std::string master_name_;
+  // file holding the free page map
+  std::string free_map_name_;
   // stream to write db file
   std::fstream db_io_;
   std::string file_name_;
@@ -103,6 +199,14 @@ class DiskManager {
   std::future<void> *flush_log_f_;
   // With multiple buffer pool instances, need to protect file access
   std::mutex db_io_latch_;
+  /** The deallocated page ids below `end_page_id_`, protected by `db_io_latch_` */
+  std::set<page_id_t> free_pages_;
+  /** One past the highest allocated page id, protected by `db_io_latch_` */
+  page_id_t end_page_id_{0};
+  /** The allocated page ids that still hold their free-page marker, protected by `db_io_latch_` */
+  std::set<page_id_t> unwritten_pages_;
+  /** `end_page_id_` when the free page map was last saved, protected by `db_io_latch_` */
+  page_id_t saved_end_page_id_{0};
 };
 
 }  // namespace bustub
@@ -0,0 +1,116 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// log_segment_manager.h
+//
+// Identification: src/include/storage/disk/log_segment_manager.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <map>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * LogSegmentManager stores the write-ahead log as a sequence of fixed-size segment files `<log name>.<index>`.
+ *
+ * Log offsets are logical: segment i holds the offsets [i * capacity, (i + 1) * capacity), where the capacity is the
+ * segment size less a small header that names the segment. A segment file is preallocated to its full size, and
+ * synced with its directory entry, when the log first moves into it, so appends never grow a file and only their
+ * data has to be synced. Truncate() retires the segments wholly before an offset,
+ * such as the redo point of the last checkpoint: they are moved into the archive directory if one is set, and
+ * otherwise zeroed and kept as spares that become the next segments, so the log stays bounded.
+ *
+ * Opening an existing log continues in the segment after the last one written, since the end of the records within
+ * a preallocated segment is not known below the log manager. Recovery skips the zeroed tail of that segment.
+ */
+class LogSegmentManager {
+ public:
+  /**
+   * Open the segments of a log, if any.
+   * @param log_name the name the segment files are derived from
+   * @param segment_size the size of a segment file in bytes
+   */
+  LogSegmentManager(std::string log_name, int segment_size);
+
+  ~LogSegmentManager();
+
+  /** Close all the segment files. */
+  void Close();
+
+  /**
+   * Append to the end of the log, crossing into new segments as needed, and sync the segments written to.
+   * @param data the bytes to append
+   * @param size the number of bytes
+   * @return false on an I/O error; otherwise the bytes are durable
+   */
+  auto Append(const char *data, int size) -> bool;
+
+  /**
+   * Read from the log; the bytes past the end of the log are zeroed.
+   * @param[out] data output buffer
+   * @param size the number of bytes
+   * @param offset the log offset to read from
+   * @return false if the offset is not in a live segment
+   */
+  auto Read(char *data, int size, int offset) -> bool;
+
+  /** @return the offset the next append is written at */
+  auto GetEndOffset() -> int;
+
+  /** @return the offset of the first segment boundary after the given offset */
+  auto GetNextSegmentOffset(int offset) const -> int { return (offset / capacity_ + 1) * capacity_; }
+
+  /**
+   * Retire every segment that ends at or before the offset, except the one being written.
+   * @param offset the oldest log offset still needed
+   */
+  void Truncate(int offset);
+
+  /**
+   * Move retired segments into a directory instead of recycling them.
+   * @param directory the archive directory, created if missing; empty to recycle
+   */
+  void SetArchiveDirectory(const std::string &directory);
+
+  /** @return the number of segment files, live or spare */
+  auto GetSegmentFileCount() -> size_t;
+
+  /** Remove every segment file of a log. */
+  static void RemoveSegments(const std::string &log_name);
+
+ private:
+  /** @return the file name of the segment with the given index */
+  auto SegmentName(int index) const -> std::string;
+
+  /** Open the segment with the given index for writing, taking a spare or creating the file. Called with latch_. */
+  auto OpenSegment(int index) -> int;
+
+  const std::string log_name_;
+  /** The size of a segment file */
+  const int segment_size_;
+  /** The log bytes a segment holds after its header */
+  const int capacity_;
+
+  std::mutex latch_;
+  /** The file descriptors of the live segments, by index */
+  std::map<int, int> segments_;
+  /** The zeroed files of retired segments, waiting to become new segments */
+  std::vector<std::string> spares_;
+  /** Where retired segments are moved, empty to recycle them */
+  std::string archive_directory_;
+  /** The offset of the next append */
+  int end_offset_{0};
+};
+
+}  // namespace bustub
@@ -86,6 +86,8 @@ class Page {
   int pin_count_ = 0;
   /** True if the page is dirty, i.e. it is different from its corresponding page on disk. */
   bool is_dirty_ = false;
+  /** The log file offset at or before the first change that may not be on disk, see GetDirtyPageTable(). */
+  int rec_offset_ = 0;
   /** Page latch. */
   ReaderWriterLatch rwlatch_;
 };
@@ -13,6 +13,7 @@
 #pragma once
 
 #include <cstring>
+#include <vector>
 
 #include "common/rid.h"
 #include "concurrency/lock_manager.h"
@@ -79,18 +80,44 @@ class TablePage : public Page {
    * @param txn transaction performing the insert
    * @param lock_manager the lock manager
    * @param log_manager the log manager
-   * @return true if the insert is successful (i.e. there is enough space)
+   * @return true if the insert is successful (i.e. there is enough space and the new tuple could be locked without
+   * waiting); if the lock is not granted right away, `*rid` is the slot to wait for, otherwise it is invalid
    */
   auto InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, LockManager *lock_manager, LogManager *log_manager)
       -> bool;
 
+  /**
+   * Lay out an empty table page without logging it. For pages that are logged whole once filled, see LogPageImage().
+   * @param page_id the page ID of this table page
+   * @param page_size the size of this table page
+   * @param prev_page_id the previous table page ID
+   */
+  void Format(page_id_t page_id, uint32_t page_size, page_id_t prev_page_id);
+
+  /**
+   * Append tuples to a page no other thread can reach yet, without logging or locking them one by one.
+   * @param tuples the tuples
+   * @param begin the position in `tuples` of the first tuple to append
+   * @return the position in `tuples` of the first tuple that did not fit
+   */
+  auto AppendTuples(const std::vector<Tuple> &tuples, size_t begin) -> size_t;
+
+  /**
+   * Write the whole page to the log as one INSERTPAGE record, which stands for creating the page and every tuple
+   * in it. Only done when logging is enabled.
+   * @param txn transaction that filled the page
+   * @param log_manager the log manager
+   */
+  void LogPageImage(Transaction *txn, LogManager *log_manager);
+
   /**
    * Mark a tuple as deleted. This does not actually delete the tuple.
    * @param rid rid of the tuple to mark as deleted
    * @param txn transaction performing the delete
    * @param lock_manager the lock manager
    * @param log_manager the log manager
-   * @return true if marking the tuple as deleted is successful (i.e the tuple exists)
+   * @return true if marking the tuple as deleted is successful (i.e the tuple exists and the transaction could lock
+   * it without waiting)
    */
   auto MarkDelete(const RID &rid, Transaction *txn, LockManager *lock_manager, LogManager *log_manager) -> bool;
 
@@ -102,7 +129,7 @@ class TablePage : public Page {
    * @param txn transaction performing the update
    * @param lock_manager the lock manager
    * @param log_manager the log manager
-   * @return true if updating the tuple succeeded
+   * @return true if updating the tuple succeeded; it fails if the transaction cannot lock the tuple without waiting
    */
   auto UpdateTuple(const Tuple &new_tuple, Tuple *old_tuple, const RID &rid, Transaction *txn,
                    LockManager *lock_manager, LogManager *log_manager) -> bool;
@@ -123,6 +150,33 @@ class TablePage : public Page {
    */
   auto GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockManager *lock_manager) -> bool;
 
+  /**
+   * Point a tuple at the data of a tuple in this page, without copying it. The tuple is a shallow view
+   * that is only valid while the page stays pinned and latched; copying it with Tuple's copy constructor
+   * yields another view.
+   * @param rid rid of the tuple to read
+   * @param[out] tuple the view of the tuple
+   * @param txn transaction performing the read
+   * @param lock_manager the lock manager
+   * @return true if the read is successful (i.e. the tuple exists and the transaction could lock it without
+   * waiting); a missing tuple aborts the transaction, a lock that is not granted right away does not
+   */
+  auto GetTupleView(const RID &rid, Tuple *tuple, Transaction *txn, LockManager *lock_manager) -> bool;
+
+  /**
+   * Point a tuple at the data stored in a slot without taking a lock, even if the tuple is marked deleted, for a
+   * reader that picks the version it sees itself (see VersionStore). The view is only valid while the page stays
+   * pinned and latched.
+   * @param rid rid of the tuple to read
+   * @param[out] tuple the view of the tuple
+   * @param[out] marked_deleted whether the tuple is marked deleted
+   * @return true if the slot holds a tuple
+   */
+  auto GetStoredTupleView(const RID &rid, Tuple *tuple, bool *marked_deleted) -> bool;
+
+  /** @return the number of slots in this page, some of which may be empty */
+  auto GetSlotCount() -> uint32_t { return GetTupleCount(); }
+
   /** @return the rid of the first tuple in this page */
 
   /**
@@ -138,6 +192,36 @@ class TablePage : public Page {
    */
   auto GetNextTupleRid(const RID &cur_rid, RID *next_rid) -> bool;
 
+  /** @return true if a tuple of this page is marked deleted, i.e. its delete is not committed yet */
+  auto HasMarkedTuples() -> bool {
+    for (uint32_t i = 0; i < GetTupleCount(); i++) {
+      if (GetTupleSize(i) & DELETE_MASK) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /** @return the bytes the tuples of this page, and their slots, would take in an empty page */
+  auto GetLiveBytes() -> uint32_t {
+    uint32_t bytes = 0;
+    for (uint32_t i = 0; i < GetTupleCount(); i++) {
+      auto tuple_size = GetTupleSize(i);
+      if (tuple_size != 0) {
+        bytes += (tuple_size & ~DELETE_MASK) + SIZE_TUPLE;
+      }
+    }
+    return bytes;
+  }
+
+  /** @return the bytes between the slot array and the tuple data */
+  auto GetFreeSpaceRemaining() -> uint32_t {
+    return GetFreeSpacePointer() - SIZE_TABLE_PAGE_HEADER - SIZE_TUPLE * GetTupleCount();
+  }
+
+  /** @return the free space InsertTuple() needs for a tuple of `tuple_size` bytes */
+  static constexpr auto GetInsertSize(uint32_t tuple_size) -> uint32_t { return tuple_size + SIZE_TUPLE; }
+
  private:
   static_assert(sizeof(page_id_t) == 4);
 
@@ -167,10 +251,6 @@ class TablePage : public Page {
   /** Set the number of tuples in this page. */
   void SetTupleCount(uint32_t tuple_count) { memcpy(GetData() + OFFSET_TUPLE_COUNT, &tuple_count, sizeof(uint32_t)); }
 
-  auto GetFreeSpaceRemaining() -> uint32_t {
-    return GetFreeSpacePointer() - SIZE_TABLE_PAGE_HEADER - SIZE_TUPLE * GetTupleCount();
-  }
-
   /** @return tuple offset at slot slot_num */
   auto GetTupleOffsetAtSlot(uint32_t slot_num) -> uint32_t {
     return *reinterpret_cast<uint32_t *>(GetData() + OFFSET_TUPLE_OFFSET + SIZE_TUPLE * slot_num);
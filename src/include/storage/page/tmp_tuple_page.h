@@ -1,5 +1,6 @@
 #pragma once
 
+#include "common/macros.h"
 #include "storage/page/page.h"
 #include "storage/table/tmp_tuple.h"
 #include "storage/table/tuple.h"
@@ -22,15 +23,70 @@ class TmpTuplePage : public Page {
  public:
   void Init(page_id_t page_id, uint32_t page_size) {
     memcpy(GetData(), &page_id, sizeof(page_id_t));
-    memcpy(GetData() + sizeof(page_id_t), &page_size, sizeof(uint32_t));
+    SetFreeSpacePointer(page_size);
   }
 
-  auto GetTablePageId() -> page_id_t { return INVALID_PAGE_ID; }
+  auto GetTablePageId() -> page_id_t { return *reinterpret_cast<page_id_t *>(GetData()); }
 
-  auto Insert(const Tuple &tuple, TmpTuple *out) -> bool { return false; }
+  /**
+   * Insert a tuple into the page.
+   * @param tuple The tuple to insert
+   * @param[out] out The location of the inserted tuple
+   * @return `true` if the insert succeeded, `false` if the page does not have enough free space
+   */
+  auto Insert(const Tuple &tuple, TmpTuple *out) -> bool {
+    BUSTUB_ASSERT(tuple.GetLength() > 0, "Cannot have empty tuples.");
+    uint32_t needed = tuple.GetLength() + sizeof(uint32_t);
+    if (GetFreeSpaceRemaining() < needed) {
+      return false;
+    }
+    uint32_t offset = GetFreeSpacePointer() - needed;
+    tuple.SerializeTo(GetData() + offset);
+    SetFreeSpacePointer(offset);
+    *out = TmpTuple(GetTablePageId(), offset);
+    return true;
+  }
+
+  /**
+   * Read the tuple stored at the given offset.
+   * @param offset The offset of the tuple, as returned by Insert()
+   * @param[out] tuple The tuple to deserialize into
+   * @return The offset of the tuple stored right after it; PAGE_SIZE once the page is exhausted
+   */
+  auto Get(uint32_t offset, Tuple *tuple) -> uint32_t {
+    tuple->DeserializeFrom(GetData() + offset);
+    return offset + sizeof(uint32_t) + tuple->GetLength();
+  }
+
+  /**
+   * @param offset The offset of a tuple
+   * @return The offset of the tuple stored right after it, without reading the tuple; PAGE_SIZE at the end
+   */
+  auto NextOffset(uint32_t offset) -> uint32_t {
+    uint32_t size;
+    memcpy(&size, GetData() + offset, sizeof(uint32_t));
+    return offset + sizeof(uint32_t) + size;
+  }
+
+  /** @return The offset of the most recently inserted tuple; tuples run from here to the end of the page */
+  auto GetFreeSpacePointer() -> uint32_t { return *reinterpret_cast<uint32_t *>(GetData() + OFFSET_FREE_SPACE); }
+
+  /** @return The number of bytes still available for tuples and their sizes */
+  auto GetFreeSpaceRemaining() -> uint32_t { return GetFreeSpacePointer() - SIZE_TMP_PAGE_HEADER; }
+
+  /** The size of the page header */
+  static constexpr uint32_t SIZE_TMP_PAGE_HEADER = 12;
+  /** The largest tuple that fits on an empty page */
+  static constexpr uint32_t MAX_TUPLE_SIZE = PAGE_SIZE - SIZE_TMP_PAGE_HEADER - sizeof(uint32_t);
 
  private:
+  void SetFreeSpacePointer(uint32_t free_space_pointer) {
+    memcpy(GetData() + OFFSET_FREE_SPACE, &free_space_pointer, sizeof(uint32_t));
+  }
+
   static_assert(sizeof(page_id_t) == 4);
+
+  static constexpr size_t OFFSET_FREE_SPACE = 8;
 };
 
 }  // namespace bustub
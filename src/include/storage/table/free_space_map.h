@@ -0,0 +1,90 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// free_space_map.h
+//
+// Identification: src/include/storage/table/free_space_map.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <unordered_map>
+#include <vector>
+
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * FreeSpaceMap tracks roughly how many bytes are free in every page of a table heap, so an insert can go
+ * straight to a page with room instead of trying the pages of the heap in order.
+ *
+ * Free space is kept as one byte per page, in units of CATEGORY_BYTES rounded down, so a page is only
+ * offered for a tuple it is sure to fit as of the last update. The bytes are the leaves of a tree whose
+ * inner nodes hold the maximum of their children, which finds a page with room in logarithmic time.
+ *
+ * Every thread has an insertion target: the page its last insert went to. A thread keeps inserting into its
+ * target while it has room and then searches onward from it, so concurrent inserters spread over different
+ * pages rather than all latching the first page with room.
+ */
+class FreeSpaceMap {
+ public:
+  /** The bytes per unit of free space */
+  static constexpr uint32_t CATEGORY_BYTES = PAGE_SIZE / 256;
+
+  /**
+   * Add a page at the end of the map and make it the insertion target of the calling thread.
+   * @param page_id the id of the page
+   * @param free_bytes the bytes free in the page
+   */
+  void AddPage(page_id_t page_id, uint32_t free_bytes);
+
+  /**
+   * Record the free space of a page; pages that are not in the map are ignored.
+   * @param page_id the id of the page
+   * @param free_bytes the bytes free in the page
+   */
+  void Update(page_id_t page_id, uint32_t free_bytes);
+
+  /**
+   * Remove a page from the map; its position is left empty.
+   * @param page_id the id of the page
+   */
+  void RemovePage(page_id_t page_id);
+
+  /**
+   * Find a page for the calling thread to insert into, and make it the thread's insertion target.
+   * @param size the bytes the insert takes
+   * @return the id of a page with at least `size` bytes free, or INVALID_PAGE_ID if there is none
+   */
+  auto FindPage(uint32_t size) -> page_id_t;
+
+ private:
+  /** Set the category of the page at `pos` and update its ancestors */
+  void SetCategory(size_t pos, uint8_t category);
+
+  /** @return the first position in [lo, hi) under `node` at or after `start` with at least `category`, or -1 */
+  auto FindFrom(size_t node, size_t lo, size_t hi, size_t start, uint8_t category) const -> int64_t;
+
+  /** Protects everything below */
+  std::mutex latch_;
+  /** The ids of the pages, by position */
+  std::vector<page_id_t> page_ids_;
+  /** The position of every page */
+  std::unordered_map<page_id_t, size_t> positions_;
+  /** The tree: node i has children 2i and 2i+1, and the leaves start at `capacity_` */
+  std::vector<uint8_t> tree_;
+  /** The number of leaves, a power of two */
+  size_t capacity_{0};
+  /** The position of the insertion target of every thread */
+  std::unordered_map<std::thread::id, size_t> targets_;
+};
+
+}  // namespace bustub
@@ -12,17 +12,27 @@
 
 #pragma once
 
+#include <functional>
+#include <mutex>  // NOLINT
+#include <optional>
+#include <vector>
+
 #include "buffer/buffer_pool_manager.h"
 #include "recovery/log_manager.h"
 #include "storage/page/table_page.h"
+#include "storage/table/free_space_map.h"
 #include "storage/table/table_iterator.h"
 #include "storage/table/tuple.h"
+#include "storage/table/version_store.h"
 
 namespace bustub {
 
 /**
  * TableHeap represents a physical table on disk.
  * This is just a doubly-linked list of pages.
+ *
+ * With `enable_mvcc`, every write also records the tuple as it was before in the version store of the heap, and
+ * SNAPSHOT_ISOLATION transactions read the versions their snapshot sees without locks (see VersionStore).
  */
 class TableHeap {
   friend class TableIterator;
@@ -59,6 +69,17 @@ class TableHeap {
    */
   auto InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) -> bool;
 
+  /**
+   * Append many tuples at once. The tuples fill fresh pages directly, without searching for free space, and every
+   * page is linked at the end of the table, logged as one INSERTPAGE record and recorded as one INSERT_PAGE entry
+   * of the write set. The last page is usually left partly empty for later inserts.
+   * @param tuples the tuples to insert, none larger than a page
+   * @param[out] rids the rids of the inserted tuples, in order
+   * @param txn the transaction performing the insert
+   * @return true iff every tuple was inserted
+   */
+  auto BulkAppend(const std::vector<Tuple> &tuples, std::vector<RID> *rids, Transaction *txn) -> bool;
+
   /**
    * Mark the tuple as deleted. The actual delete will occur when ApplyDelete is called.
    * @param rid resource id of the tuple of delete
@@ -91,7 +112,24 @@ class TableHeap {
   void RollbackDelete(const RID &rid, Transaction *txn);
 
   /**
-   * Read a tuple from the table.
+   * Called on abort to rollback the tuples a bulk append put in a page.
+   * @param rid the page, with the number of appended tuples as the slot number
+   * @param txn transaction performing the rollback
+   */
+  void RollbackAppend(const RID &rid, Transaction *txn);
+
+  /**
+   * Stamp the versions a write of a committing transaction recorded with its commit timestamp.
+   * @param rid the rid of the write record
+   * @param wtype the type of the write record
+   * @param txn the committing transaction
+   * @param watermark the timestamp of the oldest running snapshot, or the commit timestamp if there is none
+   */
+  void CommitVersion(const RID &rid, WType wtype, Transaction *txn, timestamp_t watermark);
+
+  /**
+   * Read a tuple from the table. A SNAPSHOT_ISOLATION transaction reads the version its snapshot sees, and is not
+   * aborted if it sees none.
    * @param rid rid of the tuple to read
    * @param tuple output variable for the tuple
    * @param txn transaction performing the read
@@ -99,6 +137,24 @@ class TableHeap {
    */
   auto GetTuple(const RID &rid, Tuple *tuple, Transaction *txn) -> bool;
 
+  /** @return the number of tuples with old versions kept for snapshots */
+  auto GetVersionChainCount() -> size_t { return versions_.GetChainCount(); }
+
+  /**
+   * Reclaim the space of deleted tuples. Tuples are moved out of sparse pages at the end of the table into free
+   * space at the front, and pages left empty are unlinked from the chain and deleted. A page with a delete that
+   * is not committed yet is left alone.
+   *
+   * Moving a tuple changes its rid, and an unlinked page may be reused, so no other transaction may use the table
+   * while it is vacuumed, e.g. vacuum in a TransactionManager::BeginExclusive() transaction as
+   * Catalog::VacuumTable() does. The moves are not in the write set, so that transaction must commit.
+   * @param txn the transaction performing the vacuum
+   * @param on_move called with every moved tuple, its old rid and its new rid, e.g. to update indexes
+   * @return the number of pages deleted
+   */
+  auto Vacuum(Transaction *txn, const std::function<void(const Tuple &, const RID &, const RID &)> &on_move)
+      -> size_t;
+
   /** @return the begin iterator of this table */
   auto Begin(Transaction *txn) -> TableIterator;
 
@@ -108,11 +164,160 @@ class TableHeap {
   /** @return the id of the first page of this table */
   inline auto GetFirstPageId() const -> page_id_t { return first_page_id_; }
 
+  /**
+   * @param page_id the id of a page of this table
+   * @return the id of the page that follows it, or INVALID_PAGE_ID if it is the last page
+   */
+  auto GetNextPageId(page_id_t page_id) -> page_id_t;
+
+  /**
+   * The page directory lists the pages of the heap, so that a scan can be split up front instead of
+   * walking the page chain. Pages added after the call are not included.
+   * @return the ids of the pages of this table, in chain order
+   */
+  auto GetPageIds() -> std::vector<page_id_t>;
+
+  /**
+   * Scan the tuples of one page in place. The page is pinned and read-latched once, and the visitor sees
+   * views of the tuples that point into the page (see TablePage::GetTupleView()), so nothing is copied
+   * unless the visitor copies it. The views are invalid once the visitor returns.
+   *
+   * No row lock is waited for while the page is latched, since the holder of the lock may need the latch to
+   * commit: if a tuple cannot be locked right away, the page is released, the lock waited for, and the page read
+   * again. A transaction that is aborted instead gets a TransactionAbortException.
+   * @param page_id the id of a page of this table
+   * @param txn transaction performing the read
+   * @param[out] views the views of the live tuples of the page; reused across calls to avoid allocating
+   * @param[out] next_page_id the id of the page that follows, or INVALID_PAGE_ID if it is the last page
+   * @param visit called with `*views` while the page is latched
+   * @return true if the page could be read
+   */
+  template <typename Visitor>
+  auto ScanPage(page_id_t page_id, Transaction *txn, std::vector<Tuple> *views, page_id_t *next_page_id,
+                Visitor &&visit) -> bool {
+    while (true) {
+      auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+      if (page == nullptr) {
+        if (txn != nullptr) {
+          txn->SetState(TransactionState::ABORTED);
+        }
+        return false;
+      }
+      page->RLatch();
+      views->clear();
+      // The tuple whose lock is to be waited for, if any
+      std::optional<RID> blocked;
+      try {
+        if (IsSnapshotRead(txn)) {
+          GetVisibleTupleViews(page, txn, views);
+        } else {
+          RID rid;
+          for (bool found = page->GetFirstTupleRid(&rid); found; found = page->GetNextTupleRid(rid, &rid)) {
+            views->emplace_back();
+            // Only live tuples are visited, so a view is refused for its lock alone
+            if (!page->GetTupleView(rid, &views->back(), txn, lock_manager_)) {
+              views->clear();
+              blocked = rid;
+              break;
+            }
+          }
+        }
+        if (!blocked) {
+          *next_page_id = page->GetNextPageId();
+          visit(static_cast<const std::vector<Tuple> &>(*views));
+        }
+      } catch (...) {
+        page->RUnlatch();
+        buffer_pool_manager_->UnpinPage(page_id, false);
+        throw;
+      }
+      page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(page_id, false);
+      if (!blocked) {
+        return true;
+      }
+      WaitForReadLock(*blocked, txn);
+    }
+  }
+
  private:
+  /** @return true if the transaction reads a snapshot rather than taking locks */
+  static auto IsSnapshotRead(Transaction *txn) -> bool {
+    return txn != nullptr && txn->GetIsolationLevel() == IsolationLevel::SNAPSHOT_ISOLATION;
+  }
+
+  /**
+   * Find the version of a tuple the snapshot of a transaction sees. Called with the page latched.
+   * @param[out] tuple the view of the version
+   * @return true if the snapshot sees the tuple
+   */
+  auto GetVisibleTupleView(TablePage *page, const RID &rid, Transaction *txn, Tuple *tuple) -> bool;
+
+  /** Collect the views of the tuples of a latched page the snapshot of a transaction sees, in slot order. */
+  void GetVisibleTupleViews(TablePage *page, Transaction *txn, std::vector<Tuple> *views);
+
+  /**
+   * Check that a write by a SNAPSHOT_ISOLATION transaction does not overwrite a write its snapshot does not see,
+   * aborting the transaction if it does. Called with the page write-latched.
+   * @return false if the transaction was aborted
+   */
+  auto CheckWriteConflict(const RID &rid, Transaction *txn) -> bool;
+
+  /**
+   * Take the shared lock a read of a tuple needs, before the page of the tuple is latched.
+   * @param[out] unlock whether the read is to give the lock back, as READ_COMMITTED reads do
+   * @return false if the transaction was aborted
+   */
+  auto LockForRead(const RID &rid, Transaction *txn, bool *unlock) -> bool;
+
+  /**
+   * Take the exclusive lock a write of a tuple needs, before the page of the tuple is latched.
+   * @return false if the transaction was aborted
+   */
+  auto LockForWrite(const RID &rid, Transaction *txn) -> bool;
+
+  /**
+   * Wait for the shared lock on a tuple a scan could not lock while it held the page latch. A READ_COMMITTED
+   * transaction gives the lock back right away; the scan locks the tuple again once it holds the latch.
+   * Throws TransactionAbortException if the transaction was aborted.
+   */
+  void WaitForReadLock(const RID &rid, Transaction *txn);
+
+  /** Read the page directory off the page chain, if this heap was opened rather than created */
+  void LoadPageDirectory();
+
+  /** Record a page just linked at the end of the chain */
+  void AppendToPageDirectory(page_id_t page_id);
+
+  /**
+   * Link a filled, write-latched page that no other thread can reach yet at the end of the chain.
+   * @return false if the last page could not be fetched
+   */
+  auto LinkAppendedPage(TablePage *page, Transaction *txn) -> bool;
+
+  /**
+   * Unlink an empty page from the chain and delete it.
+   * @return false if the page is the first page, or is not empty
+   */
+  auto UnlinkEmptyPage(page_id_t page_id) -> bool;
+
   BufferPoolManager *buffer_pool_manager_;
   LockManager *lock_manager_;
   LogManager *log_manager_;
   page_id_t first_page_id_{};
+  /**
+   * Protects the page directory. It is only held while waiting for page latches by the single walk of
+   * LoadPageDirectory(), which InsertTuple() forces before it latches any page.
+   */
+  std::mutex directory_latch_;
+  /** `true` once `page_ids_` lists every page of the chain */
+  bool directory_loaded_{false};
+  /** The ids of the pages of this table, in chain order */
+  std::vector<page_id_t> page_ids_;
+  /** The free space of every page in the directory, which picks the page for an insert */
+  FreeSpaceMap free_space_;
+  /** The old versions of the tuples, for snapshot reads */
+  VersionStore versions_;
 };
 
 }  // namespace bustub
@@ -13,7 +13,10 @@
 #pragma once
 
 #include <cassert>
+#include <memory>
+#include <vector>
 
+#include "common/config.h"
 #include "common/rid.h"
 #include "concurrency/transaction.h"
 #include "storage/table/tuple.h"
@@ -24,21 +27,25 @@ class TableHeap;
 
 /**
  * TableIterator enables the sequential scan of a TableHeap.
+ *
+ * The iterator reads the table a page at a time: entering a page pins and latches it once, copies the data of its
+ * visible tuples into a page image owned by the iterator, and releases the page. The tuples it yields are views into
+ * that image, so stepping through a page touches neither the buffer pool nor the heap allocator. A view stays valid
+ * while any iterator holding the same image lives; CopyTuple() returns a tuple that owns its data.
  */
 class TableIterator {
   friend class Cursor;
 
  public:
-  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn);
+  /**
+   * Create an iterator positioned on the first tuple at or after the start of a page.
+   * @param table_heap the table heap
+   * @param page_id the first page to read, or INVALID_PAGE_ID for the end iterator
+   * @param txn the transaction reading the tuples
+   */
+  TableIterator(TableHeap *table_heap, page_id_t page_id, Transaction *txn);
 
-  TableIterator(const TableIterator &other)
-      : table_heap_(other.table_heap_), tuple_(new Tuple(*other.tuple_)), txn_(other.txn_) {}
-
-  ~TableIterator() { delete tuple_; }
-
-  inline auto operator==(const TableIterator &itr) const -> bool {
-    return tuple_->rid_.Get() == itr.tuple_->rid_.Get();
-  }
+  inline auto operator==(const TableIterator &itr) const -> bool { return CurrentRid() == itr.CurrentRid(); }
 
   inline auto operator!=(const TableIterator &itr) const -> bool { return !(*this == itr); }
 
@@ -50,17 +57,34 @@ class TableIterator {
 
   auto operator++(int) -> TableIterator;
 
-  auto operator=(const TableIterator &other) -> TableIterator & {
-    table_heap_ = other.table_heap_;
-    *tuple_ = *other.tuple_;
-    txn_ = other.txn_;
-    return *this;
-  }
+  /** @return a copy of the current tuple that owns its data */
+  auto CopyTuple() const -> Tuple;
 
  private:
+  /** The tuples of one page, copied out while the page was latched */
+  struct PageImage {
+    /** The data of every tuple, back to back */
+    std::vector<char> data_;
+    /** Views into `data_`, in slot order */
+    std::vector<Tuple> tuples_;
+  };
+
+  /** @return the RID of the current tuple, or an invalid RID at the end */
+  inline auto CurrentRid() const -> int64_t {
+    return image_ == nullptr ? RID(INVALID_PAGE_ID, 0).Get() : image_->tuples_[idx_].rid_.Get();
+  }
+
+  /** Read pages from `next_page_id_` on until one has a visible tuple, or drop the image at the end of the table */
+  void LoadNextPage();
+
   TableHeap *table_heap_;
-  Tuple *tuple_;
   Transaction *txn_;
+  /** The image of the current page, shared with copies of this iterator; nullptr at the end */
+  std::shared_ptr<PageImage> image_;
+  /** The position of the current tuple in the image */
+  size_t idx_{0};
+  /** The page after the current one */
+  page_id_t next_page_id_;
 };
 
 }  // namespace bustub
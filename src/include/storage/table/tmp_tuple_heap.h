@@ -0,0 +1,95 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// tmp_tuple_heap.h
+//
+// Identification: src/include/storage/table/tmp_tuple_heap.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/macros.h"
+#include "storage/page/tmp_tuple_page.h"
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+/**
+ * TmpTupleHeap is an append-only run of TmpTuplePages that operators use to spill intermediate
+ * tuples through the buffer pool. It is not logged, not visible in the catalog and its pages are
+ * deleted when the heap is destroyed.
+ *
+ * A heap is written with Append(), sealed with Seal(), and then read back with Rewind()/Next().
+ * At most one page is pinned at any time, so an operator may keep many heaps open at once as long
+ * as the buffer pool has a free frame for each of them.
+ */
+class TmpTupleHeap {
+ public:
+  /**
+   * Create an empty heap.
+   * @param bpm the buffer pool manager that backs the heap
+   */
+  explicit TmpTupleHeap(BufferPoolManager *bpm) : bpm_{bpm} {}
+
+  /** Unpin and delete every page of the heap. */
+  ~TmpTupleHeap();
+
+  DISALLOW_COPY_AND_MOVE(TmpTupleHeap);
+
+  /**
+   * Append a tuple to the heap. Throws an OUT_OF_MEMORY exception if the buffer pool has no frame
+   * for a new page or if the tuple does not fit on a page.
+   * @param tuple the tuple to append
+   */
+  void Append(const Tuple &tuple);
+
+  /** Stop writing and unpin the page being written. Must be called before reading. */
+  void Seal();
+
+  /** Start reading from the first tuple of the heap. */
+  void Rewind();
+
+  /**
+   * Read the next tuple of the heap. Tuples come back in append order, so a heap written in sorted
+   * order can serve as a sorted run.
+   * @param[out] tuple the next tuple
+   * @return `true` if a tuple was read, `false` once the heap is exhausted
+   */
+  auto Next(Tuple *tuple) -> bool;
+
+  /** @return the number of tuples in the heap */
+  auto GetTupleCount() const -> size_t { return tuple_count_; }
+
+  /** @return the number of pages in the heap */
+  auto GetPageCount() const -> size_t { return page_ids_.size(); }
+
+  /** @return `true` if the heap holds no tuple */
+  auto IsEmpty() const -> bool { return tuple_count_ == 0; }
+
+ private:
+  /** Fetch the idx'th page of the heap, throwing OUT_OF_MEMORY if the buffer pool is full */
+  auto FetchTmpPage(size_t idx) -> TmpTuplePage *;
+
+  BufferPoolManager *bpm_;
+  /** The pages of the heap, in append order */
+  std::vector<page_id_t> page_ids_;
+  /** The pinned page currently being appended to, if any */
+  TmpTuplePage *write_page_{nullptr};
+  /** The pinned page currently being read, if any */
+  TmpTuplePage *read_page_{nullptr};
+  /** Index in `page_ids_` of the page being read */
+  size_t read_page_idx_{0};
+  /** Offsets of the tuples on `read_page_` not read yet, the next one last */
+  std::vector<uint32_t> read_offsets_;
+  /** The number of tuples in the heap */
+  size_t tuple_count_{0};
+};
+
+}  // namespace bustub
@@ -0,0 +1,118 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// version_store.h
+//
+// Identification: src/include/storage/table/version_store.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+#include "common/rid.h"
+#include "concurrency/transaction.h"
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+/**
+ * VersionStore keeps the old versions of the tuples of a table heap, so SNAPSHOT_ISOLATION transactions can read
+ * the table as of their start without locks.
+ *
+ * The table pages hold the newest version of every tuple. Every write to a tuple adds an undo entry to the version
+ * chain of its RID: the tuple as it was before the write, or the fact that it did not exist, and the writer, which
+ * stamps the entry with its commit timestamp when it commits. A snapshot sees a write if it made the write, or if
+ * the write committed at or before the snapshot was taken. A reader walks the chain from the newest write down to
+ * the first write it sees and reads the tuple as that write left it, which is the page for the newest write and
+ * the undo image of the next newer write otherwise; if it sees no write in the chain, it reads the oldest image.
+ *
+ * A write every running snapshot sees makes its own undo image, and the older entries, useless. Commit() prunes
+ * them, given the oldest running snapshot, from the chains of the writes committed since, in commit order.
+ *
+ * The chains are only changed with the page of the tuple write-latched, except for stamping and pruning, and read
+ * with the page latched, so a reader sees a page and the chains of its tuples in step. The images of the entries a
+ * reader can see are not pruned while it runs, so a view of an image stays valid while the page stays latched.
+ */
+class VersionStore {
+ public:
+  /**
+   * Record a write to a tuple. Called with the page of the tuple write-latched.
+   * @param rid the tuple
+   * @param writer the writing transaction
+   * @param before the tuple before the write, or nullptr if it did not exist
+   */
+  void Record(const RID &rid, txn_id_t writer, const Tuple *before);
+
+  /**
+   * Drop the newest entry of a tuple written by an aborted transaction, once the write is undone in the page.
+   * Called with the page of the tuple write-latched.
+   */
+  void Rollback(const RID &rid, txn_id_t writer);
+
+  /**
+   * Stamp the writes of a committed transaction to a tuple with its commit timestamp, and prune the chains of the
+   * writes every running snapshot sees. Called in commit order.
+   * @param watermark the timestamp of the oldest running snapshot, or the commit timestamp if there is none
+   */
+  void Commit(const RID &rid, txn_id_t writer, timestamp_t commit_ts, timestamp_t watermark);
+
+  /**
+   * Find the version of a tuple a snapshot sees. Called with the page of the tuple latched.
+   * @param rid the tuple
+   * @param txn the reading transaction
+   * @param exists whether the tuple is live in the page
+   * @param[in,out] tuple the view of the tuple in the page if it exists; set to a view of the version the snapshot
+   * sees if that is an older one
+   * @return true if the snapshot sees the tuple
+   */
+  auto GetVisibleVersion(const RID &rid, Transaction *txn, bool exists, Tuple *tuple) -> bool;
+
+  /** @return true if another transaction wrote the tuple after the snapshot of `txn` was taken */
+  auto HasConflict(const RID &rid, Transaction *txn) -> bool;
+
+  /** @return the number of tuples with a version chain */
+  auto GetChainCount() -> size_t;
+
+ private:
+  /** An undo entry */
+  struct Version {
+    /** The writing transaction */
+    txn_id_t writer_;
+    /** The commit timestamp of the writer, or INVALID_TS */
+    timestamp_t commit_ts_;
+    /** Whether the tuple existed before the write */
+    bool existed_;
+    /** The tuple before the write */
+    Tuple before_;
+  };
+
+  /** @return true if the snapshot of `txn` sees the write of the entry */
+  static auto IsVisible(const Version &version, Transaction *txn) -> bool {
+    return version.writer_ == txn->GetTransactionId() ||
+           (version.commit_ts_ != INVALID_TS && version.commit_ts_ <= txn->GetReadTs());
+  }
+
+  /** Drop the entries of a chain that every snapshot at or after `watermark` sees. Called with `latch_` held. */
+  void Prune(const RID &rid, timestamp_t watermark);
+
+  std::shared_mutex latch_;
+  /** The version chain of every tuple written since the oldest running snapshot, oldest write first */
+  std::unordered_map<RID, std::vector<Version>> chains_;
+  /** The number of chains, read without the latch to skip it while there are none */
+  std::atomic<size_t> chain_count_{0};
+  /** The tuples whose writes committed, with the commit timestamps, in commit order */
+  std::deque<std::pair<timestamp_t, RID>> committed_;
+};
+
+}  // namespace bustub
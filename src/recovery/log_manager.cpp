@@ -12,6 +12,10 @@
 
 #include "recovery/log_manager.h"
 
+#include <cstring>
+
+#include "common/macros.h"
+
 namespace bustub {
 /*
  * set enable_logging = true
@@ -22,33 +26,182 @@ namespace bustub {
  *
  * This thread runs forever until system shutdown/StopFlushThread
  */
-void LogManager::RunFlushThread() {}
+void LogManager::RunFlushThread() {
+  if (flush_thread_ != nullptr) {
+    return;
+  }
+  stop_flush_thread_ = false;
+  enable_logging = true;
+  flush_thread_ = new std::thread([this] {
+    bool stop = false;
+    while (!stop) {
+      {
+        std::unique_lock lock(latch_);
+        cv_.wait_for(lock, log_timeout, [this] { return flush_requested_ || stop_flush_thread_; });
+        flush_requested_ = false;
+        stop = stop_flush_thread_;
+      }
+      FlushBuffer();
+    }
+  });
+}
 
 /*
  * Stop and join the flush thread, set enable_logging = false
  */
-void LogManager::StopFlushThread() {}
+void LogManager::StopFlushThread() {
+  if (flush_thread_ == nullptr) {
+    return;
+  }
+  {
+    std::scoped_lock lock(latch_);
+    stop_flush_thread_ = true;
+  }
+  cv_.notify_one();
+  // The thread flushes whatever is left before it exits
+  flush_thread_->join();
+  delete flush_thread_;
+  flush_thread_ = nullptr;
+  enable_logging = false;
+}
 
 /*
  * append a log record into log buffer
  * you MUST set the log record's lsn within this method
  * @return: lsn that is assigned to this log record
- *
- *
- * example below
- * // First, serialize the must have fields(20 bytes in total)
- * log_record.lsn_ = next_lsn_++;
- * memcpy(log_buffer_ + offset_, &log_record, 20);
- * int pos = offset_ + 20;
- *
- * if (log_record.log_record_type_ == LogRecordType::INSERT) {
- *    memcpy(log_buffer_ + pos, &log_record.insert_rid_, sizeof(RID));
- *    pos += sizeof(RID);
- *    // we have provided serialize function for tuple class
- *    log_record.insert_tuple_.SerializeTo(log_buffer_ + pos);
- *  }
- *
  */
-auto LogManager::AppendLogRecord(LogRecord *log_record) -> lsn_t { return INVALID_LSN; }
+auto LogManager::AppendLogRecord(LogRecord *log_record) -> lsn_t {
+  uint32_t offset = ReserveSpace(log_record->size_);
+  // The LSN is taken while the reservation holds off the next flush, so every record of a flushed buffer has a
+  // smaller LSN than the records of the buffers after it
+  log_record->lsn_ = next_lsn_++;
+  log_record->SerializeTo(log_buffer_ + offset);
+  buffer_state_.fetch_sub(WRITER, std::memory_order_release);
+  return log_record->lsn_;
+}
+
+auto LogManager::AppendCheckpoint(LogRecord *checkpoint) -> lsn_t {
+  BUSTUB_ASSERT(checkpoint->log_record_type_ == LogRecordType::CHECKPOINT, "not a checkpoint record");
+  uint32_t offset = ReserveSpace(checkpoint->size_);
+  // The reservation holds off the swap that moves the buffer, so the file offset still belongs to it
+  int file_offset = buffer_file_offset_.load(std::memory_order_acquire) + static_cast<int>(offset);
+  checkpoint->lsn_ = next_lsn_++;
+  checkpoint->SerializeTo(log_buffer_ + offset);
+  buffer_state_.fetch_sub(WRITER, std::memory_order_release);
+  Flush(checkpoint->lsn_);
+  disk_manager_->WriteMasterRecord(file_offset);
+  // Recovery starts from this checkpoint now, so the segments before its scan offset are no longer needed
+  disk_manager_->TruncateLog(checkpoint->GetScanOffset());
+  return checkpoint->lsn_;
+}
+
+void LogManager::Flush(lsn_t lsn) {
+  lsn = std::min(lsn, next_lsn_ - 1);
+  if (flush_thread_ == nullptr) {
+    if (persistent_lsn_ < lsn) {
+      FlushBuffer();
+    }
+    return;
+  }
+  std::unique_lock lock(latch_);
+  while (persistent_lsn_ < lsn) {
+    flush_requested_ = true;
+    cv_.notify_one();
+    flushed_cv_.wait(lock);
+  }
+}
+
+auto LogManager::GetNextOffset() -> int {
+  while (true) {
+    uint64_t state = buffer_state_.load(std::memory_order_acquire);
+    if ((state & SEALED) != 0) {
+      std::this_thread::yield();
+      continue;
+    }
+    int file_offset = buffer_file_offset_.load(std::memory_order_acquire);
+    // The file offset belongs to the buffer read above unless a swap started in between
+    uint64_t check = buffer_state_.load(std::memory_order_acquire);
+    if ((check & (SEALED | EPOCH_MASK)) == (state & EPOCH_MASK)) {
+      return file_offset + static_cast<int>(state & OFFSET_MASK);
+    }
+  }
+}
+
+auto LogManager::ReserveSpace(uint32_t size) -> uint32_t {
+  BUSTUB_ASSERT(size <= static_cast<uint32_t>(LOG_BUFFER_SIZE), "log record larger than the log buffer");
+  uint64_t state = buffer_state_.load(std::memory_order_acquire);
+  while (true) {
+    if ((state & SEALED) == 0 && (state & OFFSET_MASK) + size <= static_cast<uint64_t>(LOG_BUFFER_SIZE)) {
+      if (buffer_state_.compare_exchange_weak(state, state + WRITER + size, std::memory_order_acq_rel)) {
+        return static_cast<uint32_t>(state & OFFSET_MASK);
+      }
+      continue;
+    }
+    // The buffer is full or being swapped: wait for the flush that empties it
+    if (flush_thread_ == nullptr) {
+      FlushBuffer();
+    } else {
+      std::unique_lock lock(latch_);
+      uint64_t flush_count = flush_count_;
+      flush_requested_ = true;
+      cv_.notify_one();
+      flushed_cv_.wait(lock, [&] { return flush_count_ != flush_count; });
+    }
+    state = buffer_state_.load(std::memory_order_acquire);
+  }
+}
+
+auto LogManager::FindLastLSN() -> lsn_t {
+  // LSNs grow along the log, so the last complete record has the largest; the checkpoint the master record points
+  // at, which truncation keeps, is the first record that may still be in the log
+  int offset = std::max(disk_manager_->ReadMasterRecord(), 0);
+  lsn_t last_lsn = INVALID_LSN;
+  while (disk_manager_->ReadLog(flush_buffer_, LOG_BUFFER_SIZE, offset)) {
+    int pos = 0;
+    LogRecord log_record;
+    while (log_record.DeserializeFrom(flush_buffer_ + pos, LOG_BUFFER_SIZE - pos)) {
+      last_lsn = log_record.lsn_;
+      pos += log_record.size_;
+    }
+    if (pos == 0) {
+      // The end of a run's log; the log of a later run starts in the next segment
+      int next_segment = disk_manager_->GetNextLogSegmentOffset(offset);
+      if (!disk_manager_->ReadLog(flush_buffer_, LOG_BUFFER_SIZE, next_segment) ||
+          !log_record.DeserializeFrom(flush_buffer_, LOG_BUFFER_SIZE)) {
+        break;
+      }
+      offset = next_segment;
+      continue;
+    }
+    offset += pos;
+  }
+  return last_lsn;
+}
+
+void LogManager::FlushBuffer() {
+  std::scoped_lock flush_lock(flush_latch_);
+  uint64_t state = buffer_state_.fetch_or(SEALED, std::memory_order_acq_rel);
+  while ((state & ~SEALED) >= WRITER) {
+    std::this_thread::yield();
+    state = buffer_state_.load(std::memory_order_acquire);
+  }
+  auto size = static_cast<int>(state & OFFSET_MASK);
+  lsn_t last_lsn = next_lsn_ - 1;
+  if (size > 0) {
+    std::swap(log_buffer_, flush_buffer_);
+  }
+  buffer_file_offset_ += size;
+  buffer_state_.store(((state & EPOCH_MASK) + EPOCH) & EPOCH_MASK, std::memory_order_release);
+
+  if (size > 0) {
+    disk_manager_->WriteLog(flush_buffer_, size);
+  }
+  {
+    std::scoped_lock lock(latch_);
+    persistent_lsn_ = last_lsn;
+    flush_count_++;
+  }
+  flushed_cv_.notify_all();
+}
 
 }  // namespace bustub
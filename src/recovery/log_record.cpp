@@ -0,0 +1,401 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// log_record.cpp
+//
+// Identification: src/recovery/log_record.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "recovery/log_record.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "common/macros.h"
+#include "common/util/hash_util.h"
+
+namespace bustub {
+
+namespace {
+
+/** The bytes of the header between the size and the variable-width ids: CRC, type and LSN */
+constexpr int FIXED_HEADER_SIZE = sizeof(uint32_t) + 1 + sizeof(lsn_t);
+
+/** The bit of the type byte that marks a compensation record */
+constexpr uint8_t COMPENSATION_FLAG = 0x80;
+
+/** The varint of an id that may be -1 */
+inline auto Biased(int32_t value) -> uint64_t { return static_cast<uint64_t>(static_cast<int64_t>(value) + 1); }
+
+inline auto Unbiased(uint64_t value) -> int32_t { return static_cast<int32_t>(static_cast<int64_t>(value) - 1); }
+
+inline auto VarintLength(uint64_t value) -> int {
+  int length = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    length++;
+  }
+  return length;
+}
+
+}  // namespace
+
+/** Writes the fields of a record, or only counts their bytes when it has no output */
+class LogRecord::Encoder {
+ public:
+  explicit Encoder(char *out) : out_(out) {}
+
+  void Varint(uint64_t value) {
+    while (value >= 0x80) {
+      Byte(static_cast<uint8_t>(value | 0x80));
+      value >>= 7;
+    }
+    Byte(static_cast<uint8_t>(value));
+  }
+
+  void Byte(uint8_t value) {
+    if (out_ != nullptr) {
+      out_[pos_] = static_cast<char>(value);
+    }
+    pos_++;
+  }
+
+  void Bytes(const char *data, size_t size) {
+    if (out_ != nullptr && size > 0) {
+      memcpy(out_ + pos_, data, size);
+    }
+    pos_ += static_cast<int>(size);
+  }
+
+  auto Position() const -> int { return pos_; }
+
+ private:
+  char *out_;
+  int pos_{0};
+};
+
+/** Reads the fields of a record; a read past the end fails the decoder instead of the process */
+class LogRecord::Decoder {
+ public:
+  Decoder(const char *data, int size) : data_(data), size_(size) {}
+
+  auto Varint() -> uint64_t {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (pos_ >= size_) {
+        ok_ = false;
+        return 0;
+      }
+      auto byte = static_cast<uint8_t>(data_[pos_++]);
+      value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) {
+        return value;
+      }
+    }
+    ok_ = false;
+    return 0;
+  }
+
+  /** @return the next `size` bytes, or nullptr if the data ends first */
+  auto Bytes(uint64_t size) -> const char * {
+    if (size > static_cast<uint64_t>(size_ - pos_)) {
+      ok_ = false;
+      return nullptr;
+    }
+    const char *bytes = data_ + pos_;
+    pos_ += static_cast<int>(size);
+    return bytes;
+  }
+
+  auto Position() const -> int { return pos_; }
+
+  auto Ok() const -> bool { return ok_; }
+
+ private:
+  const char *data_;
+  int size_;
+  int pos_{0};
+  bool ok_{true};
+};
+
+void LogRecord::ComputeSize() {
+  Encoder encoder(nullptr);
+  EncodeBody(&encoder);
+  int length = FIXED_HEADER_SIZE + VarintLength(Biased(txn_id_)) + VarintLength(Biased(prev_lsn_)) +
+               (compensation_ ? VarintLength(Biased(undo_next_lsn_)) : 0) + encoder.Position();
+  // The size counts its own varint
+  int size_length = 1;
+  while (VarintLength(length + size_length) != size_length) {
+    size_length++;
+  }
+  size_ = length + size_length;
+}
+
+void LogRecord::EncodeBody(Encoder *encoder) const {
+  switch (log_record_type_) {
+    case LogRecordType::INSERT:
+      encoder->Varint(insert_rid_.GetPageId());
+      encoder->Varint(insert_rid_.GetSlotNum());
+      encoder->Varint(insert_tuple_.GetLength());
+      encoder->Bytes(insert_tuple_.GetData(), insert_tuple_.GetLength());
+      break;
+    case LogRecordType::APPLYDELETE:
+      encoder->Varint(delete_rid_.GetPageId());
+      encoder->Varint(delete_rid_.GetSlotNum());
+      encoder->Varint(delete_tuple_.GetLength());
+      encoder->Bytes(delete_tuple_.GetData(), delete_tuple_.GetLength());
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      encoder->Varint(delete_rid_.GetPageId());
+      encoder->Varint(delete_rid_.GetSlotNum());
+      break;
+    case LogRecordType::UPDATE:
+      encoder->Varint(update_rid_.GetPageId());
+      encoder->Varint(update_rid_.GetSlotNum());
+      encoder->Bytes(update_delta_.data(), update_delta_.size());
+      break;
+    case LogRecordType::NEWPAGE:
+      encoder->Varint(Biased(prev_page_id_));
+      encoder->Varint(page_id_);
+      break;
+    case LogRecordType::INSERTPAGE:
+      encoder->Varint(Biased(prev_page_id_));
+      encoder->Varint(page_id_);
+      encoder->Varint(tuple_count_);
+      encoder->Bytes(page_image_, PAGE_SIZE);
+      break;
+    case LogRecordType::CHECKPOINT:
+      encoder->Varint(begin_offset_);
+      encoder->Varint(active_txns_.size());
+      for (const auto &entry : active_txns_) {
+        encoder->Varint(Biased(entry.txn_id_));
+        encoder->Varint(Biased(entry.last_lsn_));
+        encoder->Varint(entry.first_offset_);
+      }
+      encoder->Varint(dirty_pages_.size());
+      for (const auto &entry : dirty_pages_) {
+        encoder->Varint(entry.page_id_);
+        encoder->Varint(entry.rec_offset_);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void LogRecord::SerializeTo(char *data) const {
+  Encoder encoder(data);
+  encoder.Varint(size_);
+  int crc_pos = encoder.Position();
+  uint32_t crc = 0;
+  encoder.Bytes(reinterpret_cast<const char *>(&crc), sizeof(uint32_t));
+  encoder.Byte(static_cast<uint8_t>(log_record_type_) | (compensation_ ? COMPENSATION_FLAG : 0));
+  encoder.Bytes(reinterpret_cast<const char *>(&lsn_), sizeof(lsn_t));
+  encoder.Varint(Biased(txn_id_));
+  encoder.Varint(Biased(prev_lsn_));
+  if (compensation_) {
+    encoder.Varint(Biased(undo_next_lsn_));
+  }
+  EncodeBody(&encoder);
+  BUSTUB_ASSERT(encoder.Position() == size_, "The record size matches its encoding.");
+  int covered = crc_pos + static_cast<int>(sizeof(uint32_t));
+  crc = HashUtil::Crc32c(data + covered, size_ - covered);
+  memcpy(data + crc_pos, &crc, sizeof(uint32_t));
+}
+
+auto LogRecord::PeekSize(const char *data, int size) -> int32_t {
+  Decoder decoder(data, std::min(size, MAX_HEADER_SIZE));
+  uint64_t record_size = decoder.Varint();
+  if (!decoder.Ok() || record_size > static_cast<uint64_t>(INT32_MAX)) {
+    return 0;
+  }
+  return static_cast<int32_t>(record_size);
+}
+
+auto LogRecord::DeserializeFrom(const char *data, int size) -> bool {
+  int32_t record_size = PeekSize(data, size);
+  // A zero size is the padding after the last record
+  if (record_size <= FIXED_HEADER_SIZE || record_size > size) {
+    return false;
+  }
+  Decoder decoder(data, record_size);
+  decoder.Varint();
+  uint32_t crc;
+  memcpy(&crc, decoder.Bytes(sizeof(uint32_t)), sizeof(uint32_t));
+  if (crc != HashUtil::Crc32c(data + decoder.Position(), record_size - decoder.Position())) {
+    return false;
+  }
+  size_ = record_size;
+  auto type = static_cast<uint8_t>(*decoder.Bytes(1));
+  log_record_type_ = static_cast<LogRecordType>(type & ~COMPENSATION_FLAG);
+  compensation_ = (type & COMPENSATION_FLAG) != 0;
+  memcpy(&lsn_, decoder.Bytes(sizeof(lsn_t)), sizeof(lsn_t));
+  txn_id_ = Unbiased(decoder.Varint());
+  prev_lsn_ = Unbiased(decoder.Varint());
+  undo_next_lsn_ = compensation_ ? Unbiased(decoder.Varint()) : INVALID_LSN;
+
+  // Separate statements: the order arguments are evaluated in is unspecified
+  auto read_rid = [&decoder](RID *rid) {
+    auto page_id = static_cast<page_id_t>(decoder.Varint());
+    auto slot_num = static_cast<uint32_t>(decoder.Varint());
+    rid->Set(page_id, slot_num);
+  };
+  auto read_tuple = [&decoder](Tuple *tuple) {
+    uint64_t length = decoder.Varint();
+    const char *bytes = decoder.Bytes(length);
+    if (bytes == nullptr) {
+      return;
+    }
+    if (tuple->allocated_) {
+      delete[] tuple->data_;
+    }
+    tuple->size_ = static_cast<uint32_t>(length);
+    tuple->data_ = new char[length];
+    memcpy(tuple->data_, bytes, length);
+    tuple->allocated_ = true;
+  };
+  switch (log_record_type_) {
+    case LogRecordType::INSERT:
+      read_rid(&insert_rid_);
+      read_tuple(&insert_tuple_);
+      break;
+    case LogRecordType::APPLYDELETE:
+      read_rid(&delete_rid_);
+      read_tuple(&delete_tuple_);
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      read_rid(&delete_rid_);
+      break;
+    case LogRecordType::UPDATE: {
+      read_rid(&update_rid_);
+      int delta_size = record_size - decoder.Position();
+      update_delta_.assign(decoder.Bytes(delta_size), delta_size);
+      break;
+    }
+    case LogRecordType::NEWPAGE:
+      prev_page_id_ = Unbiased(decoder.Varint());
+      page_id_ = static_cast<page_id_t>(decoder.Varint());
+      break;
+    case LogRecordType::INSERTPAGE:
+      prev_page_id_ = Unbiased(decoder.Varint());
+      page_id_ = static_cast<page_id_t>(decoder.Varint());
+      tuple_count_ = static_cast<uint32_t>(decoder.Varint());
+      page_image_ = decoder.Bytes(PAGE_SIZE);
+      break;
+    case LogRecordType::CHECKPOINT: {
+      begin_offset_ = static_cast<int>(decoder.Varint());
+      active_txns_.resize(std::min<uint64_t>(decoder.Varint(), record_size));
+      for (auto &entry : active_txns_) {
+        entry.txn_id_ = Unbiased(decoder.Varint());
+        entry.last_lsn_ = Unbiased(decoder.Varint());
+        entry.first_offset_ = static_cast<int>(decoder.Varint());
+      }
+      dirty_pages_.resize(std::min<uint64_t>(decoder.Varint(), record_size));
+      for (auto &entry : dirty_pages_) {
+        entry.page_id_ = static_cast<page_id_t>(decoder.Varint());
+        entry.rec_offset_ = static_cast<int>(decoder.Varint());
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  return decoder.Ok() && decoder.Position() == record_size;
+}
+
+auto LogRecord::EncodeUpdateDelta(const Tuple &old_tuple, const Tuple &new_tuple) -> std::string {
+  const char *old_data = old_tuple.GetData();
+  const char *new_data = new_tuple.GetData();
+  uint32_t old_size = old_tuple.GetLength();
+  uint32_t new_size = new_tuple.GetLength();
+  std::string delta;
+  auto append_run = [&](uint32_t gap, uint32_t old_start, uint32_t old_end, uint32_t new_start, uint32_t new_end) {
+    char header[15];
+    Encoder encoder(header);
+    encoder.Varint(gap);
+    encoder.Varint(old_end - old_start);
+    encoder.Varint(new_end - new_start);
+    delta.append(header, encoder.Position());
+    delta.append(old_data + old_start, old_end - old_start);
+    delta.append(new_data + new_start, new_end - new_start);
+  };
+
+  uint32_t common = std::min(old_size, new_size);
+  uint32_t prefix = 0;
+  while (prefix < common && old_data[prefix] == new_data[prefix]) {
+    prefix++;
+  }
+  uint32_t suffix = 0;
+  while (suffix < common - prefix && old_data[old_size - 1 - suffix] == new_data[new_size - 1 - suffix]) {
+    suffix++;
+  }
+  if (old_size != new_size) {
+    // The bytes between the common prefix and suffix are replaced as one run
+    if (prefix < old_size - suffix || prefix < new_size - suffix) {
+      append_run(prefix, prefix, old_size - suffix, prefix, new_size - suffix);
+    }
+    return delta;
+  }
+
+  // Same size: one run per stretch of changed bytes. A run costs at least three bytes of header, and a single
+  // unchanged byte between two runs only two bytes, so such runs are merged
+  uint32_t end = old_size - suffix;
+  uint32_t last_end = 0;
+  uint32_t pos = prefix;
+  while (pos < end) {
+    uint32_t run_start = pos;
+    uint32_t run_end = pos + 1;
+    while (run_end < end) {
+      if (old_data[run_end] != new_data[run_end]) {
+        run_end++;
+      } else if (run_end + 1 < end && old_data[run_end + 1] != new_data[run_end + 1]) {
+        run_end += 2;
+      } else {
+        break;
+      }
+    }
+    append_run(run_start - last_end, run_start, run_end, run_start, run_end);
+    last_end = run_end;
+    pos = run_end;
+    while (pos < end && old_data[pos] == new_data[pos]) {
+      pos++;
+    }
+  }
+  return delta;
+}
+
+auto LogRecord::ApplyUpdate(const Tuple &tuple, bool undo) const -> Tuple {
+  std::string image;
+  image.reserve(tuple.GetLength());
+  Decoder decoder(update_delta_.data(), static_cast<int>(update_delta_.size()));
+  uint32_t pos = 0;
+  while (decoder.Position() < static_cast<int>(update_delta_.size())) {
+    auto gap = static_cast<uint32_t>(decoder.Varint());
+    uint64_t old_size = decoder.Varint();
+    uint64_t new_size = decoder.Varint();
+    const char *old_bytes = decoder.Bytes(old_size);
+    const char *new_bytes = decoder.Bytes(new_size);
+    BUSTUB_ASSERT(decoder.Ok() && pos + gap <= tuple.GetLength(), "The update delta fits the tuple.");
+    image.append(tuple.GetData() + pos, gap);
+    pos += gap;
+    image.append(undo ? old_bytes : new_bytes, undo ? old_size : new_size);
+    pos += static_cast<uint32_t>(undo ? new_size : old_size);
+  }
+  BUSTUB_ASSERT(pos <= tuple.GetLength(), "The update delta fits the tuple.");
+  image.append(tuple.GetData() + pos, tuple.GetLength() - pos);
+
+  Tuple result(update_rid_);
+  result.size_ = static_cast<uint32_t>(image.size());
+  result.data_ = new char[image.size()];
+  memcpy(result.data_, image.data(), image.size());
+  result.allocated_ = true;
+  return result;
+}
+
+}  // namespace bustub
@@ -12,6 +12,13 @@
 
 #include "recovery/log_recovery.h"
 
+#include <cstring>
+#include <iterator>
+#include <queue>
+#include <thread>  // NOLINT
+#include <utility>
+
+#include "common/macros.h"
 #include "storage/page/table_page.h"
 
 namespace bustub {
@@ -20,7 +27,17 @@ namespace bustub {
  * @return: true means deserialize succeed, otherwise can't deserialize cause
  * incomplete log record
  */
-auto LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record) -> bool { return false; }
+auto LogRecovery::DeserializeLogRecord(const char *data, int size, LogRecord *log_record) -> bool {
+  return log_record->DeserializeFrom(data, size);
+}
+
+void LogRecovery::ReadLogRecord(int offset, LogRecord *log_record) {
+  disk_manager_->ReadLog(log_buffer_, LogRecord::MAX_HEADER_SIZE, offset);
+  int32_t size = LogRecord::PeekSize(log_buffer_, LogRecord::MAX_HEADER_SIZE);
+  disk_manager_->ReadLog(log_buffer_, size, offset);
+  bool complete = DeserializeLogRecord(log_buffer_, size, log_record);
+  BUSTUB_ASSERT(complete, "Records of the analyzed log are complete.");
+}
 
 /*
  *redo phase on TABLE PAGE level(table/table_page.h)
@@ -29,12 +46,336 @@ auto LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record)
  *LSN with log_record's sequence number, and also build active_txn_ table &
  *lsn_mapping_ table
  */
-void LogRecovery::Redo() {}
+void LogRecovery::Redo() {
+  size_t workers = redo_threads_ != 0 ? redo_threads_ : std::thread::hardware_concurrency();
+  // Every worker pins one page at a time
+  workers = std::max<size_t>(1, std::min(workers, buffer_pool_manager_->GetPoolSize() / 2));
+  std::vector<RedoQueue> queues(workers);
+  std::vector<std::thread> threads;
+  threads.reserve(workers);
+  for (auto &queue : queues) {
+    threads.emplace_back(&LogRecovery::RunRedoWorker, this, &queue);
+  }
+
+  std::vector<std::vector<RedoItem>> batches(workers);
+  auto dispatch = [&](page_id_t page_id, bool link, const char *data, int size) {
+    batches[static_cast<size_t>(page_id) % workers].push_back(RedoItem{link, std::string(data, size)});
+  };
+
+  active_txn_.clear();
+  lsn_mapping_.clear();
+  // Start from the last checkpoint if the master record points at one: changes logged before the redo start are
+  // on disk, and every transaction unfinished at the checkpoint began at or after the scan start
+  int redo_start = 0;
+  int scan_start = 0;
+  int master_offset = disk_manager_->ReadMasterRecord();
+  LogRecord checkpoint;
+  if (master_offset >= 0 && disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, master_offset) &&
+      DeserializeLogRecord(log_buffer_, LOG_BUFFER_SIZE, &checkpoint) &&
+      checkpoint.log_record_type_ == LogRecordType::CHECKPOINT) {
+    redo_start = checkpoint.GetRedoOffset();
+    scan_start = checkpoint.GetScanOffset();
+  }
+  offset_ = scan_start;
+  while (disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, offset_)) {
+    int pos = 0;
+    while (true) {
+      LogRecord log_record;
+      if (!DeserializeLogRecord(log_buffer_ + pos, LOG_BUFFER_SIZE - pos, &log_record)) {
+        break;
+      }
+      const char *data = log_buffer_ + pos;
+      lsn_mapping_[log_record.lsn_] = offset_ + pos;
+      if (log_record.log_record_type_ == LogRecordType::COMMIT ||
+          log_record.log_record_type_ == LogRecordType::ABORT) {
+        active_txn_.erase(log_record.txn_id_);
+      } else if (log_record.log_record_type_ != LogRecordType::CHECKPOINT) {
+        active_txn_[log_record.txn_id_] = log_record.lsn_;
+      }
+      if (offset_ + pos < redo_start) {
+        // Only scanned for the transactions that were unfinished at the checkpoint
+        pos += log_record.size_;
+        continue;
+      }
+      switch (log_record.log_record_type_) {
+        case LogRecordType::INSERT:
+          dispatch(log_record.insert_rid_.GetPageId(), false, data, log_record.size_);
+          break;
+        case LogRecordType::MARKDELETE:
+        case LogRecordType::APPLYDELETE:
+        case LogRecordType::ROLLBACKDELETE:
+          dispatch(log_record.delete_rid_.GetPageId(), false, data, log_record.size_);
+          break;
+        case LogRecordType::UPDATE:
+          dispatch(log_record.update_rid_.GetPageId(), false, data, log_record.size_);
+          break;
+        case LogRecordType::NEWPAGE:
+        case LogRecordType::INSERTPAGE:
+          // The new page and the link to it from the previous page are redone by the workers of each page
+          dispatch(log_record.page_id_, false, data, log_record.size_);
+          if (log_record.prev_page_id_ != INVALID_PAGE_ID) {
+            dispatch(log_record.prev_page_id_, true, data, log_record.size_);
+          }
+          break;
+        default:
+          break;
+      }
+      pos += log_record.size_;
+    }
+    if (pos == 0) {
+      // The end of the log, or a record torn by the crash. The log of a later run starts in the next segment.
+      int next_segment = disk_manager_->GetNextLogSegmentOffset(offset_);
+      LogRecord log_record;
+      if (!disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, next_segment) ||
+          !DeserializeLogRecord(log_buffer_, LOG_BUFFER_SIZE, &log_record)) {
+        break;
+      }
+      offset_ = next_segment;
+      continue;
+    }
+    offset_ += pos;
+
+    for (size_t i = 0; i < workers; i++) {
+      if (batches[i].empty()) {
+        continue;
+      }
+      {
+        std::scoped_lock lock(queues[i].latch_);
+        std::move(batches[i].begin(), batches[i].end(), std::back_inserter(queues[i].items_));
+      }
+      queues[i].cv_.notify_one();
+      batches[i].clear();
+    }
+  }
+
+  for (auto &queue : queues) {
+    {
+      std::scoped_lock lock(queue.latch_);
+      queue.done_ = true;
+    }
+    queue.cv_.notify_one();
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  // Pages redone in the buffer pool must reach the disk before their ids can be handed out again
+  buffer_pool_manager_->FlushAllPages();
+}
+
+void LogRecovery::RunRedoWorker(RedoQueue *queue) {
+  std::deque<RedoItem> items;
+  while (true) {
+    {
+      std::unique_lock lock(queue->latch_);
+      queue->cv_.wait(lock, [queue] { return !queue->items_.empty() || queue->done_; });
+      if (queue->items_.empty()) {
+        return;
+      }
+      items.swap(queue->items_);
+    }
+    for (auto &item : items) {
+      LogRecord log_record;
+      bool complete = DeserializeLogRecord(item.record_.data(), item.record_.size(), &log_record);
+      BUSTUB_ASSERT(complete, "Redo records are complete.");
+      RedoRecord(&log_record, item.link_);
+    }
+    items.clear();
+  }
+}
+
+void LogRecovery::RedoRecord(LogRecord *log_record, bool link) {
+  page_id_t page_id;
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      page_id = log_record->insert_rid_.GetPageId();
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      page_id = log_record->delete_rid_.GetPageId();
+      break;
+    case LogRecordType::UPDATE:
+      page_id = log_record->update_rid_.GetPageId();
+      break;
+    default:
+      page_id = link ? log_record->prev_page_id_ : log_record->page_id_;
+      break;
+  }
+
+  auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  BUSTUB_ASSERT(page != nullptr, "Every redo worker can pin a page.");
+  if (page->GetLSN() >= log_record->lsn_) {
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    return;
+  }
+
+  RID rid;
+  Tuple old_tuple;
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      page->InsertTuple(log_record->insert_tuple_, &rid, nullptr, nullptr, nullptr);
+      BUSTUB_ASSERT(rid == log_record->insert_rid_, "Redone inserts take their logged slot.");
+      break;
+    case LogRecordType::MARKDELETE:
+      page->MarkDelete(log_record->delete_rid_, nullptr, nullptr, nullptr);
+      break;
+    case LogRecordType::APPLYDELETE:
+      page->ApplyDelete(log_record->delete_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::ROLLBACKDELETE:
+      page->RollbackDelete(log_record->delete_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::UPDATE: {
+      // The record holds the changed bytes only; the page holds the old tuple
+      Tuple tuple;
+      page->GetTuple(log_record->update_rid_, &tuple, nullptr, nullptr);
+      page->UpdateTuple(log_record->ApplyUpdate(tuple, false), &old_tuple, log_record->update_rid_, nullptr, nullptr,
+                        nullptr);
+      break;
+    }
+    case LogRecordType::NEWPAGE:
+      if (link) {
+        page->SetNextPageId(log_record->page_id_);
+      } else {
+        page->Init(log_record->page_id_, PAGE_SIZE, log_record->prev_page_id_, nullptr, nullptr);
+      }
+      break;
+    case LogRecordType::INSERTPAGE:
+      if (link) {
+        page->SetNextPageId(log_record->page_id_);
+      } else {
+        memcpy(page->GetData(), log_record->page_image_, PAGE_SIZE);
+      }
+      break;
+    default:
+      break;
+  }
+  page->SetLSN(log_record->lsn_);
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
 
 /*
  *undo phase on TABLE PAGE level(table/table_page.h)
  *iterate through active txn map and undo each operation
  */
-void LogRecovery::Undo() {}
+void LogRecovery::Undo() {
+  // The next record to undo of every unfinished transaction, the newest change first across all of them
+  std::priority_queue<std::pair<lsn_t, txn_id_t>> next_undo;
+  for (const auto &[txn_id, last_lsn] : active_txn_) {
+    next_undo.emplace(last_lsn, txn_id);
+  }
+  while (!next_undo.empty()) {
+    auto [lsn, txn_id] = next_undo.top();
+    next_undo.pop();
+    LogRecord log_record;
+    ReadLogRecord(lsn_mapping_[lsn], &log_record);
+    lsn_t next_lsn = log_record.prev_lsn_;
+    if (log_record.IsCompensation()) {
+      // Undone before the last crash
+      next_lsn = log_record.GetUndoNextLSN();
+    } else {
+      UndoRecord(&log_record);
+    }
+    if (next_lsn != INVALID_LSN) {
+      next_undo.emplace(next_lsn, txn_id);
+      continue;
+    }
+    // Rolled back: later recoveries no longer see the transaction as unfinished
+    LogRecord abort_record(txn_id, active_txn_[txn_id], LogRecordType::ABORT);
+    log_manager_->AppendLogRecord(&abort_record);
+  }
+  active_txn_.clear();
+  // The compensations must be durable before the pages they changed
+  log_manager_->Flush(log_manager_->GetNextLSN() - 1);
+  buffer_pool_manager_->FlushAllPages();
+}
+
+auto LogRecovery::AppendCompensation(LogRecord *clr, LogRecord *undone) -> lsn_t {
+  clr->SetUndoNextLSN(undone->prev_lsn_);
+  lsn_t lsn = log_manager_->AppendLogRecord(clr);
+  active_txn_[undone->txn_id_] = lsn;
+  return lsn;
+}
+
+void LogRecovery::UndoRecord(LogRecord *log_record) {
+  page_id_t page_id;
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      page_id = log_record->insert_rid_.GetPageId();
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      page_id = log_record->delete_rid_.GetPageId();
+      break;
+    case LogRecordType::UPDATE:
+      page_id = log_record->update_rid_.GetPageId();
+      break;
+    case LogRecordType::INSERTPAGE:
+      page_id = log_record->page_id_;
+      break;
+    default:
+      // Nothing to roll back; a new page stays in the table, empty
+      return;
+  }
+
+  auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  BUSTUB_ASSERT(page != nullptr, "Undo can pin a page.");
+  txn_id_t txn_id = log_record->txn_id_;
+  lsn_t prev_lsn = active_txn_[txn_id];
+  lsn_t lsn = INVALID_LSN;
+  RID rid;
+  Tuple old_tuple;
+  // Each compensation record is the change the undo makes, so redo repeats it like any other
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT: {
+      page->ApplyDelete(log_record->insert_rid_, nullptr, nullptr);
+      LogRecord clr(txn_id, prev_lsn, LogRecordType::APPLYDELETE, log_record->insert_rid_, log_record->insert_tuple_);
+      lsn = AppendCompensation(&clr, log_record);
+      break;
+    }
+    case LogRecordType::MARKDELETE: {
+      page->RollbackDelete(log_record->delete_rid_, nullptr, nullptr);
+      LogRecord clr(txn_id, prev_lsn, LogRecordType::ROLLBACKDELETE, log_record->delete_rid_, Tuple{});
+      lsn = AppendCompensation(&clr, log_record);
+      break;
+    }
+    case LogRecordType::APPLYDELETE: {
+      page->InsertTuple(log_record->delete_tuple_, &rid, nullptr, nullptr, nullptr);
+      LogRecord clr(txn_id, prev_lsn, LogRecordType::INSERT, rid, log_record->delete_tuple_);
+      lsn = AppendCompensation(&clr, log_record);
+      break;
+    }
+    case LogRecordType::ROLLBACKDELETE: {
+      page->MarkDelete(log_record->delete_rid_, nullptr, nullptr, nullptr);
+      LogRecord clr(txn_id, prev_lsn, LogRecordType::MARKDELETE, log_record->delete_rid_, Tuple{});
+      lsn = AppendCompensation(&clr, log_record);
+      break;
+    }
+    case LogRecordType::UPDATE: {
+      Tuple tuple;
+      page->GetTuple(log_record->update_rid_, &tuple, nullptr, nullptr);
+      Tuple restored = log_record->ApplyUpdate(tuple, true);
+      page->UpdateTuple(restored, &old_tuple, log_record->update_rid_, nullptr, nullptr, nullptr);
+      LogRecord clr(txn_id, prev_lsn, LogRecordType::UPDATE, log_record->update_rid_, tuple, restored);
+      lsn = AppendCompensation(&clr, log_record);
+      break;
+    }
+    case LogRecordType::INSERTPAGE: {
+      // The appended tuples hold the first slots of the page, as in TableHeap::RollbackAppend()
+      for (uint32_t slot = 0; slot < log_record->tuple_count_; slot++) {
+        page->ApplyDelete(RID(page_id, slot), nullptr, nullptr);
+      }
+      // The emptied page as a whole; the link from the previous page is already there
+      LogRecord clr(txn_id, prev_lsn, LogRecordType::INSERTPAGE, INVALID_PAGE_ID, page_id, 0, page->GetData());
+      lsn = AppendCompensation(&clr, log_record);
+      break;
+    }
+    default:
+      break;
+  }
+  page->SetLSN(lsn);
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
 
 }  // namespace bustub
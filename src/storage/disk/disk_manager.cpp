@@ -11,12 +11,16 @@
 //===----------------------------------------------------------------------===//
 
 #include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
 #include <cstring>
 #include <iostream>
 #include <mutex>  // NOLINT
 #include <string>
 #include <thread>  // NOLINT
+#include <vector>
 
 #include "common/exception.h"
 #include "common/logger.h"
@@ -26,31 +30,39 @@ namespace bustub {
 
 static char *buffer_used;
 
+/**
+ * The first bytes of a deallocated page: the page id and an invalid page LSN where every page keeps them, so the
+ * page is redone from scratch if recovery reuses it, followed by "FREEPAGE"
+ */
+static constexpr uint64_t FREE_PAGE_MAGIC = 0x4547415045455246;
+static constexpr size_t FREE_PAGE_OFFSET_MAGIC = sizeof(page_id_t) + sizeof(lsn_t);
+static constexpr size_t FREE_PAGE_MARKER_SIZE = FREE_PAGE_OFFSET_MAGIC + sizeof(uint64_t);
+/** Pages the file may grow by before the free page map is saved again, bounding the pages scanned at startup */
+static constexpr page_id_t FREE_PAGE_MAP_SAVE_INTERVAL = 1024;
+
 /**
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
  */
-DiskManager::DiskManager(const std::string &db_file)
-    : file_name_(db_file), num_flushes_(0), num_writes_(0), flush_log_(false), flush_log_f_(nullptr) {
+DiskManager::DiskManager(const std::string &db_file, int log_segment_size)
+    : log_name_(BaseName(db_file) + ".log"),
+      log_segments_(log_name_, log_segment_size),
+      file_name_(db_file),
+      num_flushes_(0),
+      num_writes_(0),
+      flush_log_(false),
+      flush_log_f_(nullptr) {
   std::string::size_type n = file_name_.rfind('.');
   if (n == std::string::npos) {
     LOG_DEBUG("wrong file format");
     return;
   }
-  log_name_ = file_name_.substr(0, n) + ".log";
+  master_name_ = file_name_.substr(0, n) + ".ckpt";
+  free_map_name_ = file_name_.substr(0, n) + ".free";
 
-  log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-  // directory or file does not exist
-  if (!log_io_.is_open()) {
-    log_io_.clear();
-    // create a new file
-    log_io_.open(log_name_, std::ios::binary | std::ios::trunc | std::ios::app | std::ios::out);
-    log_io_.close();
-    // reopen with original mode
-    log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-    if (!log_io_.is_open()) {
-      throw Exception("can't open dblog file");
-    }
+  // A master record without the log it points into is left over from an earlier database
+  if (log_segments_.GetEndOffset() == 0) {
+    std::remove(master_name_.c_str());
   }
 
   std::scoped_lock scoped_db_io_latch(db_io_latch_);
@@ -58,7 +70,8 @@ DiskManager::DiskManager(const std::string &db_file)
   // directory or file does not exist
   if (!db_io_.is_open()) {
     db_io_.clear();
-    // create a new file
+    // create a new file, and drop the free page map of an earlier one
+    std::remove(free_map_name_.c_str());
     db_io_.open(db_file, std::ios::binary | std::ios::trunc | std::ios::out);
     db_io_.close();
     // reopen with original mode
@@ -67,6 +80,7 @@ DiskManager::DiskManager(const std::string &db_file)
       throw Exception("can't open db file");
     }
   }
+  LoadFreePages();
   buffer_used = nullptr;
 }
 
@@ -76,9 +90,10 @@ DiskManager::DiskManager(const std::string &db_file)
 void DiskManager::ShutDown() {
   {
     std::scoped_lock scoped_db_io_latch(db_io_latch_);
+    SaveFreePageMap();
     db_io_.close();
   }
-  log_io_.close();
+  log_segments_.Close();
 }
 
 /**
@@ -86,6 +101,10 @@ void DiskManager::ShutDown() {
  */
 void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
   std::scoped_lock scoped_db_io_latch(db_io_latch_);
+  // A write to a free page, such as one redone during recovery, puts the page back in use
+  free_pages_.erase(page_id);
+  unwritten_pages_.erase(page_id);
+  end_page_id_ = std::max(end_page_id_, page_id + 1);
   size_t offset = static_cast<size_t>(page_id) * PAGE_SIZE;
   // set write cursor to offset
   num_writes_ += 1;
@@ -105,6 +124,11 @@ void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
  */
 void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
   std::scoped_lock scoped_db_io_latch(db_io_latch_);
+  // A page that was allocated but never written reads as zeros, not as its free-page marker
+  if (unwritten_pages_.count(page_id) != 0) {
+    memset(page_data, 0, PAGE_SIZE);
+    return;
+  }
   int offset = page_id * PAGE_SIZE;
   // check if read beyond file length
   if (offset > GetFileSize(file_name_)) {
@@ -129,6 +153,229 @@ void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
   }
 }
 
+/**
+ * Hand out the lowest free page id of the instance, or extend the file
+ */
+auto DiskManager::AllocatePage(uint32_t num_instances, uint32_t instance_index) -> page_id_t {
+  std::scoped_lock scoped_db_io_latch(db_io_latch_);
+  for (auto it = free_pages_.begin(); it != free_pages_.end();) {
+    if (static_cast<uint32_t>(*it) % num_instances != instance_index) {
+      ++it;
+      continue;
+    }
+    page_id_t page_id = *it;
+    it = free_pages_.erase(it);
+    // A page loaded from the free page map may have been written after the map was saved
+    if (IsMarkedFree(page_id)) {
+      unwritten_pages_.insert(page_id);
+      return page_id;
+    }
+  }
+  page_id_t first_page_id = end_page_id_;
+  page_id_t page_id = end_page_id_;
+  while (static_cast<uint32_t>(page_id) % num_instances != instance_index) {
+    free_pages_.insert(page_id++);
+  }
+  end_page_id_ = page_id + 1;
+  // The skipped ids and the new page stay free on disk until they are written
+  WriteFreePageMarkers(first_page_id, page_id);
+  unwritten_pages_.insert(page_id);
+  if (end_page_id_ - saved_end_page_id_ >= FREE_PAGE_MAP_SAVE_INTERVAL) {
+    SaveFreePageMap();
+  }
+  return page_id;
+}
+
+/**
+ * Mark a page free on disk and make its id available again
+ */
+void DiskManager::DeallocatePage(page_id_t page_id) {
+  std::scoped_lock scoped_db_io_latch(db_io_latch_);
+  if (page_id < 0 || page_id >= end_page_id_ || free_pages_.count(page_id) != 0) {
+    return;
+  }
+  free_pages_.insert(page_id);
+  // The map lists the page before its marker is written, so a crash in between cannot leave a marker the map misses
+  UpdateFreePageMap(page_id);
+  // An unwritten page still holds the marker written when it was allocated
+  if (unwritten_pages_.erase(page_id) == 0) {
+    WriteFreePageMarkers(page_id, page_id);
+  }
+  TrimFreePages();
+  if (end_page_id_ < saved_end_page_id_) {
+    UpdateFreePageMap(INVALID_PAGE_ID);
+  }
+}
+
+auto DiskManager::GetFreePageCount() -> size_t {
+  std::scoped_lock scoped_db_io_latch(db_io_latch_);
+  return free_pages_.size();
+}
+
+auto DiskManager::GetPageCount() -> page_id_t {
+  std::scoped_lock scoped_db_io_latch(db_io_latch_);
+  return end_page_id_;
+}
+
+/**
+ * Load the free page map and scan the pages past its end for free-page markers, or the whole file if there is no
+ * map. Called with db_io_latch_ held.
+ */
+void DiskManager::LoadFreePages() {
+  int file_size = GetFileSize(file_name_);
+  end_page_id_ = file_size <= 0 ? 0 : (file_size + PAGE_SIZE - 1) / PAGE_SIZE;
+  page_id_t page_id = ReadFreePageMap() ? std::min(saved_end_page_id_, end_page_id_) : 0;
+  for (; page_id < end_page_id_; page_id++) {
+    if (IsMarkedFree(page_id)) {
+      free_pages_.insert(page_id);
+    }
+  }
+  TrimFreePages();
+  SaveFreePageMap();
+}
+
+/**
+ * The map holds the end page id it was saved with, followed by one bit per page below it. Called with db_io_latch_
+ * held.
+ */
+auto DiskManager::ReadFreePageMap() -> bool {
+  std::ifstream map(free_map_name_, std::ios::binary | std::ios::in);
+  page_id_t saved_end_page_id;
+  if (!map.is_open() || !map.read(reinterpret_cast<char *>(&saved_end_page_id), sizeof(page_id_t)) ||
+      saved_end_page_id < 0) {
+    return false;
+  }
+  std::vector<char> bitmap((saved_end_page_id + 7) / 8);
+  if (!map.read(bitmap.data(), bitmap.size())) {
+    return false;
+  }
+  page_id_t end_page_id = std::min(saved_end_page_id, end_page_id_);
+  for (page_id_t page_id = 0; page_id < end_page_id; page_id++) {
+    if ((bitmap[page_id / 8] & (1 << (page_id % 8))) != 0) {
+      free_pages_.insert(page_id);
+    }
+  }
+  saved_end_page_id_ = saved_end_page_id;
+  return true;
+}
+
+/**
+ * Write the map to a temporary file and rename it over the old one, like the master record. Called with
+ * db_io_latch_ held.
+ */
+void DiskManager::SaveFreePageMap() {
+  if (free_map_name_.empty()) {
+    return;
+  }
+  std::vector<char> bitmap((end_page_id_ + 7) / 8, 0);
+  for (const auto *pages : {&free_pages_, &unwritten_pages_}) {
+    for (page_id_t page_id : *pages) {
+      bitmap[page_id / 8] |= static_cast<char>(1 << (page_id % 8));
+    }
+  }
+  std::string tmp_name = free_map_name_ + ".tmp";
+  std::ofstream map(tmp_name, std::ios::binary | std::ios::trunc | std::ios::out);
+  map.write(reinterpret_cast<const char *>(&end_page_id_), sizeof(page_id_t));
+  map.write(bitmap.data(), bitmap.size());
+  map.close();
+  if (map.fail() || std::rename(tmp_name.c_str(), free_map_name_.c_str()) != 0) {
+    LOG_DEBUG("I/O error while writing the free page map");
+    return;
+  }
+  saved_end_page_id_ = end_page_id_;
+}
+
+/**
+ * Set the bit of a page in the saved map, and lower its end page id to that of the file, in place rather than by
+ * saving the whole map. Called with db_io_latch_ held.
+ */
+void DiskManager::UpdateFreePageMap(page_id_t page_id) {
+  std::fstream map(free_map_name_, std::ios::binary | std::ios::in | std::ios::out);
+  if (!map.is_open()) {
+    SaveFreePageMap();
+    return;
+  }
+  // Pages past the end of the saved map are found by scanning for their markers
+  if (page_id != INVALID_PAGE_ID && page_id < saved_end_page_id_) {
+    auto offset = static_cast<std::streamoff>(sizeof(page_id_t) + page_id / 8);
+    char bits = 0;
+    map.seekg(offset);
+    map.read(&bits, 1);
+    bits |= static_cast<char>(1 << (page_id % 8));
+    map.seekp(offset);
+    map.write(&bits, 1);
+  }
+  if (end_page_id_ < saved_end_page_id_) {
+    map.seekp(0);
+    map.write(reinterpret_cast<const char *>(&end_page_id_), sizeof(page_id_t));
+    saved_end_page_id_ = end_page_id_;
+  }
+  map.close();
+  if (map.fail()) {
+    LOG_DEBUG("I/O error while writing the free page map");
+  }
+}
+
+/**
+ * Write the markers of a run of pages with a single write. Called with db_io_latch_ held.
+ */
+void DiskManager::WriteFreePageMarkers(page_id_t first, page_id_t last) {
+  std::vector<char> markers(static_cast<size_t>(last - first + 1) * PAGE_SIZE, 0);
+  lsn_t lsn = INVALID_LSN;
+  for (page_id_t page_id = first; page_id <= last; page_id++) {
+    char *marker = markers.data() + static_cast<size_t>(page_id - first) * PAGE_SIZE;
+    memcpy(marker, &page_id, sizeof(page_id_t));
+    memcpy(marker + sizeof(page_id_t), &lsn, sizeof(lsn_t));
+    memcpy(marker + FREE_PAGE_OFFSET_MAGIC, &FREE_PAGE_MAGIC, sizeof(uint64_t));
+  }
+  db_io_.seekp(static_cast<size_t>(first) * PAGE_SIZE);
+  db_io_.write(markers.data(), markers.size());
+  if (db_io_.bad()) {
+    LOG_DEBUG("I/O error while writing");
+    return;
+  }
+  db_io_.flush();
+}
+
+/**
+ * Called with db_io_latch_ held.
+ */
+auto DiskManager::IsMarkedFree(page_id_t page_id) -> bool {
+  char marker[FREE_PAGE_MARKER_SIZE];
+  db_io_.seekg(static_cast<size_t>(page_id) * PAGE_SIZE);
+  db_io_.read(marker, FREE_PAGE_MARKER_SIZE);
+  if (db_io_.gcount() < static_cast<std::streamsize>(FREE_PAGE_MARKER_SIZE)) {
+    db_io_.clear();
+    return false;
+  }
+  uint64_t magic;
+  page_id_t marked_page_id;
+  memcpy(&marked_page_id, marker, sizeof(page_id_t));
+  memcpy(&magic, marker + FREE_PAGE_OFFSET_MAGIC, sizeof(uint64_t));
+  return magic == FREE_PAGE_MAGIC && marked_page_id == page_id;
+}
+
+/**
+ * Give the free pages at the end of the file back to the file system. Called with db_io_latch_ held.
+ */
+void DiskManager::TrimFreePages() {
+  while (end_page_id_ > 0 && free_pages_.count(end_page_id_ - 1) != 0) {
+    free_pages_.erase(end_page_id_ - 1);
+    // A page loaded from the free page map may have been written after the map was saved
+    if (!IsMarkedFree(end_page_id_ - 1)) {
+      break;
+    }
+    end_page_id_--;
+  }
+  auto end_offset = static_cast<off_t>(end_page_id_) * PAGE_SIZE;
+  if (GetFileSize(file_name_) > end_offset) {
+    db_io_.flush();
+    if (truncate(file_name_.c_str(), end_offset) != 0) {
+      LOG_DEBUG("I/O error while truncating");
+    }
+  }
+}
+
 /**
  * Write the contents of the log into disk file
  * Only return when sync is done, and only perform sequence write
@@ -151,15 +398,10 @@ void DiskManager::WriteLog(char *log_data, int size) {
 
   num_flushes_ += 1;
   // sequence write
-  log_io_.write(log_data, size);
-
-  // check for I/O error
-  if (log_io_.bad()) {
+  if (!log_segments_.Append(log_data, size)) {
     LOG_DEBUG("I/O error while writing log");
     return;
   }
-  // needs to flush to keep disk file in sync
-  log_io_.flush();
   flush_log_ = false;
 }
 
@@ -169,26 +411,54 @@ void DiskManager::WriteLog(char *log_data, int size) {
  * @return: false means already reach the end
  */
 auto DiskManager::ReadLog(char *log_data, int size, int offset) -> bool {
-  if (offset >= GetFileSize(log_name_)) {
-    // LOG_DEBUG("end of log file");
-    // LOG_DEBUG("file size is %d", GetFileSize(log_name_));
-    return false;
-  }
-  log_io_.seekp(offset);
-  log_io_.read(log_data, size);
+  return log_segments_.Read(log_data, size, offset);
+}
 
-  if (log_io_.bad()) {
-    LOG_DEBUG("I/O error while reading log");
-    return false;
-  }
-  // if log file ends before reading "size"
-  int read_count = log_io_.gcount();
-  if (read_count < size) {
-    log_io_.clear();
-    memset(log_data + read_count, 0, size - read_count);
+auto DiskManager::GetLogEndOffset() -> int { return log_segments_.GetEndOffset(); }
+
+auto DiskManager::GetNextLogSegmentOffset(int offset) const -> int {
+  return log_segments_.GetNextSegmentOffset(offset);
+}
+
+void DiskManager::TruncateLog(int offset) { log_segments_.Truncate(offset); }
+
+void DiskManager::SetLogArchiveDirectory(const std::string &directory) {
+  log_segments_.SetArchiveDirectory(directory);
+}
+
+auto DiskManager::GetLogSegmentFileCount() -> size_t { return log_segments_.GetSegmentFileCount(); }
+
+auto DiskManager::BaseName(const std::string &db_file) -> std::string {
+  return db_file.substr(0, db_file.rfind('.'));
+}
+
+void DiskManager::RemoveLogFiles(const std::string &db_file) {
+  auto base_name = BaseName(db_file);
+  LogSegmentManager::RemoveSegments(base_name + ".log");
+  std::remove((base_name + ".ckpt").c_str());
+  std::remove((base_name + ".free").c_str());
+}
+
+/**
+ * Write the master record to a temporary file and rename it over the old one, so a crash leaves either record intact
+ */
+void DiskManager::WriteMasterRecord(int offset) {
+  std::string tmp_name = master_name_ + ".tmp";
+  std::ofstream master(tmp_name, std::ios::binary | std::ios::trunc | std::ios::out);
+  master.write(reinterpret_cast<const char *>(&offset), sizeof(int));
+  master.close();
+  if (master.fail() || std::rename(tmp_name.c_str(), master_name_.c_str()) != 0) {
+    LOG_DEBUG("I/O error while writing the master record");
   }
+}
 
-  return true;
+auto DiskManager::ReadMasterRecord() -> int {
+  std::ifstream master(master_name_, std::ios::binary | std::ios::in);
+  int offset = -1;
+  if (!master.is_open() || !master.read(reinterpret_cast<char *>(&offset), sizeof(int))) {
+    return -1;
+  }
+  return offset;
 }
 
 /**
@@ -0,0 +1,292 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// log_segment_manager.cpp
+//
+// Identification: src/storage/disk/log_segment_manager.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/log_segment_manager.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#include "common/exception.h"
+#include "common/macros.h"
+#include "common/logger.h"
+
+namespace bustub {
+
+/** Every segment file starts with "BUSTUBWL" and its index, so a zeroed spare is never taken for a segment */
+static constexpr char SEGMENT_MAGIC[8] = {'B', 'U', 'S', 'T', 'U', 'B', 'W', 'L'};
+static constexpr int SEGMENT_HEADER_SIZE = 16;
+/** Retired segments kept for reuse beyond this many are deleted */
+static constexpr size_t MAX_SPARE_SEGMENTS = 2;
+
+/** Split a path into its directory, "." if it has none, and its file name */
+static auto SplitPath(const std::string &path) -> std::pair<std::string, std::string> {
+  auto n = path.rfind('/');
+  if (n == std::string::npos) {
+    return {".", path};
+  }
+  return {n == 0 ? "/" : path.substr(0, n), path.substr(n + 1)};
+}
+
+/** @return the segment index a directory entry stands for, or -1 if it is not a segment of the log */
+static auto ParseSegmentIndex(const std::string &entry, const std::string &prefix) -> int {
+  if (entry.size() <= prefix.size() || entry.compare(0, prefix.size(), prefix) != 0) {
+    return -1;
+  }
+  auto digits = entry.substr(prefix.size());
+  if (!std::all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; }) || digits.size() > 9) {
+    return -1;
+  }
+  return std::stoi(digits);
+}
+
+/** Make the entries of a directory, such as a new or renamed segment file, durable */
+static void SyncDirectory(const std::string &directory) {
+  int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0 || fsync(fd) != 0) {
+    LOG_DEBUG("I/O error while syncing the log directory");
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+/** Call the function with the index and path of every segment file of a log */
+template <typename Function>
+static void ForEachSegmentFile(const std::string &log_name, Function &&function) {
+  auto [directory, file_name] = SplitPath(log_name);
+  auto prefix = file_name + ".";
+  DIR *dir = opendir(directory.c_str());
+  if (dir == nullptr) {
+    return;
+  }
+  std::vector<std::pair<int, std::string>> files;
+  while (dirent *entry = readdir(dir)) {
+    int index = ParseSegmentIndex(entry->d_name, prefix);
+    if (index >= 0) {
+      files.emplace_back(index, directory + "/" + entry->d_name);
+    }
+  }
+  closedir(dir);
+  for (auto &[index, path] : files) {
+    function(index, path);
+  }
+}
+
+LogSegmentManager::LogSegmentManager(std::string log_name, int segment_size)
+    : log_name_(std::move(log_name)), segment_size_(segment_size), capacity_(segment_size - SEGMENT_HEADER_SIZE) {
+  BUSTUB_ASSERT(capacity_ > 0, "log segments must be larger than their header");
+  ForEachSegmentFile(log_name_, [&](int index, const std::string &path) {
+    int fd = open(path.c_str(), O_RDWR);
+    if (fd < 0) {
+      return;
+    }
+    char header[SEGMENT_HEADER_SIZE];
+    int32_t header_index = -1;
+    if (pread(fd, header, SEGMENT_HEADER_SIZE, 0) == SEGMENT_HEADER_SIZE &&
+        memcmp(header, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) == 0) {
+      memcpy(&header_index, header + sizeof(SEGMENT_MAGIC), sizeof(int32_t));
+    }
+    if (header_index == index) {
+      segments_[index] = fd;
+    } else {
+      close(fd);
+      spares_.push_back(path);
+    }
+  });
+  if (!segments_.empty()) {
+    end_offset_ = (segments_.rbegin()->first + 1) * capacity_;
+  }
+}
+
+LogSegmentManager::~LogSegmentManager() { Close(); }
+
+void LogSegmentManager::Close() {
+  std::scoped_lock lock(latch_);
+  for (auto &[index, fd] : segments_) {
+    close(fd);
+  }
+  segments_.clear();
+}
+
+auto LogSegmentManager::SegmentName(int index) const -> std::string {
+  char suffix[16];
+  snprintf(suffix, sizeof(suffix), ".%06d", index);
+  return log_name_ + suffix;
+}
+
+auto LogSegmentManager::OpenSegment(int index) -> int {
+  auto path = SegmentName(index);
+  int fd = -1;
+  if (!spares_.empty() && std::rename(spares_.back().c_str(), path.c_str()) == 0) {
+    spares_.pop_back();
+    fd = open(path.c_str(), O_RDWR);
+  } else {
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    // Allocate the whole segment up front, so appends do not extend the file
+    if (fd >= 0 && posix_fallocate(fd, 0, segment_size_) != 0 && ftruncate(fd, segment_size_) != 0) {
+      LOG_DEBUG("I/O error while preallocating a log segment");
+    }
+  }
+  if (fd < 0) {
+    return -1;
+  }
+  char header[SEGMENT_HEADER_SIZE] = {};
+  memcpy(header, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+  auto header_index = static_cast<int32_t>(index);
+  memcpy(header + sizeof(SEGMENT_MAGIC), &header_index, sizeof(int32_t));
+  if (pwrite(fd, header, SEGMENT_HEADER_SIZE, 0) != SEGMENT_HEADER_SIZE || fsync(fd) != 0) {
+    close(fd);
+    return -1;
+  }
+  // A crash must not lose the segment, or its new name if it was a spare, once records are appended to it
+  SyncDirectory(SplitPath(path).first);
+  segments_[index] = fd;
+  return fd;
+}
+
+auto LogSegmentManager::Append(const char *data, int size) -> bool {
+  std::scoped_lock lock(latch_);
+  std::vector<int> written;
+  while (size > 0) {
+    int index = end_offset_ / capacity_;
+    int segment_offset = end_offset_ % capacity_;
+    auto it = segments_.find(index);
+    int fd = it != segments_.end() ? it->second : OpenSegment(index);
+    if (fd < 0) {
+      return false;
+    }
+    int count = std::min(size, capacity_ - segment_offset);
+    if (pwrite(fd, data, count, SEGMENT_HEADER_SIZE + segment_offset) != count) {
+      return false;
+    }
+    if (written.empty() || written.back() != fd) {
+      written.push_back(fd);
+    }
+    data += count;
+    size -= count;
+    end_offset_ += count;
+  }
+  // The segments are preallocated, so syncing their data is enough to make the append durable
+  return std::all_of(written.begin(), written.end(), [](int fd) { return fdatasync(fd) == 0; });
+}
+
+auto LogSegmentManager::Read(char *data, int size, int offset) -> bool {
+  std::scoped_lock lock(latch_);
+  if (offset < 0 || offset >= end_offset_ || segments_.count(offset / capacity_) == 0) {
+    return false;
+  }
+  int readable = std::min(size, end_offset_ - offset);
+  int done = 0;
+  while (done < readable) {
+    auto it = segments_.find((offset + done) / capacity_);
+    if (it == segments_.end()) {
+      break;
+    }
+    int segment_offset = (offset + done) % capacity_;
+    int count = std::min(readable - done, capacity_ - segment_offset);
+    auto read = pread(it->second, data + done, count, SEGMENT_HEADER_SIZE + segment_offset);
+    if (read < 0) {
+      LOG_DEBUG("I/O error while reading log");
+      return false;
+    }
+    done += static_cast<int>(read);
+    if (read < count) {
+      break;
+    }
+  }
+  memset(data + done, 0, size - done);
+  return true;
+}
+
+auto LogSegmentManager::GetEndOffset() -> int {
+  std::scoped_lock lock(latch_);
+  return end_offset_;
+}
+
+void LogSegmentManager::Truncate(int offset) {
+  std::vector<std::pair<int, int>> retired;
+  std::string archive_directory;
+  {
+    std::scoped_lock lock(latch_);
+    int write_index = end_offset_ / capacity_;
+    for (auto it = segments_.begin(); it != segments_.end() && it->first < write_index;) {
+      if ((it->first + 1) * capacity_ > offset) {
+        break;
+      }
+      retired.emplace_back(*it);
+      it = segments_.erase(it);
+    }
+    archive_directory = archive_directory_;
+  }
+  // The retired segments are out of the map, so they are archived or zeroed without holding up appends
+  std::vector<char> zeros;
+  for (auto &[index, fd] : retired) {
+    auto path = SegmentName(index);
+    if (!archive_directory.empty()) {
+      close(fd);
+      auto target = archive_directory + "/" + SplitPath(path).second;
+      if (std::rename(path.c_str(), target.c_str()) != 0) {
+        LOG_DEBUG("I/O error while archiving a log segment");
+      }
+      continue;
+    }
+    {
+      std::scoped_lock lock(latch_);
+      if (spares_.size() >= MAX_SPARE_SEGMENTS) {
+        close(fd);
+        unlink(path.c_str());
+        continue;
+      }
+    }
+    // Stale records must not show up past the end of the log once the file is reused
+    zeros.resize(std::min(segment_size_, 1 << 16));
+    bool zeroed = true;
+    for (int written = 0; written < segment_size_ && zeroed;) {
+      int count = std::min(static_cast<int>(zeros.size()), segment_size_ - written);
+      zeroed = pwrite(fd, zeros.data(), count, written) == count;
+      written += count;
+    }
+    close(fd);
+    if (!zeroed) {
+      unlink(path.c_str());
+      continue;
+    }
+    std::scoped_lock lock(latch_);
+    spares_.push_back(path);
+  }
+}
+
+void LogSegmentManager::SetArchiveDirectory(const std::string &directory) {
+  if (!directory.empty() && mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+    throw Exception("can't create the log archive directory");
+  }
+  std::scoped_lock lock(latch_);
+  archive_directory_ = directory;
+}
+
+auto LogSegmentManager::GetSegmentFileCount() -> size_t {
+  std::scoped_lock lock(latch_);
+  return segments_.size() + spares_.size();
+}
+
+void LogSegmentManager::RemoveSegments(const std::string &log_name) {
+  ForEachSegmentFile(log_name, [](int /*index*/, const std::string &path) { std::remove(path.c_str()); });
+}
+
+}  // namespace bustub
@@ -35,11 +35,53 @@ void TablePage::Init(page_id_t page_id, uint32_t page_size, page_id_t prev_page_
   SetTupleCount(0);
 }
 
+void TablePage::Format(page_id_t page_id, uint32_t page_size, page_id_t prev_page_id) {
+  memcpy(GetData(), &page_id, sizeof(page_id));
+  SetLSN(INVALID_LSN);
+  SetPrevPageId(prev_page_id);
+  SetNextPageId(INVALID_PAGE_ID);
+  SetFreeSpacePointer(page_size);
+  SetTupleCount(0);
+}
+
+auto TablePage::AppendTuples(const std::vector<Tuple> &tuples, size_t begin) -> size_t {
+  auto free_space_pointer = GetFreeSpacePointer();
+  auto tuple_count = GetTupleCount();
+  size_t i = begin;
+  // Fill new slots from the end of the slot array, keeping the header fields in locals until the page is full.
+  for (; i < tuples.size(); i++) {
+    const auto &tuple = tuples[i];
+    BUSTUB_ASSERT(tuple.size_ > 0, "Cannot have empty tuples.");
+    if (free_space_pointer - SIZE_TABLE_PAGE_HEADER - SIZE_TUPLE * tuple_count < tuple.size_ + SIZE_TUPLE) {
+      break;
+    }
+    free_space_pointer -= tuple.size_;
+    memcpy(GetData() + free_space_pointer, tuple.data_, tuple.size_);
+    SetTupleOffsetAtSlot(tuple_count, free_space_pointer);
+    SetTupleSize(tuple_count, tuple.size_);
+    tuple_count++;
+  }
+  SetFreeSpacePointer(free_space_pointer);
+  SetTupleCount(tuple_count);
+  return i;
+}
+
+void TablePage::LogPageImage(Transaction *txn, LogManager *log_manager) {
+  if (enable_logging) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::INSERTPAGE, GetPrevPageId(),
+                         GetTablePageId(), GetTupleCount(), GetData());
+    lsn_t lsn = log_manager->AppendLogRecord(&log_record);
+    SetLSN(lsn);
+    txn->SetPrevLSN(lsn);
+  }
+}
+
 auto TablePage::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, LockManager *lock_manager,
                             LogManager *log_manager) -> bool {
   BUSTUB_ASSERT(tuple.size_ > 0, "Cannot have empty tuples.");
   // If there is not enough space, then return false.
   if (GetFreeSpaceRemaining() < tuple.size_ + SIZE_TUPLE) {
+    rid->Set(INVALID_PAGE_ID, 0);
     return false;
   }
 
@@ -55,9 +97,20 @@ auto TablePage::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, Lock
 
   // If there was no free slot left, and we cannot claim it from the free space, then we give up.
   if (i == GetTupleCount() && GetFreeSpaceRemaining() < tuple.size_ + SIZE_TUPLE) {
+    rid->Set(INVALID_PAGE_ID, 0);
     return false;
   }
 
+  // Acquire an exclusive lock on the new tuple before writing it. The page is latched, so the lock is only taken if
+  // it is granted right away; otherwise the caller waits for it without the latch and tries again.
+  rid->Set(GetTablePageId(), i);
+  if (enable_logging) {
+    BUSTUB_ASSERT(!txn->IsSharedLocked(*rid), "A new tuple should not be locked in shared mode.");
+    if (!lock_manager->TryLockExclusive(txn, *rid)) {
+      return false;
+    }
+  }
+
   // Otherwise we claim available free space..
   SetFreeSpacePointer(GetFreeSpacePointer() - tuple.size_);
   memcpy(GetData() + GetFreeSpacePointer(), tuple.data_, tuple.size_);
@@ -66,17 +119,12 @@ auto TablePage::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, Lock
   SetTupleOffsetAtSlot(i, GetFreeSpacePointer());
   SetTupleSize(i, tuple.size_);
 
-  rid->Set(GetTablePageId(), i);
   if (i == GetTupleCount()) {
     SetTupleCount(GetTupleCount() + 1);
   }
 
   // Write the log record.
   if (enable_logging) {
-    BUSTUB_ASSERT(!txn->IsSharedLocked(*rid) && !txn->IsExclusiveLocked(*rid), "A new tuple should not be locked.");
-    // Acquire an exclusive lock on the new tuple.
-    bool locked = lock_manager->LockExclusive(txn, *rid);
-    BUSTUB_ASSERT(locked, "Locking a new tuple should always work.");
     LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::INSERT, *rid, tuple);
     lsn_t lsn = log_manager->AppendLogRecord(&log_record);
     SetLSN(lsn);
@@ -106,12 +154,9 @@ auto TablePage::MarkDelete(const RID &rid, Transaction *txn, LockManager *lock_m
   }
 
   if (enable_logging) {
-    // Acquire an exclusive lock, upgrading from a shared lock if necessary.
-    if (txn->IsSharedLocked(rid)) {
-      if (!lock_manager->LockUpgrade(txn, rid)) {
-        return false;
-      }
-    } else if (!txn->IsExclusiveLocked(rid) && !lock_manager->LockExclusive(txn, rid)) {
+    // Acquire an exclusive lock, upgrading from a shared lock if necessary. The caller locks the tuple before
+    // latching the page, so this does not wait.
+    if (!lock_manager->TryLockExclusive(txn, rid)) {
       return false;
     }
     Tuple dummy_tuple;
@@ -164,12 +209,9 @@ auto TablePage::UpdateTuple(const Tuple &new_tuple, Tuple *old_tuple, const RID
   old_tuple->allocated_ = true;
 
   if (enable_logging) {
-    // Acquire an exclusive lock, upgrading from shared if necessary.
-    if (txn->IsSharedLocked(rid)) {
-      if (!lock_manager->LockUpgrade(txn, rid)) {
-        return false;
-      }
-    } else if (!txn->IsExclusiveLocked(rid) && !lock_manager->LockExclusive(txn, rid)) {
+    // Acquire an exclusive lock, upgrading from shared if necessary. The caller locks the tuple before latching
+    // the page, so this does not wait.
+    if (!lock_manager->TryLockExclusive(txn, rid)) {
       return false;
     }
     LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::UPDATE, rid, *old_tuple, new_tuple);
@@ -219,7 +261,8 @@ void TablePage::ApplyDelete(const RID &rid, Transaction *txn, LogManager *log_ma
   delete_tuple.allocated_ = true;
 
   if (enable_logging) {
-    BUSTUB_ASSERT(txn->IsExclusiveLocked(rid), "We must own the exclusive lock!");
+    BUSTUB_ASSERT(txn->IsExclusiveLocked(rid) || txn->IsPageExclusiveLocked(rid.GetPageId()),
+                  "We must own the exclusive lock!");
 
     LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::APPLYDELETE, rid, delete_tuple);
     lsn_t lsn = log_manager->AppendLogRecord(&log_record);
@@ -248,7 +291,8 @@ void TablePage::ApplyDelete(const RID &rid, Transaction *txn, LogManager *log_ma
 void TablePage::RollbackDelete(const RID &rid, Transaction *txn, LogManager *log_manager) {
   // Log the rollback.
   if (enable_logging) {
-    BUSTUB_ASSERT(txn->IsExclusiveLocked(rid), "We must own an exclusive lock on the RID.");
+    BUSTUB_ASSERT(txn->IsExclusiveLocked(rid) || txn->IsPageExclusiveLocked(rid.GetPageId()),
+                  "We must own an exclusive lock on the RID.");
     Tuple dummy_tuple;
     LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::ROLLBACKDELETE, rid, dummy_tuple);
     lsn_t lsn = log_manager->AppendLogRecord(&log_record);
@@ -267,6 +311,23 @@ void TablePage::RollbackDelete(const RID &rid, Transaction *txn, LogManager *log
 }
 
 auto TablePage::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockManager *lock_manager) -> bool {
+  Tuple view;
+  if (!GetTupleView(rid, &view, txn, lock_manager)) {
+    return false;
+  }
+  // Copy the tuple data into our result.
+  if (tuple->allocated_) {
+    delete[] tuple->data_;
+  }
+  tuple->size_ = view.size_;
+  tuple->data_ = new char[tuple->size_];
+  memcpy(tuple->data_, view.data_, tuple->size_);
+  tuple->rid_ = rid;
+  tuple->allocated_ = true;
+  return true;
+}
+
+auto TablePage::GetTupleView(const RID &rid, Tuple *tuple, Transaction *txn, LockManager *lock_manager) -> bool {
   // Get the current slot number.
   uint32_t slot_num = rid.GetSlotNum();
   // If somehow we have more slots than tuples, abort the transaction.
@@ -286,23 +347,44 @@ auto TablePage::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockMan
     return false;
   }
 
-  // Otherwise we have a valid tuple, try to acquire at least a shared lock.
-  if (enable_logging) {
-    if (!txn->IsSharedLocked(rid) && !txn->IsExclusiveLocked(rid) && !lock_manager->LockShared(txn, rid)) {
+  // Otherwise we have a valid tuple, try to acquire at least a shared lock. READ_UNCOMMITTED reads take none, and
+  // READ_COMMITTED reads give it back right away: the page latch keeps the tuple from changing under the view.
+  // The page is latched, so the lock is only taken if it is granted right away.
+  if (enable_logging && txn->GetIsolationLevel() != IsolationLevel::READ_UNCOMMITTED &&
+      !txn->IsSharedLocked(rid) && !txn->IsExclusiveLocked(rid)) {
+    if (!lock_manager->TryLockShared(txn, rid)) {
       return false;
     }
+    if (txn->GetIsolationLevel() == IsolationLevel::READ_COMMITTED) {
+      lock_manager->Unlock(txn, rid);
+    }
   }
 
-  // At this point, we have at least a shared lock on the RID. Copy the tuple data into our result.
-  uint32_t tuple_offset = GetTupleOffsetAtSlot(slot_num);
+  // At this point, we have at least a shared lock on the RID. Point the view at the tuple data.
+  if (tuple->allocated_) {
+    delete[] tuple->data_;
+  }
   tuple->size_ = tuple_size;
+  tuple->data_ = GetData() + GetTupleOffsetAtSlot(slot_num);
+  tuple->rid_ = rid;
+  tuple->allocated_ = false;
+  return true;
+}
+
+auto TablePage::GetStoredTupleView(const RID &rid, Tuple *tuple, bool *marked_deleted) -> bool {
+  uint32_t slot_num = rid.GetSlotNum();
+  if (slot_num >= GetTupleCount() || GetTupleSize(slot_num) == 0) {
+    return false;
+  }
+  uint32_t tuple_size = GetTupleSize(slot_num);
+  *marked_deleted = IsDeleted(tuple_size);
   if (tuple->allocated_) {
     delete[] tuple->data_;
   }
-  tuple->data_ = new char[tuple->size_];
-  memcpy(tuple->data_, GetData() + tuple_offset, tuple->size_);
+  tuple->size_ = UnsetDeletedFlag(tuple_size);
+  tuple->data_ = GetData() + GetTupleOffsetAtSlot(slot_num);
   tuple->rid_ = rid;
-  tuple->allocated_ = true;
+  tuple->allocated_ = false;
   return true;
 }
 
@@ -0,0 +1,118 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// free_space_map.cpp
+//
+// Identification: src/storage/table/free_space_map.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/table/free_space_map.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "common/macros.h"
+
+namespace bustub {
+
+namespace {
+
+/** @return the units of free space of a page, rounded down */
+auto FreeCategory(uint32_t free_bytes) -> uint8_t {
+  return static_cast<uint8_t>(std::min<uint32_t>(free_bytes / FreeSpaceMap::CATEGORY_BYTES, UINT8_MAX));
+}
+
+/** @return the units of free space an insert needs, rounded up */
+auto NeededCategory(uint32_t size) -> uint32_t {
+  return (size + FreeSpaceMap::CATEGORY_BYTES - 1) / FreeSpaceMap::CATEGORY_BYTES;
+}
+
+}  // namespace
+
+void FreeSpaceMap::AddPage(page_id_t page_id, uint32_t free_bytes) {
+  std::lock_guard<std::mutex> guard(latch_);
+  size_t pos = page_ids_.size();
+  if (pos == capacity_) {
+    // Double the leaves and rebuild the inner nodes above them.
+    size_t capacity = std::max<size_t>(capacity_ * 2, 64);
+    std::vector<uint8_t> tree(capacity * 2, 0);
+    std::copy(tree_.begin() + capacity_, tree_.begin() + capacity_ * 2, tree.begin() + capacity);
+    for (size_t node = capacity - 1; node > 0; node--) {
+      tree[node] = std::max(tree[node * 2], tree[node * 2 + 1]);
+    }
+    tree_ = std::move(tree);
+    capacity_ = capacity;
+  }
+  page_ids_.push_back(page_id);
+  positions_[page_id] = pos;
+  SetCategory(pos, FreeCategory(free_bytes));
+  targets_[std::this_thread::get_id()] = pos;
+}
+
+void FreeSpaceMap::Update(page_id_t page_id, uint32_t free_bytes) {
+  std::lock_guard<std::mutex> guard(latch_);
+  auto it = positions_.find(page_id);
+  if (it != positions_.end()) {
+    SetCategory(it->second, FreeCategory(free_bytes));
+  }
+}
+
+void FreeSpaceMap::RemovePage(page_id_t page_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  auto it = positions_.find(page_id);
+  if (it != positions_.end()) {
+    // A category of zero is never enough for an insert, so the position is never offered again.
+    SetCategory(it->second, 0);
+    positions_.erase(it);
+  }
+}
+
+auto FreeSpaceMap::FindPage(uint32_t size) -> page_id_t {
+  uint32_t needed = NeededCategory(size);
+  if (needed > UINT8_MAX) {
+    return INVALID_PAGE_ID;
+  }
+  auto category = static_cast<uint8_t>(needed);
+  std::lock_guard<std::mutex> guard(latch_);
+  if (page_ids_.empty() || tree_[1] < category) {
+    return INVALID_PAGE_ID;
+  }
+  // Start from the thread's target; a thread new to this heap starts at a position of its own.
+  auto thread_id = std::this_thread::get_id();
+  auto target = targets_.find(thread_id);
+  size_t start = target != targets_.end() ? target->second
+                                          : std::hash<std::thread::id>{}(thread_id) % page_ids_.size();
+  int64_t pos = FindFrom(1, 0, capacity_, start, category);
+  if (pos < 0) {
+    pos = FindFrom(1, 0, capacity_, 0, category);
+  }
+  BUSTUB_ASSERT(pos >= 0, "The root promised a page with enough free space.");
+  targets_[thread_id] = pos;
+  return page_ids_[pos];
+}
+
+void FreeSpaceMap::SetCategory(size_t pos, uint8_t category) {
+  size_t node = capacity_ + pos;
+  tree_[node] = category;
+  for (node /= 2; node > 0; node /= 2) {
+    tree_[node] = std::max(tree_[node * 2], tree_[node * 2 + 1]);
+  }
+}
+
+auto FreeSpaceMap::FindFrom(size_t node, size_t lo, size_t hi, size_t start, uint8_t category) const -> int64_t {
+  if (hi <= start || tree_[node] < category) {
+    return -1;
+  }
+  if (hi - lo == 1) {
+    return lo;
+  }
+  size_t mid = lo + (hi - lo) / 2;
+  int64_t pos = FindFrom(node * 2, lo, mid, start, category);
+  return pos >= 0 ? pos : FindFrom(node * 2 + 1, mid, hi, start, category);
+}
+
+}  // namespace bustub
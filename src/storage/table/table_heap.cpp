@@ -10,7 +10,9 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 
 #include "common/logger.h"
 #include "storage/table/table_heap.h"
@@ -32,8 +34,11 @@ TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_m
   BUSTUB_ASSERT(first_page != nullptr, "Couldn't create a page for the table heap.");
   first_page->WLatch();
   first_page->Init(first_page_id_, PAGE_SIZE, INVALID_LSN, log_manager_, txn);
+  free_space_.AddPage(first_page_id_, first_page->GetFreeSpaceRemaining());
   first_page->WUnlatch();
   buffer_pool_manager_->UnpinPage(first_page_id_, true);
+  page_ids_.push_back(first_page_id_);
+  directory_loaded_ = true;
 }
 
 auto TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) -> bool {
@@ -42,20 +47,71 @@ auto TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) -> b
     return false;
   }
 
-  auto cur_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(first_page_id_));
+  // New pages are recorded while pages are latched, so the directory must not need a walk by then.
+  LoadPageDirectory();
+
+  // Go straight to a page the free-space map says has room. The map is only corrected after an insert, so a
+  // page may turn out to be fuller than recorded; its entry is then fixed and the map asked again.
+  auto insert_size = TablePage::GetInsertSize(tuple.size_);
+  for (auto page_id = free_space_.FindPage(insert_size); page_id != INVALID_PAGE_ID;
+       page_id = free_space_.FindPage(insert_size)) {
+    auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+    if (page == nullptr) {
+      txn->SetState(TransactionState::ABORTED);
+      return false;
+    }
+    page->WLatch();
+    bool inserted = page->InsertTuple(tuple, rid, txn, lock_manager_, log_manager_);
+    if (inserted && enable_mvcc) {
+      versions_.Record(*rid, txn->GetTransactionId(), nullptr);
+    }
+    free_space_.Update(page_id, page->GetFreeSpaceRemaining());
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, inserted);
+    if (inserted) {
+      txn->GetWriteSet()->emplace_back(*rid, WType::INSERT, Tuple{}, this);
+      return true;
+    }
+    // If the free slot could not be locked right away, wait for it without the latch and try the page again.
+    if (rid->GetPageId() != INVALID_PAGE_ID && !lock_manager_->LockExclusive(txn, *rid)) {
+      return false;
+    }
+  }
+
+  // No page has room, so append one. Start from the last known page; other inserts may append pages meanwhile.
+  page_id_t last_page_id;
+  {
+    std::lock_guard<std::mutex> guard(directory_latch_);
+    last_page_id = page_ids_.back();
+  }
+  auto cur_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(last_page_id));
   if (cur_page == nullptr) {
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
 
   cur_page->WLatch();
-  // Insert into the first page with enough space. If no such page exists, create a new page and insert into that.
+  // Insert into the first page from here with enough space. If no such page exists, create a new page and insert
+  // into that.
   // INVARIANT: cur_page is WLatched if you leave the loop normally.
   while (!cur_page->InsertTuple(tuple, rid, txn, lock_manager_, log_manager_)) {
     auto next_page_id = cur_page->GetNextPageId();
-    // If the next page is a valid page,
-    if (next_page_id != INVALID_PAGE_ID) {
-      // Unlatch and unpin the current page.
+    // If the free slot could not be locked right away, wait for it without the latch and try the page again.
+    if (rid->GetPageId() != INVALID_PAGE_ID) {
+      auto page_id = cur_page->GetTablePageId();
+      cur_page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(page_id, false);
+      if (!lock_manager_->LockExclusive(txn, *rid)) {
+        return false;
+      }
+      cur_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+      if (cur_page == nullptr) {
+        txn->SetState(TransactionState::ABORTED);
+        return false;
+      }
+      cur_page->WLatch();
+    } else if (next_page_id != INVALID_PAGE_ID) {
+      // If the next page is a valid page, unlatch and unpin the current page.
       cur_page->WUnlatch();
       buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), false);
       // And repeat the process with the next page.
@@ -76,6 +132,9 @@ auto TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) -> b
       new_page->WLatch();
       cur_page->SetNextPageId(next_page_id);
       new_page->Init(next_page_id, PAGE_SIZE, cur_page->GetTablePageId(), log_manager_, txn);
+      // Still holding the latch of the old last page, so new pages are recorded in chain order.
+      AppendToPageDirectory(next_page_id);
+      free_space_.AddPage(next_page_id, new_page->GetFreeSpaceRemaining());
       cur_page->WUnlatch();
       buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), true);
       cur_page = new_page;
@@ -83,6 +142,10 @@ auto TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) -> b
   }
   // This line has caused most of us to double-take and "whoa double unlatch".
   // We are not, in fact, double unlatching. See the invariant above.
+  if (enable_mvcc) {
+    versions_.Record(*rid, txn->GetTransactionId(), nullptr);
+  }
+  free_space_.Update(cur_page->GetTablePageId(), cur_page->GetFreeSpaceRemaining());
   cur_page->WUnlatch();
   buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), true);
   // Update the transaction's write set.
@@ -90,8 +153,105 @@ auto TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) -> b
   return true;
 }
 
+auto TableHeap::BulkAppend(const std::vector<Tuple> &tuples, std::vector<RID> *rids, Transaction *txn) -> bool {
+  for (const auto &tuple : tuples) {
+    if (tuple.size_ + 32 > PAGE_SIZE) {  // larger than one page size
+      txn->SetState(TransactionState::ABORTED);
+      return false;
+    }
+  }
+  // New pages are recorded while pages are latched, so the directory must not need a walk by then.
+  LoadPageDirectory();
+
+  rids->clear();
+  rids->reserve(tuples.size());
+  size_t next = 0;
+  while (next < tuples.size()) {
+    page_id_t page_id;
+    auto page = static_cast<TablePage *>(buffer_pool_manager_->NewPage(&page_id));
+    if (page == nullptr) {
+      txn->SetState(TransactionState::ABORTED);
+      return false;
+    }
+    // The page is unreachable until it is linked, so it is filled without logging or locking every tuple.
+    page->WLatch();
+    page->Format(page_id, PAGE_SIZE, INVALID_PAGE_ID);
+    auto begin = next;
+    next = page->AppendTuples(tuples, begin);
+    page->WUnlatch();
+    // Lock the new tuples before linking the page. A lock may wait, e.g. for a page lock on a reused page id, so
+    // the latch is not held; if the transaction is aborted instead, the page is dropped before anyone sees it.
+    bool locked = true;
+    try {
+      for (auto i = begin; locked && enable_logging && i < next; i++) {
+        locked = lock_manager_->LockExclusive(txn, RID(page_id, i - begin));
+      }
+    } catch (...) {
+      buffer_pool_manager_->UnpinPage(page_id, false);
+      buffer_pool_manager_->DeletePage(page_id);
+      throw;
+    }
+    if (!locked) {
+      buffer_pool_manager_->UnpinPage(page_id, false);
+      buffer_pool_manager_->DeletePage(page_id);
+      txn->SetState(TransactionState::ABORTED);
+      return false;
+    }
+    page->WLatch();
+    if (!LinkAppendedPage(page, txn)) {
+      page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(page_id, true);
+      txn->SetState(TransactionState::ABORTED);
+      return false;
+    }
+    for (auto i = begin; i < next; i++) {
+      rids->emplace_back(page_id, i - begin);
+      if (enable_mvcc) {
+        versions_.Record(rids->back(), txn->GetTransactionId(), nullptr);
+      }
+    }
+    free_space_.AddPage(page_id, page->GetFreeSpaceRemaining());
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, true);
+    txn->GetWriteSet()->emplace_back(RID(page_id, next - begin), WType::INSERT_PAGE, Tuple{}, this);
+  }
+  return true;
+}
+
+auto TableHeap::LinkAppendedPage(TablePage *page, Transaction *txn) -> bool {
+  page_id_t last_page_id;
+  {
+    std::lock_guard<std::mutex> guard(directory_latch_);
+    last_page_id = page_ids_.back();
+  }
+  auto last_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(last_page_id));
+  if (last_page == nullptr) {
+    return false;
+  }
+  last_page->WLatch();
+  // Other inserts may have appended pages since the directory was read.
+  while (last_page->GetNextPageId() != INVALID_PAGE_ID) {
+    auto next_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(last_page->GetNextPageId()));
+    last_page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(last_page->GetTablePageId(), false);
+    last_page = next_page;
+    last_page->WLatch();
+  }
+  page->SetPrevPageId(last_page->GetTablePageId());
+  last_page->SetNextPageId(page->GetTablePageId());
+  page->LogPageImage(txn, log_manager_);
+  // Still holding the latch of the old last page, so new pages are recorded in chain order.
+  AppendToPageDirectory(page->GetTablePageId());
+  last_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(last_page->GetTablePageId(), true);
+  return true;
+}
+
 auto TableHeap::MarkDelete(const RID &rid, Transaction *txn) -> bool {
-  // TODO(Amadou): remove empty page
+  // An emptied page stays in the chain for Vacuum() to unlink, since a scan may still be on it.
+  if (!LockForWrite(rid, txn)) {
+    return false;
+  }
   // Find the page which contains the tuple.
   auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
   // If the page could not be found, then abort the transaction.
@@ -101,7 +261,18 @@ auto TableHeap::MarkDelete(const RID &rid, Transaction *txn) -> bool {
   }
   // Otherwise, mark the tuple as deleted.
   page->WLatch();
-  page->MarkDelete(rid, txn, lock_manager_, log_manager_);
+  if (!CheckWriteConflict(rid, txn)) {
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetTablePageId(), false);
+    return false;
+  }
+  if (page->MarkDelete(rid, txn, lock_manager_, log_manager_) && enable_mvcc) {
+    // The data stays in the page until the delete is applied at commit
+    Tuple before;
+    bool marked_deleted;
+    page->GetStoredTupleView(rid, &before, &marked_deleted);
+    versions_.Record(rid, txn->GetTransactionId(), &before);
+  }
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
   // Update the transaction's write set.
@@ -110,6 +281,9 @@ auto TableHeap::MarkDelete(const RID &rid, Transaction *txn) -> bool {
 }
 
 auto TableHeap::UpdateTuple(const Tuple &tuple, const RID &rid, Transaction *txn) -> bool {
+  if (!LockForWrite(rid, txn)) {
+    return false;
+  }
   // Find the page which contains the tuple.
   auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
   // If the page could not be found, then abort the transaction.
@@ -120,7 +294,21 @@ auto TableHeap::UpdateTuple(const Tuple &tuple, const RID &rid, Transaction *txn
   // Update the tuple; but first save the old value for rollbacks.
   Tuple old_tuple;
   page->WLatch();
+  if (!CheckWriteConflict(rid, txn)) {
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetTablePageId(), false);
+    return false;
+  }
   bool is_updated = page->UpdateTuple(tuple, &old_tuple, rid, txn, lock_manager_, log_manager_);
+  if (is_updated && enable_mvcc) {
+    // An aborting transaction updates the tuple back to undo its own update
+    if (txn->GetState() == TransactionState::ABORTED) {
+      versions_.Rollback(rid, txn->GetTransactionId());
+    } else {
+      versions_.Record(rid, txn->GetTransactionId(), &old_tuple);
+    }
+  }
+  free_space_.Update(rid.GetPageId(), page->GetFreeSpaceRemaining());
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetTablePageId(), is_updated);
   // Update the transaction's write set.
@@ -137,7 +325,12 @@ void TableHeap::ApplyDelete(const RID &rid, Transaction *txn) {
   // Delete the tuple from the page.
   page->WLatch();
   page->ApplyDelete(rid, txn, log_manager_);
+  // Rolling back an insert drops its version; a committed delete keeps its version for older snapshots
+  if (enable_mvcc && txn->GetState() == TransactionState::ABORTED) {
+    versions_.Rollback(rid, txn->GetTransactionId());
+  }
   lock_manager_->Unlock(txn, rid);
+  free_space_.Update(rid.GetPageId(), page->GetFreeSpaceRemaining());
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
 }
@@ -149,11 +342,36 @@ void TableHeap::RollbackDelete(const RID &rid, Transaction *txn) {
   // Rollback the delete.
   page->WLatch();
   page->RollbackDelete(rid, txn, log_manager_);
+  if (enable_mvcc) {
+    versions_.Rollback(rid, txn->GetTransactionId());
+  }
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
 }
 
+void TableHeap::RollbackAppend(const RID &rid, Transaction *txn) {
+  auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
+  BUSTUB_ASSERT(page != nullptr, "Couldn't find a page containing that RID.");
+  // The appended tuples hold the first slots of the page; later inserts may have used the ones after them.
+  page->WLatch();
+  for (uint32_t slot = 0; slot < rid.GetSlotNum(); slot++) {
+    RID tuple_rid(rid.GetPageId(), slot);
+    page->ApplyDelete(tuple_rid, txn, log_manager_);
+    if (enable_mvcc) {
+      versions_.Rollback(tuple_rid, txn->GetTransactionId());
+    }
+    lock_manager_->Unlock(txn, tuple_rid);
+  }
+  free_space_.Update(rid.GetPageId(), page->GetFreeSpaceRemaining());
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(rid.GetPageId(), true);
+}
+
 auto TableHeap::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn) -> bool {
+  bool unlock = false;
+  if (!IsSnapshotRead(txn) && !LockForRead(rid, txn, &unlock)) {
+    return false;
+  }
   // Find the page which contains the tuple.
   auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
   // If the page could not be found, then abort the transaction.
@@ -163,32 +381,241 @@ auto TableHeap::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn) -> bool
   }
   // Read the tuple from the page.
   page->RLatch();
-  bool res = page->GetTuple(rid, tuple, txn, lock_manager_);
+  bool res;
+  if (IsSnapshotRead(txn)) {
+    Tuple view;
+    res = GetVisibleTupleView(page, rid, txn, &view);
+    if (res) {
+      *tuple = view;
+      tuple->data_ = new char[tuple->size_];
+      memcpy(tuple->data_, view.data_, tuple->size_);
+      tuple->allocated_ = true;
+    }
+  } else {
+    res = page->GetTuple(rid, tuple, txn, lock_manager_);
+  }
   page->RUnlatch();
   buffer_pool_manager_->UnpinPage(rid.GetPageId(), false);
+  if (unlock) {
+    lock_manager_->Unlock(txn, rid);
+  }
   return res;
 }
 
-auto TableHeap::Begin(Transaction *txn) -> TableIterator {
-  // Start an iterator from the first page.
-  // TODO(Wuwen): Hacky fix for now. Removing empty pages is a better way to handle this.
+auto TableHeap::LockForRead(const RID &rid, Transaction *txn, bool *unlock) -> bool {
+  // The page latch must not be held while waiting: the holder of the lock may need it to commit.
+  if (!enable_logging || txn->GetIsolationLevel() == IsolationLevel::READ_UNCOMMITTED || txn->IsSharedLocked(rid) ||
+      txn->IsExclusiveLocked(rid)) {
+    return true;
+  }
+  if (!lock_manager_->LockShared(txn, rid)) {
+    return false;
+  }
+  *unlock = txn->GetIsolationLevel() == IsolationLevel::READ_COMMITTED;
+  return true;
+}
+
+auto TableHeap::LockForWrite(const RID &rid, Transaction *txn) -> bool {
+  return !enable_logging || lock_manager_->LockExclusive(txn, rid);
+}
+
+void TableHeap::WaitForReadLock(const RID &rid, Transaction *txn) {
+  if (txn->GetState() != TransactionState::ABORTED && lock_manager_->LockShared(txn, rid)) {
+    if (txn->GetIsolationLevel() == IsolationLevel::READ_COMMITTED) {
+      lock_manager_->Unlock(txn, rid);
+    }
+    return;
+  }
+  throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
+}
+
+auto TableHeap::GetVisibleTupleView(TablePage *page, const RID &rid, Transaction *txn, Tuple *tuple) -> bool {
+  bool marked_deleted = false;
+  bool exists = page->GetStoredTupleView(rid, tuple, &marked_deleted) && !marked_deleted;
+  return versions_.GetVisibleVersion(rid, txn, exists, tuple);
+}
+
+void TableHeap::GetVisibleTupleViews(TablePage *page, Transaction *txn, std::vector<Tuple> *views) {
+  // Every slot is looked at, since a snapshot may see a tuple that has since been deleted
+  for (uint32_t slot = 0; slot < page->GetSlotCount(); slot++) {
+    views->emplace_back();
+    if (!GetVisibleTupleView(page, RID(page->GetTablePageId(), slot), txn, &views->back())) {
+      views->pop_back();
+    }
+  }
+}
+
+auto TableHeap::CheckWriteConflict(const RID &rid, Transaction *txn) -> bool {
+  // An aborting transaction only undoes its own writes
+  if (!IsSnapshotRead(txn) || txn->GetState() == TransactionState::ABORTED || !versions_.HasConflict(rid, txn)) {
+    return true;
+  }
+  txn->SetState(TransactionState::ABORTED);
+  return false;
+}
+
+void TableHeap::CommitVersion(const RID &rid, WType wtype, Transaction *txn, timestamp_t watermark) {
+  if (wtype != WType::INSERT_PAGE) {
+    versions_.Commit(rid, txn->GetTransactionId(), txn->GetCommitTs(), watermark);
+    return;
+  }
+  for (uint32_t slot = 0; slot < rid.GetSlotNum(); slot++) {
+    versions_.Commit(RID(rid.GetPageId(), slot), txn->GetTransactionId(), txn->GetCommitTs(), watermark);
+  }
+}
+
+auto TableHeap::GetNextPageId(page_id_t page_id) -> page_id_t {
+  auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  BUSTUB_ASSERT(page != nullptr, "All pages of the table heap must be readable.");
+  page->RLatch();
+  auto next_page_id = page->GetNextPageId();
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(page_id, false);
+  return next_page_id;
+}
+
+auto TableHeap::Vacuum(Transaction *txn,
+                       const std::function<void(const Tuple &, const RID &, const RID &)> &on_move) -> size_t {
+  auto page_ids = GetPageIds();
+  // Two fingers: tuples move from sparse pages at the back to pages with room at the front until they meet.
+  size_t front = 0;
+  TablePage *target = nullptr;
+  auto release_target = [&](bool is_dirty) {
+    if (target != nullptr) {
+      free_space_.Update(target->GetTablePageId(), target->GetFreeSpaceRemaining());
+      target->WUnlatch();
+      buffer_pool_manager_->UnpinPage(target->GetTablePageId(), is_dirty);
+      target = nullptr;
+    }
+  };
+  bool target_dirty = false;
+  for (size_t back = page_ids.size() - 1; back > front; back--) {
+    auto source = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_ids[back]));
+    BUSTUB_ASSERT(source != nullptr, "All pages of the table heap must be readable.");
+    source->WLatch();
+    // Emptied slots are never given back, so the free space of a page understates how sparse it is.
+    bool sparse = source->GetLiveBytes() <= PAGE_SIZE / 2;
+    bool source_dirty = false;
+    RID rid;
+    for (bool found = sparse && !source->HasMarkedTuples() && source->GetFirstTupleRid(&rid); found;
+         found = source->GetNextTupleRid(rid, &rid)) {
+      Tuple tuple;
+      source->GetTuple(rid, &tuple, txn, lock_manager_);
+      RID new_rid;
+      while (front < back) {
+        if (target == nullptr) {
+          target = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_ids[front]));
+          BUSTUB_ASSERT(target != nullptr, "All pages of the table heap must be readable.");
+          target->WLatch();
+          target_dirty = false;
+        }
+        if (target->InsertTuple(tuple, &new_rid, txn, lock_manager_, log_manager_)) {
+          target_dirty = true;
+          break;
+        }
+        release_target(target_dirty);
+        front++;
+      }
+      if (front == back) {
+        break;
+      }
+      source->MarkDelete(rid, txn, lock_manager_, log_manager_);
+      source->ApplyDelete(rid, txn, log_manager_);
+      source_dirty = true;
+      on_move(tuple, rid, new_rid);
+    }
+    free_space_.Update(page_ids[back], source->GetFreeSpaceRemaining());
+    source->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page_ids[back], source_dirty);
+  }
+  release_target(target_dirty);
+
+  size_t deleted = 0;
+  for (auto page_id : page_ids) {
+    if (UnlinkEmptyPage(page_id)) {
+      deleted++;
+    }
+  }
+  return deleted;
+}
+
+auto TableHeap::UnlinkEmptyPage(page_id_t page_id) -> bool {
+  if (page_id == first_page_id_) {
+    return false;
+  }
+  auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  BUSTUB_ASSERT(page != nullptr, "All pages of the table heap must be readable.");
   RID rid;
-  auto page_id = first_page_id_;
-  while (page_id != INVALID_PAGE_ID) {
+  if (page->GetFirstTupleRid(&rid) || page->HasMarkedTuples()) {
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    return false;
+  }
+  auto prev_page_id = page->GetPrevPageId();
+  auto next_page_id = page->GetNextPageId();
+  buffer_pool_manager_->UnpinPage(page_id, false);
+
+  auto prev_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(prev_page_id));
+  BUSTUB_ASSERT(prev_page != nullptr, "All pages of the table heap must be readable.");
+  prev_page->WLatch();
+  prev_page->SetNextPageId(next_page_id);
+  prev_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(prev_page_id, true);
+  if (next_page_id != INVALID_PAGE_ID) {
+    auto next_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(next_page_id));
+    BUSTUB_ASSERT(next_page != nullptr, "All pages of the table heap must be readable.");
+    next_page->WLatch();
+    next_page->SetPrevPageId(prev_page_id);
+    next_page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(next_page_id, true);
+  }
+  // The relinks are not logged, and deleting the page writes its free marker to disk at once, so the chain on
+  // disk must skip the page before it can be handed out again
+  buffer_pool_manager_->FlushPage(prev_page_id);
+  if (next_page_id != INVALID_PAGE_ID) {
+    buffer_pool_manager_->FlushPage(next_page_id);
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(directory_latch_);
+    page_ids_.erase(std::find(page_ids_.begin(), page_ids_.end(), page_id));
+  }
+  free_space_.RemovePage(page_id);
+  buffer_pool_manager_->DeletePage(page_id);
+  return true;
+}
+
+auto TableHeap::GetPageIds() -> std::vector<page_id_t> {
+  LoadPageDirectory();
+  std::lock_guard<std::mutex> guard(directory_latch_);
+  return page_ids_;
+}
+
+void TableHeap::LoadPageDirectory() {
+  std::lock_guard<std::mutex> guard(directory_latch_);
+  if (directory_loaded_) {
+    return;
+  }
+  for (auto page_id = first_page_id_; page_id != INVALID_PAGE_ID;) {
     auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+    BUSTUB_ASSERT(page != nullptr, "All pages of the table heap must be readable.");
     page->RLatch();
-    // If this fails because there is no tuple, then RID will be the default-constructed value, which means EOF.
-    auto found_tuple = page->GetFirstTupleRid(&rid);
+    page_ids_.push_back(page_id);
+    free_space_.AddPage(page_id, page->GetFreeSpaceRemaining());
+    auto next_page_id = page->GetNextPageId();
     page->RUnlatch();
     buffer_pool_manager_->UnpinPage(page_id, false);
-    if (found_tuple) {
-      break;
-    }
-    page_id = page->GetNextPageId();
+    page_id = next_page_id;
   }
-  return TableIterator(this, rid, txn);
+  directory_loaded_ = true;
 }
 
-auto TableHeap::End() -> TableIterator { return TableIterator(this, RID(INVALID_PAGE_ID, 0), nullptr); }
+void TableHeap::AppendToPageDirectory(page_id_t page_id) {
+  std::lock_guard<std::mutex> guard(directory_latch_);
+  page_ids_.push_back(page_id);
+}
+
+auto TableHeap::Begin(Transaction *txn) -> TableIterator { return TableIterator(this, first_page_id_, txn); }
+
+auto TableHeap::End() -> TableIterator { return TableIterator(this, INVALID_PAGE_ID, nullptr); }
 
 }  // namespace bustub
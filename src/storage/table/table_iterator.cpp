@@ -11,56 +11,66 @@
 //===----------------------------------------------------------------------===//
 
 #include <cassert>
+#include <cstring>
 
+#include "common/exception.h"
 #include "storage/table/table_heap.h"
 
 namespace bustub {
 
-TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn)
-    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn) {
-  if (rid.GetPageId() != INVALID_PAGE_ID) {
-    table_heap_->GetTuple(tuple_->rid_, tuple_, txn_);
+TableIterator::TableIterator(TableHeap *table_heap, page_id_t page_id, Transaction *txn)
+    : table_heap_(table_heap), txn_(txn), next_page_id_(page_id) {
+  LoadNextPage();
+}
+
+void TableIterator::LoadNextPage() {
+  // Reuse the buffers of the image unless a copy of this iterator still points into them.
+  if (image_ == nullptr || image_.use_count() > 1) {
+    image_ = std::make_shared<PageImage>();
+  }
+  idx_ = 0;
+  while (next_page_id_ != INVALID_PAGE_ID) {
+    auto page_id = next_page_id_;
+    auto *image = image_.get();
+    bool fetched = table_heap_->ScanPage(page_id, txn_, &image->tuples_, &next_page_id_,
+                                         [image](const std::vector<Tuple> &views) {
+                                           size_t size = 0;
+                                           for (const auto &view : views) {
+                                             size += view.size_;
+                                           }
+                                           image->data_.resize(size);
+                                           size_t offset = 0;
+                                           for (auto &view : image->tuples_) {
+                                             memcpy(image->data_.data() + offset, view.data_, view.size_);
+                                             view.data_ = image->data_.data() + offset;
+                                             offset += view.size_;
+                                           }
+                                         });
+    if (!fetched) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "TableIterator: could not fetch a table page");
+    }
+    if (!image->tuples_.empty()) {
+      return;
+    }
   }
+  image_ = nullptr;
 }
 
 auto TableIterator::operator*() -> const Tuple & {
-  assert(*this != table_heap_->End());
-  return *tuple_;
+  assert(image_ != nullptr);
+  return image_->tuples_[idx_];
 }
 
 auto TableIterator::operator->() -> Tuple * {
-  assert(*this != table_heap_->End());
-  return tuple_;
+  assert(image_ != nullptr);
+  return &image_->tuples_[idx_];
 }
 
 auto TableIterator::operator++() -> TableIterator & {
-  BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
-  auto cur_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId()));
-  cur_page->RLatch();
-  assert(cur_page != nullptr);  // all pages are pinned
-
-  RID next_tuple_rid;
-  if (!cur_page->GetNextTupleRid(tuple_->rid_,
-                                 &next_tuple_rid)) {  // end of this page
-    while (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
-      auto next_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(cur_page->GetNextPageId()));
-      cur_page->RUnlatch();
-      buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
-      cur_page = next_page;
-      cur_page->RLatch();
-      if (cur_page->GetFirstTupleRid(&next_tuple_rid)) {
-        break;
-      }
-    }
-  }
-  tuple_->rid_ = next_tuple_rid;
-
-  if (*this != table_heap_->End()) {
-    table_heap_->GetTuple(tuple_->rid_, tuple_, txn_);
+  assert(image_ != nullptr);
+  if (++idx_ == image_->tuples_.size()) {
+    LoadNextPage();
   }
-  // release until copy the tuple
-  cur_page->RUnlatch();
-  buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
   return *this;
 }
 
@@ -70,4 +80,15 @@ auto TableIterator::operator++(int) -> TableIterator {
   return clone;
 }
 
+auto TableIterator::CopyTuple() const -> Tuple {
+  assert(image_ != nullptr);
+  const auto &view = image_->tuples_[idx_];
+  Tuple tuple(view.rid_);
+  tuple.size_ = view.size_;
+  tuple.data_ = new char[tuple.size_];
+  memcpy(tuple.data_, view.data_, tuple.size_);
+  tuple.allocated_ = true;
+  return tuple;
+}
+
 }  // namespace bustub
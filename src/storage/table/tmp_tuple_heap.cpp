@@ -0,0 +1,98 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// tmp_tuple_heap.cpp
+//
+// Identification: src/storage/table/tmp_tuple_heap.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/table/tmp_tuple_heap.h"
+
+#include "common/exception.h"
+
+namespace bustub {
+
+TmpTupleHeap::~TmpTupleHeap() {
+  Seal();
+  if (read_page_ != nullptr) {
+    bpm_->UnpinPage(page_ids_[read_page_idx_], false);
+  }
+  for (auto page_id : page_ids_) {
+    bpm_->DeletePage(page_id);
+  }
+}
+
+void TmpTupleHeap::Append(const Tuple &tuple) {
+  if (tuple.GetLength() > TmpTuplePage::MAX_TUPLE_SIZE) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "tuple is too large to be spilled");
+  }
+  TmpTuple location{INVALID_PAGE_ID, 0};
+  if (write_page_ == nullptr || !write_page_->Insert(tuple, &location)) {
+    Seal();
+    page_id_t page_id;
+    auto *page = bpm_->NewPage(&page_id);
+    if (page == nullptr) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "no free frame for a spill page");
+    }
+    write_page_ = reinterpret_cast<TmpTuplePage *>(page);
+    write_page_->Init(page_id, PAGE_SIZE);
+    page_ids_.push_back(page_id);
+    write_page_->Insert(tuple, &location);
+  }
+  tuple_count_++;
+}
+
+void TmpTupleHeap::Seal() {
+  if (write_page_ != nullptr) {
+    bpm_->UnpinPage(page_ids_.back(), true);
+    write_page_ = nullptr;
+  }
+}
+
+void TmpTupleHeap::Rewind() {
+  BUSTUB_ASSERT(write_page_ == nullptr, "Seal() the heap before reading it.");
+  if (read_page_ != nullptr) {
+    bpm_->UnpinPage(page_ids_[read_page_idx_], false);
+    read_page_ = nullptr;
+  }
+  read_page_idx_ = 0;
+  read_offsets_.clear();
+}
+
+auto TmpTupleHeap::Next(Tuple *tuple) -> bool {
+  while (true) {
+    if (read_page_ == nullptr) {
+      if (read_page_idx_ >= page_ids_.size()) {
+        return false;
+      }
+      read_page_ = FetchTmpPage(read_page_idx_);
+      // A page fills from its end, so the newest tuple comes first; collect the offsets to read it backwards
+      read_offsets_.clear();
+      for (auto offset = read_page_->GetFreeSpacePointer(); offset < PAGE_SIZE;
+           offset = read_page_->NextOffset(offset)) {
+        read_offsets_.push_back(offset);
+      }
+    }
+    if (!read_offsets_.empty()) {
+      read_page_->Get(read_offsets_.back(), tuple);
+      read_offsets_.pop_back();
+      return true;
+    }
+    bpm_->UnpinPage(page_ids_[read_page_idx_++], false);
+    read_page_ = nullptr;
+  }
+}
+
+auto TmpTupleHeap::FetchTmpPage(size_t idx) -> TmpTuplePage * {
+  auto *page = bpm_->FetchPage(page_ids_[idx]);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "no free frame to read a spill page");
+  }
+  return reinterpret_cast<TmpTuplePage *>(page);
+}
+
+}  // namespace bustub
@@ -0,0 +1,138 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// version_store.cpp
+//
+// Identification: src/storage/table/version_store.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/table/version_store.h"
+
+#include <cstring>
+#include <iterator>
+#include <mutex>  // NOLINT
+
+namespace bustub {
+
+void VersionStore::Record(const RID &rid, txn_id_t writer, const Tuple *before) {
+  std::unique_lock lock(latch_);
+  auto &chain = chains_[rid];
+  if (chain.empty()) {
+    chain_count_++;
+  }
+  Tuple image;
+  if (before != nullptr) {
+    // The image must outlive the page data it may point to
+    image.size_ = before->size_;
+    image.data_ = new char[image.size_];
+    memcpy(image.data_, before->data_, image.size_);
+    image.rid_ = rid;
+    image.allocated_ = true;
+  }
+  chain.push_back({writer, INVALID_TS, before != nullptr, std::move(image)});
+}
+
+void VersionStore::Rollback(const RID &rid, txn_id_t writer) {
+  std::unique_lock lock(latch_);
+  auto chain = chains_.find(rid);
+  if (chain == chains_.end()) {
+    return;
+  }
+  auto &versions = chain->second;
+  for (auto version = versions.rbegin(); version != versions.rend(); ++version) {
+    if (version->writer_ == writer && version->commit_ts_ == INVALID_TS) {
+      versions.erase(std::next(version).base());
+      break;
+    }
+  }
+  if (versions.empty()) {
+    chains_.erase(chain);
+    chain_count_--;
+  }
+}
+
+void VersionStore::Commit(const RID &rid, txn_id_t writer, timestamp_t commit_ts, timestamp_t watermark) {
+  std::unique_lock lock(latch_);
+  auto chain = chains_.find(rid);
+  if (chain != chains_.end()) {
+    for (auto &version : chain->second) {
+      if (version.writer_ == writer && version.commit_ts_ == INVALID_TS) {
+        version.commit_ts_ = commit_ts;
+      }
+    }
+    committed_.emplace_back(commit_ts, rid);
+  }
+  while (!committed_.empty() && committed_.front().first <= watermark) {
+    Prune(committed_.front().second, watermark);
+    committed_.pop_front();
+  }
+}
+
+void VersionStore::Prune(const RID &rid, timestamp_t watermark) {
+  auto chain = chains_.find(rid);
+  if (chain == chains_.end()) {
+    return;
+  }
+  auto &versions = chain->second;
+  // Every running snapshot sees the newest such write, and reads the tuple as it or a newer write left it
+  size_t seen_by_all = 0;
+  for (size_t i = 0; i < versions.size(); i++) {
+    if (versions[i].commit_ts_ != INVALID_TS && versions[i].commit_ts_ <= watermark) {
+      seen_by_all = i + 1;
+    }
+  }
+  versions.erase(versions.begin(), versions.begin() + seen_by_all);
+  if (versions.empty()) {
+    chains_.erase(chain);
+    chain_count_--;
+  }
+}
+
+auto VersionStore::GetVisibleVersion(const RID &rid, Transaction *txn, bool exists, Tuple *tuple) -> bool {
+  if (chain_count_ == 0) {
+    return exists;
+  }
+  std::shared_lock lock(latch_);
+  auto chain = chains_.find(rid);
+  if (chain == chains_.end()) {
+    return exists;
+  }
+  const auto &versions = chain->second;
+  // The state the newest write the snapshot sees left the tuple in: the page, or the undo image of the next write
+  auto newest_seen = versions.size();
+  while (newest_seen > 0 && !IsVisible(versions[newest_seen - 1], txn)) {
+    newest_seen--;
+  }
+  if (newest_seen == versions.size()) {
+    return exists;
+  }
+  const auto &next = versions[newest_seen];
+  if (!next.existed_) {
+    return false;
+  }
+  if (tuple->allocated_) {
+    delete[] tuple->data_;
+  }
+  tuple->size_ = next.before_.size_;
+  tuple->data_ = next.before_.data_;
+  tuple->rid_ = rid;
+  tuple->allocated_ = false;
+  return true;
+}
+
+auto VersionStore::HasConflict(const RID &rid, Transaction *txn) -> bool {
+  if (chain_count_ == 0) {
+    return false;
+  }
+  std::shared_lock lock(latch_);
+  auto chain = chains_.find(rid);
+  return chain != chains_.end() && !IsVisible(chain->second.back(), txn);
+}
+
+auto VersionStore::GetChainCount() -> size_t { return chain_count_; }
+
+}  // namespace bustub
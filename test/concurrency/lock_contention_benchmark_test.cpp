@@ -0,0 +1,138 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lock_contention_benchmark_test.cpp
+//
+// Identification: test/concurrency/lock_contention_benchmark_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <random>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "common/config.h"
+#include "concurrency/lock_manager.h"
+#include "concurrency/transaction_manager.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+/**
+ * Run short transactions that each lock a few rows, two of them from a small set of hot rows, from several threads,
+ * under both deadlock policies. The rows are locked in random order, so transactions deadlock.
+ */
+class LockContentionBenchmark : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    saved_interval_ = cycle_detection_interval;
+    cycle_detection_interval = std::chrono::milliseconds(5);
+  }
+
+  void TearDown() override { cycle_detection_interval = saved_interval_; }
+
+  /** Threads running transactions */
+  static constexpr int THREADS = 8;
+  /** Rows every transaction's first locks are on */
+  static constexpr int HOT_ROWS = 8;
+  /** Locks per transaction on hot rows */
+  static constexpr int HOT_LOCKS_PER_TXN = 2;
+  /** Rows the other locks are on */
+  static constexpr int COLD_ROWS = 1024;
+  /** Locks per transaction */
+  static constexpr int LOCKS_PER_TXN = 4;
+  /** How long each policy runs */
+  static constexpr std::chrono::milliseconds DURATION{300};
+
+  /** The detection interval of the other tests */
+  std::chrono::milliseconds saved_interval_;
+
+  struct Result {
+    size_t commits_;
+    size_t aborts_;
+  };
+
+  /**
+   * Run the workload against a lock manager with the given policy.
+   * @param disjoint if `true`, every thread locks rows of its own, so the transactions never conflict
+   */
+  static auto Run(DeadlockPolicy policy, bool disjoint = false) -> Result {
+    LockManager lock_mgr{policy};
+    TransactionManager txn_mgr{&lock_mgr};
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> commits{0};
+    std::atomic<size_t> aborts{0};
+
+    auto worker = [&](int thread_id) {
+      std::mt19937 generator(thread_id);
+      while (!stop) {
+        Transaction *txn = txn_mgr.Begin();
+        try {
+          for (int i = 0; i < LOCKS_PER_TXN && txn->GetState() != TransactionState::ABORTED; i++) {
+            RID rid = i < HOT_LOCKS_PER_TXN ? RID(0, generator() % HOT_ROWS) : RID(1, generator() % COLD_ROWS);
+            if (disjoint) {
+              rid = RID(thread_id + 2, generator() % COLD_ROWS);
+            }
+            // A quarter of the locks are shared
+            if (generator() % 4 == 0) {
+              lock_mgr.LockShared(txn, rid);
+            } else {
+              lock_mgr.LockExclusive(txn, rid);
+            }
+          }
+        } catch (TransactionAbortException &e) {
+          // Two transactions upgrading the same row
+        }
+        if (txn->GetState() == TransactionState::ABORTED) {
+          txn_mgr.Abort(txn);
+          aborts++;
+        } else {
+          txn_mgr.Commit(txn);
+          commits++;
+        }
+        delete txn;
+      }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < THREADS; i++) {
+      threads.emplace_back(worker, i);
+    }
+    std::this_thread::sleep_for(DURATION);
+    stop = true;
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    return {commits, aborts};
+  }
+};
+
+// NOLINTNEXTLINE
+TEST_F(LockContentionBenchmark, HotRows) {
+  auto detection = Run(DeadlockPolicy::DETECTION);
+  auto wound_wait = Run(DeadlockPolicy::WOUND_WAIT);
+  auto per_second = [](size_t count) { return static_cast<double>(count) * 1000 / DURATION.count(); };
+  std::printf("lock contention, %d threads, %d hot rows: detection %.0f commits/s, %.0f aborts/s; "  // NOLINT
+              "wound-wait %.0f commits/s, %.0f aborts/s\n",
+              THREADS, HOT_ROWS, per_second(detection.commits_), per_second(detection.aborts_),
+              per_second(wound_wait.commits_), per_second(wound_wait.aborts_));
+  // Both policies keep the workload moving
+  EXPECT_GT(detection.commits_, 0);
+  EXPECT_GT(wound_wait.commits_, 0);
+}
+
+// NOLINTNEXTLINE
+TEST_F(LockContentionBenchmark, DisjointRows) {
+  auto result = Run(DeadlockPolicy::DETECTION, true);
+  std::printf("lock throughput, %d threads on disjoint rows: %.0f commits/s\n", THREADS,  // NOLINT
+              static_cast<double>(result.commits_) * 1000 / DURATION.count());
+  EXPECT_EQ(0, result.aborts_);
+}
+
+}  // namespace bustub
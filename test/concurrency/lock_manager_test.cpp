@@ -2,6 +2,9 @@
  * lock_manager_test.cpp
  */
 
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <future>  // NOLINT
 #include <random>
 #include <thread>  // NOLINT
 
@@ -77,7 +80,7 @@ void BasicTest1() {
     delete txns[i];
   }
 }
-TEST(LockManagerTest, DISABLED_BasicTest) { BasicTest1(); }
+TEST(LockManagerTest, BasicTest) { BasicTest1(); }
 
 void TwoPLTest() {
   LockManager lock_mgr{};
@@ -123,7 +126,7 @@ void TwoPLTest() {
 
   delete txn;
 }
-TEST(LockManagerTest, DISABLED_TwoPLTest) { TwoPLTest(); }
+TEST(LockManagerTest, TwoPLTest) { TwoPLTest(); }
 
 void UpgradeTest() {
   LockManager lock_mgr{};
@@ -150,10 +153,10 @@ void UpgradeTest() {
   txn_mgr.Commit(&txn);
   CheckCommitted(&txn);
 }
-TEST(LockManagerTest, DISABLED_UpgradeLockTest) { UpgradeTest(); }
+TEST(LockManagerTest, UpgradeLockTest) { UpgradeTest(); }
 
 void WoundWaitBasicTest() {
-  LockManager lock_mgr{};
+  LockManager lock_mgr{DeadlockPolicy::WOUND_WAIT};
   TransactionManager txn_mgr{&lock_mgr};
   RID rid{0, 0};
 
@@ -202,6 +205,338 @@ void WoundWaitBasicTest() {
   txn_mgr.Commit(&txn_hold);
   CheckCommitted(&txn_hold);
 }
-TEST(LockManagerTest, DISABLED_WoundWaitBasicTest) { WoundWaitBasicTest(); }
+TEST(LockManagerTest, WoundWaitBasicTest) { WoundWaitBasicTest(); }
+
+// Shared requests behind a waiting exclusive request wait for it, and upgrades jump ahead of waiters
+void QueueOrderTest() {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  RID rid{0, 0};
+  Transaction txn0(0);
+  Transaction txn1(1);
+  Transaction txn2(2);
+  txn_mgr.Begin(&txn0);
+  txn_mgr.Begin(&txn1);
+  txn_mgr.Begin(&txn2);
+
+  EXPECT_TRUE(lock_mgr.LockShared(&txn0, rid));
+  std::atomic<bool> exclusive_granted{false};
+  std::atomic<bool> shared_granted{false};
+  std::thread writer([&] {
+    EXPECT_TRUE(lock_mgr.LockExclusive(&txn1, rid));
+    exclusive_granted = true;
+    txn_mgr.Commit(&txn1);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  std::thread reader([&] {
+    EXPECT_TRUE(lock_mgr.LockShared(&txn2, rid));
+    // The writer was queued first
+    EXPECT_TRUE(exclusive_granted);
+    shared_granted = true;
+    txn_mgr.Commit(&txn2);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(exclusive_granted);
+  EXPECT_FALSE(shared_granted);
+
+  // The upgrade is granted ahead of both waiters
+  EXPECT_TRUE(lock_mgr.LockUpgrade(&txn0, rid));
+  CheckTxnLockSize(&txn0, 0, 1);
+  EXPECT_FALSE(exclusive_granted);
+  txn_mgr.Commit(&txn0);
+  writer.join();
+  reader.join();
+  EXPECT_TRUE(shared_granted);
+}
+TEST(LockManagerTest, QueueOrderTest) { QueueOrderTest(); }
+
+// Shared locks follow the isolation level
+void IsolationLevelTest() {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  RID rid{0, 0};
+
+  auto *read_committed = txn_mgr.Begin(nullptr, IsolationLevel::READ_COMMITTED);
+  EXPECT_TRUE(lock_mgr.LockShared(read_committed, rid));
+  EXPECT_TRUE(lock_mgr.Unlock(read_committed, rid));
+  // Releasing a shared lock early does not end the growing phase
+  CheckGrowing(read_committed);
+  EXPECT_TRUE(lock_mgr.LockExclusive(read_committed, rid));
+  EXPECT_TRUE(lock_mgr.Unlock(read_committed, rid));
+  CheckShrinking(read_committed);
+  txn_mgr.Commit(read_committed);
+  delete read_committed;
+
+  auto *read_uncommitted = txn_mgr.Begin(nullptr, IsolationLevel::READ_UNCOMMITTED);
+  EXPECT_THROW(lock_mgr.LockShared(read_uncommitted, rid), TransactionAbortException);
+  CheckAborted(read_uncommitted);
+  txn_mgr.Abort(read_uncommitted);
+  delete read_uncommitted;
+}
+TEST(LockManagerTest, IsolationLevelTest) { IsolationLevelTest(); }
+
+void IntentionLockTest() {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  table_oid_t oid = 0;
+  Transaction txn0(0);
+  Transaction txn1(1);
+  Transaction txn2(2);
+  txn_mgr.Begin(&txn0);
+  txn_mgr.Begin(&txn1);
+  txn_mgr.Begin(&txn2);
+
+  // Intention locks of different kinds are compatible
+  EXPECT_TRUE(lock_mgr.LockTable(&txn0, LockMode::INTENTION_EXCLUSIVE, oid));
+  EXPECT_TRUE(lock_mgr.LockTable(&txn1, LockMode::INTENTION_SHARED, oid));
+  std::atomic<bool> shared_granted{false};
+  std::thread reader([&] {
+    EXPECT_TRUE(lock_mgr.LockTable(&txn2, LockMode::SHARED, oid));
+    shared_granted = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  // SHARED waits for the writer's INTENTION_EXCLUSIVE
+  EXPECT_FALSE(shared_granted);
+  txn_mgr.Commit(&txn0);
+  reader.join();
+  EXPECT_TRUE(shared_granted);
+  EXPECT_EQ(0, txn0.GetTableLockSet()->size());
+
+  // SHARED and INTENTION_EXCLUSIVE make SHARED_INTENTION_EXCLUSIVE, which still lets INTENTION_SHARED in
+  EXPECT_TRUE(lock_mgr.LockTable(&txn2, LockMode::INTENTION_EXCLUSIVE, oid));
+  EXPECT_EQ(LockMode::SHARED_INTENTION_EXCLUSIVE, txn2.GetTableLockSet()->at(oid));
+  EXPECT_TRUE(lock_mgr.LockTable(&txn2, LockMode::SHARED, oid));
+  EXPECT_EQ(LockMode::SHARED_INTENTION_EXCLUSIVE, txn2.GetTableLockSet()->at(oid));
+  txn_mgr.Commit(&txn1);
+  txn_mgr.Commit(&txn2);
+
+  EXPECT_TRUE(LockManager::Covers(LockMode::SHARED_INTENTION_EXCLUSIVE, LockMode::INTENTION_EXCLUSIVE));
+  EXPECT_FALSE(LockManager::Covers(LockMode::INTENTION_EXCLUSIVE, LockMode::SHARED));
+  EXPECT_TRUE(LockManager::AreCompatible(LockMode::INTENTION_SHARED, LockMode::SHARED_INTENTION_EXCLUSIVE));
+  EXPECT_FALSE(LockManager::AreCompatible(LockMode::SHARED, LockMode::INTENTION_EXCLUSIVE));
+
+  auto *read_uncommitted = txn_mgr.Begin(nullptr, IsolationLevel::READ_UNCOMMITTED);
+  EXPECT_TRUE(lock_mgr.LockTable(read_uncommitted, LockMode::INTENTION_EXCLUSIVE, oid));
+  EXPECT_THROW(lock_mgr.LockTable(read_uncommitted, LockMode::INTENTION_SHARED, oid), TransactionAbortException);
+  CheckAborted(read_uncommitted);
+  txn_mgr.Abort(read_uncommitted);
+  delete read_uncommitted;
+}
+TEST(LockManagerTest, IntentionLockTest) { IntentionLockTest(); }
+
+void LockEscalationTest() {
+  const uint32_t threshold = 4;
+  LockManager lock_mgr{DeadlockPolicy::DETECTION, threshold};
+  TransactionManager txn_mgr{&lock_mgr};
+  Transaction txn0(0);
+  Transaction txn1(1);
+  txn_mgr.Begin(&txn0);
+  txn_mgr.Begin(&txn1);
+
+  // Row locks take an intention lock on their page
+  for (uint32_t slot = 0; slot < threshold; slot++) {
+    EXPECT_TRUE(lock_mgr.LockShared(&txn0, RID{0, slot}));
+  }
+  CheckTxnLockSize(&txn0, threshold, 0);
+  EXPECT_EQ(LockMode::INTENTION_SHARED, txn0.GetPageLockSet()->at(0));
+  // One more row locks the page instead
+  EXPECT_TRUE(lock_mgr.LockShared(&txn0, RID{0, threshold}));
+  CheckTxnLockSize(&txn0, 0, 0);
+  EXPECT_EQ(LockMode::SHARED, txn0.GetPageLockSet()->at(0));
+  EXPECT_TRUE(lock_mgr.LockShared(&txn0, RID{0, 100}));
+  CheckTxnLockSize(&txn0, 0, 0);
+
+  // Another reader gets in; a writer of a row on the page waits for the page lock
+  EXPECT_TRUE(lock_mgr.LockShared(&txn1, RID{0, 0}));
+  std::atomic<bool> exclusive_granted{false};
+  Transaction txn2(2);
+  txn_mgr.Begin(&txn2);
+  std::thread writer([&] {
+    EXPECT_TRUE(lock_mgr.LockExclusive(&txn2, RID{0, 200}));
+    exclusive_granted = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(exclusive_granted);
+
+  // Writing rows under the shared page lock makes it SHARED_INTENTION_EXCLUSIVE, then EXCLUSIVE
+  EXPECT_TRUE(lock_mgr.LockExclusive(&txn0, RID{1, 0}));
+  EXPECT_EQ(LockMode::INTENTION_EXCLUSIVE, txn0.GetPageLockSet()->at(1));
+  txn_mgr.Commit(&txn1);
+  for (uint32_t slot = 0; slot < threshold; slot++) {
+    EXPECT_TRUE(lock_mgr.LockExclusive(&txn0, RID{0, slot}));
+  }
+  CheckTxnLockSize(&txn0, 0, threshold + 1);
+  EXPECT_EQ(LockMode::SHARED_INTENTION_EXCLUSIVE, txn0.GetPageLockSet()->at(0));
+  EXPECT_TRUE(lock_mgr.LockExclusive(&txn0, RID{0, threshold}));
+  CheckTxnLockSize(&txn0, 0, 1);
+  EXPECT_EQ(LockMode::EXCLUSIVE, txn0.GetPageLockSet()->at(0));
+  EXPECT_TRUE(txn0.IsPageExclusiveLocked(0));
+  EXPECT_FALSE(exclusive_granted);
+
+  txn_mgr.Commit(&txn0);
+  EXPECT_EQ(0, txn0.GetPageLockSet()->size());
+  writer.join();
+  EXPECT_TRUE(exclusive_granted);
+  txn_mgr.Commit(&txn2);
+}
+TEST(LockManagerTest, LockEscalationTest) { LockEscalationTest(); }
+
+// A granted request behind a waiting one, as page queues get when a reader comes in behind a waiting escalation,
+// keeps an upgrade ahead of both from being granted
+void UpgradePastGrantedTest() {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  Transaction txn1(1);
+  Transaction txn2(2);
+  Transaction txn3(3);
+  txn_mgr.Begin(&txn1);
+  txn_mgr.Begin(&txn2);
+  txn_mgr.Begin(&txn3);
+  const table_oid_t oid = 0;
+
+  // [IX txn1 granted, S txn2 waiting, IS txn3 granted]
+  EXPECT_TRUE(lock_mgr.LockTable(&txn1, LockMode::INTENTION_EXCLUSIVE, oid));
+  std::atomic<bool> shared_granted{false};
+  std::thread reader([&] {
+    EXPECT_TRUE(lock_mgr.LockTable(&txn2, LockMode::SHARED, oid));
+    shared_granted = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(shared_granted);
+  EXPECT_TRUE(lock_mgr.LockTable(&txn3, LockMode::INTENTION_SHARED, oid));
+
+  // Nothing is ahead of txn1, but txn3 still holds its lock
+  std::atomic<bool> exclusive_granted{false};
+  std::thread writer([&] {
+    EXPECT_TRUE(lock_mgr.LockTable(&txn1, LockMode::EXCLUSIVE, oid));
+    exclusive_granted = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(exclusive_granted);
+
+  txn_mgr.Commit(&txn3);
+  writer.join();
+  EXPECT_TRUE(exclusive_granted);
+  EXPECT_FALSE(shared_granted);
+  txn_mgr.Commit(&txn1);
+  reader.join();
+  EXPECT_TRUE(shared_granted);
+  txn_mgr.Commit(&txn2);
+}
+TEST(LockManagerTest, UpgradePastGrantedTest) { UpgradePastGrantedTest(); }
+
+void TryLockTest() {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  Transaction txn0(0);
+  Transaction txn1(1);
+  Transaction txn2(2);
+  txn_mgr.Begin(&txn0);
+  txn_mgr.Begin(&txn1);
+  txn_mgr.Begin(&txn2);
+  RID written{0, 0};
+  RID read{0, 1};
+
+  // A lock that would have to wait is not taken, and the transaction goes on
+  EXPECT_TRUE(lock_mgr.LockExclusive(&txn0, written));
+  EXPECT_FALSE(lock_mgr.TryLockShared(&txn1, written));
+  EXPECT_FALSE(lock_mgr.TryLockExclusive(&txn1, written));
+  CheckGrowing(&txn1);
+  CheckTxnLockSize(&txn1, 0, 0);
+
+  // An upgrade that would have to wait keeps the shared lock
+  EXPECT_TRUE(lock_mgr.TryLockShared(&txn1, read));
+  EXPECT_TRUE(lock_mgr.LockShared(&txn2, read));
+  EXPECT_FALSE(lock_mgr.TryLockExclusive(&txn1, read));
+  CheckGrowing(&txn1);
+  CheckTxnLockSize(&txn1, 1, 0);
+
+  // A request that breaks the protocol is refused without throwing; the waiting request then aborts
+  EXPECT_TRUE(lock_mgr.Unlock(&txn2, read));
+  CheckShrinking(&txn2);
+  EXPECT_FALSE(lock_mgr.TryLockShared(&txn2, written));
+  CheckShrinking(&txn2);
+  EXPECT_THROW(lock_mgr.LockShared(&txn2, written), TransactionAbortException);
+  CheckAborted(&txn2);
+
+  // Once the holders are gone, the locks are granted right away
+  txn_mgr.Commit(&txn0);
+  EXPECT_TRUE(lock_mgr.TryLockExclusive(&txn1, read));
+  EXPECT_TRUE(lock_mgr.TryLockShared(&txn1, written));
+  CheckTxnLockSize(&txn1, 1, 1);
+  txn_mgr.Commit(&txn1);
+  txn_mgr.Abort(&txn2);
+}
+TEST(LockManagerTest, TryLockTest) { TryLockTest(); }
+
+// NOLINTNEXTLINE
+TEST(LockManagerTest, GraphTest) {
+  // No detection thread rebuilding the graph under the test
+  LockManager lock_mgr{DeadlockPolicy::WOUND_WAIT};
+  txn_id_t victim;
+  lock_mgr.AddEdge(0, 1);
+  lock_mgr.AddEdge(1, 2);
+  EXPECT_FALSE(lock_mgr.HasCycle(&victim));
+  lock_mgr.AddEdge(2, 0);
+  lock_mgr.AddEdge(3, 2);
+  EXPECT_EQ(4, lock_mgr.GetEdgeList().size());
+  EXPECT_TRUE(lock_mgr.HasCycle(&victim));
+  // The youngest transaction in the cycle, not the one waiting into it
+  EXPECT_EQ(2, victim);
+  lock_mgr.RemoveEdge(1, 2);
+  EXPECT_FALSE(lock_mgr.HasCycle(&victim));
+}
+
+// Two transactions locking two rows in opposite orders: the detector aborts the younger one
+void DeadlockDetectionTest() {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  RID rid0{0, 0};
+  RID rid1{0, 1};
+  Transaction txn0(0);
+  Transaction txn1(1);
+  txn_mgr.Begin(&txn0);
+  txn_mgr.Begin(&txn1);
+
+  EXPECT_TRUE(lock_mgr.LockExclusive(&txn0, rid0));
+  EXPECT_TRUE(lock_mgr.LockShared(&txn1, rid1));
+  std::thread younger([&] {
+    EXPECT_FALSE(lock_mgr.LockExclusive(&txn1, rid0));
+    CheckAborted(&txn1);
+    txn_mgr.Abort(&txn1);
+  });
+  EXPECT_TRUE(lock_mgr.LockExclusive(&txn0, rid1));
+  younger.join();
+  CheckGrowing(&txn0);
+  txn_mgr.Commit(&txn0);
+}
+TEST(LockManagerTest, DeadlockDetectionTest) { DeadlockDetectionTest(); }
+
+// Under wound-wait, the older transaction takes the lock a younger one waits for, and the younger one waits
+void WoundWaitDeadlockTest() {
+  LockManager lock_mgr{DeadlockPolicy::WOUND_WAIT};
+  TransactionManager txn_mgr{&lock_mgr};
+  RID rid0{0, 0};
+  RID rid1{0, 1};
+  Transaction txn0(0);
+  Transaction txn1(1);
+  txn_mgr.Begin(&txn0);
+  txn_mgr.Begin(&txn1);
+
+  EXPECT_TRUE(lock_mgr.LockExclusive(&txn0, rid0));
+  EXPECT_TRUE(lock_mgr.LockExclusive(&txn1, rid1));
+  std::thread younger([&] {
+    // Waits for the older transaction, until it is wounded
+    EXPECT_FALSE(lock_mgr.LockExclusive(&txn1, rid0));
+    CheckAborted(&txn1);
+    txn_mgr.Abort(&txn1);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_TRUE(lock_mgr.LockExclusive(&txn0, rid1));
+  younger.join();
+  CheckGrowing(&txn0);
+  txn_mgr.Commit(&txn0);
+}
+TEST(LockManagerTest, WoundWaitDeadlockTest) { WoundWaitDeadlockTest(); }
 
 }  // namespace bustub
@@ -10,6 +10,10 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <future>  // NOLINT
 #include <memory>
 #include <numeric>
 #include <string>
@@ -19,20 +23,31 @@
 
 #include "buffer/buffer_pool_manager_instance.h"
 #include "concurrency/transaction_manager.h"
+#include "execution/bloom_filter.h"
 #include "execution/execution_engine.h"
 #include "execution/executor_context.h"
+#include "execution/executor_factory.h"
+#include "execution/expression_program.h"
+#include "execution/morsel_queue.h"
+#include "execution/task_scheduler.h"
 #include "execution/executors/aggregation_executor.h"
+#include "execution/executors/exchange_executor.h"
+#include "execution/executors/hash_join_executor.h"
 #include "execution/executors/insert_executor.h"
 #include "execution/executors/nested_loop_join_executor.h"
+#include "execution/executors/sort_executor.h"
+#include "execution/tuple_batch.h"
 #include "execution/expressions/aggregate_value_expression.h"
 #include "execution/expressions/column_value_expression.h"
 #include "execution/expressions/comparison_expression.h"
 #include "execution/expressions/constant_value_expression.h"
 #include "execution/plans/delete_plan.h"
 #include "execution/plans/distinct_plan.h"
+#include "execution/plans/exchange_plan.h"
 #include "execution/plans/hash_join_plan.h"
 #include "execution/plans/limit_plan.h"
 #include "execution/plans/seq_scan_plan.h"
+#include "execution/plans/sort_plan.h"
 #include "execution/plans/update_plan.h"
 #include "executor_test_util.h"  // NOLINT
 #include "gtest/gtest.h"
@@ -53,8 +68,14 @@
  * - Nested Loop Join
  * - Hash Join
  * - Aggregation
+ * - Parallel Aggregation
+ * - Spilling Aggregation
+ * - Sort (external and Top-N)
  * - Limit
+ * - Exchange (morsel-driven parallel scans)
  * - Distinct
+ * - Batch (NextBatch) execution
+ * - Bloom filter pushdown
  *
  * Each of the tests demonstrates how to construct a query plan for
  * a particular executors. Students should be able to learn from and
@@ -87,7 +108,7 @@ using ComparatorType = GenericComparator<8>;
 using HashFunctionType = HashFunction<KeyType>;
 
 // SELECT col_a, col_b FROM test_1 WHERE col_a < 500
-TEST_F(ExecutorTest, DISABLED_SimpleSeqScanTest) {
+TEST_F(ExecutorTest, SimpleSeqScanTest) {
   // Construct query plan
   TableInfo *table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
   const Schema &schema = table_info->schema_;
@@ -110,8 +131,29 @@ TEST_F(ExecutorTest, DISABLED_SimpleSeqScanTest) {
   }
 }
 
+// SELECT colA FROM test_1 WHERE colA < x, with the predicate compiled or interpreted
+TEST_F(ExecutorTest, SeqScanPushdownTest) {
+  TableInfo *table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  const Schema &schema = table_info->schema_;
+  auto *col_a = MakeColumnValueExpression(schema, 0, "colA");
+  auto *out_schema = MakeOutputSchema({{"colA", col_a}});
+  // A VARCHAR constant cannot be compiled, so the predicate is interpreted over the page views instead
+  for (const auto &bound : {ValueFactory::GetIntegerValue(500), ValueFactory::GetVarcharValue("500"),
+                            ValueFactory::GetIntegerValue(0), ValueFactory::GetIntegerValue(TEST1_SIZE)}) {
+    auto *predicate = MakeComparisonExpression(col_a, MakeConstantValueExpression(bound), ComparisonType::LessThan);
+    SeqScanPlanNode plan{out_schema, predicate, table_info->oid_};
+    std::vector<Tuple> result_set{};
+    GetExecutionEngine()->Execute(&plan, &result_set, GetTxn(), GetExecutorContext());
+    auto expected = bound.CastAs(TypeId::INTEGER).GetAs<int32_t>();
+    ASSERT_EQ(result_set.size(), expected);
+    for (int32_t i = 0; i < expected; i++) {
+      ASSERT_EQ(result_set[i].GetValue(out_schema, 0).GetAs<int32_t>(), i);
+    }
+  }
+}
+
 // INSERT INTO empty_table2 VALUES (100, 10), (101, 11), (102, 12)
-TEST_F(ExecutorTest, DISABLED_SimpleRawInsertTest) {
+TEST_F(ExecutorTest, SimpleRawInsertTest) {
   // Create Values to insert
   std::vector<Value> val1{ValueFactory::GetIntegerValue(100), ValueFactory::GetIntegerValue(10)};
   std::vector<Value> val2{ValueFactory::GetIntegerValue(101), ValueFactory::GetIntegerValue(11)};
@@ -152,8 +194,140 @@ TEST_F(ExecutorTest, DISABLED_SimpleRawInsertTest) {
   ASSERT_EQ(result_set[2].GetValue(out_schema, out_schema->GetColIdx("colB")).GetAs<int32_t>(), 12);
 }
 
+// INSERT INTO empty_table2 VALUES (0, 0), ..., (4999, 4999), appended in bulk
+TEST_F(ExecutorTest, BulkRawInsertTest) {
+  constexpr int32_t count = 5000;
+  auto table_info = GetExecutorContext()->GetCatalog()->GetTable("empty_table2");
+  auto key_schema = ParseCreateStatement("a bigint");
+  auto *index_info = GetExecutorContext()->GetCatalog()->CreateIndex<KeyType, ValueType, ComparatorType>(
+      GetTxn(), "index1", "empty_table2", table_info->schema_, *key_schema, {0}, 8, HashFunctionType{});
+
+  auto make_plan = [&] {
+    std::vector<std::vector<Value>> raw_vals;
+    for (int32_t i = 0; i < count; i++) {
+      raw_vals.push_back({ValueFactory::GetIntegerValue(i), ValueFactory::GetIntegerValue(i)});
+    }
+    return std::make_unique<InsertPlanNode>(std::move(raw_vals), table_info->oid_);
+  };
+  auto &schema = table_info->schema_;
+  auto key_of = [&](int32_t i) {
+    Tuple tuple{{ValueFactory::GetIntegerValue(i), ValueFactory::GetIntegerValue(i)}, &schema};
+    return tuple.KeyFromTuple(schema, index_info->key_schema_, index_info->index_->GetKeyAttrs());
+  };
+  auto col_a = MakeColumnValueExpression(schema, 0, "colA");
+  auto out_schema = MakeOutputSchema({{"colA", col_a}});
+  SeqScanPlanNode scan_plan{out_schema, nullptr, table_info->oid_};
+
+  // An aborted bulk insert leaves neither tuples nor index entries behind.
+  auto *txn = GetTxnManager()->Begin();
+  ExecutorContext exec_ctx{txn, GetCatalog(), GetBPM(), GetTxnManager(), GetLockManager()};
+  auto plan = make_plan();
+  GetExecutionEngine()->Execute(plan.get(), nullptr, txn, &exec_ctx);
+  const auto &write_set = *txn->GetWriteSet();
+  ASSERT_FALSE(write_set.empty());
+  EXPECT_LT(write_set.size(), count / 10);
+  for (const auto &record : write_set) {
+    EXPECT_EQ(record.wtype_, WType::INSERT_PAGE);
+  }
+  GetTxnManager()->Abort(txn);
+  delete txn;
+
+  std::vector<Tuple> result_set;
+  GetExecutionEngine()->Execute(&scan_plan, &result_set, GetTxn(), GetExecutorContext());
+  EXPECT_TRUE(result_set.empty());
+  std::vector<RID> rids;
+  index_info->index_->ScanKey(key_of(7), &rids, GetTxn());
+  EXPECT_TRUE(rids.empty());
+
+  // A committed one is scanned in insertion order and indexed.
+  plan = make_plan();
+  GetExecutionEngine()->Execute(plan.get(), nullptr, GetTxn(), GetExecutorContext());
+  GetExecutionEngine()->Execute(&scan_plan, &result_set, GetTxn(), GetExecutorContext());
+  ASSERT_EQ(result_set.size(), count);
+  for (int32_t i = 0; i < count; i++) {
+    ASSERT_EQ(result_set[i].GetValue(out_schema, 0).GetAs<int32_t>(), i);
+  }
+  for (int32_t i = 0; i < count; i += 499) {
+    rids.clear();
+    index_info->index_->ScanKey(key_of(i), &rids, GetTxn());
+    ASSERT_EQ(rids.size(), 1);
+    Tuple indexed_tuple;
+    ASSERT_TRUE(table_info->table_->GetTuple(rids[0], &indexed_tuple, GetTxn()));
+    EXPECT_EQ(indexed_tuple.GetValue(&schema, 0).GetAs<int32_t>(), i);
+  }
+}
+
+// DELETE FROM empty_table2 WHERE colA % 10 <> 0, then VACUUM empty_table2
+TEST_F(ExecutorTest, VacuumTest) {
+  constexpr int32_t count = 5000;
+  auto table_info = GetExecutorContext()->GetCatalog()->GetTable("empty_table2");
+  auto &schema = table_info->schema_;
+  auto key_schema = ParseCreateStatement("a bigint");
+  auto *index_info = GetExecutorContext()->GetCatalog()->CreateIndex<KeyType, ValueType, ComparatorType>(
+      GetTxn(), "index1", "empty_table2", schema, *key_schema, {0}, 8, HashFunctionType{});
+  auto key_of = [&](const Tuple &tuple) {
+    return tuple.KeyFromTuple(schema, index_info->key_schema_, index_info->index_->GetKeyAttrs());
+  };
+
+  std::vector<std::vector<Value>> raw_vals;
+  for (int32_t i = 0; i < count; i++) {
+    raw_vals.push_back({ValueFactory::GetIntegerValue(i), ValueFactory::GetIntegerValue(i)});
+  }
+  InsertPlanNode insert_plan{std::move(raw_vals), table_info->oid_};
+  GetExecutionEngine()->Execute(&insert_plan, nullptr, GetTxn(), GetExecutorContext());
+  auto *heap = table_info->table_.get();
+  auto pages_before = heap->GetPageIds().size();
+
+  // Delete nine tuples out of ten in a transaction of its own, so the deletes are applied on commit.
+  auto *txn = GetTxnManager()->Begin();
+  std::vector<Tuple> deleted;
+  for (auto it = heap->Begin(txn); it != heap->End(); ++it) {
+    if (it->GetValue(&schema, 0).GetAs<int32_t>() % 10 != 0) {
+      deleted.push_back(it.CopyTuple());
+    }
+  }
+  for (const auto &tuple : deleted) {
+    ASSERT_TRUE(heap->MarkDelete(tuple.GetRid(), txn));
+    index_info->index_->DeleteEntry(key_of(tuple), tuple.GetRid(), txn);
+  }
+  GetTxnManager()->Commit(txn);
+  delete txn;
+
+  // The vacuum waits for the running transactions, the test's own included, to end.
+  auto *reader = GetTxnManager()->Begin();
+  GetTxnManager()->Commit(GetTxn());
+  auto vacuum =
+      std::async(std::launch::async, [&] { return GetCatalog()->VacuumTable(GetTxnManager(), "empty_table2"); });
+  EXPECT_EQ(vacuum.wait_for(std::chrono::milliseconds(100)), std::future_status::timeout);
+  GetTxnManager()->Commit(reader);
+  delete reader;
+  auto pages_deleted = vacuum.get();
+  GetTxn()->SetState(TransactionState::GROWING);
+  GetTxnManager()->Begin(GetTxn());
+  EXPECT_GT(pages_deleted, 0);
+  auto pages_after = heap->GetPageIds().size();
+  EXPECT_EQ(pages_after + pages_deleted, pages_before);
+  EXPECT_LE(pages_after, pages_before / 5);
+
+  // Every survivor is still there, once, and the index finds it at its new rid.
+  std::vector<int32_t> survivors;
+  for (auto it = heap->Begin(GetTxn()); it != heap->End(); ++it) {
+    auto value = it->GetValue(&schema, 0).GetAs<int32_t>();
+    survivors.push_back(value);
+    std::vector<RID> rids;
+    index_info->index_->ScanKey(key_of(*it), &rids, GetTxn());
+    ASSERT_EQ(rids.size(), 1);
+    EXPECT_EQ(rids[0], it->GetRid());
+  }
+  std::sort(survivors.begin(), survivors.end());
+  ASSERT_EQ(survivors.size(), count / 10);
+  for (int32_t i = 0; i < count / 10; i++) {
+    EXPECT_EQ(survivors[i], i * 10);
+  }
+}
+
 // INSERT INTO empty_table2 SELECT col_a, col_b FROM test_1 WHERE col_a < 500
-TEST_F(ExecutorTest, DISABLED_SimpleSelectInsertTest) {
+TEST_F(ExecutorTest, SimpleSelectInsertTest) {
   const Schema *out_schema1;
   std::unique_ptr<AbstractPlanNode> scan_plan1;
   {
@@ -205,7 +379,7 @@ TEST_F(ExecutorTest, DISABLED_SimpleSelectInsertTest) {
 }
 
 // INSERT INTO empty_table2 VALUES (100, 10), (101, 11), (102, 12)
-TEST_F(ExecutorTest, DISABLED_SimpleRawInsertWithIndexTest) {
+TEST_F(ExecutorTest, SimpleRawInsertWithIndexTest) {
   // Create Values to insert
   std::vector<Value> val1{ValueFactory::GetIntegerValue(100), ValueFactory::GetIntegerValue(10)};
   std::vector<Value> val2{ValueFactory::GetIntegerValue(101), ValueFactory::GetIntegerValue(11)};
@@ -270,7 +444,7 @@ TEST_F(ExecutorTest, DISABLED_SimpleRawInsertWithIndexTest) {
 }
 
 // UPDATE test_3 SET colB = colB + 1;
-TEST_F(ExecutorTest, DISABLED_SimpleUpdateTest) {
+TEST_F(ExecutorTest, SimpleUpdateTest) {
   // Construct a sequential scan of the table
   const Schema *out_schema{};
   std::unique_ptr<AbstractPlanNode> scan_plan{};
@@ -329,7 +503,7 @@ TEST_F(ExecutorTest, DISABLED_SimpleUpdateTest) {
 }
 
 // DELETE FROM test_1 WHERE col_a == 50;
-TEST_F(ExecutorTest, DISABLED_SimpleDeleteTest) {
+TEST_F(ExecutorTest, SimpleDeleteTest) {
   // Construct query plan
   auto table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
   auto &schema = table_info->schema_;
@@ -374,7 +548,7 @@ TEST_F(ExecutorTest, DISABLED_SimpleDeleteTest) {
 }
 
 // SELECT test_1.col_a, test_1.col_b, test_2.col1, test_2.col3 FROM test_1 JOIN test_2 ON test_1.col_a = test_2.col1;
-TEST_F(ExecutorTest, DISABLED_SimpleNestedLoopJoinTest) {
+TEST_F(ExecutorTest, SimpleNestedLoopJoinTest) {
   const Schema *out_schema1;
   std::unique_ptr<AbstractPlanNode> scan_plan1;
   {
@@ -418,7 +592,7 @@ TEST_F(ExecutorTest, DISABLED_SimpleNestedLoopJoinTest) {
 }
 
 // SELECT test_4.colA, test_4.colB, test_6.colA, test_6.colB FROM test_4 JOIN test_6 ON test_4.colA = test_6.colA;
-TEST_F(ExecutorTest, DISABLED_SimpleHashJoinTest) {
+TEST_F(ExecutorTest, SimpleHashJoinTest) {
   // Construct sequential scan of table test_4
   const Schema *out_schema1{};
   std::unique_ptr<AbstractPlanNode> scan_plan1{};
@@ -486,8 +660,154 @@ TEST_F(ExecutorTest, DISABLED_SimpleHashJoinTest) {
   }
 }
 
+// SELECT l.colA, l.colB, r.colA, r.colB FROM test_1 l INNER JOIN test_1 r ON l.colA = r.colA, with a memory
+// budget small enough that the build side is spilled and its partitions are split again
+TEST_F(ExecutorTest, GraceHashJoinTest) {
+  auto *table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  auto &schema = table_info->schema_;
+  auto *col_a = MakeColumnValueExpression(schema, 0, "colA");
+  auto *col_b = MakeColumnValueExpression(schema, 0, "colB");
+  auto *scan_schema = MakeOutputSchema({{"colA", col_a}, {"colB", col_b}});
+  auto scan_plan1 = std::make_unique<SeqScanPlanNode>(scan_schema, nullptr, table_info->oid_);
+  auto scan_plan2 = std::make_unique<SeqScanPlanNode>(scan_schema, nullptr, table_info->oid_);
+
+  auto *left_col_a = MakeColumnValueExpression(*scan_schema, 0, "colA");
+  auto *left_col_b = MakeColumnValueExpression(*scan_schema, 0, "colB");
+  auto *right_col_a = MakeColumnValueExpression(*scan_schema, 1, "colA");
+  auto *right_col_b = MakeColumnValueExpression(*scan_schema, 1, "colB");
+  auto *out_schema = MakeOutputSchema(
+      {{"left_colA", left_col_a}, {"left_colB", left_col_b}, {"right_colA", right_col_a}, {"right_colB", right_col_b}});
+  auto join_plan = std::make_unique<HashJoinPlanNode>(
+      out_schema, std::vector<const AbstractPlanNode *>{scan_plan1.get(), scan_plan2.get()}, left_col_a, right_col_a);
+
+  // The whole build side takes about 40KB in memory
+  GetExecutorContext()->SetMemoryBudget(4096);
+  std::vector<Tuple> result_set{};
+  GetExecutionEngine()->Execute(join_plan.get(), &result_set, GetTxn(), GetExecutorContext());
+  ASSERT_EQ(result_set.size(), TEST1_SIZE);
+
+  std::vector<bool> seen(TEST1_SIZE, false);
+  for (const auto &tuple : result_set) {
+    const auto left_a = tuple.GetValue(out_schema, 0).GetAs<int32_t>();
+    ASSERT_EQ(left_a, tuple.GetValue(out_schema, 2).GetAs<int32_t>());
+    ASSERT_EQ(tuple.GetValue(out_schema, 1).GetAs<int32_t>(), tuple.GetValue(out_schema, 3).GetAs<int32_t>());
+    ASSERT_FALSE(seen[left_a]);
+    seen[left_a] = true;
+  }
+
+  // Every spill page has been given back to the buffer pool
+  for (size_t i = 0; i < GetBPM()->GetPoolSize(); i++) {
+    page_id_t page_id;
+    auto *page = GetBPM()->NewPage(&page_id);
+    ASSERT_NE(page, nullptr);
+  }
+}
+
+// SELECT test_1.colA, test_1.colB, test_3.colA FROM test_1 INNER JOIN test_3 ON test_1.colB = test_3.colA, once
+// with the radix-partitioned join picked by a large build estimate and once with the default join
+TEST_F(ExecutorTest, RadixHashJoinTest) {
+  auto *table1_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  auto *col1_a = MakeColumnValueExpression(table1_info->schema_, 0, "colA");
+  auto *col1_b = MakeColumnValueExpression(table1_info->schema_, 0, "colB");
+  auto *scan_schema1 = MakeOutputSchema({{"colA", col1_a}, {"colB", col1_b}});
+  SeqScanPlanNode scan_plan1{scan_schema1, nullptr, table1_info->oid_};
+
+  auto *table3_info = GetExecutorContext()->GetCatalog()->GetTable("test_3");
+  auto *col3_a = MakeColumnValueExpression(table3_info->schema_, 0, "colA");
+  auto *scan_schema3 = MakeOutputSchema({{"colA", col3_a}});
+  SeqScanPlanNode scan_plan3{scan_schema3, nullptr, table3_info->oid_};
+
+  auto *left_col_a = MakeColumnValueExpression(*scan_schema1, 0, "colA");
+  auto *left_col_b = MakeColumnValueExpression(*scan_schema1, 0, "colB");
+  auto *right_col_a = MakeColumnValueExpression(*scan_schema3, 1, "colA");
+  auto *out_schema =
+      MakeOutputSchema({{"left_colA", left_col_a}, {"left_colB", left_col_b}, {"right_colA", right_col_a}});
+  HashJoinPlanNode join_plan{out_schema, {&scan_plan1, &scan_plan3}, left_col_b, right_col_a};
+
+  auto run = [&]() {
+    std::vector<Tuple> result_set{};
+    GetExecutionEngine()->Execute(&join_plan, &result_set, GetTxn(), GetExecutorContext());
+    std::vector<int32_t> left_keys{};
+    for (const auto &tuple : result_set) {
+      EXPECT_EQ(tuple.GetValue(out_schema, 1).GetAs<int32_t>(), tuple.GetValue(out_schema, 2).GetAs<int32_t>());
+      left_keys.push_back(tuple.GetValue(out_schema, 0).GetAs<int32_t>());
+    }
+    std::sort(left_keys.begin(), left_keys.end());
+    return left_keys;
+  };
+
+  auto chained = run();
+  scan_plan1.SetEstimatedCardinality(HashJoinExecutor::RADIX_JOIN_MIN_BUILD_ROWS);
+  auto radix = run();
+
+  // Every row of test_1 joins with exactly one row of test_3
+  ASSERT_EQ(radix.size(), TEST1_SIZE);
+  ASSERT_EQ(radix, chained);
+  for (size_t i = 0; i < radix.size(); i++) {
+    ASSERT_EQ(radix[i], static_cast<int32_t>(i));
+  }
+}
+
+// The Bloom filter never forgets a key, and rarely admits one it has not seen
+TEST(BloomFilterTest, FalsePositiveRate) {
+  constexpr int64_t num_keys = 10000;
+  BloomFilter filter{num_keys};
+  for (int64_t i = 0; i < num_keys; i++) {
+    auto key = ValueFactory::GetBigIntValue(i);
+    filter.Insert(HashUtil::HashValue(&key));
+  }
+  size_t false_positives = 0;
+  for (int64_t i = 0; i < num_keys; i++) {
+    auto present = ValueFactory::GetBigIntValue(i);
+    ASSERT_TRUE(filter.MayContain(HashUtil::HashValue(&present)));
+    auto absent = ValueFactory::GetBigIntValue(num_keys + i);
+    false_positives += filter.MayContain(HashUtil::HashValue(&absent)) ? 1 : 0;
+  }
+  ASSERT_LT(false_positives, num_keys / 50);
+}
+
+// A Bloom filter pushed into a sequential scan drops the rows whose key it has never seen
+TEST_F(ExecutorTest, BloomFilterPushdownTest) {
+  auto *table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  auto &schema = table_info->schema_;
+  auto *col_a = MakeColumnValueExpression(schema, 0, "colA");
+  auto *col_b = MakeColumnValueExpression(schema, 0, "colB");
+  auto *out_schema = MakeOutputSchema({{"colB", col_b}, {"colA", col_a}});
+  SeqScanPlanNode plan{out_schema, nullptr, table_info->oid_};
+
+  // Only keep colA in {3, 500}; the key refers to the scan's output schema, as a join key would
+  BloomFilter filter{2};
+  for (int32_t key : {3, 500}) {
+    auto value = ValueFactory::GetIntegerValue(key);
+    filter.Insert(HashUtil::HashValue(&value));
+  }
+  auto *key = MakeColumnValueExpression(*out_schema, 1, "colA");
+
+  auto executor = ExecutorFactory::CreateExecutor(GetExecutorContext(), &plan);
+  executor->Init();
+  ASSERT_TRUE(executor->PushDownBloomFilter(&filter, key));
+  std::vector<int32_t> keys{};
+  TupleBatch batch;
+  while (executor->NextBatch(&batch)) {
+    for (uint32_t i = 0; i < batch.Size(); i++) {
+      keys.push_back(batch.TupleAt(i).GetValue(out_schema, 1).GetAs<int32_t>());
+    }
+  }
+  ASSERT_NE(std::find(keys.begin(), keys.end(), 3), keys.end());
+  ASSERT_NE(std::find(keys.begin(), keys.end(), 500), keys.end());
+  ASSERT_LT(keys.size(), TEST1_SIZE / 10);
+
+  // Init() forgets the filter
+  executor->Init();
+  size_t count = 0;
+  while (executor->NextBatch(&batch)) {
+    count += batch.Size();
+  }
+  ASSERT_EQ(count, TEST1_SIZE);
+}
+
 // SELECT COUNT(col_a), SUM(col_a), min(col_a), max(col_a) from test_1;
-TEST_F(ExecutorTest, DISABLED_SimpleAggregationTest) {
+TEST_F(ExecutorTest, SimpleAggregationTest) {
   const Schema *scan_schema;
   std::unique_ptr<AbstractPlanNode> scan_plan;
   {
@@ -537,7 +857,7 @@ TEST_F(ExecutorTest, DISABLED_SimpleAggregationTest) {
 }
 
 // SELECT count(col_a), col_b, sum(col_c) FROM test_1 Group By col_b HAVING count(col_a) > 100
-TEST_F(ExecutorTest, DISABLED_SimpleGroupByAggregation) {
+TEST_F(ExecutorTest, SimpleGroupByAggregation) {
   const Schema *scan_schema;
   std::unique_ptr<AbstractPlanNode> scan_plan;
   {
@@ -589,8 +909,515 @@ TEST_F(ExecutorTest, DISABLED_SimpleGroupByAggregation) {
   }
 }
 
+// SELECT test_1.colA, test_8.colB, count(test_1.colA), sum(test_1.colA) FROM test_1, test_8
+// GROUP BY test_1.colA, test_8.colB
+TEST_F(ExecutorTest, ParallelGroupByAggregation) {
+  const Schema *scan_schema1;
+  std::unique_ptr<AbstractPlanNode> scan_plan1;
+  {
+    auto table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+    auto col_a = MakeColumnValueExpression(table_info->schema_, 0, "colA");
+    scan_schema1 = MakeOutputSchema({{"colA", col_a}});
+    scan_plan1 = std::make_unique<SeqScanPlanNode>(scan_schema1, nullptr, table_info->oid_);
+  }
+  const Schema *scan_schema2;
+  std::unique_ptr<AbstractPlanNode> scan_plan2;
+  {
+    auto table_info = GetExecutorContext()->GetCatalog()->GetTable("test_8");
+    auto col_b = MakeColumnValueExpression(table_info->schema_, 0, "colB");
+    scan_schema2 = MakeOutputSchema({{"colB", col_b}});
+    scan_plan2 = std::make_unique<SeqScanPlanNode>(scan_schema2, nullptr, table_info->oid_);
+  }
+
+  // The cross product has TEST1_SIZE * TEST8_SIZE distinct groups, more than a pre-aggregation table
+  // holds, so the workers have to flush and the partitions have to be merged
+  const Schema *join_schema;
+  std::unique_ptr<AbstractPlanNode> join_plan;
+  {
+    auto left_a = MakeColumnValueExpression(*scan_schema1, 0, "colA");
+    auto right_b = MakeColumnValueExpression(*scan_schema2, 1, "colB");
+    join_schema = MakeOutputSchema({{"leftA", left_a}, {"rightB", right_b}});
+    join_plan = std::make_unique<NestedLoopJoinPlanNode>(
+        join_schema, std::vector<const AbstractPlanNode *>{scan_plan1.get(), scan_plan2.get()}, nullptr);
+  }
+  ASSERT_GT(TEST1_SIZE * TEST8_SIZE, AggregationExecutor::PREAGGREGATION_CAPACITY);
+
+  const Schema *agg_schema;
+  std::unique_ptr<AbstractPlanNode> agg_plan;
+  {
+    const AbstractExpression *left_a = MakeColumnValueExpression(*join_schema, 0, "leftA");
+    const AbstractExpression *right_b = MakeColumnValueExpression(*join_schema, 0, "rightB");
+    agg_schema = MakeOutputSchema({{"leftA", MakeAggregateValueExpression(true, 0)},
+                                   {"rightB", MakeAggregateValueExpression(true, 1)},
+                                   {"count", MakeAggregateValueExpression(false, 0)},
+                                   {"sum", MakeAggregateValueExpression(false, 1)}});
+    agg_plan = std::make_unique<AggregationPlanNode>(
+        agg_schema, join_plan.get(), nullptr, std::vector<const AbstractExpression *>{left_a, right_b},
+        std::vector<const AbstractExpression *>{left_a, left_a},
+        std::vector<AggregationType>{AggregationType::CountAggregate, AggregationType::SumAggregate});
+  }
+
+  auto run = [&](size_t parallelism) {
+    GetExecutorContext()->SetParallelism(parallelism);
+    std::vector<Tuple> result_set{};
+    GetExecutionEngine()->Execute(agg_plan.get(), &result_set, GetTxn(), GetExecutorContext());
+    std::vector<std::pair<int32_t, int32_t>> groups;
+    for (const auto &tuple : result_set) {
+      auto left_a = tuple.GetValue(agg_schema, 0).GetAs<int32_t>();
+      auto right_b = tuple.GetValue(agg_schema, 1).GetAs<int32_t>();
+      EXPECT_EQ(tuple.GetValue(agg_schema, 2).GetAs<int32_t>(), 1);
+      EXPECT_EQ(tuple.GetValue(agg_schema, 3).GetAs<int32_t>(), left_a);
+      groups.emplace_back(left_a, right_b);
+    }
+    std::sort(groups.begin(), groups.end());
+    return groups;
+  };
+
+  auto serial = run(1);
+  auto parallel = run(4);
+  ASSERT_EQ(serial.size(), TEST1_SIZE * TEST8_SIZE);
+  ASSERT_EQ(std::unique(serial.begin(), serial.end()), serial.end());
+  ASSERT_EQ(serial, parallel);
+}
+
+// SELECT test_1.colA, test_8.colB, count(test_1.colA), min(test_8.colB) FROM test_1, test_8
+// GROUP BY test_1.colA, test_8.colB[, 'group'] with a memory budget far below the size of the groups
+TEST_F(ExecutorTest, SpillingGroupByAggregation) {
+  const Schema *scan_schema1;
+  std::unique_ptr<AbstractPlanNode> scan_plan1;
+  {
+    auto table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+    auto col_a = MakeColumnValueExpression(table_info->schema_, 0, "colA");
+    scan_schema1 = MakeOutputSchema({{"colA", col_a}});
+    scan_plan1 = std::make_unique<SeqScanPlanNode>(scan_schema1, nullptr, table_info->oid_);
+  }
+  const Schema *scan_schema2;
+  std::unique_ptr<AbstractPlanNode> scan_plan2;
+  {
+    auto table_info = GetExecutorContext()->GetCatalog()->GetTable("test_8");
+    auto col_b = MakeColumnValueExpression(table_info->schema_, 0, "colB");
+    scan_schema2 = MakeOutputSchema({{"colB", col_b}});
+    scan_plan2 = std::make_unique<SeqScanPlanNode>(scan_schema2, nullptr, table_info->oid_);
+  }
+  const Schema *join_schema;
+  std::unique_ptr<AbstractPlanNode> join_plan;
+  {
+    auto left_a = MakeColumnValueExpression(*scan_schema1, 0, "colA");
+    auto right_b = MakeColumnValueExpression(*scan_schema2, 1, "colB");
+    join_schema = MakeOutputSchema({{"leftA", left_a}, {"rightB", right_b}});
+    join_plan = std::make_unique<NestedLoopJoinPlanNode>(
+        join_schema, std::vector<const AbstractPlanNode *>{scan_plan1.get(), scan_plan2.get()}, nullptr);
+  }
+
+  // A VARCHAR group-by takes the SimpleAggregationHashTable path, the others the flat tables
+  for (bool varchar : {false, true}) {
+    const AbstractExpression *left_a = MakeColumnValueExpression(*join_schema, 0, "leftA");
+    const AbstractExpression *right_b = MakeColumnValueExpression(*join_schema, 0, "rightB");
+    std::vector<const AbstractExpression *> group_bys{left_a, right_b};
+    if (varchar) {
+      group_bys.push_back(MakeConstantValueExpression(ValueFactory::GetVarcharValue("group")));
+    }
+    const Schema *agg_schema = MakeOutputSchema({{"leftA", MakeAggregateValueExpression(true, 0)},
+                                                 {"rightB", MakeAggregateValueExpression(true, 1)},
+                                                 {"count", MakeAggregateValueExpression(false, 0)},
+                                                 {"min", MakeAggregateValueExpression(false, 1)}});
+    auto agg_plan = std::make_unique<AggregationPlanNode>(
+        agg_schema, join_plan.get(), nullptr, std::move(group_bys),
+        std::vector<const AbstractExpression *>{left_a, right_b},
+        std::vector<AggregationType>{AggregationType::CountAggregate, AggregationType::MinAggregate});
+
+    for (size_t parallelism : {1, 4}) {
+      SCOPED_TRACE(std::to_string(parallelism) + (varchar ? " threads, VARCHAR group-by" : " threads"));
+      GetExecutorContext()->SetParallelism(parallelism);
+      GetExecutorContext()->SetMemoryBudget(16 * 1024);
+      std::vector<Tuple> result_set{};
+      GetExecutionEngine()->Execute(agg_plan.get(), &result_set, GetTxn(), GetExecutorContext());
+      GetExecutorContext()->SetMemoryBudget(EXECUTOR_MEMORY_BUDGET);
+
+      std::vector<std::pair<int32_t, int32_t>> groups;
+      for (const auto &tuple : result_set) {
+        auto group_a = tuple.GetValue(agg_schema, 0).GetAs<int32_t>();
+        auto group_b = tuple.GetValue(agg_schema, 1).GetAs<int32_t>();
+        ASSERT_EQ(tuple.GetValue(agg_schema, 2).GetAs<int32_t>(), 1);
+        ASSERT_EQ(tuple.GetValue(agg_schema, 3).GetAs<int32_t>(), group_b);
+        groups.emplace_back(group_a, group_b);
+      }
+      std::sort(groups.begin(), groups.end());
+      ASSERT_EQ(groups.size(), TEST1_SIZE * TEST8_SIZE);
+      ASSERT_EQ(std::unique(groups.begin(), groups.end()), groups.end());
+    }
+  }
+}
+
+// SELECT colA, colB FROM test_1 ORDER BY colB ASC, colA DESC
+TEST_F(ExecutorTest, SimpleSortTest) {
+  auto *table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  auto *col_a = MakeColumnValueExpression(table_info->schema_, 0, "colA");
+  auto *col_b = MakeColumnValueExpression(table_info->schema_, 0, "colB");
+  auto *scan_schema = MakeOutputSchema({{"colA", col_a}, {"colB", col_b}});
+  auto scan_plan = std::make_unique<SeqScanPlanNode>(scan_schema, nullptr, table_info->oid_);
+  auto sort_plan = std::make_unique<SortPlanNode>(
+      scan_schema, scan_plan.get(),
+      std::vector<std::pair<OrderByType, const AbstractExpression *>>{
+          {OrderByType::Ascending, MakeColumnValueExpression(*scan_schema, 0, "colB")},
+          {OrderByType::Descending, MakeColumnValueExpression(*scan_schema, 0, "colA")}});
+
+  std::vector<Tuple> result_set{};
+  GetExecutionEngine()->Execute(sort_plan.get(), &result_set, GetTxn(), GetExecutorContext());
+  ASSERT_EQ(result_set.size(), TEST1_SIZE);
+  for (size_t i = 1; i < result_set.size(); i++) {
+    auto prev_b = result_set[i - 1].GetValue(scan_schema, 1).GetAs<int32_t>();
+    auto b = result_set[i].GetValue(scan_schema, 1).GetAs<int32_t>();
+    ASSERT_LE(prev_b, b);
+    if (prev_b == b) {
+      ASSERT_GT(result_set[i - 1].GetValue(scan_schema, 0).GetAs<int32_t>(),
+                result_set[i].GetValue(scan_schema, 0).GetAs<int32_t>());
+    }
+  }
+}
+
+// SELECT colA, colB FROM test_1 ORDER BY colB DESC, colA ASC, with a memory budget small enough that the sort
+// writes more runs than it can merge at once
+TEST_F(ExecutorTest, ExternalSortTest) {
+  auto *table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  auto *col_a = MakeColumnValueExpression(table_info->schema_, 0, "colA");
+  auto *col_b = MakeColumnValueExpression(table_info->schema_, 0, "colB");
+  auto *scan_schema = MakeOutputSchema({{"colA", col_a}, {"colB", col_b}});
+  auto scan_plan = std::make_unique<SeqScanPlanNode>(scan_schema, nullptr, table_info->oid_);
+  auto sort_plan = std::make_unique<SortPlanNode>(
+      scan_schema, scan_plan.get(),
+      std::vector<std::pair<OrderByType, const AbstractExpression *>>{
+          {OrderByType::Descending, MakeColumnValueExpression(*scan_schema, 0, "colB")},
+          {OrderByType::Ascending, MakeColumnValueExpression(*scan_schema, 0, "colA")}});
+
+  GetExecutorContext()->SetMemoryBudget(2048);
+  SortExecutor executor{GetExecutorContext(), sort_plan.get(),
+                        ExecutorFactory::CreateExecutor(GetExecutorContext(), scan_plan.get())};
+  executor.Init();
+  ASSERT_GT(executor.GetRunCount(), GetBPM()->GetPoolSize() / 4);
+
+  std::vector<Tuple> result_set{};
+  Tuple tuple;
+  RID rid;
+  while (executor.Next(&tuple, &rid)) {
+    result_set.push_back(tuple);
+  }
+  ASSERT_EQ(result_set.size(), TEST1_SIZE);
+  std::vector<bool> seen(TEST1_SIZE, false);
+  for (size_t i = 0; i < result_set.size(); i++) {
+    auto a = result_set[i].GetValue(scan_schema, 0).GetAs<int32_t>();
+    ASSERT_FALSE(seen[a]);
+    seen[a] = true;
+    if (i > 0) {
+      auto prev_b = result_set[i - 1].GetValue(scan_schema, 1).GetAs<int32_t>();
+      auto b = result_set[i].GetValue(scan_schema, 1).GetAs<int32_t>();
+      ASSERT_GE(prev_b, b);
+      if (prev_b == b) {
+        ASSERT_LT(result_set[i - 1].GetValue(scan_schema, 0).GetAs<int32_t>(), a);
+      }
+    }
+  }
+}
+
+// SELECT colA FROM test_1 ORDER BY colA DESC LIMIT 10
+TEST_F(ExecutorTest, TopNSortTest) {
+  auto *table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  auto *col_a = MakeColumnValueExpression(table_info->schema_, 0, "colA");
+  auto *scan_schema = MakeOutputSchema({{"colA", col_a}});
+  auto scan_plan = std::make_unique<SeqScanPlanNode>(scan_schema, nullptr, table_info->oid_);
+  auto sort_plan = std::make_unique<SortPlanNode>(
+      scan_schema, scan_plan.get(),
+      std::vector<std::pair<OrderByType, const AbstractExpression *>>{
+          {OrderByType::Descending, MakeColumnValueExpression(*scan_schema, 0, "colA")}});
+  auto limit_plan = std::make_unique<LimitPlanNode>(scan_schema, sort_plan.get(), 10);
+
+  std::vector<Tuple> result_set{};
+  GetExecutionEngine()->Execute(limit_plan.get(), &result_set, GetTxn(), GetExecutorContext());
+  ASSERT_EQ(result_set.size(), 10);
+  for (size_t i = 0; i < result_set.size(); i++) {
+    ASSERT_EQ(result_set[i].GetValue(scan_schema, 0).GetAs<int32_t>(), static_cast<int32_t>(TEST1_SIZE - 1 - i));
+  }
+}
+
+TEST(SortKeyTest, NormalizedKeyOrder) {
+  // Every list is in ascending order
+  std::vector<std::vector<Value>> ordered{
+      {ValueFactory::GetNullValueByType(TypeId::INTEGER), ValueFactory::GetIntegerValue(BUSTUB_INT32_MIN),
+       ValueFactory::GetIntegerValue(-1), ValueFactory::GetIntegerValue(0), ValueFactory::GetIntegerValue(1),
+       ValueFactory::GetIntegerValue(BUSTUB_INT32_MAX)},
+      {ValueFactory::GetBigIntValue(-300), ValueFactory::GetBigIntValue(-2), ValueFactory::GetBigIntValue(256)},
+      {ValueFactory::GetDecimalValue(-2.5), ValueFactory::GetDecimalValue(-0.5), ValueFactory::GetDecimalValue(0),
+       ValueFactory::GetDecimalValue(0.25), ValueFactory::GetDecimalValue(1e10)},
+      {ValueFactory::GetVarcharValue(""), ValueFactory::GetVarcharValue("a"), ValueFactory::GetVarcharValue("ab"),
+       ValueFactory::GetVarcharValue("b")},
+  };
+  for (const auto &values : ordered) {
+    for (size_t i = 1; i < values.size(); i++) {
+      std::string prev_asc;
+      std::string asc;
+      std::string prev_desc;
+      std::string desc;
+      SortExecutor::AppendNormalizedKey(values[i - 1], OrderByType::Ascending, &prev_asc);
+      SortExecutor::AppendNormalizedKey(values[i], OrderByType::Ascending, &asc);
+      SortExecutor::AppendNormalizedKey(values[i - 1], OrderByType::Descending, &prev_desc);
+      SortExecutor::AppendNormalizedKey(values[i], OrderByType::Descending, &desc);
+      EXPECT_LT(prev_asc, asc) << values[i - 1].ToString() << " < " << values[i].ToString();
+      EXPECT_GT(prev_desc, desc) << values[i - 1].ToString() << " < " << values[i].ToString();
+    }
+  }
+
+  // -0.0 and 0.0 are equal
+  std::string negative_zero;
+  std::string zero;
+  SortExecutor::AppendNormalizedKey(ValueFactory::GetDecimalValue(-0.0), OrderByType::Ascending, &negative_zero);
+  SortExecutor::AppendNormalizedKey(ValueFactory::GetDecimalValue(0.0), OrderByType::Ascending, &zero);
+  EXPECT_EQ(negative_zero, zero);
+}
+
+TEST(ExpressionProgramTest, MatchesInterpreter) {
+  Schema schema{{Column{"b", TypeId::BOOLEAN}, Column{"t", TypeId::TINYINT}, Column{"s", TypeId::SMALLINT},
+                 Column{"i", TypeId::INTEGER}, Column{"g", TypeId::BIGINT}, Column{"d", TypeId::DECIMAL},
+                 Column{"v", TypeId::VARCHAR, 8}}};
+  std::vector<Tuple> tuples;
+  for (int x = -2; x <= 2; x++) {
+    auto null = x == 2;
+    tuples.emplace_back(
+        std::vector<Value>{
+            null ? ValueFactory::GetNullValueByType(TypeId::BOOLEAN) : ValueFactory::GetBooleanValue(x > 0),
+            ValueFactory::GetTinyIntValue(static_cast<int8_t>(x)),
+            null ? ValueFactory::GetNullValueByType(TypeId::SMALLINT) : ValueFactory::GetSmallIntValue(-x),
+            ValueFactory::GetIntegerValue(x * 1000), ValueFactory::GetBigIntValue(int64_t{x} << 40),
+            null ? ValueFactory::GetNullValueByType(TypeId::DECIMAL) : ValueFactory::GetDecimalValue(x * 0.5),
+            ValueFactory::GetVarcharValue("v")},
+        &schema);
+  }
+
+  std::vector<std::unique_ptr<AbstractExpression>> owned;
+  auto make = [&owned](AbstractExpression *expr) -> const AbstractExpression * {
+    owned.emplace_back(expr);
+    return expr;
+  };
+  std::vector<const AbstractExpression *> numeric;
+  for (uint32_t col = 1; col <= 5; col++) {
+    numeric.push_back(make(new ColumnValueExpression(0, col, schema.GetColumn(col).GetType())));
+  }
+  numeric.push_back(make(new ConstantValueExpression(ValueFactory::GetIntegerValue(0))));
+  numeric.push_back(make(new ConstantValueExpression(ValueFactory::GetDecimalValue(-0.5))));
+  numeric.push_back(make(new ConstantValueExpression(ValueFactory::GetNullValueByType(TypeId::INTEGER))));
+  const auto *column_b = make(new ColumnValueExpression(0, 0, TypeId::BOOLEAN));
+  const auto *column_d = numeric[4];
+  const auto *column_s = numeric[1];
+
+  std::vector<const AbstractExpression *> predicates{column_b};
+  for (auto type : {ComparisonType::Equal, ComparisonType::NotEqual, ComparisonType::LessThan,
+                    ComparisonType::LessThanOrEqual, ComparisonType::GreaterThan, ComparisonType::GreaterThanOrEqual}) {
+    for (const auto *left : numeric) {
+      for (const auto *right : numeric) {
+        predicates.push_back(make(new ComparisonExpression(left, right, type)));
+      }
+    }
+    // Comparisons of comparisons, and of BOOLEAN columns
+    predicates.push_back(make(new ComparisonExpression(
+        make(new ComparisonExpression(column_d, column_s, ComparisonType::LessThan)), column_b, type)));
+  }
+
+  for (const auto *predicate : predicates) {
+    auto program = ExpressionProgram::Compile(predicate, &schema);
+    ASSERT_NE(program, nullptr);
+    TupleBatch batch;
+    std::vector<bool> expected;
+    for (const auto &tuple : tuples) {
+      // A NULL BOOLEAN is a nonzero byte, so it passes like TRUE
+      expected.push_back(predicate->Evaluate(&tuple, &schema).GetAs<int8_t>() != 0);
+      ASSERT_EQ(program->Matches(tuple), expected.back());
+      batch.Append(Tuple{tuple}, tuple.GetRid());
+    }
+    program->Filter(&batch);
+    uint32_t selected = 0;
+    for (uint32_t i = 0; i < tuples.size(); i++) {
+      if (expected[i]) {
+        ASSERT_LT(selected, batch.Size());
+        ASSERT_EQ(batch.TupleAt(selected++).GetValue(&schema, 1).GetAs<int8_t>(),
+                  tuples[i].GetValue(&schema, 1).GetAs<int8_t>());
+      }
+    }
+    ASSERT_EQ(selected, batch.Size());
+  }
+
+  // Comparisons of constants fold away
+  const auto *constant_predicate = make(new ComparisonExpression(numeric[5], numeric[6], ComparisonType::LessThan));
+  auto folded = ExpressionProgram::Compile(constant_predicate, &schema);
+  ASSERT_NE(folded, nullptr);
+  ASSERT_EQ(folded->GetInstructionCount(), 0);
+
+  // VARCHAR columns, and BOOLEAN compared with numbers, are left to the interpreter
+  const auto *column_v = make(new ColumnValueExpression(0, 6, TypeId::VARCHAR));
+  const auto *constant_v = make(new ConstantValueExpression(ValueFactory::GetVarcharValue("v")));
+  const auto *varchar_predicate = make(new ComparisonExpression(column_v, constant_v, ComparisonType::Equal));
+  ASSERT_EQ(ExpressionProgram::Compile(varchar_predicate, &schema), nullptr);
+  const auto *mixed_predicate = make(new ComparisonExpression(column_b, column_s, ComparisonType::Equal));
+  ASSERT_EQ(ExpressionProgram::Compile(mixed_predicate, &schema), nullptr);
+
+  // Join predicates read each column from its own side
+  const auto *left_i = make(new ColumnValueExpression(0, 3, TypeId::INTEGER));
+  const auto *right_d = make(new ColumnValueExpression(1, 5, TypeId::DECIMAL));
+  const auto *join_predicate = make(new ComparisonExpression(left_i, right_d, ComparisonType::GreaterThan));
+  auto join_program = ExpressionProgram::Compile(join_predicate, &schema, &schema);
+  ASSERT_NE(join_program, nullptr);
+  for (const auto &left : tuples) {
+    for (const auto &right : tuples) {
+      auto expected = join_predicate->EvaluateJoin(&left, &schema, &right, &schema).GetAs<int8_t>() != 0;
+      ASSERT_EQ(join_program->MatchesJoin(left, right), expected);
+    }
+  }
+}
+
+TEST(MorselQueueTest, ClaimsEveryPageOnce) {
+  DiskManager disk_manager("morsel_queue_test.db");
+  BufferPoolManagerInstance bpm(10, &disk_manager);
+  Transaction txn(0);
+  TableHeap heap(&bpm, nullptr, nullptr, &txn);
+  Schema schema{std::vector<Column>{Column{"a", TypeId::VARCHAR, 128}}};
+  Tuple tuple{{ValueFactory::GetVarcharValue(std::string(100, 'x'))}, &schema};
+  for (int i = 0; i < 2000; i++) {
+    RID rid;
+    ASSERT_TRUE(heap.InsertTuple(tuple, &rid, &txn));
+  }
+  auto page_ids = heap.GetPageIds();
+  ASSERT_GT(page_ids.size(), MorselQueue::MORSEL_PAGES * 8);
+
+  MorselQueue queue(&heap);
+  EXPECT_EQ(queue.GetPageCount(), page_ids.size());
+  auto claim = [&queue] {
+    std::vector<page_id_t> claimed;
+    std::vector<page_id_t> morsel;
+    while (queue.Next(&morsel)) {
+      EXPECT_LE(morsel.size(), MorselQueue::MORSEL_PAGES);
+      claimed.insert(claimed.end(), morsel.begin(), morsel.end());
+    }
+    return claimed;
+  };
+  std::vector<std::future<std::vector<page_id_t>>> workers;
+  for (int i = 0; i < 4; i++) {
+    workers.push_back(std::async(std::launch::async, claim));
+  }
+  std::vector<page_id_t> claimed;
+  for (auto &worker : workers) {
+    auto pages = worker.get();
+    claimed.insert(claimed.end(), pages.begin(), pages.end());
+  }
+  std::sort(claimed.begin(), claimed.end());
+  std::sort(page_ids.begin(), page_ids.end());
+  EXPECT_EQ(claimed, page_ids);
+
+  disk_manager.ShutDown();
+  remove("morsel_queue_test.db");
+  remove("morsel_queue_test.log");
+}
+
+TEST(TaskSchedulerTest, RunsEveryTask) {
+  std::atomic<size_t> sum{0};
+  {
+    TaskScheduler scheduler{4};
+    std::vector<std::future<void>> futures;
+    for (size_t i = 0; i < 100; i++) {
+      // Tasks submitted from a worker land on its own deque and are stolen by the others
+      futures.emplace_back(scheduler.Submit([&scheduler, &sum, i] {
+        for (size_t j = 0; j < 10; j++) {
+          scheduler.Submit([&sum, i] { sum += i; });
+        }
+        sum += i;
+      }));
+    }
+    futures.emplace_back(scheduler.Submit([] { throw Exception(ExceptionType::INVALID, "task failed"); }));
+    for (size_t i = 0; i + 1 < futures.size(); i++) {
+      futures[i].get();
+    }
+    ASSERT_THROW(futures.back().get(), Exception);
+    // The scheduler runs the tasks still queued before its workers exit
+  }
+  ASSERT_EQ(sum.load(), 11 * 4950);
+}
+
+// SELECT colA FROM test_1 WHERE colA < 700, scanned by four instances that share the table's pages
+TEST_F(ExecutorTest, ExchangeSeqScanTest) {
+  auto *table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  auto *col_a = MakeColumnValueExpression(table_info->schema_, 0, "colA");
+  auto *predicate = MakeComparisonExpression(
+      col_a, MakeConstantValueExpression(ValueFactory::GetIntegerValue(700)), ComparisonType::LessThan);
+  auto *out_schema = MakeOutputSchema({{"colA", col_a}});
+  auto scan_plan = std::make_unique<SeqScanPlanNode>(out_schema, predicate, table_info->oid_);
+  auto exchange_plan = std::make_unique<ExchangePlanNode>(out_schema, scan_plan.get(), 4);
+
+  // Run it twice to check that Init() restarts the scan
+  for (int run = 0; run < 2; run++) {
+    std::vector<Tuple> result_set{};
+    GetExecutionEngine()->Execute(exchange_plan.get(), &result_set, GetTxn(), GetExecutorContext());
+    ASSERT_EQ(result_set.size(), 700);
+    std::vector<bool> seen(700, false);
+    for (const auto &tuple : result_set) {
+      auto a = tuple.GetValue(out_schema, 0).GetAs<int32_t>();
+      ASSERT_FALSE(seen[a]);
+      seen[a] = true;
+    }
+  }
+}
+
+// The same scan in a transaction that locks the rows it reads, whose instances take turns on the calling thread
+TEST_F(ExecutorTest, ExchangeLockingSeqScanTest) {
+  auto *table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  auto *col_a = MakeColumnValueExpression(table_info->schema_, 0, "colA");
+  auto *predicate = MakeComparisonExpression(
+      col_a, MakeConstantValueExpression(ValueFactory::GetIntegerValue(700)), ComparisonType::LessThan);
+  auto *out_schema = MakeOutputSchema({{"colA", col_a}});
+  auto scan_plan = std::make_unique<SeqScanPlanNode>(out_schema, predicate, table_info->oid_);
+  auto exchange_plan = std::make_unique<ExchangePlanNode>(out_schema, scan_plan.get(), 4);
+
+  // Rows are only locked with logging on; nothing is written, so nothing is logged
+  std::vector<Tuple> result_set{};
+  enable_logging = true;
+  GetExecutionEngine()->Execute(exchange_plan.get(), &result_set, GetTxn(), GetExecutorContext());
+  enable_logging = false;
+  ASSERT_EQ(result_set.size(), 700);
+  std::vector<bool> seen(700, false);
+  for (const auto &tuple : result_set) {
+    auto a = tuple.GetValue(out_schema, 0).GetAs<int32_t>();
+    ASSERT_FALSE(seen[a]);
+    seen[a] = true;
+  }
+  ASSERT_FALSE(GetTxn()->GetPageLockSet()->empty());
+}
+
+// SELECT l.colA, r.colA FROM test_1 l JOIN test_1 r ON l.colA = r.colA, with the probe side split between
+// three instances that each build the whole hash table
+TEST_F(ExecutorTest, ExchangeHashJoinTest) {
+  auto *table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  auto *col_a = MakeColumnValueExpression(table_info->schema_, 0, "colA");
+  auto *scan_schema = MakeOutputSchema({{"colA", col_a}});
+  auto build_plan = std::make_unique<SeqScanPlanNode>(scan_schema, nullptr, table_info->oid_);
+  auto probe_plan = std::make_unique<SeqScanPlanNode>(scan_schema, nullptr, table_info->oid_);
+  auto *left_a = MakeColumnValueExpression(*scan_schema, 0, "colA");
+  auto *right_a = MakeColumnValueExpression(*scan_schema, 1, "colA");
+  auto *out_schema = MakeOutputSchema({{"left_colA", left_a}, {"right_colA", right_a}});
+  auto join_plan = std::make_unique<HashJoinPlanNode>(
+      out_schema, std::vector<const AbstractPlanNode *>{build_plan.get(), probe_plan.get()}, left_a, right_a);
+  ASSERT_EQ(ExchangeExecutor::GetDrivingScan(join_plan.get()), probe_plan.get());
+  auto exchange_plan = std::make_unique<ExchangePlanNode>(out_schema, join_plan.get(), 3);
+
+  std::vector<Tuple> result_set{};
+  GetExecutionEngine()->Execute(exchange_plan.get(), &result_set, GetTxn(), GetExecutorContext());
+  ASSERT_EQ(result_set.size(), TEST1_SIZE);
+  std::vector<bool> seen(TEST1_SIZE, false);
+  for (const auto &tuple : result_set) {
+    auto a = tuple.GetValue(out_schema, 0).GetAs<int32_t>();
+    ASSERT_EQ(a, tuple.GetValue(out_schema, 1).GetAs<int32_t>());
+    ASSERT_FALSE(seen[a]);
+    seen[a] = true;
+  }
+}
+
 // SELECT colA, colB FROM test_3 LIMIT 10
-TEST_F(ExecutorTest, DISABLED_SimpleLimitTest) {
+TEST_F(ExecutorTest, SimpleLimitTest) {
   auto *table_info = GetExecutorContext()->GetCatalog()->GetTable("test_3");
   auto &schema = table_info->schema_;
 
@@ -618,7 +1445,7 @@ TEST_F(ExecutorTest, DISABLED_SimpleLimitTest) {
 }
 
 // SELECT DISTINCT colC FROM test_7
-TEST_F(ExecutorTest, DISABLED_SimpleDistinctTest) {
+TEST_F(ExecutorTest, SimpleDistinctTest) {
   auto *table_info = GetExecutorContext()->GetCatalog()->GetTable("test_7");
   auto &schema = table_info->schema_;
 
@@ -653,4 +1480,76 @@ TEST_F(ExecutorTest, DISABLED_SimpleDistinctTest) {
   ASSERT_TRUE(std::equal(results.cbegin(), results.cend(), expected.cbegin()));
 }
 
+// SELECT colA, colB FROM test_1 WHERE colA < 500, pulled both a batch and a tuple at a time
+TEST_F(ExecutorTest, BatchAndTupleAtATimeAgree) {
+  auto *table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  auto &schema = table_info->schema_;
+  auto *col_a = MakeColumnValueExpression(schema, 0, "colA");
+  auto *col_b = MakeColumnValueExpression(schema, 0, "colB");
+  auto *const500 = MakeConstantValueExpression(ValueFactory::GetIntegerValue(500));
+  auto *predicate = MakeComparisonExpression(col_a, const500, ComparisonType::LessThan);
+  auto *out_schema = MakeOutputSchema({{"colA", col_a}, {"colB", col_b}});
+  SeqScanPlanNode plan{out_schema, predicate, table_info->oid_};
+
+  // Batch at a time
+  std::vector<int32_t> batch_results{};
+  {
+    auto executor = ExecutorFactory::CreateExecutor(GetExecutorContext(), &plan);
+    executor->Init();
+    TupleBatch batch;
+    while (executor->NextBatch(&batch)) {
+      ASSERT_FALSE(batch.IsEmpty());
+      ASSERT_LE(batch.Size(), batch.Capacity());
+      for (uint32_t i = 0; i < batch.Size(); i++) {
+        batch_results.push_back(batch.TupleAt(i).GetValue(out_schema, 0).GetAs<int32_t>());
+      }
+    }
+  }
+
+  // Tuple at a time
+  std::vector<int32_t> tuple_results{};
+  {
+    auto executor = ExecutorFactory::CreateExecutor(GetExecutorContext(), &plan);
+    executor->Init();
+    Tuple tuple;
+    RID rid;
+    while (executor->Next(&tuple, &rid)) {
+      ASSERT_EQ(rid.GetPageId() != INVALID_PAGE_ID, true);
+      tuple_results.push_back(tuple.GetValue(out_schema, 0).GetAs<int32_t>());
+    }
+  }
+
+  ASSERT_EQ(batch_results.size(), 500UL);
+  ASSERT_EQ(batch_results, tuple_results);
+  for (auto i = 0UL; i < batch_results.size(); ++i) {
+    ASSERT_EQ(batch_results[i], static_cast<int32_t>(i));
+  }
+}
+
+// The selection vector narrows a batch in place without reordering the survivors
+TEST_F(ExecutorTest, TupleBatchSelectionTest) {
+  auto *table_info = GetExecutorContext()->GetCatalog()->GetTable("test_3");
+  const auto *schema = &table_info->schema_;
+
+  TupleBatch batch{16};
+  for (int32_t i = 0; !batch.IsFull(); i++) {
+    batch.Append(Tuple{{ValueFactory::GetIntegerValue(i), ValueFactory::GetIntegerValue(i)}, schema}, RID(0, i));
+  }
+  ASSERT_EQ(batch.Size(), 16U);
+
+  // Keep the even values, then only the first three of those
+  batch.Filter([schema](const Tuple &tuple) { return tuple.GetValue(schema, 0).GetAs<int32_t>() % 2 == 0; });
+  ASSERT_EQ(batch.Size(), 8U);
+  batch.Truncate(3);
+  ASSERT_EQ(batch.Size(), 3U);
+  for (uint32_t i = 0; i < batch.Size(); i++) {
+    ASSERT_EQ(batch.TupleAt(i).GetValue(schema, 0).GetAs<int32_t>(), static_cast<int32_t>(2 * i));
+    ASSERT_EQ(batch.RidAt(i).GetSlotNum(), 2 * i);
+  }
+
+  batch.Reset();
+  ASSERT_TRUE(batch.IsEmpty());
+  ASSERT_FALSE(batch.IsFull());
+}
+
 }  // namespace bustub
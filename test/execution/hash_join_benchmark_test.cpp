@@ -0,0 +1,104 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// hash_join_benchmark_test.cpp
+//
+// Identification: test/execution/hash_join_benchmark_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "execution/executor_factory.h"
+#include "execution/executors/hash_join_executor.h"
+#include "execution/plans/hash_join_plan.h"
+#include "execution/plans/seq_scan_plan.h"
+#include "executor_test_util.h"  // NOLINT
+#include "gtest/gtest.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+/**
+ * Join two generated tables whose build side is larger than the buffer pool: in memory, with a budget
+ * that forces the Grace hash join to spill, and radix partitioned.
+ */
+class HashJoinBenchmark : public ExecutorTest {
+ public:
+  /** Number of rows on the build side: about 40 pages, against a 32 frame buffer pool */
+  static constexpr int32_t BUILD_SIZE = 10000;
+  /** Number of rows on the probe side; every other probe row finds a match */
+  static constexpr int32_t PROBE_SIZE = 2 * BUILD_SIZE;
+
+  /** Create table `name` with columns (key, payload) holding the rows (i * stride, i) for i in [0, size) */
+  auto MakeTable(const std::string &name, int32_t size, int32_t stride) -> TableInfo * {
+    Schema schema{{Column{"key", TypeId::INTEGER}, Column{"payload", TypeId::INTEGER}}};
+    auto *table_info = GetCatalog()->CreateTable(GetTxn(), name, schema);
+    RID rid;
+    for (int32_t i = 0; i < size; i++) {
+      Tuple tuple{{ValueFactory::GetIntegerValue(i * stride), ValueFactory::GetIntegerValue(i)}, &table_info->schema_};
+      EXPECT_TRUE(table_info->table_->InsertTuple(tuple, &rid, GetTxn()));
+    }
+    return table_info;
+  }
+
+  /** Run the join to completion and return the number of output tuples and the elapsed milliseconds */
+  auto RunJoin(const AbstractPlanNode *plan, size_t budget) -> std::pair<size_t, int64_t> {
+    GetExecutorContext()->SetMemoryBudget(budget);
+    auto start = std::chrono::steady_clock::now();
+    auto executor = ExecutorFactory::CreateExecutor(GetExecutorContext(), plan);
+    executor->Init();
+    size_t count = 0;
+    TupleBatch batch;
+    while (executor->NextBatch(&batch)) {
+      count += batch.Size();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return {count, std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()};
+  }
+};
+
+// NOLINTNEXTLINE
+TEST_F(HashJoinBenchmark, BuildLargerThanBufferPool) {
+  auto *build_info = MakeTable("build", BUILD_SIZE, 2);
+  auto *probe_info = MakeTable("probe", PROBE_SIZE, 1);
+
+  auto *build_key = MakeColumnValueExpression(build_info->schema_, 0, "key");
+  auto *build_payload = MakeColumnValueExpression(build_info->schema_, 0, "payload");
+  auto *build_schema = MakeOutputSchema({{"key", build_key}, {"payload", build_payload}});
+  SeqScanPlanNode build_scan{build_schema, nullptr, build_info->oid_};
+
+  auto *probe_key = MakeColumnValueExpression(probe_info->schema_, 0, "key");
+  auto *probe_payload = MakeColumnValueExpression(probe_info->schema_, 0, "payload");
+  auto *probe_schema = MakeOutputSchema({{"key", probe_key}, {"payload", probe_payload}});
+  SeqScanPlanNode probe_scan{probe_schema, nullptr, probe_info->oid_};
+
+  auto *left_key = MakeColumnValueExpression(*build_schema, 0, "key");
+  auto *left_payload = MakeColumnValueExpression(*build_schema, 0, "payload");
+  auto *right_payload = MakeColumnValueExpression(*probe_schema, 1, "payload");
+  auto *right_key = MakeColumnValueExpression(*probe_schema, 1, "key");
+  auto *out_schema = MakeOutputSchema({{"key", left_key}, {"build", left_payload}, {"probe", right_payload}});
+  HashJoinPlanNode join_plan{out_schema, {&build_scan, &probe_scan}, left_key, right_key};
+
+  auto [in_memory_count, in_memory_ms] = RunJoin(&join_plan, EXECUTOR_MEMORY_BUDGET);
+  auto [spilled_count, spilled_ms] = RunJoin(&join_plan, 16 * 1024);
+  build_scan.SetEstimatedCardinality(HashJoinExecutor::RADIX_JOIN_MIN_BUILD_ROWS);
+  auto [radix_count, radix_ms] = RunJoin(&join_plan, EXECUTOR_MEMORY_BUDGET);
+  ASSERT_EQ(in_memory_count, static_cast<size_t>(BUILD_SIZE));
+  ASSERT_EQ(spilled_count, static_cast<size_t>(BUILD_SIZE));
+  ASSERT_EQ(radix_count, static_cast<size_t>(BUILD_SIZE));
+
+  std::printf("hash join, %d x %d rows, %zu frames: in-memory %ld ms, spilled (16KB budget) %ld ms, radix %ld ms\n",
+              BUILD_SIZE, PROBE_SIZE, GetBPM()->GetPoolSize(), static_cast<long>(in_memory_ms),  // NOLINT
+              static_cast<long>(spilled_ms), static_cast<long>(radix_ms));                     // NOLINT
+}
+
+}  // namespace bustub
@@ -0,0 +1,116 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// log_size_benchmark_test.cpp
+//
+// Identification: test/recovery/log_size_benchmark_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/bustub_instance.h"
+#include "gtest/gtest.h"
+#include "storage/table/table_heap.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+/**
+ * Run an update-heavy workload, small transactions that each update one row of a small table, and compare the
+ * log it writes to the size of the same records with full tuple images and fixed-width fields.
+ */
+class LogSizeBenchmark : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    remove("log_size.db");
+    DiskManager::RemoveLogFiles("log_size.db");
+  }
+
+  void TearDown() override {
+    remove("log_size.db");
+    DiskManager::RemoveLogFiles("log_size.db");
+  }
+
+  /** Rows in the table */
+  static constexpr int TABLE_SIZE = 200;
+  /** Update transactions */
+  static constexpr int UPDATES = 5000;
+  /** The fixed header of a record with full images, the RID and the two tuple lengths of its update body */
+  static constexpr size_t FULL_HEADER_SIZE = 20;
+  static constexpr size_t FULL_UPDATE_BODY_SIZE = sizeof(RID) + 2 * sizeof(int32_t);
+};
+
+// NOLINTNEXTLINE
+TEST_F(LogSizeBenchmark, UpdateHeavyWorkload) {
+  auto *bustub_instance = new BustubInstance("log_size.db");
+  bustub_instance->log_manager_->RunFlushThread();
+  Schema schema{{Column{"id", TypeId::INTEGER}, Column{"balance", TypeId::INTEGER},
+                 Column{"note", TypeId::VARCHAR, 64}}};
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                              bustub_instance->log_manager_, txn);
+  std::vector<RID> rids(TABLE_SIZE);
+  std::vector<Tuple> rows;
+  for (int i = 0; i < TABLE_SIZE; i++) {
+    rows.emplace_back(Tuple{{ValueFactory::GetIntegerValue(i), ValueFactory::GetIntegerValue(0),
+                             ValueFactory::GetVarcharValue(std::string(48, static_cast<char>('a' + i % 26)))},
+                            &schema});
+    ASSERT_TRUE(table->InsertTuple(rows.back(), &rids[i], txn));
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  int log_start = bustub_instance->disk_manager_->GetLogEndOffset();
+
+  // Most updates change the balance; every fourth also rewrites the note, with a new length no longer than the
+  // original one so the row still fits its page
+  std::mt19937 generator(42);
+  size_t full_image_bytes = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < UPDATES; i++) {
+    int row = static_cast<int>(generator() % TABLE_SIZE);
+    Value note = rows[row].GetValue(&schema, 2);
+    if (i % 4 == 0) {
+      note = ValueFactory::GetVarcharValue(std::string(40 + generator() % 9, static_cast<char>('a' + i % 26)));
+    }
+    Tuple updated{{ValueFactory::GetIntegerValue(row), ValueFactory::GetIntegerValue(i), note}, &schema};
+    txn = bustub_instance->transaction_manager_->Begin();
+    ASSERT_TRUE(table->UpdateTuple(updated, rids[row], txn));
+    bustub_instance->transaction_manager_->Commit(txn);
+    delete txn;
+    // BEGIN, UPDATE and COMMIT with full images
+    full_image_bytes += 3 * FULL_HEADER_SIZE + FULL_UPDATE_BODY_SIZE + rows[row].GetLength() + updated.GetLength();
+    rows[row] = updated;
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  size_t log_bytes = bustub_instance->disk_manager_->GetLogEndOffset() - log_start;
+
+  // The log still recovers the table
+  for (int i = 0; i < TABLE_SIZE; i++) {
+    Tuple tuple;
+    txn = bustub_instance->transaction_manager_->Begin();
+    ASSERT_TRUE(table->GetTuple(rids[i], &tuple, txn));
+    bustub_instance->transaction_manager_->Commit(txn);
+    delete txn;
+    ASSERT_EQ(0, std::memcmp(tuple.GetData(), rows[i].GetData(), tuple.GetLength()));
+  }
+  EXPECT_LT(log_bytes * 2, full_image_bytes);
+
+  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+  std::printf("log size, %d update transactions: %zu bytes (%.1f per txn), full images %zu bytes (%.1f per txn), "
+              "%ld ms\n",
+              UPDATES, log_bytes, static_cast<double>(log_bytes) / UPDATES, full_image_bytes,
+              static_cast<double>(full_image_bytes) / UPDATES, static_cast<long>(ms));  // NOLINT
+  delete table;
+  delete bustub_instance;
+}
+
+}  // namespace bustub
@@ -10,7 +10,10 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <atomic>
+#include <chrono>  // NOLINT
 #include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
 #include "common/bustub_instance.h"
@@ -31,19 +34,64 @@ class RecoveryTest : public ::testing::Test {
   // This function is called before every test.
   void SetUp() override {
     remove("test.db");
-    remove("test.log");
+    DiskManager::RemoveLogFiles("test.db");
   }
 
   // This function is called after every test.
   void TearDown() override {
     LOG_INFO("Tearing down the system..");
     remove("test.db");
-    remove("test.log");
+    DiskManager::RemoveLogFiles("test.db");
   };
 };
 
 // NOLINTNEXTLINE
-TEST_F(RecoveryTest, DISABLED_RedoTest) {
+TEST_F(RecoveryTest, GroupCommitTest) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+  ASSERT_TRUE(enable_logging);
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  const Tuple tuple = ConstructTuple(&schema);
+
+  // Every commit waits until its record is on disk, but commits that wait together share a flush
+  constexpr int num_threads = 8;
+  constexpr int commits_per_thread = 50;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < commits_per_thread; j++) {
+        Transaction *txn = bustub_instance->transaction_manager_->Begin();
+        RID rid;
+        EXPECT_TRUE(test_table->InsertTuple(tuple, &rid, txn));
+        bustub_instance->transaction_manager_->Commit(txn);
+        EXPECT_GE(bustub_instance->log_manager_->GetPersistentLSN(), txn->GetPrevLSN());
+        delete txn;
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(bustub_instance->log_manager_->GetNextLSN() - 1, bustub_instance->log_manager_->GetPersistentLSN());
+  EXPECT_LT(bustub_instance->log_manager_->GetFlushCount(), static_cast<uint64_t>(num_threads * commits_per_thread));
+
+  delete test_table;
+  delete bustub_instance;
+  EXPECT_FALSE(enable_logging);
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, RedoTest) {
   BustubInstance *bustub_instance = new BustubInstance("test.db");
 
   ASSERT_FALSE(enable_logging);
@@ -101,7 +149,8 @@ TEST_F(RecoveryTest, DISABLED_RedoTest) {
   delete txn;
 
   LOG_INFO("Begin recovery");
-  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_,
+                                       bustub_instance->log_manager_);
 
   ASSERT_FALSE(enable_logging);
 
@@ -132,7 +181,7 @@ TEST_F(RecoveryTest, DISABLED_RedoTest) {
 }
 
 // NOLINTNEXTLINE
-TEST_F(RecoveryTest, DISABLED_UndoTest) {
+TEST_F(RecoveryTest, UndoTest) {
   BustubInstance *bustub_instance = new BustubInstance("test.db");
 
   ASSERT_FALSE(enable_logging);
@@ -185,7 +234,8 @@ TEST_F(RecoveryTest, DISABLED_UndoTest) {
   delete txn;
 
   LOG_INFO("Recovery started..");
-  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_,
+                                       bustub_instance->log_manager_);
 
   ASSERT_FALSE(enable_logging);
 
@@ -211,7 +261,289 @@ TEST_F(RecoveryTest, DISABLED_UndoTest) {
 }
 
 // NOLINTNEXTLINE
-TEST_F(RecoveryTest, DISABLED_CheckpointTest) {
+TEST_F(RecoveryTest, RestartContinuesLsnTest) {
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+
+  LOG_INFO("First run: commit an insert and write its page to disk");
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  RID rid;
+  ASSERT_TRUE(test_table->InsertTuple(ConstructTuple(&schema), &rid, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  bustub_instance->buffer_pool_manager_->FlushPage(first_page_id);
+  lsn_t first_run_lsn = bustub_instance->log_manager_->GetNextLSN();
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+
+  LOG_INFO("Second run: the LSNs carry on; crash after committing an insert on the same page");
+  bustub_instance = new BustubInstance("test.db");
+  ASSERT_GE(bustub_instance->log_manager_->GetNextLSN(), first_run_lsn);
+  bustub_instance->log_manager_->RunFlushThread();
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  RID rid1;
+  ASSERT_TRUE(test_table->InsertTuple(ConstructTuple(&schema), &rid1, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+
+  LOG_INFO("Recovery redoes the insert of the second run over the page written in the first");
+  bustub_instance = new BustubInstance("test.db");
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_,
+                                       bustub_instance->log_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  Tuple tuple;
+  ASSERT_TRUE(test_table->GetTuple(rid, &tuple, txn));
+  ASSERT_TRUE(test_table->GetTuple(rid1, &tuple, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  delete log_recovery;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, UndoIsLoggedTest) {
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+
+  LOG_INFO("Crash with an unfinished insert on disk");
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  txn = bustub_instance->transaction_manager_->Begin();
+  RID loser_rid;
+  ASSERT_TRUE(test_table->InsertTuple(ConstructTuple(&schema), &loser_rid, txn));
+  bustub_instance->buffer_pool_manager_->FlushPage(first_page_id);
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+
+  LOG_INFO("Recover, then crash after committing an insert into the slot the undo freed");
+  bustub_instance = new BustubInstance("test.db");
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_,
+                                       bustub_instance->log_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  delete log_recovery;
+  bustub_instance->log_manager_->RunFlushThread();
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  const Tuple tuple = ConstructTuple(&schema);
+  RID rid;
+  ASSERT_TRUE(test_table->InsertTuple(tuple, &rid, txn));
+  ASSERT_EQ(rid, loser_rid);
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+
+  LOG_INFO("The loser was rolled back for good, so the second recovery keeps the committed insert");
+  bustub_instance = new BustubInstance("test.db");
+  log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_,
+                                 bustub_instance->log_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  Tuple recovered;
+  ASSERT_TRUE(test_table->GetTuple(rid, &recovered, txn));
+  ASSERT_EQ(recovered.GetValue(&schema, 0).CompareEquals(tuple.GetValue(&schema, 0)), CmpBool::CmpTrue);
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  delete log_recovery;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, ScanWaitsForLockWithoutLatchTest) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  RID updated_rid;
+  RID deleted_rid;
+  ASSERT_TRUE(test_table->InsertTuple(ConstructTuple(&schema), &updated_rid, txn));
+  ASSERT_TRUE(test_table->InsertTuple(ConstructTuple(&schema), &deleted_rid, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  LOG_INFO("A scan waits for a row locked by an update");
+  Transaction *writer = bustub_instance->transaction_manager_->Begin();
+  ASSERT_TRUE(test_table->UpdateTuple(ConstructTuple(&schema), updated_rid, writer));
+  ASSERT_TRUE(test_table->MarkDelete(deleted_rid, writer));
+  Transaction *reader = bustub_instance->transaction_manager_->Begin();
+  std::atomic<bool> scanned{false};
+  size_t count = 0;
+  std::thread scan([&] {
+    for (auto it = test_table->Begin(reader); it != test_table->End(); ++it) {
+      count++;
+    }
+    scanned = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(scanned);
+
+  LOG_INFO("The delete latches the page to commit, so the scan must not hold the latch while it waits");
+  bustub_instance->transaction_manager_->Commit(writer);
+  scan.join();
+  EXPECT_EQ(1, count);
+  bustub_instance->transaction_manager_->Commit(reader);
+  delete writer;
+  delete reader;
+  delete test_table;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, BulkAppendOfAbortedTransactionTest) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  LOG_INFO("A transaction wounded before it locks the appended tuples leaves the table as it was");
+  txn = bustub_instance->transaction_manager_->Begin();
+  txn->SetState(TransactionState::ABORTED);
+  std::vector<Tuple> tuples{ConstructTuple(&schema), ConstructTuple(&schema)};
+  std::vector<RID> rids;
+  EXPECT_FALSE(test_table->BulkAppend(tuples, &rids, txn));
+  EXPECT_EQ(1, test_table->GetPageIds().size());
+  bustub_instance->transaction_manager_->Abort(txn);
+  delete txn;
+
+  txn = bustub_instance->transaction_manager_->Begin();
+  EXPECT_TRUE(test_table->Begin(txn) == test_table->End());
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, ParallelRedoTest) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+
+  // Committed inserts, updates and deletes spread over many more pages than the buffer pool holds
+  std::vector<RID> rids;
+  std::vector<Tuple> tuples;
+  txn = bustub_instance->transaction_manager_->Begin();
+  for (int i = 0; i < 1000; i++) {
+    RID rid;
+    tuples.push_back(ConstructTuple(&schema));
+    ASSERT_TRUE(test_table->InsertTuple(tuples.back(), &rid, txn));
+    rids.push_back(rid);
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  txn = bustub_instance->transaction_manager_->Begin();
+  for (size_t i = 0; i < rids.size(); i += 3) {
+    ASSERT_TRUE(test_table->MarkDelete(rids[i], txn));
+  }
+  for (size_t i = 1; i < rids.size(); i += 3) {
+    // A tuple of the same size fits in place
+    tuples[i] = Tuple({tuples[i].GetValue(&schema, 0), Value(TypeId::SMALLINT, static_cast<int16_t>(i))}, &schema);
+    ASSERT_TRUE(test_table->UpdateTuple(tuples[i], rids[i], txn));
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  // An unfinished transaction, whose records reach the log when the flush thread stops
+  txn = bustub_instance->transaction_manager_->Begin();
+  std::vector<RID> lost_rids;
+  for (int i = 0; i < 100; i++) {
+    RID rid;
+    ASSERT_TRUE(test_table->InsertTuple(ConstructTuple(&schema), &rid, txn));
+    lost_rids.push_back(rid);
+  }
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+
+  bustub_instance = new BustubInstance("test.db");
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_,
+                                       bustub_instance->log_manager_, 4);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  delete log_recovery;
+
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  for (size_t i = 0; i < rids.size(); i++) {
+    Tuple tuple;
+    if (i % 3 == 0) {
+      EXPECT_FALSE(test_table->GetTuple(rids[i], &tuple, txn));
+      continue;
+    }
+    ASSERT_TRUE(test_table->GetTuple(rids[i], &tuple, txn));
+    EXPECT_EQ(tuple.GetLength(), tuples[i].GetLength());
+    EXPECT_EQ(0, std::memcmp(tuple.GetData(), tuples[i].GetData(), tuple.GetLength()));
+  }
+  for (const auto &rid : lost_rids) {
+    Tuple tuple;
+    EXPECT_FALSE(test_table->GetTuple(rid, &tuple, txn));
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, CheckpointTest) {
   BustubInstance *bustub_instance = new BustubInstance("test.db");
 
   EXPECT_FALSE(enable_logging);
@@ -314,4 +646,148 @@ TEST_F(RecoveryTest, DISABLED_CheckpointTest) {
   LOG_INFO("Shutdown System");
   delete bustub_instance;
 }
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, FuzzyCheckpointTest) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+
+  // Transactions keep committing while checkpoints are taken
+  std::atomic<bool> done{false};
+  std::vector<RID> rids;
+  std::vector<Tuple> tuples;
+  std::thread writer([&] {
+    for (int i = 0; i < 20; i++) {
+      Transaction *writer_txn = bustub_instance->transaction_manager_->Begin();
+      for (int j = 0; j < 50; j++) {
+        RID rid;
+        tuples.push_back(ConstructTuple(&schema));
+        ASSERT_TRUE(test_table->InsertTuple(tuples.back(), &rid, writer_txn));
+        rids.push_back(rid);
+      }
+      bustub_instance->transaction_manager_->Commit(writer_txn);
+      delete writer_txn;
+    }
+    done = true;
+  });
+  int checkpoints = 0;
+  do {
+    bustub_instance->checkpoint_manager_->BeginCheckpoint();
+    bustub_instance->checkpoint_manager_->EndCheckpoint();
+    checkpoints++;
+  } while (!done);
+  writer.join();
+  EXPECT_GT(checkpoints, 0);
+
+  // A transaction unfinished at the last checkpoint, with changes before and after it
+  txn = bustub_instance->transaction_manager_->Begin();
+  std::vector<RID> lost_rids;
+  for (int i = 0; i < 100; i++) {
+    if (i == 50) {
+      bustub_instance->checkpoint_manager_->BeginCheckpoint();
+    }
+    RID rid;
+    ASSERT_TRUE(test_table->InsertTuple(ConstructTuple(&schema), &rid, txn));
+    lost_rids.push_back(rid);
+  }
+  bustub_instance->checkpoint_manager_->EndCheckpoint();
+  EXPECT_GT(bustub_instance->disk_manager_->ReadMasterRecord(), 0);
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+
+  bustub_instance = new BustubInstance("test.db");
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_,
+                                       bustub_instance->log_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  delete log_recovery;
+
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  for (size_t i = 0; i < rids.size(); i++) {
+    Tuple tuple;
+    ASSERT_TRUE(test_table->GetTuple(rids[i], &tuple, txn));
+    EXPECT_EQ(0, std::memcmp(tuple.GetData(), tuples[i].GetData(), tuple.GetLength()));
+  }
+  for (const auto &rid : lost_rids) {
+    Tuple tuple;
+    EXPECT_FALSE(test_table->GetTuple(rid, &tuple, txn));
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, LogRecordFormatTest) {
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  RID rid(3, 7);
+
+  for (int i = 0; i < 100; i++) {
+    // Updates of the same size, changing one column, and of any size
+    Tuple old_tuple = ConstructTuple(&schema);
+    Tuple new_tuple = ConstructTuple(&schema);
+    if (i % 2 == 1) {
+      new_tuple = Tuple({old_tuple.GetValue(&schema, 0), Value(TypeId::SMALLINT, static_cast<int16_t>(i))}, &schema);
+    }
+    LogRecord log_record(5, 9, LogRecordType::UPDATE, rid, old_tuple, new_tuple);
+    std::vector<char> data(log_record.GetSize());
+    log_record.SerializeTo(data.data());
+
+    LogRecord decoded;
+    ASSERT_TRUE(decoded.DeserializeFrom(data.data(), data.size()));
+    EXPECT_EQ(decoded.GetSize(), log_record.GetSize());
+    EXPECT_EQ(decoded.GetTxnId(), 5);
+    EXPECT_EQ(decoded.GetPrevLSN(), 9);
+    EXPECT_EQ(decoded.GetUpdateRID(), rid);
+    Tuple redone = decoded.ApplyUpdate(old_tuple, false);
+    ASSERT_EQ(redone.GetLength(), new_tuple.GetLength());
+    EXPECT_EQ(0, std::memcmp(redone.GetData(), new_tuple.GetData(), new_tuple.GetLength()));
+    Tuple undone = decoded.ApplyUpdate(new_tuple, true);
+    ASSERT_EQ(undone.GetLength(), old_tuple.GetLength());
+    EXPECT_EQ(0, std::memcmp(undone.GetData(), old_tuple.GetData(), old_tuple.GetLength()));
+    if (i % 2 == 1) {
+      // Only the changed bytes are logged, not both tuples
+      EXPECT_LT(log_record.GetSize(), static_cast<int32_t>(old_tuple.GetLength() + new_tuple.GetLength()));
+    }
+
+    // A torn or corrupted record is rejected
+    EXPECT_FALSE(decoded.DeserializeFrom(data.data(), data.size() - 1));
+    data.back() ^= 1;
+    EXPECT_FALSE(decoded.DeserializeFrom(data.data(), data.size()));
+  }
+
+  // A compensation record keeps its type and undo-next LSN, including an invalid one
+  for (lsn_t undo_next_lsn : {lsn_t{4}, INVALID_LSN}) {
+    LogRecord clr(5, 9, LogRecordType::APPLYDELETE, rid, ConstructTuple(&schema));
+    clr.SetUndoNextLSN(undo_next_lsn);
+    std::vector<char> data(clr.GetSize());
+    clr.SerializeTo(data.data());
+    LogRecord decoded;
+    ASSERT_TRUE(decoded.DeserializeFrom(data.data(), data.size()));
+    EXPECT_EQ(decoded.GetLogRecordType(), LogRecordType::APPLYDELETE);
+    EXPECT_TRUE(decoded.IsCompensation());
+    EXPECT_EQ(decoded.GetUndoNextLSN(), undo_next_lsn);
+    EXPECT_EQ(decoded.GetDeleteRID(), rid);
+  }
+}
+
 }  // namespace bustub
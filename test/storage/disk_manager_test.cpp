@@ -11,6 +11,8 @@
 //===----------------------------------------------------------------------===//
 
 #include <cstring>
+#include <fstream>
+#include <string>
 
 #include "common/exception.h"
 #include "gtest/gtest.h"
@@ -23,13 +25,13 @@ class DiskManagerTest : public ::testing::Test {
   // This function is called before every test.
   void SetUp() override {
     remove("test.db");
-    remove("test.log");
+    DiskManager::RemoveLogFiles("test.db");
   }
 
   // This function is called after every test.
   void TearDown() override {
     remove("test.db");
-    remove("test.log");
+    DiskManager::RemoveLogFiles("test.db");
   };
 };
 
@@ -72,6 +74,209 @@ TEST_F(DiskManagerTest, ReadWriteLogTest) {
   dm.ShutDown();
 }
 
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, LogSegmentTest) {
+  // Segments of 64 log bytes after their header
+  const int segment_size = 64 + 16;
+  char data[2][100];
+  char expected[400];
+  for (int i = 0; i < 400; i++) {
+    expected[i] = static_cast<char>(i % 251 + 1);
+  }
+  char buf[400] = {0};
+  std::string db_file("test.db");
+  {
+    auto dm = DiskManager(db_file, segment_size);
+    EXPECT_EQ(0, dm.GetLogEndOffset());
+    EXPECT_FALSE(dm.ReadLog(buf, 16, 0));
+
+    // Writes cross into new segments
+    for (int i = 0; i < 4; i++) {
+      std::memcpy(data[i % 2], expected + i * 50, 50);
+      dm.WriteLog(data[i % 2], 50);
+    }
+    EXPECT_EQ(200, dm.GetLogEndOffset());
+    EXPECT_EQ(4, dm.GetLogSegmentFileCount());
+    EXPECT_TRUE(dm.ReadLog(buf, 200, 0));
+    EXPECT_EQ(std::memcmp(buf, expected, 200), 0);
+    EXPECT_FALSE(dm.ReadLog(buf, 16, 200));
+    EXPECT_EQ(128, dm.GetNextLogSegmentOffset(100));
+
+    // The segments before the offset are zeroed and kept for reuse
+    dm.TruncateLog(130);
+    EXPECT_EQ(4, dm.GetLogSegmentFileCount());
+    EXPECT_FALSE(dm.ReadLog(buf, 16, 0));
+    EXPECT_TRUE(dm.ReadLog(buf, 72, 128));
+    EXPECT_EQ(std::memcmp(buf, expected + 128, 72), 0);
+
+    // New segments take the recycled files
+    std::memcpy(data[0], expected + 200, 100);
+    dm.WriteLog(data[0], 100);
+    EXPECT_EQ(300, dm.GetLogEndOffset());
+    EXPECT_EQ(4, dm.GetLogSegmentFileCount());
+    EXPECT_TRUE(dm.ReadLog(buf, 172, 128));
+    EXPECT_EQ(std::memcmp(buf, expected + 128, 172), 0);
+    dm.ShutDown();
+  }
+
+  // Reopening continues in the next segment; the records written are still there
+  auto dm = DiskManager(db_file, segment_size);
+  EXPECT_EQ(320, dm.GetLogEndOffset());
+  EXPECT_TRUE(dm.ReadLog(buf, 172, 128));
+  EXPECT_EQ(std::memcmp(buf, expected + 128, 172), 0);
+  std::memcpy(data[1], expected + 320, 80);
+  dm.WriteLog(data[1], 80);
+  EXPECT_TRUE(dm.ReadLog(buf, 80, 320));
+  EXPECT_EQ(std::memcmp(buf, expected + 320, 80), 0);
+
+  // Archived segments are moved out of the log
+  dm.SetLogArchiveDirectory("test_log_archive");
+  dm.TruncateLog(320);
+  EXPECT_FALSE(dm.ReadLog(buf, 16, 128));
+  EXPECT_TRUE(dm.ReadLog(buf, 80, 320));
+  std::ifstream archived("test_log_archive/test.log.000004");
+  EXPECT_TRUE(archived.is_open());
+  dm.ShutDown();
+  DiskManager::RemoveLogFiles("test_log_archive/test.db");
+  remove("test_log_archive");
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, FreePageReuseTest) {
+  char data[PAGE_SIZE] = {0};
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file);
+
+  for (page_id_t page_id = 0; page_id < 6; page_id++) {
+    EXPECT_EQ(page_id, dm.AllocatePage());
+    dm.WritePage(page_id, data);
+  }
+  dm.DeallocatePage(1);
+  dm.DeallocatePage(3);
+  EXPECT_EQ(2, dm.GetFreePageCount());
+
+  // The lowest free pages are reused before the file grows
+  EXPECT_EQ(1, dm.AllocatePage());
+  EXPECT_EQ(3, dm.AllocatePage());
+  EXPECT_EQ(6, dm.AllocatePage());
+  EXPECT_EQ(0, dm.GetFreePageCount());
+
+  // Page ids striped over several instances skip the ids of the others, which stay free for them
+  EXPECT_EQ(9, dm.AllocatePage(4, 1));
+  EXPECT_EQ(7, dm.AllocatePage(4, 3));
+  EXPECT_EQ(8, dm.AllocatePage(4, 0));
+
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, FreePageRecoveryTest) {
+  char data[PAGE_SIZE] = {0};
+  std::strncpy(data, "A test string.", sizeof(data));
+  std::string db_file("test.db");
+  {
+    auto dm = DiskManager(db_file);
+    for (page_id_t page_id = 0; page_id < 8; page_id++) {
+      EXPECT_EQ(page_id, dm.AllocatePage());
+      dm.WritePage(page_id, data);
+    }
+    dm.DeallocatePage(2);
+    dm.DeallocatePage(6);
+    dm.DeallocatePage(7);
+    // Free pages at the end of the file are given back to the file system
+    EXPECT_EQ(6, dm.GetPageCount());
+    EXPECT_EQ(1, dm.GetFreePageCount());
+    dm.ShutDown();
+  }
+
+  auto dm = DiskManager(db_file);
+  EXPECT_EQ(6, dm.GetPageCount());
+  EXPECT_EQ(1, dm.GetFreePageCount());
+  EXPECT_EQ(2, dm.AllocatePage());
+  EXPECT_EQ(6, dm.AllocatePage());
+
+  // Pages in use are untouched
+  char buf[PAGE_SIZE] = {0};
+  dm.ReadPage(5, buf);
+  EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+
+  // Writing a free page, as recovery does, puts it back in use
+  dm.DeallocatePage(4);
+  dm.WritePage(4, data);
+  EXPECT_EQ(0, dm.GetFreePageCount());
+  EXPECT_EQ(7, dm.AllocatePage());
+
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, FreePageCrashTest) {
+  char data[PAGE_SIZE] = {0};
+  std::strncpy(data, "A test string.", sizeof(data));
+  std::string db_file("test.db");
+  {
+    auto dm = DiskManager(db_file);
+    for (page_id_t page_id = 0; page_id < 4; page_id++) {
+      EXPECT_EQ(page_id, dm.AllocatePage());
+      dm.WritePage(page_id, data);
+    }
+    dm.ShutDown();
+  }
+  {
+    auto dm = DiskManager(db_file);
+    dm.DeallocatePage(1);
+    // Pages 4, 5, 7 and 8 are skipped for the other instances, page 9 is allocated but never written
+    EXPECT_EQ(6, dm.AllocatePage(3, 0));
+    dm.WritePage(6, data);
+    EXPECT_EQ(9, dm.AllocatePage(3, 0));
+    char buf[PAGE_SIZE];
+    std::memset(buf, 1, sizeof(buf));
+    dm.ReadPage(9, buf);
+    EXPECT_EQ(buf[sizeof(page_id_t)], 0);
+    // The database stops without shutting down
+  }
+
+  // Page 1 lies below the end of the saved free page map, so only the map knows it is free
+  auto dm = DiskManager(db_file);
+  EXPECT_EQ(7, dm.GetPageCount());
+  EXPECT_EQ(3, dm.GetFreePageCount());
+  EXPECT_EQ(1, dm.AllocatePage());
+  EXPECT_EQ(4, dm.AllocatePage());
+  EXPECT_EQ(5, dm.AllocatePage());
+  EXPECT_EQ(7, dm.AllocatePage());
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, StaleFreePageMapTest) {
+  char data[PAGE_SIZE] = {0};
+  std::strncpy(data, "A test string.", sizeof(data));
+  std::string db_file("test.db");
+  {
+    auto dm = DiskManager(db_file);
+    for (page_id_t page_id = 0; page_id < 4; page_id++) {
+      EXPECT_EQ(page_id, dm.AllocatePage());
+      dm.WritePage(page_id, data);
+    }
+    dm.ShutDown();
+  }
+  {
+    auto dm = DiskManager(db_file);
+    dm.DeallocatePage(2);
+    EXPECT_EQ(2, dm.AllocatePage());
+    dm.WritePage(2, data);
+    // The database stops without shutting down, so the map still lists page 2 as free
+  }
+
+  // A listed page that was written since is left alone
+  auto dm = DiskManager(db_file);
+  EXPECT_EQ(4, dm.AllocatePage());
+  char buf[PAGE_SIZE] = {0};
+  dm.ReadPage(2, buf);
+  EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+  dm.ShutDown();
+}
+
 // NOLINTNEXTLINE
 TEST_F(DiskManagerTest, ThrowBadFileTest) { EXPECT_THROW(DiskManager("dev/null\\/foo/bar/baz/test.db"), Exception); }
 
@@ -19,7 +19,7 @@
 namespace bustub {
 
 // NOLINTNEXTLINE
-TEST(TmpTuplePageTest, DISABLED_BasicTest) {
+TEST(TmpTuplePageTest, BasicTest) {
   // There are many ways to do this assignment, and this is only one of them.
   // If you don't like the TmpTuplePage idea, please feel free to delete this test case entirely.
   // You will get full credit as long as you are correctly using a linear probe hash table.
@@ -41,11 +41,30 @@ TEST(TmpTuplePageTest, DISABLED_BasicTest) {
 
   Tuple tuple(values, &schema);
   TmpTuple tmp_tuple(INVALID_PAGE_ID, 0);
-  page.Insert(tuple, &tmp_tuple);
+  ASSERT_TRUE(page.Insert(tuple, &tmp_tuple));
+  ASSERT_EQ(tmp_tuple.GetPageId(), page_id);
+  ASSERT_EQ(tmp_tuple.GetOffset(), PAGE_SIZE - 8);
 
   ASSERT_EQ(*reinterpret_cast<uint32_t *>(data + sizeof(page_id_t) + sizeof(lsn_t)), PAGE_SIZE - 8);
   ASSERT_EQ(*reinterpret_cast<uint32_t *>(data + PAGE_SIZE - 8), 4);
   ASSERT_EQ(*reinterpret_cast<uint32_t *>(data + PAGE_SIZE - 4), 123);
+
+  // Fill the page up and read everything back, most recent insert first
+  uint32_t inserted = 1;
+  values[0] = ValueFactory::GetIntegerValue(456);
+  Tuple other(values, &schema);
+  while (page.Insert(other, &tmp_tuple)) {
+    inserted++;
+  }
+  ASSERT_LT(page.GetFreeSpaceRemaining(), 8U);
+
+  uint32_t read = 0;
+  Tuple result;
+  for (uint32_t offset = page.GetFreeSpacePointer(); offset < PAGE_SIZE; read++) {
+    offset = page.Get(offset, &result);
+    ASSERT_EQ(result.GetValue(&schema, 0).GetAs<int32_t>(), read + 1 == inserted ? 123 : 456);
+  }
+  ASSERT_EQ(read, inserted);
 }
 
 }  // namespace bustub
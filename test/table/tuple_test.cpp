@@ -14,13 +14,16 @@
 #include <cstdio>
 #include <iostream>
 #include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
 #include "buffer/buffer_pool_manager_instance.h"
+#include "concurrency/transaction_manager.h"
 #include "gtest/gtest.h"
 #include "logging/common.h"
 #include "storage/table/table_heap.h"
 #include "storage/table/tuple.h"
+#include "type/value_factory.h"
 
 namespace bustub {
 // NOLINTNEXTLINE
@@ -71,4 +74,313 @@ TEST(TupleTest, DISABLED_TableHeapTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(TupleTest, TableIteratorTest) {
+  Schema schema{std::vector<Column>{Column{"a", TypeId::INTEGER}, Column{"b", TypeId::VARCHAR, 32}}};
+  auto *disk_manager = new DiskManager("test.db");
+  auto *buffer_pool_manager = new BufferPoolManagerInstance(10, disk_manager);
+  Transaction txn(0);
+  auto *table = new TableHeap(buffer_pool_manager, nullptr, nullptr, &txn);
+
+  // Enough tuples to span many more pages than the buffer pool holds.
+  const int count = 2000;
+  std::vector<RID> rid_v;
+  for (int i = 0; i < count; ++i) {
+    Tuple tuple{{ValueFactory::GetIntegerValue(i), ValueFactory::GetVarcharValue(std::to_string(i))}, &schema};
+    RID rid;
+    ASSERT_TRUE(table->InsertTuple(tuple, &rid, &txn));
+    rid_v.push_back(rid);
+  }
+
+  int i = 0;
+  Tuple copy;
+  for (auto itr = table->Begin(&txn); itr != table->End(); ++itr, ++i) {
+    ASSERT_LT(i, count);
+    EXPECT_EQ(itr->GetRid(), rid_v[i]);
+    EXPECT_EQ(itr->GetValue(&schema, 0).GetAs<int32_t>(), i);
+    EXPECT_FALSE(itr->IsAllocated());
+    if (i == 100) {
+      copy = itr.CopyTuple();
+    }
+  }
+  EXPECT_EQ(i, count);
+
+  // The copy owns its data once the iterator is gone.
+  EXPECT_TRUE(copy.IsAllocated());
+  EXPECT_EQ(copy.GetRid(), rid_v[100]);
+  EXPECT_EQ(copy.GetValue(&schema, 1).ToString(), "100");
+
+  // A clone made by post-increment keeps its view while the original moves on to other pages.
+  auto itr = table->Begin(&txn);
+  for (int j = 0; j < 10; ++j) {
+    ++itr;
+  }
+  auto clone = itr++;
+  for (int j = 0; j < 500; ++j) {
+    ++itr;
+  }
+  EXPECT_EQ(clone->GetValue(&schema, 0).GetAs<int32_t>(), 10);
+  EXPECT_EQ(itr->GetValue(&schema, 0).GetAs<int32_t>(), 511);
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  delete table;
+  delete buffer_pool_manager;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(TupleTest, PageDirectoryTest) {
+  Schema schema{std::vector<Column>{Column{"a", TypeId::INTEGER}, Column{"b", TypeId::VARCHAR, 64}}};
+  auto *disk_manager = new DiskManager("test.db");
+  auto *buffer_pool_manager = new BufferPoolManagerInstance(10, disk_manager);
+  Transaction txn(0);
+  auto *table = new TableHeap(buffer_pool_manager, nullptr, nullptr, &txn);
+  EXPECT_EQ(table->GetPageIds(), std::vector<page_id_t>{table->GetFirstPageId()});
+
+  for (int i = 0; i < 1000; ++i) {
+    Tuple tuple{{ValueFactory::GetIntegerValue(i), ValueFactory::GetVarcharValue(std::string(50, 'x'))}, &schema};
+    RID rid;
+    ASSERT_TRUE(table->InsertTuple(tuple, &rid, &txn));
+  }
+
+  // The directory lists the page chain in order.
+  std::vector<page_id_t> chain;
+  for (auto page_id = table->GetFirstPageId(); page_id != INVALID_PAGE_ID; page_id = table->GetNextPageId(page_id)) {
+    chain.push_back(page_id);
+  }
+  EXPECT_GT(chain.size(), 10);
+  EXPECT_EQ(table->GetPageIds(), chain);
+
+  // A reopened heap reads its directory off the chain.
+  TableHeap reopened(buffer_pool_manager, nullptr, nullptr, table->GetFirstPageId());
+  EXPECT_EQ(reopened.GetPageIds(), chain);
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  delete table;
+  delete buffer_pool_manager;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(TupleTest, FreeSpaceMapTest) {
+  FreeSpaceMap map;
+  EXPECT_EQ(map.FindPage(100), INVALID_PAGE_ID);
+  for (page_id_t page_id = 0; page_id < 200; page_id++) {
+    map.AddPage(page_id, 50);
+  }
+  map.AddPage(200, 1024);
+  EXPECT_EQ(map.FindPage(10), 200);
+  EXPECT_EQ(map.FindPage(1024), 200);
+  EXPECT_EQ(map.FindPage(1025), INVALID_PAGE_ID);
+
+  // Once its target is full, a thread moves on to the next page with room, wrapping around.
+  map.Update(200, 0);
+  map.Update(7, 500);
+  map.Update(150, 500);
+  EXPECT_EQ(map.FindPage(400), 7);
+  map.Update(7, 0);
+  EXPECT_EQ(map.FindPage(400), 150);
+  map.Update(150, 4 * FreeSpaceMap::CATEGORY_BYTES + 1);
+  EXPECT_EQ(map.FindPage(400), INVALID_PAGE_ID);
+  // Free space is kept in whole units, so a page is only offered if the tuple surely fits.
+  EXPECT_EQ(map.FindPage(4 * FreeSpaceMap::CATEGORY_BYTES), 150);
+  EXPECT_EQ(map.FindPage(4 * FreeSpaceMap::CATEGORY_BYTES + 1), INVALID_PAGE_ID);
+}
+
+// NOLINTNEXTLINE
+TEST(TupleTest, FreeSpaceReuseTest) {
+  Schema schema{std::vector<Column>{Column{"a", TypeId::VARCHAR, 512}}};
+  auto *disk_manager = new DiskManager("test.db");
+  auto *buffer_pool_manager = new BufferPoolManagerInstance(10, disk_manager);
+  LockManager lock_manager;
+  Transaction txn(0);
+  auto *table = new TableHeap(buffer_pool_manager, &lock_manager, nullptr, &txn);
+
+  Tuple tuple{{ValueFactory::GetVarcharValue(std::string(500, 'x'))}, &schema};
+  std::vector<RID> rid_v;
+  for (int i = 0; i < 100; ++i) {
+    RID rid;
+    ASSERT_TRUE(table->InsertTuple(tuple, &rid, &txn));
+    rid_v.push_back(rid);
+  }
+  auto page_count = table->GetPageIds().size();
+
+  // Space freed in the first page is found again without appending pages.
+  auto first_page_id = table->GetFirstPageId();
+  for (const auto &rid : rid_v) {
+    if (rid.GetPageId() == first_page_id) {
+      ASSERT_TRUE(table->MarkDelete(rid, &txn));
+      table->ApplyDelete(rid, &txn);
+    }
+  }
+  // The last page may still have room; once it is full, inserts wrap around to the first page.
+  RID rid;
+  for (int i = 0; i < 16 && rid.GetPageId() != first_page_id; ++i) {
+    ASSERT_TRUE(table->InsertTuple(tuple, &rid, &txn));
+  }
+  EXPECT_EQ(rid.GetPageId(), first_page_id);
+  EXPECT_EQ(table->GetPageIds().size(), page_count);
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  delete table;
+  delete buffer_pool_manager;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(TupleTest, SnapshotReadTest) {
+  enable_mvcc = true;
+  Schema schema{std::vector<Column>{Column{"a", TypeId::INTEGER}, Column{"b", TypeId::VARCHAR, 32}}};
+  auto *disk_manager = new DiskManager("test.db");
+  auto *buffer_pool_manager = new BufferPoolManagerInstance(10, disk_manager);
+  LockManager lock_manager{DeadlockPolicy::WOUND_WAIT};
+  TransactionManager txn_mgr{&lock_manager};
+  auto make_tuple = [&](int value) {
+    return Tuple{{ValueFactory::GetIntegerValue(value), ValueFactory::GetVarcharValue(std::to_string(value))},
+                 &schema};
+  };
+
+  auto *writer = txn_mgr.Begin();
+  auto *table = new TableHeap(buffer_pool_manager, &lock_manager, nullptr, writer);
+  std::vector<RID> rid_v;
+  for (int i = 0; i < 10; ++i) {
+    RID rid;
+    ASSERT_TRUE(table->InsertTuple(make_tuple(i), &rid, writer));
+    rid_v.push_back(rid);
+  }
+  txn_mgr.Commit(writer);
+  delete writer;
+  auto scan = [&](Transaction *txn) {
+    std::vector<int> values;
+    for (auto itr = table->Begin(txn); itr != table->End(); ++itr) {
+      values.push_back(itr->GetValue(&schema, 0).GetAs<int32_t>());
+    }
+    return values;
+  };
+  const std::vector<int> before{0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+  auto *reader = txn_mgr.Begin(nullptr, IsolationLevel::SNAPSHOT_ISOLATION);
+  writer = txn_mgr.Begin();
+  ASSERT_TRUE(table->UpdateTuple(make_tuple(100), rid_v[0], writer));
+  ASSERT_TRUE(table->MarkDelete(rid_v[1], writer));
+  RID new_rid;
+  ASSERT_TRUE(table->InsertTuple(make_tuple(10), &new_rid, writer));
+  // The writer sees its own writes; the snapshot sees none of them, before or after the commit
+  EXPECT_EQ(scan(reader), before);
+  txn_mgr.Commit(writer);
+  delete writer;
+  EXPECT_EQ(scan(reader), before);
+  Tuple tuple;
+  ASSERT_TRUE(table->GetTuple(rid_v[0], &tuple, reader));
+  EXPECT_EQ(tuple.GetValue(&schema, 0).GetAs<int32_t>(), 0);
+  ASSERT_TRUE(table->GetTuple(rid_v[1], &tuple, reader));
+  EXPECT_EQ(tuple.GetValue(&schema, 1).ToString(), "1");
+  EXPECT_FALSE(table->GetTuple(new_rid, &tuple, reader));
+  EXPECT_EQ(reader->GetState(), TransactionState::GROWING);
+
+  // A new snapshot sees the commit
+  auto *later_reader = txn_mgr.Begin(nullptr, IsolationLevel::SNAPSHOT_ISOLATION);
+  EXPECT_EQ(scan(later_reader), (std::vector<int>{100, 2, 3, 4, 5, 6, 7, 8, 9, 10}));
+  txn_mgr.Commit(later_reader);
+  delete later_reader;
+
+  // The first snapshot may not overwrite the newer version it does not see
+  EXPECT_FALSE(table->UpdateTuple(make_tuple(200), rid_v[0], reader));
+  EXPECT_EQ(reader->GetState(), TransactionState::ABORTED);
+  txn_mgr.Abort(reader);
+  delete reader;
+
+  // An aborted write leaves no version behind
+  reader = txn_mgr.Begin(nullptr, IsolationLevel::SNAPSHOT_ISOLATION);
+  writer = txn_mgr.Begin();
+  ASSERT_TRUE(table->UpdateTuple(make_tuple(300), rid_v[2], writer));
+  ASSERT_TRUE(table->GetTuple(rid_v[2], &tuple, reader));
+  EXPECT_EQ(tuple.GetValue(&schema, 0).GetAs<int32_t>(), 2);
+  txn_mgr.Abort(writer);
+  delete writer;
+  txn_mgr.Commit(reader);
+  delete reader;
+
+  // Once no snapshot needs them, the next commit to the table drops the old versions
+  EXPECT_GT(table->GetVersionChainCount(), 0);
+  writer = txn_mgr.Begin();
+  ASSERT_TRUE(table->UpdateTuple(make_tuple(400), rid_v[3], writer));
+  txn_mgr.Commit(writer);
+  delete writer;
+  EXPECT_EQ(table->GetVersionChainCount(), 0);
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  delete table;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  enable_mvcc = false;
+}
+
+// NOLINTNEXTLINE
+TEST(TupleTest, SnapshotConsistencyTest) {
+  enable_mvcc = true;
+  Schema schema{std::vector<Column>{Column{"a", TypeId::INTEGER}}};
+  auto *disk_manager = new DiskManager("test.db");
+  auto *buffer_pool_manager = new BufferPoolManagerInstance(10, disk_manager);
+  LockManager lock_manager{DeadlockPolicy::WOUND_WAIT};
+  TransactionManager txn_mgr{&lock_manager};
+  auto make_tuple = [&](int value) { return Tuple{{ValueFactory::GetIntegerValue(value)}, &schema}; };
+
+  // Two accounts whose total the writer keeps at 100
+  auto *txn = txn_mgr.Begin();
+  auto *table = new TableHeap(buffer_pool_manager, &lock_manager, nullptr, txn);
+  RID first;
+  RID second;
+  ASSERT_TRUE(table->InsertTuple(make_tuple(100), &first, txn));
+  ASSERT_TRUE(table->InsertTuple(make_tuple(0), &second, txn));
+  txn_mgr.Commit(txn);
+  delete txn;
+
+  const int transfers = 500;
+  std::thread writer([&] {
+    for (int i = 1; i <= transfers; ++i) {
+      auto *txn = txn_mgr.Begin();
+      table->UpdateTuple(make_tuple(100 - i % 100), first, txn);
+      table->UpdateTuple(make_tuple(i % 100), second, txn);
+      txn_mgr.Commit(txn);
+      delete txn;
+    }
+  });
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 2; ++r) {
+    readers.emplace_back([&] {
+      for (int i = 0; i < transfers; ++i) {
+        auto *txn = txn_mgr.Begin(nullptr, IsolationLevel::SNAPSHOT_ISOLATION);
+        int total = 0;
+        for (auto itr = table->Begin(txn); itr != table->End(); ++itr) {
+          total += itr->GetValue(&schema, 0).GetAs<int32_t>();
+        }
+        EXPECT_EQ(total, 100);
+        txn_mgr.Commit(txn);
+        delete txn;
+      }
+    });
+  }
+  writer.join();
+  for (auto &reader : readers) {
+    reader.join();
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  delete table;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  enable_mvcc = false;
+}
+
 }  // namespace bustub